@@ -0,0 +1,434 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AIDriverSubsystem.h"
+
+#include "RacingEngineer.h"
+#include "MapManager.h"
+#include "TrackFollower.h"
+#include "WheeledVehiclePawn.h"
+#include "ChaosWheeledVehicleMovementComponent.h"
+#include "EngineUtils.h"
+#include "Kismet/GameplayStatics.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "Chaos/SimCallbackInput.h"
+#include "Chaos/SimCallbackObject.h"
+#include "PBDRigidsSolver.h"
+#include "PhysicsProxy/SingleParticlePhysicsProxy.h"
+
+namespace AIDriver
+{
+	constexpr float SteeringP = 1.0f;
+	constexpr float SteeringI = 0.2f;
+	constexpr float SteeringD = 0.05f;
+	constexpr float MaxSteeringIntegral = 0.5f;
+
+	// Only reached on tracks without a racing line, where nothing else limits the speed on a straight
+	constexpr float MaxSpeedCm = 5000.0f;
+
+	// Lane offsets and speed scales repeat every this many drivers, the scales are of FTrackFollower's profile
+	constexpr int32 VariationPeriod = 4;
+	constexpr float LaneOffsets[VariationPeriod] = { -80.0f, 80.0f, -40.0f, 40.0f };
+	constexpr float SpeedScales[VariationPeriod] = { 1.0f, 0.975f, 0.95f, 0.93f };
+
+	// Half the distance between the two grid columns
+	constexpr float GridColumnOffsetCm = 150.0f;
+
+	constexpr int32 MinSearchRadius = 8;
+}
+
+struct FAIDriverSimInput : public Chaos::FSimCallbackInput
+{
+	void Reset()
+	{
+		TrackFrames.Reset();
+		GridBatch.Reset();
+		ChassisProxies.Reset();
+		bDriving = false;
+	}
+
+	TSharedPtr<const FTrackFrameTable> TrackFrames;
+	TSharedPtr<const FAIDriverBatch> GridBatch;
+	uint32 DriversGeneration = 0;
+
+	// One per driver, null where the vehicle has no physics state
+	TArray<Chaos::FSingleParticlePhysicsProxy*> ChassisProxies;
+	FTransform MapTransform;
+
+	// Off while the map is being rebuilt
+	bool bDriving = false;
+};
+
+struct FAIDriverSimOutput : public Chaos::FSimCallbackOutput
+{
+	void Reset()
+	{
+		Steering.Reset();
+		Throttle.Reset();
+		Brake.Reset();
+	}
+
+	uint32 DriversGeneration = 0;
+
+	TArray<float> Steering;
+	TArray<float> Throttle;
+	TArray<float> Brake;
+};
+
+class FAIDriverSimCallback : public Chaos::TSimCallbackObject<FAIDriverSimInput, FAIDriverSimOutput>
+{
+	virtual void OnPreSimulate_Internal() override
+	{
+		SCOPE_CYCLE_COUNTER(STAT_RacingEngineer_AIDriversUpdate);
+
+		const FAIDriverSimInput* Input = GetConsumerInput_Internal();
+		if (Input == nullptr || !Input->bDriving || !Input->TrackFrames.IsValid() || Input->TrackFrames->IsEmpty() || !Input->GridBatch.IsValid())
+		{
+			return;
+		}
+
+		// New opponents or a new track, every driver starts over from the grid
+		if (Input->DriversGeneration != DriversGeneration)
+		{
+			Batch = *Input->GridBatch;
+			DriversGeneration = Input->DriversGeneration;
+		}
+
+		if (Batch.Num() != Input->ChassisProxies.Num())
+		{
+			return;
+		}
+
+		const float DeltaSeconds = GetDeltaTime_Internal();
+
+		GatherVehicles(*Input);
+		UpdateDrivers(*Input->TrackFrames, DeltaSeconds);
+
+		FAIDriverSimOutput& Output = GetProducerOutputData_Internal();
+		Output.DriversGeneration = DriversGeneration;
+		Output.Steering = Batch.Steering;
+		Output.Throttle = Batch.Throttle;
+		Output.Brake = Batch.Brake;
+	}
+
+	// The step's own chassis state, so every substep steers from where the car is
+	void GatherVehicles(const FAIDriverSimInput& Input)
+	{
+		for (int32 Index = 0; Index < Batch.Num(); Index++)
+		{
+			const Chaos::FSingleParticlePhysicsProxy* Proxy = Input.ChassisProxies[Index];
+			const Chaos::FRigidBodyHandle_Internal* Chassis = Proxy != nullptr ? Proxy->GetPhysicsThreadAPI() : nullptr;
+			if (Chassis == nullptr)
+			{
+				Batch.Speeds[Index] = 0.0f;
+				continue;
+			}
+
+			const FVector Forward = Chassis->R().GetForwardVector();
+
+			Batch.Locations[Index] = FVector2D(Input.MapTransform.InverseTransformPosition(Chassis->X()));
+			Batch.Forwards[Index] = FVector2D(Input.MapTransform.InverseTransformVectorNoScale(Forward)).GetSafeNormal();
+			Batch.Speeds[Index] = FVector::DotProduct(Chassis->V(), Forward);
+		}
+	}
+
+	void UpdateDrivers(const FTrackFrameTable& TrackFrames, float DeltaSeconds)
+	{
+		const float SafeDeltaSeconds = FMath::Max(DeltaSeconds, UE_KINDA_SMALL_NUMBER);
+
+		for (int32 Index = 0; Index < Batch.Num(); Index++)
+		{
+			const FVector Location(Batch.Locations[Index], 0.0f);
+			const float Speed = FMath::Max(Batch.Speeds[Index], 0.0f);
+
+			// No car moves more than a few samples per step, which keeps the search and so the cost per car flat
+			const int32 SearchRadius = FMath::Max(AIDriver::MinSearchRadius,
+				FMath::CeilToInt32(2.0f * Speed * SafeDeltaSeconds / TrackFrames.SampleSpacing));
+			const int32 ClosestSample = TrackFrames.FindClosestIndex(Location, Batch.ClosestSamples[Index], SearchRadius);
+			const float Distance = ClosestSample * TrackFrames.SampleSpacing;
+
+			Batch.ClosestSamples[Index] = ClosestSample;
+			Batch.TrackDistances[Index] = Distance;
+			Batch.LateralOffsets[Index] = FVector2D::DotProduct(FVector2D(Location - TrackFrames.Locations[ClosestSample]),
+				FVector2D(TrackFrames.GetRightVectorAtIndex(ClosestSample)));
+
+			const FVector2D PursuitPoint = FTrackFollower::GetPursuitPoint(TrackFrames, Distance, Speed, Batch.LaneOffsets[Index]);
+			const float Error = FTrackFollower::GetHeadingError(Batch.Locations[Index], Batch.Forwards[Index], PursuitPoint);
+
+			Batch.SteeringIntegrals[Index] = FMath::Clamp(Batch.SteeringIntegrals[Index] + Error * SafeDeltaSeconds,
+				-AIDriver::MaxSteeringIntegral, AIDriver::MaxSteeringIntegral);
+			const float ErrorRate = (Error - Batch.SteeringErrors[Index]) / SafeDeltaSeconds;
+			Batch.SteeringErrors[Index] = Error;
+
+			const float SteeringAngle = AIDriver::SteeringP * Error + AIDriver::SteeringI * Batch.SteeringIntegrals[Index] + AIDriver::SteeringD * ErrorRate;
+			Batch.Steering[Index] = FTrackFollower::GetSteeringInput(SteeringAngle);
+
+			Batch.TargetSpeeds[Index] = FTrackFollower::GetProfileSpeed(TrackFrames, Distance, Speed, AIDriver::MaxSpeedCm) * Batch.SpeedScales[Index];
+			FTrackFollower::GetPedalInputs(Batch.TargetSpeeds[Index], Batch.Speeds[Index], Batch.Throttle[Index], Batch.Brake[Index]);
+		}
+	}
+
+	FAIDriverBatch Batch;
+	uint32 DriversGeneration = 0;
+};
+
+#pragma region AIDriverBatch
+
+void FAIDriverBatch::Reset()
+{
+	Locations.Reset();
+	Forwards.Reset();
+	Speeds.Reset();
+	ClosestSamples.Reset();
+	TrackDistances.Reset();
+	LateralOffsets.Reset();
+	TargetSpeeds.Reset();
+	LaneOffsets.Reset();
+	SpeedScales.Reset();
+	SteeringErrors.Reset();
+	SteeringIntegrals.Reset();
+	Steering.Reset();
+	Throttle.Reset();
+	Brake.Reset();
+}
+
+void FAIDriverBatch::Add(float TrackDistance, float LaneOffset, float SpeedScale)
+{
+	Locations.AddZeroed();
+	Forwards.AddZeroed();
+	Speeds.AddZeroed();
+	ClosestSamples.Add(INDEX_NONE);
+	TrackDistances.Add(TrackDistance);
+	LateralOffsets.AddZeroed();
+	TargetSpeeds.AddZeroed();
+	LaneOffsets.Add(LaneOffset);
+	SpeedScales.Add(SpeedScale);
+	SteeringErrors.AddZeroed();
+	SteeringIntegrals.AddZeroed();
+	Steering.AddZeroed();
+	Throttle.AddZeroed();
+	Brake.AddZeroed();
+}
+
+#pragma endregion
+
+bool UAIDriverSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	if (World == nullptr || !World->IsGameWorld() || !Super::ShouldCreateSubsystem(Outer))
+	{
+		return false;
+	}
+
+	int32 Count = OpponentCount;
+	FParse::Value(FCommandLine::Get(), TEXT("Opponents="), Count);
+
+	return Count > 0;
+}
+
+void UAIDriverSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	FParse::Value(FCommandLine::Get(), TEXT("Opponents="), OpponentCount);
+
+	TActorIterator<AMapManager> MapManagerIterator(&InWorld);
+	MapManager = MapManagerIterator ? *MapManagerIterator : nullptr;
+
+	if (!MapManager.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("UAIDriverSubsystem::OnWorldBeginPlay World has no map manager, no opponents are spawned"));
+		return;
+	}
+
+	BoundPhysScene = InWorld.GetPhysicsScene();
+	if (BoundPhysScene != nullptr)
+	{
+		// Runs for every step the solver takes, substeps included
+		SimCallback = BoundPhysScene->GetSolver()->CreateAndRegisterSimCallbackObject_External<FAIDriverSimCallback>();
+		PhysScenePreTickHandle = BoundPhysScene->OnPhysScenePreTick.AddUObject(this, &UAIDriverSubsystem::OnPhysScenePreTick);
+	}
+}
+
+void UAIDriverSubsystem::Deinitialize()
+{
+	if (BoundPhysScene != nullptr)
+	{
+		BoundPhysScene->OnPhysScenePreTick.Remove(PhysScenePreTickHandle);
+
+		if (SimCallback != nullptr)
+		{
+			BoundPhysScene->GetSolver()->UnregisterAndFreeSimCallbackObject_External(SimCallback);
+			SimCallback = nullptr;
+		}
+
+		BoundPhysScene = nullptr;
+	}
+
+	Movements.Reset();
+	GridBatch.Reset();
+	TrackFrames.Reset();
+	Opponents.Reset();
+
+	Super::Deinitialize();
+}
+
+TStatId UAIDriverSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UAIDriverSubsystem, STATGROUP_Tickables);
+}
+
+void UAIDriverSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!MapManager.IsValid() || MapManager->IsBuildingMap())
+	{
+		return;
+	}
+
+	const FTrackFrameTable& MapTrackFrames = MapManager->GetTrackFrames();
+	if (MapTrackFrames.IsEmpty())
+	{
+		return;
+	}
+
+	// Another track can have the same sample count and length, only the generation tells them apart
+	const bool bTrackChanged = MapManager->GetBuildGeneration() != TrackBuildGeneration;
+	if (bTrackChanged || Opponents.Num() < OpponentCount)
+	{
+		TrackFrames = MakeShared<const FTrackFrameTable>(MapTrackFrames);
+		TrackBuildGeneration = MapManager->GetBuildGeneration();
+		SpawnOpponents();
+	}
+}
+
+void UAIDriverSubsystem::SpawnOpponents()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UAIDriverSubsystem::SpawnOpponents);
+
+	UWorld* World = GetWorld();
+
+	UClass* VehicleClass = OpponentClass.LoadSynchronous();
+	if (VehicleClass == nullptr)
+	{
+		const APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(this, 0);
+		VehicleClass = PlayerPawn != nullptr && PlayerPawn->IsA<AWheeledVehiclePawn>() ? PlayerPawn->GetClass() : nullptr;
+	}
+
+	if (VehicleClass == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("UAIDriverSubsystem::SpawnOpponents No OpponentClass and the player pawn isn't a vehicle"));
+		OpponentCount = Opponents.Num();
+		return;
+	}
+
+	Opponents.RemoveAll([](const AWheeledVehiclePawn* Opponent) { return !IsValid(Opponent); });
+	Movements.Reset();
+
+	TSharedRef<FAIDriverBatch> Batch = MakeShared<FAIDriverBatch>();
+
+	const FTransform MapTransform = MapManager->GetActorTransform();
+
+	for (int32 OpponentIndex = 0; OpponentIndex < OpponentCount; OpponentIndex++)
+	{
+		// Two columns, the player starts at distance 0 so the grid is behind it
+		const int32 Variation = OpponentIndex % AIDriver::VariationPeriod;
+		const float Distance = TrackFrames->WrapDistance(-(OpponentIndex / 2 + 1) * GridSpacing);
+		const float ColumnOffset = OpponentIndex % 2 == 0 ? -AIDriver::GridColumnOffsetCm : AIDriver::GridColumnOffsetCm;
+
+		const FVector Direction = TrackFrames->GetDirectionAtDistance(Distance);
+		const FVector Right = FVector::CrossProduct(FVector::UpVector, Direction).GetSafeNormal();
+		const FVector GridLocation = TrackFrames->GetLocationAtDistance(Distance) + Right * ColumnOffset;
+
+		const FVector Location = MapTransform.TransformPosition(GridLocation) + FVector(0.0f, 0.0f, 50.0f);
+		const FRotator Rotation(0.0f, MapTransform.TransformVectorNoScale(Direction).Rotation().Yaw, 0.0f);
+
+		AWheeledVehiclePawn* Opponent = Opponents.IsValidIndex(OpponentIndex) ? Opponents[OpponentIndex].Get() : nullptr;
+		if (Opponent == nullptr)
+		{
+			FActorSpawnParameters SpawnParameters;
+			SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+			Opponent = World->SpawnActor<AWheeledVehiclePawn>(VehicleClass, Location, Rotation, SpawnParameters);
+			if (Opponent == nullptr)
+			{
+				UE_LOG(LogTemp, Error, TEXT("UAIDriverSubsystem::SpawnOpponents Failed to spawn opponent %d"), OpponentIndex);
+				continue;
+			}
+
+			// The movement component only reads its inputs on locally controlled pawns
+			Opponent->SpawnDefaultController();
+			Opponents.Add(Opponent);
+		}
+		else
+		{
+			Opponent->SetActorTransform(FTransform(Rotation, Location, FVector::OneVector), false, nullptr, ETeleportType::TeleportPhysics);
+			Opponent->GetMesh()->SetPhysicsLinearVelocity(FVector::ZeroVector);
+			Opponent->GetMesh()->SetPhysicsAngularVelocityInDegrees(FVector::ZeroVector);
+		}
+
+		UChaosWheeledVehicleMovementComponent* Movement = Cast<UChaosWheeledVehicleMovementComponent>(Opponent->GetVehicleMovementComponent());
+		if (Movement != nullptr)
+		{
+			Movements.Add(Movement);
+			Batch->Add(Distance, AIDriver::LaneOffsets[Variation], AIDriver::SpeedScales[Variation]);
+		}
+	}
+
+	// Failed spawns aren't retried every frame
+	OpponentCount = Opponents.Num();
+
+	GridBatch = Batch;
+	DriversGeneration++;
+
+	SET_DWORD_STAT(STAT_RacingEngineer_AIDrivers, Batch->Num());
+}
+
+void UAIDriverSubsystem::OnPhysScenePreTick(FPhysScene_Chaos* PhysScene, float DeltaSeconds)
+{
+	if (SimCallback == nullptr)
+	{
+		return;
+	}
+
+	// In step order, so the inputs of the last step are the ones left on the vehicles
+	while (Chaos::TSimCallbackOutputHandle<FAIDriverSimOutput> Output = SimCallback->PopOutputData_External())
+	{
+		if (Output->DriversGeneration == DriversGeneration)
+		{
+			ApplyInputs(*Output);
+		}
+	}
+
+	FAIDriverSimInput* Input = SimCallback->GetProducerInputData_External();
+	Input->TrackFrames = TrackFrames;
+	Input->GridBatch = GridBatch;
+	Input->DriversGeneration = DriversGeneration;
+	Input->bDriving = GridBatch.IsValid() && GridBatch->Num() > 0 && MapManager.IsValid() && !MapManager->IsBuildingMap();
+	Input->MapTransform = MapManager.IsValid() ? MapManager->GetActorTransform() : FTransform::Identity;
+
+	Input->ChassisProxies.Reset(Movements.Num());
+	for (const TWeakObjectPtr<UChaosWheeledVehicleMovementComponent>& Movement : Movements)
+	{
+		const AWheeledVehiclePawn* Vehicle = Movement.IsValid() ? Cast<AWheeledVehiclePawn>(Movement->GetOwner()) : nullptr;
+		const FBodyInstance* ChassisBody = Vehicle != nullptr && Vehicle->GetMesh() != nullptr ? Vehicle->GetMesh()->GetBodyInstance() : nullptr;
+		Input->ChassisProxies.Add(ChassisBody != nullptr ? ChassisBody->GetPhysicsActorHandle() : nullptr);
+	}
+}
+
+void UAIDriverSubsystem::ApplyInputs(const FAIDriverSimOutput& Output)
+{
+	const int32 DriversNum = FMath::Min(Movements.Num(), Output.Steering.Num());
+
+	for (int32 Index = 0; Index < DriversNum; Index++)
+	{
+		UChaosWheeledVehicleMovementComponent* Movement = Movements[Index].Get();
+		if (Movement != nullptr)
+		{
+			Movement->SetSteeringInput(Output.Steering[Index]);
+			Movement->SetThrottleInput(Output.Throttle[Index]);
+			Movement->SetBrakeInput(Output.Brake[Index]);
+		}
+	}
+}
@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MapBuildPipeline.h"
+#include "AIDriverSubsystem.generated.h"
+
+class AMapManager;
+class AWheeledVehiclePawn;
+class UChaosWheeledVehicleMovementComponent;
+class FPhysScene_Chaos;
+class FAIDriverSimCallback;
+struct FAIDriverSimOutput;
+
+/**
+ *  State of every AI driver, one entry per car in each array so a pass over the batch only touches what it needs.
+ *  Owned by the physics thread once the drivers are on the grid.
+ */
+struct FAIDriverBatch
+{
+	int32 Num() const { return LaneOffsets.Num(); }
+
+	void Reset();
+	void Add(float TrackDistance, float LaneOffset, float SpeedScale);
+
+	// Read from the chassis every physics step, in map space
+	TArray<FVector2D> Locations;
+	TArray<FVector2D> Forwards;
+	TArray<float> Speeds;
+
+	TArray<int32> ClosestSamples;
+	TArray<float> TrackDistances;
+	TArray<float> LateralOffsets;
+	TArray<float> TargetSpeeds;
+
+	// Per driver variation, the offset from the racing line it keeps and the share of the speed profile it drives at
+	TArray<float> LaneOffsets;
+	TArray<float> SpeedScales;
+
+	// Steering PID on the heading error to the pursuit point
+	TArray<float> SteeringErrors;
+	TArray<float> SteeringIntegrals;
+
+	TArray<float> Steering;
+	TArray<float> Throttle;
+	TArray<float> Brake;
+};
+
+/**
+ *  Spawns opponent vehicles on a grid behind the start line and drives all of them in one batch on every physics step.
+ *  They follow the racing line of the map manager's FTrackFrameTable with FTrackFollower, so lookahead is a table lookup instead of a spline query.
+ *  Chaos vehicles take their inputs from the game thread, so the inputs of the last step are applied before the next frame's physics.
+ *  Off unless OpponentCount is set in the config or with -Opponents=<count>.
+ */
+UCLASS(Config = Game)
+class RACINGENGINEER_API UAIDriverSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	// Begin FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	// End FTickableGameObject interface
+
+	UFUNCTION(BlueprintCallable, Category = "AI Drivers")
+	int32 GetOpponentCount() const { return Opponents.Num(); }
+
+private:
+	// Spawns the missing opponents once the map has a track and puts all of them back on the grid
+	void SpawnOpponents();
+
+	// Applies the inputs of the last physics step and hands the vehicles to the steps that follow
+	void OnPhysScenePreTick(FPhysScene_Chaos* PhysScene, float DeltaSeconds);
+
+	void ApplyInputs(const FAIDriverSimOutput& Output);
+
+	UPROPERTY(Config)
+	int32 OpponentCount = 0;
+
+	// Falls back to the class of the player's pawn
+	UPROPERTY(Config)
+	TSoftClassPtr<AWheeledVehiclePawn> OpponentClass;
+
+	// Distance between grid rows along the track
+	UPROPERTY(Config)
+	float GridSpacing = 1200.0f;
+
+	UPROPERTY()
+	TArray<TObjectPtr<AWheeledVehiclePawn>> Opponents;
+
+	// One per driver of GridBatch
+	TArray<TWeakObjectPtr<UChaosWheeledVehicleMovementComponent>> Movements;
+
+	TWeakObjectPtr<AMapManager> MapManager;
+
+	// Copied when the opponents are put on the grid and shared with the physics thread, a rebuilt map puts them back on the new one
+	TSharedPtr<const FTrackFrameTable> TrackFrames;
+	uint32 TrackBuildGeneration = 0;
+
+	// Drivers as they start from the grid, the physics thread starts over from it whenever DriversGeneration changes
+	TSharedPtr<const FAIDriverBatch> GridBatch;
+	uint32 DriversGeneration = 0;
+
+	FAIDriverSimCallback* SimCallback = nullptr;
+
+	FPhysScene_Chaos* BoundPhysScene = nullptr;
+	FDelegateHandle PhysScenePreTickHandle;
+};
@@ -3,8 +3,10 @@
 
 #include "CheckpointGenerator.h"
 
+#include "RacingEngineer.h"
 #include "TrackCheckpoint.h"
 #include "Async/Async.h"
+#include "LapHistorySubsystem.h"
 
 ACheckpointGenerator::ACheckpointGenerator()
 {
@@ -23,6 +25,9 @@ void ACheckpointGenerator::Tick(float DeltaTime)
 
 void ACheckpointGenerator::DoWork(const FWorkerData& Data, const FOnWorkFinished Callback)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(ACheckpointGenerator::DoWork);
+	LLM_SCOPE_BYTAG(RacingEngineer_Checkpoints);
+
 	//SpawnedTrackCheckpoints = SpawnCheckpointsAlongSpline(Data.TrackSpline);
 	
 	PrepareCheckpointData(Data.TrackSpline, DistanceBetweenCheckpoints);
@@ -35,9 +40,44 @@ void ACheckpointGenerator::DoWork(const FWorkerData& Data, const FOnWorkFinished
 
 }
 
+void ACheckpointGenerator::ResetWork()
+{
+	bTimerStarted = false;
+	TargetCheckpointIndex = UINT16_MAX;
+	UpdateTimer(0.0f);
+	SectorSplits.Empty();
+
+	CheckpointSpawnData.Empty();
+	CheckpointSpawned = 0;
+	ActiveCheckpointsNum = 0;
+
+	for (const TWeakObjectPtr<ATrackCheckpoint>& Checkpoint : SpawnedTrackCheckpoints)
+	{
+		if (Checkpoint.IsValid())
+		{
+			SetCheckpointActive(Checkpoint.Get(), false);
+		}
+	}
+}
+
+FWorkerMemoryUsage ACheckpointGenerator::GetRetainedMemory() const
+{
+	FWorkerMemoryUsage Usage;
+	Usage.BuildBuffers = CheckpointSpawnData.GetAllocatedSize() + SpawnedTrackCheckpoints.GetAllocatedSize()
+		+ SectorSplits.GetAllocatedSize();
+
+	return Usage;
+}
+
+void ACheckpointGenerator::SetCheckpointActive(ATrackCheckpoint* Checkpoint, bool bActive)
+{
+	Checkpoint->SetActorHiddenInGame(!bActive);
+	Checkpoint->SetActorEnableCollision(bActive);
+}
+
 void ACheckpointGenerator::StartTimer()
 {
-	if (SpawnedTrackCheckpoints.Num() > 1)
+	if (ActiveCheckpointsNum > 1)
 	{
 		if (SpawnedTrackCheckpoints[1].IsValid())
 		{
@@ -45,6 +85,12 @@ void ACheckpointGenerator::StartTimer()
 			TargetCheckpointIndex = 1;
 
 			UpdateTimer(0.0f);
+			SectorSplits.Empty();
+
+			if (ULapHistorySubsystem* LapHistory = GetGameInstance()->GetSubsystem<ULapHistorySubsystem>())
+			{
+				LapHistory->BeginSession();
+			}
 
 			bTimerStarted = true;
 		}
@@ -89,11 +135,32 @@ void ACheckpointGenerator::PrepareCheckpointData(const USplineComponent* TrackSp
 void ACheckpointGenerator::SpawnCheckpointsBasedOnPreparedData(TArray<FCheckpointSpawnData>& CheckpointsData,
 	FOnWorkFinished Callback)
 {
+	INC_DWORD_STAT_BY(STAT_RacingEngineer_SpawnQueueDepth, CheckpointsData.Num());
+
 	SpawnBatchCheckpointTimer.BindLambda([this, &CheckpointsData, Callback]
 		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(ACheckpointGenerator::SpawnBatch);
+			LLM_SCOPE_BYTAG(RacingEngineer_Checkpoints);
+
+			const int32 BatchStart = CheckpointSpawned;
+
 			for (int32 i = 0; i < BatchSize && CheckpointSpawned < CheckpointsData.Num(); i++, CheckpointSpawned++)
 			{
 				const FCheckpointSpawnData& CheckpointData = CheckpointsData[CheckpointSpawned];
+
+				// Checkpoints left over from a previous build are moved instead of spawning new ones
+				ATrackCheckpoint* PooledCheckpoint = SpawnedTrackCheckpoints.IsValidIndex(CheckpointSpawned)
+					? SpawnedTrackCheckpoints[CheckpointSpawned].Get() : nullptr;
+
+				if (PooledCheckpoint != nullptr)
+				{
+					PooledCheckpoint->SetActorLocationAndRotation(CheckpointData.Location, CheckpointData.Rotation,
+						false, nullptr, ETeleportType::TeleportPhysics);
+					PooledCheckpoint->SetMaterialToBasic();
+					SetCheckpointActive(PooledCheckpoint, true);
+					continue;
+				}
+
 				ATrackCheckpoint* Checkpoint = GetWorld()->SpawnActor<ATrackCheckpoint>(TrackCheckpointClass, CheckpointData.Location, CheckpointData.Rotation);
 				if (Checkpoint != nullptr)
 				{
@@ -101,15 +168,19 @@ void ACheckpointGenerator::SpawnCheckpointsBasedOnPreparedData(TArray<FCheckpoin
 					Checkpoint->OnPawnOverlappedWTrackCheckpoint.AddUObject(this, &ACheckpointGenerator::OnCheckpointOverlapped);
 					Checkpoint->AttachToComponent(GetRootComponent(), FAttachmentTransformRules::KeepWorldTransform,
 						*FString::Printf(TEXT("TrackCheckpoint%d"), CheckpointSpawned));
-
-					SpawnedTrackCheckpoints.Emplace(Checkpoint);
 				}
 				else
 				{
 					UE_LOG(LogTemp, Error, TEXT("ACheckpointGenerator::SpawnCheckpointsBasedOnPreparedData Failed to spawn checkpoint"));
 				}
+
+				// Keeps indices in the pool aligned with checkpoint indices even if spawning failed
+				SpawnedTrackCheckpoints.SetNum(CheckpointSpawned + 1);
+				SpawnedTrackCheckpoints[CheckpointSpawned] = Checkpoint;
 			}
 
+			DEC_DWORD_STAT_BY(STAT_RacingEngineer_SpawnQueueDepth, CheckpointSpawned - BatchStart);
+
 			if (CheckpointSpawned < CheckpointsData.Num())
 			{
 				GetWorld()->GetTimerManager().SetTimerForNextTick(SpawnBatchCheckpointTimer);
@@ -117,6 +188,8 @@ void ACheckpointGenerator::SpawnCheckpointsBasedOnPreparedData(TArray<FCheckpoin
 
 			if (CheckpointSpawned == CheckpointsData.Num())
 			{
+				ActiveCheckpointsNum = CheckpointSpawned;
+				SET_DWORD_STAT(STAT_RacingEngineer_Checkpoints, ActiveCheckpointsNum);
 				CheckpointsData.Empty();
 
 				if (Callback.IsBound())
@@ -181,7 +254,7 @@ void ACheckpointGenerator::OnCheckpointOverlapped(uint16 CheckpointIndex)
 			OverlappedCheckpoint->SetMaterialToBasic();
 		}
 
-		TargetCheckpointIndex = (TargetCheckpointIndex + 1) % SpawnedTrackCheckpoints.Num();
+		TargetCheckpointIndex = (TargetCheckpointIndex + 1) % ActiveCheckpointsNum;
 
 		if (CheckpointIndex == 0)
 		{
@@ -190,7 +263,17 @@ void ACheckpointGenerator::OnCheckpointOverlapped(uint16 CheckpointIndex)
 				OnLapFinishedEvent.Broadcast(LapTime);
 			}
 
+			if (ULapHistorySubsystem* LapHistory = GetGameInstance()->GetSubsystem<ULapHistorySubsystem>())
+			{
+				LapHistory->RecordLap(LapTime, SectorSplits);
+			}
+
 			UpdateTimer(0.0f);
+			SectorSplits.Reset();
+		}
+		else if (IsSectorEnd(CheckpointIndex))
+		{
+			SectorSplits.Emplace(LapTime);
 		}
 
 		const ATrackCheckpoint* TargetCheckpoint = SpawnedTrackCheckpoints[TargetCheckpointIndex].Get();
@@ -199,4 +282,12 @@ void ACheckpointGenerator::OnCheckpointOverlapped(uint16 CheckpointIndex)
 			TargetCheckpoint->SetMaterialToTarget();
 		}
 	}
-}
\ No newline at end of file
+}
+
+bool ACheckpointGenerator::IsSectorEnd(uint16 CheckpointIndex) const
+{
+	const int32 CheckpointsPerSector = FMath::Max(1, ActiveCheckpointsNum / FMath::Max(1, SectorsNum));
+
+	// The last sector ends on the finish line, which is the lap and not a split
+	return CheckpointIndex % CheckpointsPerSector == 0 && CheckpointIndex / CheckpointsPerSector < SectorsNum;
+}
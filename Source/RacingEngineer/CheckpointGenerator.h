@@ -32,6 +32,8 @@ public:
 	virtual void Tick(float DeltaTime) override;
 
 	virtual void DoWork(const FWorkerData& Data, const FOnWorkFinished Callback) override;
+	virtual void ResetWork() override;
+	virtual FWorkerMemoryUsage GetRetainedMemory() const override;
 
 	UFUNCTION(BlueprintCallable)
 	void StartTimer();
@@ -47,8 +49,12 @@ private:
 
 	void OnCheckpointOverlapped(uint16 CheckpointIndex);
 
+	static void SetCheckpointActive(ATrackCheckpoint* Checkpoint, bool bActive);
+
 	void UpdateTimer(float DeltaTime);
 
+	bool IsSectorEnd(uint16 CheckpointIndex) const;
+
 	void PrepareCheckpointData(const USplineComponent* TrackSpline, float CheckpointDistance);
 	void SpawnCheckpointsBasedOnPreparedData(TArray<FCheckpointSpawnData>& CheckpointsData, FOnWorkFinished Callback);
 
@@ -59,15 +65,24 @@ private:
 	UPROPERTY(EditAnywhere)
 	float DistanceBetweenCheckpoints = 200.0f;
 
+	// Pool of every checkpoint spawned so far, only the first ActiveCheckpointsNum belong to the current track
 	UPROPERTY(VisibleAnywhere)
 	TArray<TWeakObjectPtr<ATrackCheckpoint>> SpawnedTrackCheckpoints;
 
+	int32 ActiveCheckpointsNum = 0;
+
 	UPROPERTY(VisibleAnywhere)
 	bool bTimerStarted = false;
 
 	UPROPERTY()
 	float LapTime = 0.0f;
 
+	// Checkpoints are split evenly into sectors, the lap history stores the time at the end of each of them
+	UPROPERTY(EditAnywhere)
+	int32 SectorsNum = 3;
+
+	TArray<float> SectorSplits;
+
 	uint16 TargetCheckpointIndex = UINT16_MAX;
 
 	UPROPERTY(EditAnywhere)
@@ -0,0 +1,540 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DriveBenchmarkSubsystem.h"
+
+#include "MapManager.h"
+#include "RacingEngineerPawn.h"
+#include "RacingEngineerGameInstance.h"
+#include "TrackFollower.h"
+#include "WorkerActor.h"
+#include "ChaosWheeledVehicleMovementComponent.h"
+#include "Dom/JsonObject.h"
+#include "EngineUtils.h"
+#include "HAL/PlatformMemory.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/FileHelper.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "RenderCore.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+namespace DriveBenchmark
+{
+	constexpr float CmPerSecondToKmh = 0.036f;
+
+	constexpr int32 MinSearchRadius = 8;
+
+	// FPlatformMemory::GetStats reads the process status from the OS, far too slow for every frame of a timed run
+	constexpr double MemorySampleSeconds = 0.25;
+
+	// Waits for the level's own InitializeMap, which runs in BeginPlay, before building over it
+	constexpr int32 LevelSettleFrames = 2;
+
+	float Percentile(TArray<float> Values, float Fraction)
+	{
+		if (Values.IsEmpty())
+		{
+			return 0.0f;
+		}
+
+		Values.Sort();
+		const int32 Index = FMath::Clamp(FMath::FloorToInt32(Fraction * (Values.Num() - 1) + 0.5f), 0, Values.Num() - 1);
+		return Values[Index];
+	}
+}
+
+bool UDriveBenchmarkSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return FParse::Param(FCommandLine::Get(), TEXT("DriveBenchmark")) && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UDriveBenchmarkSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+
+	FParse::Value(CommandLine, TEXT("Image="), ImagePath);
+	FParse::Value(CommandLine, TEXT("Seed="), Seed);
+	FParse::Value(CommandLine, TEXT("Laps="), Laps);
+	FParse::Value(CommandLine, TEXT("TargetSpeed="), TargetSpeedKmh);
+	FParse::Value(CommandLine, TEXT("MaxSeconds="), MaxSeconds);
+	FParse::Value(CommandLine, TEXT("HitchMs="), HitchMs);
+	FParse::Value(CommandLine, TEXT("Grass="), GrassProbability);
+	FParse::Value(CommandLine, TEXT("Rocks="), RocksProbability);
+	FParse::Value(CommandLine, TEXT("Trees="), TreesProbability);
+	FParse::Value(CommandLine, TEXT("SkipWorkers="), SkipWorkers, false);
+	bLightWeightMode = FParse::Param(CommandLine, TEXT("LightWeight"));
+	Laps = FMath::Max(1, Laps);
+
+	if (!FParse::Value(CommandLine, TEXT("Output="), OutputPath))
+	{
+		OutputPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Benchmarks"),
+			FString::Printf(TEXT("Drive_%s_%d.csv"), *FPaths::GetBaseFilename(ImagePath), Seed));
+	}
+
+	// MakeBuildSettings takes the light weight mode from the game instance
+	if (URacingEngineerGameInstance* RacingEngineerGameInstance = Cast<URacingEngineerGameInstance>(GetGameInstance()))
+	{
+		RacingEngineerGameInstance->bLightWeightMode = bLightWeightMode;
+	}
+
+	RunStartSeconds = FPlatformTime::Seconds();
+	Frames.Reserve(FMath::CeilToInt32(MaxSeconds) * 60);
+
+	if (ImagePath.IsEmpty() || !FPaths::FileExists(ImagePath))
+	{
+		Finish(false, FString::Printf(TEXT("Image '%s' doesn't exist"), *ImagePath));
+		return;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("UDriveBenchmarkSubsystem Driving %d lap(s) of %s with seed %d"), Laps, *ImagePath, Seed);
+}
+
+void UDriveBenchmarkSubsystem::Deinitialize()
+{
+	UnbindPhysicsScene();
+
+	if (State != EState::Finished)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("UDriveBenchmarkSubsystem The game shut down before the benchmark finished"));
+		State = EState::Finished;
+	}
+
+	Super::Deinitialize();
+}
+
+TStatId UDriveBenchmarkSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UDriveBenchmarkSubsystem, STATGROUP_Tickables);
+}
+
+void UDriveBenchmarkSubsystem::Tick(float DeltaTime)
+{
+	const UWorld* World = GetGameInstance()->GetWorld();
+	if (World == nullptr || !World->HasBegunPlay())
+	{
+		return;
+	}
+
+	if (FPlatformTime::Seconds() - RunStartSeconds > MaxSeconds)
+	{
+		Finish(false, FString::Printf(TEXT("Timed out after %.0fs"), MaxSeconds));
+		return;
+	}
+
+	++StateFrames;
+
+	if (State != EState::WaitingForLevel && (!IsValid(MapManager) || !IsValid(Pawn)))
+	{
+		Finish(false, TEXT("The map manager or the pawn was destroyed"));
+		return;
+	}
+
+	switch (State)
+	{
+	case EState::WaitingForLevel:
+		if (StateFrames > DriveBenchmark::LevelSettleFrames && FindLevelActors() && !MapManager->IsBuildingMap())
+		{
+			if (StartMapBuild())
+			{
+				SetState(EState::BuildingMap);
+			}
+			else
+			{
+				Finish(false, TEXT("Map build failed"));
+			}
+		}
+		break;
+
+	case EState::BuildingMap:
+		// The map manager moves the player to the start line once all workers are done
+		if (!MapManager->IsBuildingMap())
+		{
+			BindPhysicsScene();
+			SetState(EState::Settling);
+		}
+		break;
+
+	case EState::Settling:
+		Pawn->GetChaosVehicleMovement()->SetBrakeInput(1.0f);
+
+		if (StateFrames >= SettleFrames)
+		{
+			const FVector MapLocation = MapManager->GetActorTransform().InverseTransformPosition(Pawn->GetActorLocation());
+			ClosestSample = TrackFrames.FindClosestIndex(MapLocation, INDEX_NONE, TrackFrames.Num());
+			LastSampleDistance = ClosestSample * TrackFrames.SampleSpacing;
+			TravelledDistance = 0.0f;
+			StuckSeconds = 0.0f;
+			DriveStartSeconds = FPlatformTime::Seconds();
+			LastTickSeconds = DriveStartSeconds;
+			LastMemorySampleSeconds = DriveStartSeconds;
+			UsedPhysicalMB = static_cast<float>(FPlatformMemory::GetStats().UsedPhysical / (1024.0 * 1024.0));
+
+			Pawn->GetChaosVehicleMovement()->SetBrakeInput(0.0f);
+			SetState(EState::Driving);
+		}
+		break;
+
+	case EState::Driving:
+		TickDriving(DeltaTime);
+		break;
+
+	case EState::Finished:
+		break;
+	}
+}
+
+void UDriveBenchmarkSubsystem::SetState(EState NewState)
+{
+	State = NewState;
+	StateFrames = 0;
+}
+
+bool UDriveBenchmarkSubsystem::FindLevelActors()
+{
+	UWorld* World = GetGameInstance()->GetWorld();
+
+	if (MapManager == nullptr)
+	{
+		TActorIterator<AMapManager> MapManagerIterator(World);
+		MapManager = MapManagerIterator ? *MapManagerIterator : nullptr;
+	}
+
+	if (Pawn == nullptr)
+	{
+		Pawn = Cast<ARacingEngineerPawn>(UGameplayStatics::GetPlayerPawn(World, 0));
+	}
+
+	return MapManager != nullptr && Pawn != nullptr && Pawn->GetChaosVehicleMovement() != nullptr;
+}
+
+bool UDriveBenchmarkSubsystem::StartMapBuild()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UDriveBenchmarkSubsystem::StartMapBuild);
+
+	const double BuildStartSeconds = FPlatformTime::Seconds();
+
+	// Whatever the level built on its own is thrown away, the same as a regenerated map
+	TArray<FString> SkippedClassNames;
+	SkipWorkers.ParseIntoArray(SkippedClassNames, TEXT(","));
+
+	TArray<AWorkerActor*> BenchmarkWorkers;
+	for (AWorkerActor* Worker : MapManager->GetWorkers())
+	{
+		if (Worker == nullptr)
+		{
+			continue;
+		}
+
+		Worker->ResetWork();
+
+		const FString ClassName = Worker->GetClass()->GetName();
+		const bool bSkipped = SkippedClassNames.ContainsByPredicate([&ClassName](const FString& SkippedClassName)
+			{
+				return ClassName.Contains(SkippedClassName);
+			});
+
+		if (bSkipped)
+		{
+			UE_LOG(LogTemp, Display, TEXT("UDriveBenchmarkSubsystem Skipping worker %s"), *Worker->GetName());
+		}
+		else
+		{
+			BenchmarkWorkers.Add(Worker);
+		}
+	}
+	MapManager->SetWorkers(BenchmarkWorkers);
+
+	TSharedRef<FMapBuildData> BuildData = MakeShared<FMapBuildData>();
+	FMapBuildSettings Settings = MapManager->MakeBuildSettings(Seed);
+
+	// Decoding the image replaces reading the texture on the render thread, which -nullrhi doesn't have.
+	// Banded builds only need the track mask, which large images are read into a few rows at a time
+	const bool bLoaded = Settings.BandRows > 0
+		? FMapBuildPipeline::LoadImageTrackMask(ImagePath, *BuildData)
+		: FMapBuildPipeline::LoadImageColors(ImagePath, *BuildData);
+
+	if (!bLoaded)
+	{
+		return false;
+	}
+
+	Settings.NodeToSkip = AMapManager::CalculateNodeToSkip(BuildData->Height, BuildData->Width);
+	Settings.VertScale = AMapManager::CalculateVertScale(BuildData->Height, BuildData->Width);
+
+	if (GrassProbability >= 0.0f)
+	{
+		Settings.GrassFoliageProbability = GrassProbability;
+	}
+	if (RocksProbability >= 0.0f)
+	{
+		Settings.RocksProbability = RocksProbability;
+	}
+	if (TreesProbability >= 0.0f)
+	{
+		Settings.TreesProbability = TreesProbability;
+	}
+
+	BuildData->Settings = Settings;
+
+	// Never through the build cache, every run measures the full build
+	FMapBuildPipeline::RunStages(*BuildData);
+
+	if (BuildData->TrackNodes.IsEmpty() || BuildData->TrackFrames.IsEmpty())
+	{
+		UE_LOG(LogTemp, Error, TEXT("UDriveBenchmarkSubsystem::StartMapBuild No track found in %s"), *ImagePath);
+		return false;
+	}
+
+	TrackFrames = BuildData->TrackFrames;
+
+	MapManager->BuildMapFromData(BuildData);
+
+	BuildSeconds = FPlatformTime::Seconds() - BuildStartSeconds;
+
+	return true;
+}
+
+void UDriveBenchmarkSubsystem::TickDriving(float DeltaTime)
+{
+	const double NowSeconds = FPlatformTime::Seconds();
+
+	UChaosWheeledVehicleMovementComponent* VehicleMovement = Pawn->GetChaosVehicleMovement();
+
+	const FTransform MapTransform = MapManager->GetActorTransform();
+	const FVector MapLocation = MapTransform.InverseTransformPosition(Pawn->GetActorLocation());
+	const FVector MapForward = MapTransform.InverseTransformVectorNoScale(Pawn->GetActorForwardVector());
+	const float SpeedCm = VehicleMovement->GetForwardSpeed();
+	const float SpeedKmh = SpeedCm * DriveBenchmark::CmPerSecondToKmh;
+
+	// The vehicle never moves more than a few samples per frame, so only the ones around the last are searched
+	const int32 SearchRadius = FMath::Max(DriveBenchmark::MinSearchRadius,
+		FMath::CeilToInt32(2.0f * FMath::Abs(SpeedCm) * DeltaTime / TrackFrames.SampleSpacing));
+	ClosestSample = TrackFrames.FindClosestIndex(MapLocation, ClosestSample, SearchRadius);
+
+	// Progress is summed per frame, so going backwards over the start line doesn't count as a lap
+	const float SampleDistance = ClosestSample * TrackFrames.SampleSpacing;
+	float DistanceDelta = SampleDistance - LastSampleDistance;
+	if (DistanceDelta > TrackFrames.Length * 0.5f)
+	{
+		DistanceDelta -= TrackFrames.Length;
+	}
+	else if (DistanceDelta < -TrackFrames.Length * 0.5f)
+	{
+		DistanceDelta += TrackFrames.Length;
+	}
+	TravelledDistance += DistanceDelta;
+	LastSampleDistance = SampleDistance;
+
+	const FDriveInput Input = FollowTrack(MapLocation, MapForward, SpeedCm);
+	VehicleMovement->SetSteeringInput(Input.Steering);
+	VehicleMovement->SetThrottleInput(Input.Throttle);
+	VehicleMovement->SetBrakeInput(Input.Brake);
+
+	if (NowSeconds - LastMemorySampleSeconds >= DriveBenchmark::MemorySampleSeconds)
+	{
+		UsedPhysicalMB = static_cast<float>(FPlatformMemory::GetStats().UsedPhysical / (1024.0 * 1024.0));
+		LastMemorySampleSeconds = NowSeconds;
+	}
+
+	// GGameThreadTime and GRenderThreadTime are of the previous frame, the engine sets them at the end of its tick
+	FFrameSample& Sample = Frames.AddDefaulted_GetRef();
+	Sample.Time = NowSeconds - DriveStartSeconds;
+	Sample.FrameMs = static_cast<float>((NowSeconds - LastTickSeconds) * 1000.0);
+	Sample.GameThreadMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+	Sample.RenderThreadMs = FPlatformTime::ToMilliseconds(GRenderThreadTime);
+	Sample.PhysicsMs = LastPhysicsMs;
+	Sample.UsedPhysicalMB = UsedPhysicalMB;
+	Sample.SpeedKmh = SpeedKmh;
+	Sample.Distance = TravelledDistance;
+	Sample.Steering = Input.Steering;
+	Sample.Throttle = Input.Throttle;
+	Sample.Brake = Input.Brake;
+
+	LastTickSeconds = NowSeconds;
+
+	StuckSeconds = FMath::Abs(SpeedKmh) < StuckSpeedKmh ? StuckSeconds + DeltaTime : 0.0f;
+	if (StuckSeconds >= StuckResetSeconds)
+	{
+		ResetVehicleToTrack();
+	}
+
+	if (TravelledDistance >= Laps * TrackFrames.Length)
+	{
+		Finish(true, FString::Printf(TEXT("Drove %d lap(s)"), Laps));
+	}
+}
+
+UDriveBenchmarkSubsystem::FDriveInput UDriveBenchmarkSubsystem::FollowTrack(const FVector& MapLocation, const FVector& MapForward, float SpeedCm) const
+{
+	FDriveInput Input;
+
+	const float CurrentDistance = ClosestSample * TrackFrames.SampleSpacing;
+
+	const FVector2D PursuitPoint = FTrackFollower::GetPursuitPoint(TrackFrames, CurrentDistance, SpeedCm);
+	Input.Steering = FTrackFollower::GetSteeringInput(FTrackFollower::GetHeadingError(FVector2D(MapLocation), FVector2D(MapForward), PursuitPoint));
+
+	const float WantedSpeed = FTrackFollower::GetProfileSpeed(TrackFrames, CurrentDistance, SpeedCm, TargetSpeedKmh / DriveBenchmark::CmPerSecondToKmh);
+	FTrackFollower::GetPedalInputs(WantedSpeed, SpeedCm, Input.Throttle, Input.Brake);
+
+	return Input;
+}
+
+void UDriveBenchmarkSubsystem::ResetVehicleToTrack()
+{
+	// Same placement the player's reset uses
+	const FTransform ResetTransform = MapManager->GetTrackResetTransform(ClosestSample * TrackFrames.SampleSpacing);
+
+	Pawn->SetActorTransform(ResetTransform, false, nullptr, ETeleportType::TeleportPhysics);
+	Pawn->GetMesh()->SetPhysicsAngularVelocityInDegrees(FVector::ZeroVector);
+	Pawn->GetMesh()->SetPhysicsLinearVelocity(FVector::ZeroVector);
+
+	StuckSeconds = 0.0f;
+	VehicleResets++;
+
+	UE_LOG(LogTemp, Warning, TEXT("UDriveBenchmarkSubsystem Vehicle got stuck %.0fcm into the run, reset to the track"), TravelledDistance);
+}
+
+void UDriveBenchmarkSubsystem::BindPhysicsScene()
+{
+	UWorld* World = GetGameInstance()->GetWorld();
+	BoundPhysScene = World != nullptr ? World->GetPhysicsScene() : nullptr;
+
+	if (BoundPhysScene != nullptr)
+	{
+		PhysScenePreTickHandle = BoundPhysScene->OnPhysScenePreTick.AddUObject(this, &UDriveBenchmarkSubsystem::OnPhysScenePreTick);
+		PhysScenePostTickHandle = BoundPhysScene->OnPhysScenePostTick.AddUObject(this, &UDriveBenchmarkSubsystem::OnPhysScenePostTick);
+	}
+}
+
+void UDriveBenchmarkSubsystem::UnbindPhysicsScene()
+{
+	if (BoundPhysScene != nullptr)
+	{
+		BoundPhysScene->OnPhysScenePreTick.Remove(PhysScenePreTickHandle);
+		BoundPhysScene->OnPhysScenePostTick.Remove(PhysScenePostTickHandle);
+		BoundPhysScene = nullptr;
+	}
+}
+
+void UDriveBenchmarkSubsystem::OnPhysScenePreTick(FPhysScene_Chaos* PhysScene, float DeltaSeconds)
+{
+	PhysicsStartCycles = FPlatformTime::Cycles64();
+}
+
+void UDriveBenchmarkSubsystem::OnPhysScenePostTick(FPhysScene_Chaos* PhysScene)
+{
+	// Game thread span of the physics frame, which includes the wait for the solver
+	LastPhysicsMs = static_cast<float>(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - PhysicsStartCycles));
+}
+
+void UDriveBenchmarkSubsystem::Finish(bool bSucceeded, const FString& Reason)
+{
+	State = EState::Finished;
+	UnbindPhysicsScene();
+
+	if (Pawn != nullptr && Pawn->GetChaosVehicleMovement() != nullptr)
+	{
+		Pawn->GetChaosVehicleMovement()->SetThrottleInput(0.0f);
+		Pawn->GetChaosVehicleMovement()->SetBrakeInput(1.0f);
+	}
+
+	const bool bWritten = WriteFrames() && WriteSummary(bSucceeded, Reason);
+
+	if (bSucceeded && bWritten)
+	{
+		UE_LOG(LogTemp, Display, TEXT("UDriveBenchmarkSubsystem %s in %d frames, wrote %s"), *Reason, Frames.Num(), *OutputPath);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("UDriveBenchmarkSubsystem Benchmark failed: %s"), *Reason);
+	}
+
+	FPlatformMisc::RequestExitWithStatus(false, bSucceeded && bWritten ? 0 : 1);
+}
+
+bool UDriveBenchmarkSubsystem::WriteFrames() const
+{
+	FString Csv = TEXT("frame,time_s,frame_ms,game_thread_ms,render_thread_ms,physics_ms,used_physical_mb,speed_kmh,distance,steering,throttle,brake,hitch\n");
+	Csv.Reserve(Csv.Len() + Frames.Num() * 96);
+
+	for (int32 FrameIndex = 0; FrameIndex < Frames.Num(); FrameIndex++)
+	{
+		const FFrameSample& Sample = Frames[FrameIndex];
+		Csv += FString::Printf(TEXT("%d,%.4f,%.3f,%.3f,%.3f,%.3f,%.1f,%.1f,%.0f,%.3f,%.3f,%.3f,%d\n"), FrameIndex, Sample.Time,
+			Sample.FrameMs, Sample.GameThreadMs, Sample.RenderThreadMs, Sample.PhysicsMs, Sample.UsedPhysicalMB,
+			Sample.SpeedKmh, Sample.Distance, Sample.Steering, Sample.Throttle, Sample.Brake, Sample.FrameMs > HitchMs ? 1 : 0);
+	}
+
+	if (!FFileHelper::SaveStringToFile(Csv, *OutputPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("UDriveBenchmarkSubsystem::WriteFrames Failed to write %s"), *OutputPath);
+		return false;
+	}
+
+	return true;
+}
+
+bool UDriveBenchmarkSubsystem::WriteSummary(bool bSucceeded, const FString& Reason) const
+{
+	TSharedRef<FJsonObject> Summary = MakeShared<FJsonObject>();
+	Summary->SetBoolField(TEXT("succeeded"), bSucceeded);
+	Summary->SetStringField(TEXT("reason"), Reason);
+	Summary->SetStringField(TEXT("image"), ImagePath);
+	Summary->SetNumberField(TEXT("seed"), Seed);
+	Summary->SetNumberField(TEXT("laps"), Laps);
+	Summary->SetBoolField(TEXT("light_weight"), bLightWeightMode);
+	Summary->SetStringField(TEXT("skipped_workers"), SkipWorkers);
+	Summary->SetNumberField(TEXT("track_length"), TrackFrames.Length);
+	Summary->SetNumberField(TEXT("build_seconds"), BuildSeconds);
+	Summary->SetNumberField(TEXT("drive_seconds"), Frames.IsEmpty() ? 0.0 : Frames.Last().Time);
+	Summary->SetNumberField(TEXT("frames"), Frames.Num());
+	Summary->SetNumberField(TEXT("vehicle_resets"), VehicleResets);
+
+	int32 Hitches = 0;
+	float PeakUsedPhysicalMB = 0.0f;
+	for (const FFrameSample& Sample : Frames)
+	{
+		Hitches += Sample.FrameMs > HitchMs ? 1 : 0;
+		PeakUsedPhysicalMB = FMath::Max(PeakUsedPhysicalMB, Sample.UsedPhysicalMB);
+	}
+	Summary->SetNumberField(TEXT("hitch_ms"), HitchMs);
+	Summary->SetNumberField(TEXT("hitches"), Hitches);
+	Summary->SetNumberField(TEXT("peak_used_physical_mb"), PeakUsedPhysicalMB);
+
+	auto AddMetric = [this, &Summary](const TCHAR* Name, float FFrameSample::* Member)
+	{
+		TArray<float> Values;
+		Values.Reserve(Frames.Num());
+		for (const FFrameSample& Sample : Frames)
+		{
+			Values.Add(Sample.*Member);
+		}
+
+		TSharedRef<FJsonObject> Metric = MakeShared<FJsonObject>();
+		Metric->SetNumberField(TEXT("p50"), DriveBenchmark::Percentile(Values, 0.5f));
+		Metric->SetNumberField(TEXT("p95"), DriveBenchmark::Percentile(Values, 0.95f));
+		Metric->SetNumberField(TEXT("p99"), DriveBenchmark::Percentile(Values, 0.99f));
+		Metric->SetNumberField(TEXT("max"), DriveBenchmark::Percentile(Values, 1.0f));
+		Summary->SetObjectField(Name, Metric);
+	};
+
+	AddMetric(TEXT("frame_ms"), &FFrameSample::FrameMs);
+	AddMetric(TEXT("game_thread_ms"), &FFrameSample::GameThreadMs);
+	AddMetric(TEXT("render_thread_ms"), &FFrameSample::RenderThreadMs);
+	AddMetric(TEXT("physics_ms"), &FFrameSample::PhysicsMs);
+
+	FString SummaryString;
+	FJsonSerializer::Serialize(Summary, TJsonWriterFactory<>::Create(&SummaryString));
+
+	const FString SummaryPath = FPaths::ChangeExtension(OutputPath, TEXT("json"));
+	if (!FFileHelper::SaveStringToFile(SummaryString, *SummaryPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("UDriveBenchmarkSubsystem::WriteSummary Failed to write %s"), *SummaryPath);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
+#include "MapBuildPipeline.h"
+#include "DriveBenchmarkSubsystem.generated.h"
+
+class AMapManager;
+class ARacingEngineerPawn;
+class FPhysScene_Chaos;
+
+/**
+ *  Drives the player vehicle around the track and records the runtime cost of every frame to CSV.
+ *  Only created with -DriveBenchmark, the engine exits once the laps are done.
+ *
+ *  RacingEngineer <game level> -game -nullrhi -unattended -benchmark -fps=60 -DriveBenchmark
+ *      -Image=<png> [-Seed=42] [-Laps=1] [-TargetSpeed=80] [-MaxSeconds=600] [-HitchMs=50]
+ *      [-LightWeight] [-Grass=] [-Rocks=] [-Trees=] [-SkipWorkers=<class name>,<class name>] [-BandRows=<rows>] [-Output=<csv>]
+ *
+ *  The map is built from the image file instead of a texture, so it runs without an RHI.
+ *  -benchmark -fps=60 gives every frame the same delta time, which keeps the driven line repeatable.
+ */
+UCLASS()
+class RACINGENGINEER_API UDriveBenchmarkSubsystem : public UGameInstanceSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// Begin FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override { return ETickableTickType::Conditional; }
+	virtual bool IsTickable() const override { return State != EState::Finished; }
+	virtual TStatId GetStatId() const override;
+	// End FTickableGameObject interface
+
+private:
+	enum class EState : uint8
+	{
+		// Waiting for the level, its map manager and pawn, and for the level's own map build to end
+		WaitingForLevel,
+		BuildingMap,
+		// The vehicle is dropped on the start line and left to settle before anything is recorded
+		Settling,
+		Driving,
+		Finished
+	};
+
+	struct FFrameSample
+	{
+		double Time = 0.0;
+		float FrameMs = 0.0f;
+		float GameThreadMs = 0.0f;
+		float RenderThreadMs = 0.0f;
+		float PhysicsMs = 0.0f;
+		float UsedPhysicalMB = 0.0f;
+		float SpeedKmh = 0.0f;
+		float Distance = 0.0f;
+		float Steering = 0.0f;
+		float Throttle = 0.0f;
+		float Brake = 0.0f;
+	};
+
+	struct FDriveInput
+	{
+		float Steering = 0.0f;
+		float Throttle = 0.0f;
+		float Brake = 0.0f;
+	};
+
+	void SetState(EState NewState);
+
+	bool FindLevelActors();
+	bool StartMapBuild();
+
+	void TickDriving(float DeltaTime);
+
+	// FTrackFollower's pure pursuit and speed profile, never faster than TargetSpeedKmh
+	FDriveInput FollowTrack(const FVector& MapLocation, const FVector& MapForward, float SpeedCm) const;
+
+	void ResetVehicleToTrack();
+
+	void BindPhysicsScene();
+	void UnbindPhysicsScene();
+	void OnPhysScenePreTick(FPhysScene_Chaos* PhysScene, float DeltaSeconds);
+	void OnPhysScenePostTick(FPhysScene_Chaos* PhysScene);
+
+	void Finish(bool bSucceeded, const FString& Reason);
+	bool WriteFrames() const;
+	bool WriteSummary(bool bSucceeded, const FString& Reason) const;
+
+	EState State = EState::WaitingForLevel;
+
+	UPROPERTY()
+	TObjectPtr<AMapManager> MapManager;
+
+	UPROPERTY()
+	TObjectPtr<ARacingEngineerPawn> Pawn;
+
+	// Copied out of the build data, the workers are free to consume the rest of it
+	FTrackFrameTable TrackFrames;
+
+	FString ImagePath;
+	FString OutputPath;
+	FString SkipWorkers;
+	int32 Seed = 42;
+	int32 Laps = 1;
+	float TargetSpeedKmh = 80.0f;
+	float MaxSeconds = 600.0f;
+	float HitchMs = 50.0f;
+	float GrassProbability = -1.0f;
+	float RocksProbability = -1.0f;
+	float TreesProbability = -1.0f;
+	bool bLightWeightMode = false;
+
+	int32 StateFrames = 0;
+	double RunStartSeconds = 0.0;
+	double DriveStartSeconds = 0.0;
+	double LastTickSeconds = 0.0;
+	double BuildSeconds = 0.0;
+
+	// Memory stats are sampled every MemorySampleSeconds, frames in between repeat the last value
+	double LastMemorySampleSeconds = 0.0;
+	float UsedPhysicalMB = 0.0f;
+
+	int32 ClosestSample = 0;
+	float LastSampleDistance = 0.0f;
+	float TravelledDistance = 0.0f;
+	float StuckSeconds = 0.0f;
+	int32 VehicleResets = 0;
+
+	TArray<FFrameSample> Frames;
+
+	FPhysScene_Chaos* BoundPhysScene = nullptr;
+	FDelegateHandle PhysScenePreTickHandle;
+	FDelegateHandle PhysScenePostTickHandle;
+	uint64 PhysicsStartCycles = 0;
+	float LastPhysicsMs = 0.0f;
+
+	// Below this speed for StuckResetSeconds the vehicle is put back on the centre line
+	static constexpr float StuckSpeedKmh = 3.0f;
+	static constexpr float StuckResetSeconds = 3.0f;
+	static constexpr int32 SettleFrames = 60;
+};
@@ -0,0 +1,157 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LapHistorySubsystem.h"
+
+#include "RacingEngineerGameInstance.h"
+#include "RacingEngineerSaveGame.h"
+#include "Async/Async.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "HAL/FileManager.h"
+#include "Kismet/GameplayStatics.h"
+
+void ULapHistorySubsystem::Deinitialize()
+{
+	// Waits for the queued laps to reach the disk
+	Writer.Reset();
+
+	Super::Deinitialize();
+}
+
+void ULapHistorySubsystem::BeginSession()
+{
+	EnsureWriterForSelectedSlot();
+}
+
+void ULapHistorySubsystem::RecordLap(float LapTime, const TArray<float>& SectorSplits)
+{
+	// Switching to another slot resets the statistics, so it has to happen before the lap is counted
+	const bool bHasWriter = EnsureWriterForSelectedSlot();
+
+	SessionStatistics.AddLap(LapTime);
+	OnLapStatisticsUpdated.Broadcast(GetStatistics());
+
+	if (!bHasWriter)
+	{
+		return;
+	}
+
+	FLapRecord Record;
+	Record.LapTime = LapTime;
+	Record.SectorSplits = SectorSplits;
+	Record.FinishedAt = FDateTime::UtcNow();
+
+	const URacingEngineerGameInstance* RacingEngineerGameInstance = Cast<URacingEngineerGameInstance>(GetGameInstance());
+	if (RacingEngineerGameInstance != nullptr)
+	{
+		Record.Seed = RacingEngineerGameInstance->GetLastBuildSettings().Seed;
+	}
+
+	const APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(this, 0);
+	if (PlayerPawn != nullptr)
+	{
+		Record.CarType = PlayerPawn->GetClass()->GetFName();
+	}
+
+	Writer->Enqueue(MoveTemp(Record));
+}
+
+FLapStatistics ULapHistorySubsystem::GetStatistics() const
+{
+	FLapStatistics Statistics = ExistingStatistics;
+	Statistics.Combine(SessionStatistics);
+
+	return Statistics;
+}
+
+bool ULapHistorySubsystem::EnsureWriterForSelectedSlot()
+{
+	const URacingEngineerGameInstance* RacingEngineerGameInstance = Cast<URacingEngineerGameInstance>(GetGameInstance());
+	if (RacingEngineerGameInstance == nullptr || RacingEngineerGameInstance->SelectedSaveSlot == nullptr)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("ULapHistorySubsystem::RecordLap No save slot selected, lap is not logged"));
+		return false;
+	}
+
+	const FString FilePath = GetLapHistoryFilePath(RacingEngineerGameInstance->SelectedSaveSlot->SaveSlotName);
+
+	if (!Writer.IsValid() || Writer->GetFilePath() != FilePath)
+	{
+		// The previous slot's writer finishes its queue before the new one starts reading
+		Writer.Reset();
+
+		ExistingStatistics = FLapStatistics();
+		SessionStatistics = FLapStatistics();
+
+		TWeakObjectPtr<ULapHistorySubsystem> WeakThis(this);
+		Writer = MakeUnique<FLapHistoryWriter>(FilePath, FLapHistoryWriter::FOnExistingLapsRead::CreateLambda(
+			[WeakThis, FilePath](const FLapStatistics& Statistics)
+			{
+				AsyncTask(ENamedThreads::GameThread, [WeakThis, FilePath, Statistics]
+					{
+						if (WeakThis.IsValid())
+						{
+							WeakThis->OnExistingLapsRead(Statistics, FilePath);
+						}
+					});
+			}));
+	}
+
+	return true;
+}
+
+void ULapHistorySubsystem::OnExistingLapsRead(const FLapStatistics& Statistics, const FString& FilePath)
+{
+	// The slot may have changed again while the old log was being read
+	if (Writer.IsValid() && Writer->GetFilePath() == FilePath)
+	{
+		ExistingStatistics = Statistics;
+		OnLapStatisticsUpdated.Broadcast(GetStatistics());
+	}
+}
+
+void ULapHistorySubsystem::DeleteLapHistory(const FString& SaveSlotName)
+{
+	check(IsInGameThread());
+
+	const FString FilePath = GetLapHistoryFilePath(SaveSlotName);
+
+	// The writer holds the file open and would append the laps still queued after the delete
+	if (GEngine != nullptr)
+	{
+		for (const FWorldContext& Context : GEngine->GetWorldContexts())
+		{
+			ULapHistorySubsystem* LapHistory = Context.OwningGameInstance != nullptr ? Context.OwningGameInstance->GetSubsystem<ULapHistorySubsystem>() : nullptr;
+			if (LapHistory != nullptr)
+			{
+				LapHistory->CloseLapHistory(FilePath);
+			}
+		}
+	}
+
+	IFileManager& FileManager = IFileManager::Get();
+	if (FileManager.FileExists(*FilePath) && !FileManager.Delete(*FilePath))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("ULapHistorySubsystem::DeleteLapHistory Failed to delete %s"), *FilePath);
+	}
+}
+
+void ULapHistorySubsystem::CloseLapHistory(const FString& FilePath)
+{
+	if (!Writer.IsValid() || Writer->GetFilePath() != FilePath)
+	{
+		return;
+	}
+
+	Writer.Reset();
+
+	ExistingStatistics = FLapStatistics();
+	SessionStatistics = FLapStatistics();
+	OnLapStatisticsUpdated.Broadcast(GetStatistics());
+}
+
+FString ULapHistorySubsystem::GetLapHistoryFilePath(const FString& SaveSlotName)
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), LapHistoryDirName, SaveSlotName + TEXT(".") + LapHistoryExtension);
+}
@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "LapHistoryWriter.h"
+#include "LapHistorySubsystem.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnLapStatisticsUpdated, const FLapStatistics&, Statistics);
+
+/**
+ *  Appends every finished lap to the lap history of the selected save slot.
+ *  All file access happens on the writer thread, the statistics are kept up to date in memory.
+ */
+UCLASS()
+class RACINGENGINEER_API ULapHistorySubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	// Starts reading the selected slot's history so its statistics are known before the first lap
+	void BeginSession();
+
+	void RecordLap(float LapTime, const TArray<float>& SectorSplits);
+
+	// Statistics of every lap of the current slot, including the ones logged in earlier sessions once they are read
+	UFUNCTION(BlueprintCallable, Category = "LapHistory")
+	FLapStatistics GetStatistics() const;
+
+	UFUNCTION(BlueprintCallable, Category = "LapHistory")
+	float GetConsistency() const { return GetStatistics().GetConsistency(); }
+
+	UPROPERTY(BlueprintAssignable)
+	FOnLapStatisticsUpdated OnLapStatisticsUpdated;
+
+	// Stops every writer logging to the slot and deletes its history, so a new slot of the same name starts without laps
+	static void DeleteLapHistory(const FString& SaveSlotName);
+
+private:
+	// Switches the log over when another save slot was selected, returns false when there is no slot to log to
+	bool EnsureWriterForSelectedSlot();
+
+	void OnExistingLapsRead(const FLapStatistics& Statistics, const FString& FilePath);
+
+	// Drops the writer and the statistics when it logs to FilePath
+	void CloseLapHistory(const FString& FilePath);
+
+	static FString GetLapHistoryFilePath(const FString& SaveSlotName);
+
+	TUniquePtr<FLapHistoryWriter> Writer;
+
+	FLapStatistics ExistingStatistics;
+	FLapStatistics SessionStatistics;
+
+	static inline FString LapHistoryDirName = TEXT("LapHistory");
+	static inline FString LapHistoryExtension = TEXT("laps");
+};
@@ -0,0 +1,230 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LapHistoryWriter.h"
+
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+FArchive& operator<<(FArchive& Ar, FLapRecord& Record)
+{
+	Ar << Record.LapTime;
+	Ar << Record.SectorSplits;
+	Ar << Record.CarType;
+	Ar << Record.Seed;
+	Ar << Record.FinishedAt;
+
+	return Ar;
+}
+
+#pragma region LapStatistics
+
+void FLapStatistics::AddLap(float LapTime)
+{
+	LapsNum++;
+	BestLapTime = LapsNum == 1 ? LapTime : FMath::Min(BestLapTime, LapTime);
+
+	const double Delta = LapTime - AverageLapTime;
+	AverageLapTime += Delta / LapsNum;
+	SquaredDeviationSum += Delta * (LapTime - AverageLapTime);
+}
+
+void FLapStatistics::Combine(const FLapStatistics& Other)
+{
+	if (Other.LapsNum == 0)
+	{
+		return;
+	}
+
+	if (LapsNum == 0)
+	{
+		*this = Other;
+		return;
+	}
+
+	const int32 CombinedLapsNum = LapsNum + Other.LapsNum;
+	const double Delta = Other.AverageLapTime - AverageLapTime;
+
+	SquaredDeviationSum += Other.SquaredDeviationSum + Delta * Delta * LapsNum * Other.LapsNum / CombinedLapsNum;
+	AverageLapTime += Delta * Other.LapsNum / CombinedLapsNum;
+	BestLapTime = FMath::Min(BestLapTime, Other.BestLapTime);
+	LapsNum = CombinedLapsNum;
+}
+
+float FLapStatistics::GetStandardDeviation() const
+{
+	return LapsNum > 1 ? FMath::Sqrt(SquaredDeviationSum / (LapsNum - 1)) : 0.0f;
+}
+
+float FLapStatistics::GetConsistency() const
+{
+	return AverageLapTime > 0.0f ? FMath::Max(0.0f, 1.0f - GetStandardDeviation() / AverageLapTime) : 0.0f;
+}
+
+#pragma endregion
+
+FLapHistoryWriter::FLapHistoryWriter(const FString& InFilePath, FOnExistingLapsRead InOnExistingLapsRead)
+	: FilePath(InFilePath)
+	, OnExistingLapsRead(MoveTemp(InOnExistingLapsRead))
+	, WorkEvent(FPlatformProcess::GetSynchEventFromPool())
+{
+	Thread = FRunnableThread::Create(this, TEXT("LapHistoryWriter"), 0, TPri_BelowNormal);
+}
+
+FLapHistoryWriter::~FLapHistoryWriter()
+{
+	if (Thread != nullptr)
+	{
+		// Kill waits for the thread, which writes whatever is still queued before it exits
+		Thread->Kill(true);
+		delete Thread;
+	}
+
+	FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+}
+
+void FLapHistoryWriter::Enqueue(FLapRecord&& Record)
+{
+	PendingRecords.Enqueue(MoveTemp(Record));
+	WorkEvent->Trigger();
+}
+
+void FLapHistoryWriter::Stop()
+{
+	bStopping = true;
+	WorkEvent->Trigger();
+}
+
+uint32 FLapHistoryWriter::Run()
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(FilePath));
+
+	TArray<FLapRecord> ExistingRecords;
+	int64 ValidSize = 0;
+	const bool bHasValidHeader = ReadLapRecords(FilePath, ExistingRecords, ValidSize);
+
+	FLapStatistics ExistingStatistics;
+	for (const FLapRecord& Record : ExistingRecords)
+	{
+		ExistingStatistics.AddLap(Record.LapTime);
+	}
+
+	OnExistingLapsRead.ExecuteIfBound(ExistingStatistics);
+
+	// A missing or foreign file is started over, records are only ever appended after the header
+	TUniquePtr<IFileHandle> FileHandle(PlatformFile.OpenWrite(*FilePath, bHasValidHeader, false));
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("FLapHistoryWriter::Run Failed to open %s"), *FilePath);
+		return 1;
+	}
+
+	if (bHasValidHeader && FileHandle->Size() > ValidSize)
+	{
+		FileHandle->Truncate(ValidSize);
+		FileHandle->SeekFromEnd(0);
+	}
+
+	if (!bHasValidHeader)
+	{
+		TArray<uint8> Header;
+		FMemoryWriter HeaderWriter(Header);
+
+		uint32 Magic = LogMagic;
+		int32 Version = LogVersion;
+		HeaderWriter << Magic;
+		HeaderWriter << Version;
+
+		FileHandle->Write(Header.GetData(), Header.Num());
+		FileHandle->Flush(true);
+	}
+
+	while (!bStopping)
+	{
+		WorkEvent->Wait();
+		WritePendingRecords(*FileHandle);
+	}
+
+	WritePendingRecords(*FileHandle);
+
+	return 0;
+}
+
+void FLapHistoryWriter::WritePendingRecords(IFileHandle& FileHandle)
+{
+	TArray<uint8> Batch;
+	FMemoryWriter BatchWriter(Batch);
+
+	FLapRecord Record;
+	while (PendingRecords.Dequeue(Record))
+	{
+		// Every record is prefixed by its size, so a torn write at the end of the file is detected on read
+		TArray<uint8> RecordData;
+		FMemoryWriter RecordWriter(RecordData);
+		RecordWriter << Record;
+
+		uint32 RecordSize = RecordData.Num();
+		BatchWriter << RecordSize;
+		BatchWriter.Serialize(RecordData.GetData(), RecordData.Num());
+	}
+
+	if (!Batch.IsEmpty())
+	{
+		// Records only arrive at lap boundaries, so one full flush per batch is one per finished lap at most
+		if (!FileHandle.Write(Batch.GetData(), Batch.Num()) || !FileHandle.Flush(true))
+		{
+			UE_LOG(LogTemp, Error, TEXT("FLapHistoryWriter::WritePendingRecords Failed to write to %s"), *FilePath);
+		}
+	}
+}
+
+bool FLapHistoryWriter::ReadLapRecords(const FString& FilePath, TArray<FLapRecord>& OutRecords, int64& OutValidSize)
+{
+	OutValidSize = 0;
+
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *FilePath, FILEREAD_Silent))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(FileData);
+
+	uint32 Magic = 0;
+	int32 Version = 0;
+	Reader << Magic;
+	Reader << Version;
+
+	if (Reader.IsError() || Magic != LogMagic || Version != LogVersion)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("FLapHistoryWriter::ReadLapRecords %s isn't a lap history log"), *FilePath);
+		return false;
+	}
+
+	OutValidSize = Reader.Tell();
+
+	while (Reader.Tell() + static_cast<int64>(sizeof(uint32)) <= Reader.TotalSize())
+	{
+		uint32 RecordSize = 0;
+		Reader << RecordSize;
+
+		if (Reader.Tell() + RecordSize > Reader.TotalSize())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("FLapHistoryWriter::ReadLapRecords %s ends with a partial record"), *FilePath);
+			break;
+		}
+
+		const int64 RecordEnd = Reader.Tell() + RecordSize;
+		Reader << OutRecords.AddDefaulted_GetRef();
+		Reader.Seek(RecordEnd);
+
+		OutValidSize = RecordEnd;
+	}
+
+	return true;
+}
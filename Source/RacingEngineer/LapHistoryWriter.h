@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "Containers/Queue.h"
+#include "LapHistoryWriter.generated.h"
+
+USTRUCT(BlueprintType)
+struct FLapRecord
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "LapHistory")
+	float LapTime = 0.0f;
+
+	// Time since the start of the lap at the end of every sector but the last one
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "LapHistory")
+	TArray<float> SectorSplits;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "LapHistory")
+	FName CarType;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "LapHistory")
+	int32 Seed = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "LapHistory")
+	FDateTime FinishedAt;
+
+	friend FArchive& operator<<(FArchive& Ar, FLapRecord& Record);
+};
+
+/**
+ *  Best, average and consistency of lap times, updated one lap at a time with Welford's algorithm.
+ */
+USTRUCT(BlueprintType)
+struct FLapStatistics
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "LapHistory")
+	int32 LapsNum = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "LapHistory")
+	float BestLapTime = 0.0f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "LapHistory")
+	float AverageLapTime = 0.0f;
+
+	// Sum of squared differences from the average
+	double SquaredDeviationSum = 0.0;
+
+	void AddLap(float LapTime);
+
+	// Merges statistics of two disjoint sets of laps
+	void Combine(const FLapStatistics& Other);
+
+	float GetStandardDeviation() const;
+
+	// 1 when every lap takes exactly the same time, lower the more the laps are spread out
+	float GetConsistency() const;
+};
+
+/**
+ *  Owns the thread appending lap records to a single log file.
+ *  Records are queued from the game thread and written in batches, every batch is flushed to disk.
+ */
+class RACINGENGINEER_API FLapHistoryWriter : public FRunnable
+{
+public:
+	// Called on the writer thread once the laps already in the file have been read
+	DECLARE_DELEGATE_OneParam(FOnExistingLapsRead, const FLapStatistics&);
+
+	FLapHistoryWriter(const FString& InFilePath, FOnExistingLapsRead InOnExistingLapsRead);
+	virtual ~FLapHistoryWriter() override;
+
+	// Game thread only
+	void Enqueue(FLapRecord&& Record);
+
+	const FString& GetFilePath() const { return FilePath; }
+
+	// OutValidSize is where the last complete record ends, anything after it is a torn write
+	static bool ReadLapRecords(const FString& FilePath, TArray<FLapRecord>& OutRecords, int64& OutValidSize);
+
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	void WritePendingRecords(IFileHandle& FileHandle);
+
+	static constexpr uint32 LogMagic = 0x524C4150; // RLAP
+	static constexpr int32 LogVersion = 1;
+
+	FString FilePath;
+	FOnExistingLapsRead OnExistingLapsRead;
+
+	TQueue<FLapRecord, EQueueMode::Spsc> PendingRecords;
+	FEvent* WorkEvent = nullptr;
+	std::atomic_bool bStopping = false;
+
+	FRunnableThread* Thread = nullptr;
+};
@@ -0,0 +1,373 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MapBuildBenchmarkCommandlet.h"
+
+#include "MapManager.h"
+#include "WorkerActor.h"
+#include "Dom/JsonObject.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+UMapBuildBenchmarkCommandlet::UMapBuildBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UMapBuildBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString ImagePath;
+	if (!FParse::Value(*Params, TEXT("Image="), ImagePath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("UMapBuildBenchmarkCommandlet::Main -Image=<path> is required"));
+		return 1;
+	}
+
+	int32 Seed = 42;
+	int32 Iterations = 5;
+	float NoiseFrequency = 0.01f;
+	FString WorkerClassPaths;
+	FString OutputPath;
+
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	FParse::Value(*Params, TEXT("NoiseFrequency="), NoiseFrequency);
+	FParse::Value(*Params, TEXT("Workers="), WorkerClassPaths, false);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+	Iterations = FMath::Max(1, Iterations);
+
+	if (!WorkerClassPaths.IsEmpty() && !SpawnWorkers(WorkerClassPaths))
+	{
+		DestroyWorld();
+		return 1;
+	}
+
+	// Workers add their own inputs the same way they do in the level
+	FMapBuildSettings Settings = MapManager != nullptr ? MapManager->MakeBuildSettings(Seed) : FMapBuildSettings();
+	Settings.Seed = Seed;
+	Settings.NoiseFrequency = NoiseFrequency;
+	Settings.bLightWeightMode = FParse::Param(*Params, TEXT("LightWeight"));
+
+	// Banded builds stream their terrain, without workers the terrain generator isn't there to set it
+	FParse::Value(*Params, TEXT("BandRows="), Settings.BandRows);
+	Settings.bStreamTerrain |= Settings.BandRows > 0;
+	FParse::Value(*Params, TEXT("ErosionIterations="), Settings.ErosionIterations);
+
+	TArray<FIterationResult> Results;
+	Results.Reserve(Iterations);
+
+	// Everything the process holds before the first build, the peak above it is what the builds needed
+	const uint64 BaselineUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+	const double BenchmarkStart = FPlatformTime::Seconds();
+
+	for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		if (!RunIteration(ImagePath, Settings, Results.AddDefaulted_GetRef()))
+		{
+			UE_LOG(LogTemp, Error, TEXT("UMapBuildBenchmarkCommandlet::Main Iteration %d failed"), Iteration);
+			DestroyWorld();
+			return 1;
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("UMapBuildBenchmarkCommandlet::Main Iteration %d/%d done"), Iteration + 1, Iterations);
+	}
+
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+
+	TSharedRef<FJsonObject> Report = MakeShared<FJsonObject>();
+	Report->SetStringField(TEXT("image"), ImagePath);
+	Report->SetNumberField(TEXT("seed"), Seed);
+	Report->SetNumberField(TEXT("iterations"), Iterations);
+	Report->SetStringField(TEXT("platform"), FPlatformProperties::IniPlatformName());
+	Report->SetNumberField(TEXT("total_wall_ms"), (FPlatformTime::Seconds() - BenchmarkStart) * 1000.0);
+	Report->SetNumberField(TEXT("peak_used_physical_bytes"), MemoryStats.PeakUsedPhysical);
+	Report->SetNumberField(TEXT("baseline_used_physical_bytes"), BaselineUsedPhysical);
+	Report->SetNumberField(TEXT("build_peak_physical_bytes"), MemoryStats.PeakUsedPhysical > BaselineUsedPhysical ? MemoryStats.PeakUsedPhysical - BaselineUsedPhysical : 0);
+	Report->SetNumberField(TEXT("peak_used_virtual_bytes"), MemoryStats.PeakUsedVirtual);
+	Report->SetArrayField(TEXT("stages"), MakeStagesJson(Results));
+	Report->SetObjectField(TEXT("outputs"), Results.Last().OutputSizes);
+
+	// What the workers keep alive between builds
+	if (MapManager != nullptr)
+	{
+		TSharedRef<FJsonObject> Retained = MakeShared<FJsonObject>();
+		for (const AWorkerActor* Worker : MapManager->GetWorkers())
+		{
+			if (Worker != nullptr)
+			{
+				const FWorkerMemoryUsage Usage = Worker->GetRetainedMemory();
+
+				TSharedRef<FJsonObject> WorkerRetained = MakeShared<FJsonObject>();
+				WorkerRetained->SetNumberField(TEXT("build_buffers_bytes"), static_cast<double>(Usage.BuildBuffers));
+				WorkerRetained->SetNumberField(TEXT("component_data_bytes"), static_cast<double>(Usage.ComponentData));
+				Retained->SetObjectField(Worker->GetClass()->GetName(), WorkerRetained);
+			}
+		}
+		Report->SetObjectField(TEXT("retained"), Retained);
+	}
+
+	FString ReportString;
+	const TSharedRef<TJsonWriter<>> JsonWriter = TJsonWriterFactory<>::Create(&ReportString);
+	FJsonSerializer::Serialize(Report, JsonWriter);
+
+	if (!OutputPath.IsEmpty())
+	{
+		if (!FFileHelper::SaveStringToFile(ReportString, *OutputPath))
+		{
+			UE_LOG(LogTemp, Error, TEXT("UMapBuildBenchmarkCommandlet::Main Failed to write %s"), *OutputPath);
+			DestroyWorld();
+			return 1;
+		}
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("%s"), *ReportString);
+
+	DestroyWorld();
+	return 0;
+}
+
+bool UMapBuildBenchmarkCommandlet::RunIteration(const FString& ImagePath, const FMapBuildSettings& Settings, FIterationResult& OutResult)
+{
+	TSharedRef<FMapBuildData> BuildData = MakeShared<FMapBuildData>();
+	BuildData->Settings = Settings;
+
+	// Decoding the image replaces reading the texture on the render thread, which -nullrhi doesn't have
+	const double DecodeWallStart = FPlatformTime::Seconds();
+	const double DecodeCPUStart = FMapBuildPipeline::GetProcessCPUSeconds();
+
+	const bool bLoaded = Settings.BandRows > 0
+		? FMapBuildPipeline::LoadImageTrackMask(ImagePath, *BuildData)
+		: FMapBuildPipeline::LoadImageColors(ImagePath, *BuildData);
+
+	if (!bLoaded)
+	{
+		return false;
+	}
+
+	FMapBuildStageTiming& DecodeTiming = OutResult.StageTimings.AddDefaulted_GetRef();
+	DecodeTiming.Stage = TEXT("MaskExtraction");
+	DecodeTiming.WallSeconds = FPlatformTime::Seconds() - DecodeWallStart;
+	DecodeTiming.CPUSeconds = FMapBuildPipeline::GetProcessCPUSeconds() - DecodeCPUStart;
+
+	// Same scaling the map manager applies to maps picked in the menu
+	BuildData->Settings.NodeToSkip = AMapManager::CalculateNodeToSkip(BuildData->Height, BuildData->Width);
+	BuildData->Settings.VertScale = AMapManager::CalculateVertScale(BuildData->Height, BuildData->Width);
+
+	FMapBuildPipeline::RunStages(*BuildData, &OutResult.StageTimings);
+
+	if (BuildData->TrackNodes.IsEmpty())
+	{
+		UE_LOG(LogTemp, Error, TEXT("UMapBuildBenchmarkCommandlet::RunIteration No track found in %s"), *ImagePath);
+		return false;
+	}
+
+	OutResult.OutputSizes = MakeOutputSizesJson(*BuildData);
+
+	return MapManager == nullptr || RunWorkers(BuildData, OutResult);
+}
+
+bool UMapBuildBenchmarkCommandlet::RunWorkers(const TSharedRef<FMapBuildData>& BuildData, FIterationResult& OutResult)
+{
+	for (AWorkerActor* Worker : MapManager->GetWorkers())
+	{
+		if (Worker != nullptr)
+		{
+			Worker->ResetWork();
+		}
+	}
+
+	const double WallStart = FPlatformTime::Seconds();
+	const double CPUStart = FMapBuildPipeline::GetProcessCPUSeconds();
+
+	MapManager->BuildMapFromData(BuildData);
+
+	// Nothing ticks the world in a commandlet, so the batched spawning and game thread tasks are driven here
+	constexpr float DeltaSeconds = 1.0f / 60.0f;
+	while (MapManager->IsBuildingMap())
+	{
+		FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+		World->Tick(LEVELTICK_All, DeltaSeconds);
+
+		if (FPlatformTime::Seconds() - WallStart > WorkerTimeoutSeconds)
+		{
+			UE_LOG(LogTemp, Error, TEXT("UMapBuildBenchmarkCommandlet::RunWorkers Workers didn't finish in %f seconds"), WorkerTimeoutSeconds);
+			return false;
+		}
+	}
+
+	FMapBuildStageTiming& WorkersTiming = OutResult.StageTimings.AddDefaulted_GetRef();
+	WorkersTiming.Stage = TEXT("Workers");
+	WorkersTiming.WallSeconds = FPlatformTime::Seconds() - WallStart;
+	WorkersTiming.CPUSeconds = FMapBuildPipeline::GetProcessCPUSeconds() - CPUStart;
+
+	// Workers run concurrently, so only their wall time up to their callback is known
+	const TArray<TObjectPtr<AWorkerActor>>& Workers = MapManager->GetWorkers();
+	const TArray<double>& WorkerElapsedSeconds = MapManager->GetWorkerElapsedSeconds();
+
+	for (int32 WorkerIndex = 0; WorkerIndex < Workers.Num(); WorkerIndex++)
+	{
+		if (Workers[WorkerIndex] != nullptr && WorkerElapsedSeconds.IsValidIndex(WorkerIndex))
+		{
+			FMapBuildStageTiming& WorkerTiming = OutResult.StageTimings.AddDefaulted_GetRef();
+			WorkerTiming.Stage = *FString::Printf(TEXT("DoWork.%s"), *Workers[WorkerIndex]->GetClass()->GetName());
+			WorkerTiming.WallSeconds = WorkerElapsedSeconds[WorkerIndex];
+		}
+	}
+
+	return true;
+}
+
+bool UMapBuildBenchmarkCommandlet::SpawnWorkers(const FString& WorkerClassPaths)
+{
+	World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("MapBuildBenchmark"));
+	if (World == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("UMapBuildBenchmarkCommandlet::SpawnWorkers Failed to create world"));
+		return false;
+	}
+
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+
+	MapManager = World->SpawnActor<AMapManager>();
+	if (MapManager == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("UMapBuildBenchmarkCommandlet::SpawnWorkers Failed to spawn map manager"));
+		return false;
+	}
+
+	TArray<FString> ClassPaths;
+	WorkerClassPaths.ParseIntoArray(ClassPaths, TEXT(","));
+
+	TArray<AWorkerActor*> Workers;
+	for (const FString& ClassPath : ClassPaths)
+	{
+		UClass* WorkerClass = LoadClass<AWorkerActor>(nullptr, *ClassPath);
+		AWorkerActor* Worker = WorkerClass != nullptr ? World->SpawnActor<AWorkerActor>(WorkerClass) : nullptr;
+
+		if (Worker == nullptr)
+		{
+			UE_LOG(LogTemp, Error, TEXT("UMapBuildBenchmarkCommandlet::SpawnWorkers Failed to spawn worker %s"), *ClassPath);
+			return false;
+		}
+
+		Workers.Emplace(Worker);
+	}
+
+	MapManager->SetWorkers(Workers);
+
+	return true;
+}
+
+void UMapBuildBenchmarkCommandlet::DestroyWorld()
+{
+	if (World != nullptr)
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+		World = nullptr;
+		MapManager = nullptr;
+	}
+}
+
+TSharedRef<FJsonObject> UMapBuildBenchmarkCommandlet::MakeOutputSizesJson(const FMapBuildData& BuildData)
+{
+	TSharedRef<FJsonObject> Outputs = MakeShared<FJsonObject>();
+
+	auto AddArray = [&Outputs](const TCHAR* Name, const auto& Array)
+	{
+		TSharedRef<FJsonObject> Output = MakeShared<FJsonObject>();
+		Output->SetNumberField(TEXT("num"), Array.Num());
+		Output->SetNumberField(TEXT("bytes"), static_cast<double>(Array.GetAllocatedSize()));
+		Outputs->SetObjectField(Name, Output);
+	};
+
+	Outputs->SetNumberField(TEXT("width"), BuildData.Width);
+	Outputs->SetNumberField(TEXT("height"), BuildData.Height);
+	Outputs->SetNumberField(TEXT("track_length"), BuildData.TrackFrames.Length);
+
+	AddArray(TEXT("heights"), BuildData.Heights);
+	AddArray(TEXT("eroded_heights"), BuildData.ErodedHeights);
+	AddArray(TEXT("track_nodes"), BuildData.TrackNodes);
+	AddArray(TEXT("spline_points"), BuildData.SplinePoints);
+	AddArray(TEXT("track_frames"), BuildData.TrackFrames.Locations);
+	AddArray(TEXT("track_distance"), BuildData.TrackDistance);
+	AddArray(TEXT("terrain_vertices"), BuildData.TerrainVertices);
+	AddArray(TEXT("terrain_triangles"), BuildData.TerrainTriangles);
+	AddArray(TEXT("terrain_normals"), BuildData.TerrainNormals);
+	AddArray(TEXT("grass"), BuildData.GrassFoliageTransforms);
+	AddArray(TEXT("rocks"), BuildData.RocksTransforms);
+	AddArray(TEXT("trees"), BuildData.TreesTransforms);
+
+	return Outputs;
+}
+
+TArray<TSharedPtr<FJsonValue>> UMapBuildBenchmarkCommandlet::MakeStagesJson(const TArray<FIterationResult>& Results)
+{
+	struct FStageSamples
+	{
+		TArray<double> WallMs;
+		TArray<double> CPUMs;
+	};
+
+	// Stages keep the order of their first appearance
+	TArray<FName> StageOrder;
+	TMap<FName, FStageSamples> Samples;
+
+	for (const FIterationResult& Result : Results)
+	{
+		for (const FMapBuildStageTiming& Timing : Result.StageTimings)
+		{
+			if (!Samples.Contains(Timing.Stage))
+			{
+				StageOrder.Emplace(Timing.Stage);
+			}
+
+			FStageSamples& StageSamples = Samples.FindOrAdd(Timing.Stage);
+			StageSamples.WallMs.Emplace(Timing.WallSeconds * 1000.0);
+			StageSamples.CPUMs.Emplace(Timing.CPUSeconds * 1000.0);
+		}
+	}
+
+	auto MakeSummary = [](TArray<double> Values)
+	{
+		Values.Sort();
+
+		double Sum = 0.0;
+		for (const double Value : Values)
+		{
+			Sum += Value;
+		}
+
+		TSharedRef<FJsonObject> Summary = MakeShared<FJsonObject>();
+		Summary->SetNumberField(TEXT("min"), Values[0]);
+		Summary->SetNumberField(TEXT("median"), Values[Values.Num() / 2]);
+		Summary->SetNumberField(TEXT("mean"), Sum / Values.Num());
+		Summary->SetNumberField(TEXT("max"), Values.Last());
+		return Summary;
+	};
+
+	TArray<TSharedPtr<FJsonValue>> StagesJson;
+	for (const FName& Stage : StageOrder)
+	{
+		const FStageSamples& StageSamples = Samples[Stage];
+
+		TSharedRef<FJsonObject> StageJson = MakeShared<FJsonObject>();
+		StageJson->SetStringField(TEXT("name"), Stage.ToString());
+		StageJson->SetObjectField(TEXT("wall_ms"), MakeSummary(StageSamples.WallMs));
+		StageJson->SetObjectField(TEXT("cpu_ms"), MakeSummary(StageSamples.CPUMs));
+		StagesJson.Emplace(MakeShared<FJsonValueObject>(StageJson));
+	}
+
+	return StagesJson;
+}
@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "MapBuildPipeline.h"
+#include "MapBuildBenchmarkCommandlet.generated.h"
+
+class AMapManager;
+class FJsonObject;
+class FJsonValue;
+
+/**
+ *  Times the map build without a viewport and writes the results as JSON.
+ *
+ *  UnrealEditor-Cmd RacingEngineer.uproject -run=MapBuildBenchmark -nullrhi -unattended
+ *      -Image=<png> [-Seed=42] [-Iterations=5] [-NoiseFrequency=0.01] [-LightWeight]
+ *      [-Workers=<class path>,<class path>] [-BandRows=<rows>] [-ErosionIterations=<count>] [-Output=<json>]
+ *
+ *  Workers are spawned from the given classes into a transient world that is ticked by hand,
+ *  without them only the CPU stages of the pipeline are timed.
+ *  -BandRows builds the terrain out of core, a raw 8 bit square image (.r8) is then never held whole either.
+ */
+UCLASS()
+class RACINGENGINEER_API UMapBuildBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMapBuildBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	struct FIterationResult
+	{
+		TArray<FMapBuildStageTiming> StageTimings;
+
+		// Taken before the workers run, they move parts of the build data out
+		TSharedPtr<FJsonObject> OutputSizes;
+	};
+
+	bool RunIteration(const FString& ImagePath, const FMapBuildSettings& Settings, FIterationResult& OutResult);
+
+	bool RunWorkers(const TSharedRef<FMapBuildData>& BuildData, FIterationResult& OutResult);
+
+	bool SpawnWorkers(const FString& WorkerClassPaths);
+	void DestroyWorld();
+
+	static TSharedRef<FJsonObject> MakeOutputSizesJson(const FMapBuildData& BuildData);
+	static TArray<TSharedPtr<FJsonValue>> MakeStagesJson(const TArray<FIterationResult>& Results);
+
+	UPROPERTY()
+	TObjectPtr<UWorld> World;
+
+	UPROPERTY()
+	TObjectPtr<AMapManager> MapManager;
+
+	// Workers that don't call back within this many seconds fail the iteration
+	double WorkerTimeoutSeconds = 120.0;
+};
@@ -0,0 +1,262 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MapBuildCache.h"
+
+#include "MapBuildPipeline.h"
+#include "TerrainGenerator.h"
+#include "TerrainQuerySubsystem.h"
+#include "Hash/Blake3.h"
+#include "HAL/FileManager.h"
+
+FString FMapBuildCache::MakeKey(const TArray<FColor>& TextureColors, const uint32 Width, const uint32 Height, const FMapBuildSettings& Settings)
+{
+	// Banded builds keep their terrain in a file of their own, too large to be worth caching
+	if (TextureColors.IsEmpty() || static_cast<uint32>(TextureColors.Num()) != Width * Height || Settings.BandRows > 0)
+	{
+		return FString();
+	}
+
+	FBlake3 Hasher;
+	HashSettings(Hasher, Width, Height, Settings);
+	Hasher.Update(TextureColors.GetData(), TextureColors.Num() * TextureColors.GetTypeSize());
+
+	return LexToString(Hasher.Finalize());
+}
+
+void FMapBuildCache::HashSettings(FBlake3& Hasher, const uint32 Width, const uint32 Height, const FMapBuildSettings& Settings)
+{
+	auto HashValue = [&Hasher](const auto& Value)
+	{
+		Hasher.Update(&Value, sizeof(Value));
+	};
+
+	HashValue(CacheVersion);
+	HashValue(Width);
+	HashValue(Height);
+
+	HashValue(Settings.Seed);
+	HashValue(Settings.NoiseFrequency);
+	HashValue(Settings.NodeToSkip);
+	HashValue(Settings.VertScale.X);
+	HashValue(Settings.VertScale.Y);
+	HashValue(Settings.VertScale.Z);
+	HashValue(Settings.TrackWidth);
+	HashValue(Settings.TrackDepth);
+	HashValue(Settings.GrassFoliageProbability);
+	HashValue(Settings.RocksProbability);
+	HashValue(Settings.TreesProbability);
+	HashValue(Settings.bLightWeightMode);
+	HashValue(Settings.bStreamTerrain);
+	HashValue(Settings.bLandscapeTerrain);
+	HashValue(Settings.ErosionIterations);
+}
+
+FString FMapBuildCache::GetCacheFilePath(const FString& Key)
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), CacheDirName, Key + TEXT(".") + CacheFileExtension);
+}
+
+void FMapBuildCache::Serialize(FArchive& Ar, FMapBuildData& Data)
+{
+	// Everything is plain old data, so arrays are copied in one block instead of per element
+	Ar << Data.Width;
+	Ar << Data.Height;
+
+	Data.Heights.BulkSerialize(Ar);
+	Data.ErodedHeights.BulkSerialize(Ar);
+	Data.TrackNodes.BulkSerialize(Ar);
+	Data.SplinePoints.BulkSerialize(Ar);
+
+	Ar << Data.TrackFrames.SampleSpacing;
+	Ar << Data.TrackFrames.Length;
+	Data.TrackFrames.Locations.BulkSerialize(Ar);
+	Data.TrackFrames.Directions.BulkSerialize(Ar);
+	Data.TrackFrames.RacingLineOffsets.BulkSerialize(Ar);
+	Data.TrackFrames.RacingLineSpeeds.BulkSerialize(Ar);
+
+	Data.TrackDistance.BulkSerialize(Ar);
+	Data.TrackHeight.BulkSerialize(Ar);
+
+	Data.TerrainVertices.BulkSerialize(Ar);
+	Data.TerrainNormals.BulkSerialize(Ar);
+
+	Data.GrassFoliageTransforms.BulkSerialize(Ar);
+	Data.RocksTransforms.BulkSerialize(Ar);
+	Data.TreesTransforms.BulkSerialize(Ar);
+}
+
+bool FMapBuildCache::Load(const FString& Key, FMapBuildData& OutData)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FMapBuildCache::Load);
+
+	if (Key.IsEmpty())
+	{
+		return false;
+	}
+
+	const FString FilePath = GetCacheFilePath(Key);
+
+	// Read straight into the arrays, a missing file is just a miss
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*FilePath));
+	if (!Reader.IsValid())
+	{
+		return false;
+	}
+
+	uint32 Magic = 0;
+	int32 Version = 0;
+	FString StoredKey;
+	*Reader << Magic;
+	*Reader << Version;
+	*Reader << StoredKey;
+
+	if (Reader->IsError() || Magic != CacheMagic || Version != CacheVersion || StoredKey != Key)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("FMapBuildCache::Load %s is stale, it will be rebuilt"), *FilePath);
+		return false;
+	}
+
+	// Read into a data of its own, a damaged file leaves the pipeline's data as it was for the rebuild
+	FMapBuildData LoadedData;
+	LoadedData.Settings = OutData.Settings;
+
+	Serialize(*Reader, LoadedData);
+
+	const bool bReadSucceeded = !Reader->IsError() && Reader->Tell() == Reader->TotalSize();
+	Reader.Reset();
+
+	// Streamed terrain keeps no whole map mesh, its tiles are built from the heights and the distance field.
+	// Landscape terrain keeps the vertices but no normals
+	const int32 TexelsNum = LoadedData.Width * LoadedData.Height;
+	const int32 VerticesNum = LoadedData.Settings.bStreamTerrain ? 0 : TexelsNum;
+	const int32 NormalsNum = LoadedData.Settings.NeedsTerrainMesh() ? TexelsNum : 0;
+	if (!bReadSucceeded || LoadedData.Width != OutData.Width || LoadedData.Height != OutData.Height
+		|| LoadedData.Heights.Num() != TexelsNum || (!LoadedData.ErodedHeights.IsEmpty() && LoadedData.ErodedHeights.Num() != TexelsNum)
+		|| LoadedData.TrackDistance.Num() != TexelsNum
+		|| LoadedData.TerrainVertices.Num() != VerticesNum || LoadedData.TerrainNormals.Num() != NormalsNum)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("FMapBuildCache::Load %s is damaged, it will be rebuilt"), *FilePath);
+		return false;
+	}
+
+	// Triangles only depend on the grid size and are cheaper to rebuild than to read
+	if (LoadedData.Settings.NeedsTerrainMesh())
+	{
+		LoadedData.TerrainTriangles = ATerrainGenerator::CalculateTriangles(LoadedData.Width, LoadedData.Height);
+	}
+
+	// Derived from what was just read, like the triangles
+	LoadedData.TrackFrames.BuildSpatialIndex();
+	LoadedData.HeightField = FTerrainHeightField::Build(LoadedData);
+
+	// Cached builds are never banded, so nothing but the texture colors is left behind, and those aren't needed anymore
+	OutData = MoveTemp(LoadedData);
+
+	// The modification time is what the eviction goes by, access times are often not kept
+	IFileManager::Get().SetTimeStamp(*FilePath, FDateTime::UtcNow());
+
+	return true;
+}
+
+bool FMapBuildCache::Save(const FString& Key, const FMapBuildData& Data)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FMapBuildCache::Save);
+
+	if (Key.IsEmpty() || Data.TrackNodes.IsEmpty())
+	{
+		return false;
+	}
+
+	const FString FilePath = GetCacheFilePath(Key);
+	const FString TempFilePath = FilePath + TEXT(".tmp");
+
+	// Written next to the final file and moved over it, so a crash never leaves a half written cache
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*TempFilePath));
+	if (!Writer.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("FMapBuildCache::Save Failed to create %s"), *TempFilePath);
+		return false;
+	}
+
+	uint32 Magic = CacheMagic;
+	int32 Version = CacheVersion;
+	FString StoredKey = Key;
+	*Writer << Magic;
+	*Writer << Version;
+	*Writer << StoredKey;
+
+	Serialize(*Writer, const_cast<FMapBuildData&>(Data));
+
+	const bool bWriteSucceeded = Writer->Close();
+	Writer.Reset();
+
+	if (!bWriteSucceeded || !IFileManager::Get().Move(*FilePath, *TempFilePath, true, true))
+	{
+		UE_LOG(LogTemp, Error, TEXT("FMapBuildCache::Save Failed to write %s"), *FilePath);
+		IFileManager::Get().Delete(*TempFilePath, false, false, true);
+		return false;
+	}
+
+	EvictLeastRecentlyUsed(FilePath);
+
+	return true;
+}
+
+void FMapBuildCache::EvictLeastRecentlyUsed(const FString& KeptFilePath)
+{
+	struct FCacheFile
+	{
+		FString Path;
+		int64 Size = 0;
+		FDateTime LastUsed;
+	};
+
+	TArray<FCacheFile> CacheFiles;
+	int64 CacheSize = 0;
+
+	const FString CacheDirPath = FPaths::Combine(FPaths::ProjectSavedDir(), CacheDirName);
+	IFileManager::Get().IterateDirectoryStat(*CacheDirPath, [&CacheFiles, &CacheSize](const TCHAR* Path, const FFileStatData& StatData)
+		{
+			if (!StatData.bIsDirectory && FPaths::GetExtension(Path) == CacheFileExtension)
+			{
+				CacheFiles.Add({ Path, StatData.FileSize, StatData.ModificationTime });
+				CacheSize += StatData.FileSize;
+			}
+
+			return true;
+		});
+
+	if (CacheSize <= MaxCacheSize)
+	{
+		return;
+	}
+
+	CacheFiles.Sort([](const FCacheFile& A, const FCacheFile& B)
+		{
+			return A.LastUsed < B.LastUsed;
+		});
+
+	int32 EvictedNum = 0;
+	for (const FCacheFile& CacheFile : CacheFiles)
+	{
+		if (CacheSize <= MaxCacheSize)
+		{
+			break;
+		}
+
+		// The file just written is kept even when it is larger than the whole budget
+		if (FPaths::IsSamePath(CacheFile.Path, KeptFilePath))
+		{
+			continue;
+		}
+
+		if (IFileManager::Get().Delete(*CacheFile.Path, false, false, true))
+		{
+			CacheSize -= CacheFile.Size;
+			EvictedNum++;
+		}
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("FMapBuildCache::EvictLeastRecentlyUsed Evicted %d files, %lld bytes left"), EvictedNum, CacheSize);
+}
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FBlake3;
+struct FMapBuildData;
+struct FMapBuildSettings;
+
+/**
+ *  On-disk cache of the CPU side of the map build, one file per map under Saved/MapBuildCache.
+ *  Files are keyed by a hash of the texture pixels, the texture size and every build setting.
+ *  The least recently used files are evicted once the directory grows past MaxCacheSize.
+ */
+class RACINGENGINEER_API FMapBuildCache
+{
+public:
+	// Bump whenever the file layout or the output of any pipeline stage changes
+	static constexpr int32 CacheVersion = 4;
+
+	// Keyed by the decoded pixels, so a map picked in the menu and the same map loaded from a save slot share their file.
+	// Empty when the texture colors are missing, such builds are never cached
+	static FString MakeKey(const TArray<FColor>& TextureColors, const uint32 Width, const uint32 Height, const FMapBuildSettings& Settings);
+
+	// Fills everything the pipeline would produce, returns false on a miss or a stale or damaged file, OutData is left as it was then
+	static bool Load(const FString& Key, FMapBuildData& OutData);
+
+	static bool Save(const FString& Key, const FMapBuildData& Data);
+
+	static FString GetCacheFilePath(const FString& Key);
+
+private:
+	static void HashSettings(FBlake3& Hasher, const uint32 Width, const uint32 Height, const FMapBuildSettings& Settings);
+
+	static void Serialize(FArchive& Ar, FMapBuildData& Data);
+
+	// Deletes the least recently loaded or saved files until the directory fits MaxCacheSize
+	static void EvictLeastRecentlyUsed(const FString& KeptFilePath);
+
+	static inline FString CacheDirName = TEXT("MapBuildCache");
+	static inline FString CacheFileExtension = TEXT("mapcache");
+	static constexpr uint32 CacheMagic = 0x524D4243; // RMBC
+
+	// A 2048x2048 map takes about 100MB
+	static constexpr int64 MaxCacheSize = 2ll * 1024 * 1024 * 1024;
+};
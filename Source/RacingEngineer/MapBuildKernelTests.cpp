@@ -0,0 +1,394 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MapManager.h"
+#include "TerrainGenerator.h"
+#include "MapBuildPipeline.h"
+#include "Dom/JsonObject.h"
+#include "Engine/Texture2D.h"
+#include "Hash/Blake3.h"
+#include "HAL/FileManager.h"
+#include "ImageCore.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "TerrainGrid.h"
+#include "TerrainNoise.h"
+
+// The height maps are read from their source data, which only editor builds keep
+#if WITH_DEV_AUTOMATION_TESTS && WITH_EDITORONLY_DATA
+
+namespace MapBuildKernelTests
+{
+	constexpr int32 GoldenVersion = 4;
+
+	// Steps of FindNextTrackNode checked on their own, CreateTrack covers the whole loop
+	constexpr int32 FindNextSteps = 64;
+
+	constexpr int32 Repeats = 5;
+
+	// Budgets below this are timer noise
+	constexpr double MinBudgetMs = 0.05;
+
+	struct FKernelResult
+	{
+		FString Name;
+		FString Hash;
+		double MedianMs = 0.0;
+	};
+
+	FString GetGoldenPath()
+	{
+		return FPaths::Combine(FPaths::ProjectDir(), TEXT("Build"), TEXT("MapBuildGolden.json"));
+	}
+
+	FString HashBytes(const void* Data, int64 Size)
+	{
+		return LexToString(FBlake3::HashBuffer(Data, Size));
+	}
+
+	// Floating point outputs are quantised first, so the last bits a compiler may change don't matter
+	template <typename VectorType>
+	FString HashQuantized(const TArray<VectorType>& Vectors, double Step)
+	{
+		constexpr int32 ComponentsNum = sizeof(VectorType) / sizeof(typename VectorType::FReal);
+
+		TArray<int64> Quantized;
+		Quantized.Reserve(Vectors.Num() * ComponentsNum);
+
+		for (const VectorType& Vector : Vectors)
+		{
+			for (int32 Component = 0; Component < ComponentsNum; Component++)
+			{
+				Quantized.Emplace(FMath::RoundToInt64(Vector[Component] / Step));
+			}
+		}
+
+		return HashBytes(Quantized.GetData(), Quantized.Num() * sizeof(int64));
+	}
+
+	// Median wall time of Repeats runs of Kernel, which returns the hash of its output
+	FKernelResult RunKernel(FAutomationTestBase& Test, const FString& Name, TFunctionRef<FString()> Kernel)
+	{
+		FKernelResult Result;
+		Result.Name = Name;
+
+		TArray<double> TimesMs;
+		TimesMs.Reserve(Repeats);
+
+		for (int32 Repeat = 0; Repeat < Repeats; Repeat++)
+		{
+			const double Start = FPlatformTime::Seconds();
+			const FString Hash = Kernel();
+			TimesMs.Emplace((FPlatformTime::Seconds() - Start) * 1000.0);
+
+			// A kernel giving different results between runs is as broken as a wrong one
+			if (!Result.Hash.IsEmpty() && Result.Hash != Hash)
+			{
+				Test.AddError(FString::Printf(TEXT("%s isn't deterministic"), *Name));
+				break;
+			}
+
+			Result.Hash = Hash;
+		}
+
+		TimesMs.Sort();
+		Result.MedianMs = TimesMs[TimesMs.Num() / 2];
+
+		return Result;
+	}
+
+	// Median wall time of a fixed workload, the unit kernel costs are stored in
+	double RunCalibration()
+	{
+		TArray<double> TimesMs;
+		TimesMs.Reserve(Repeats);
+		float Checksum = 0.0f;
+
+		for (int32 Repeat = 0; Repeat < Repeats; Repeat++)
+		{
+			const double Start = FPlatformTime::Seconds();
+
+			// Some arithmetic and some memory traffic, like the kernels, on one thread
+			const FTerrainNoise Noise(1, 0.01f);
+			float Sum = 0.0f;
+			for (uint32 y = 0; y < 256; y++)
+			{
+				for (uint32 x = 0; x < 256; x++)
+				{
+					Sum += Noise.GetNoise2D(x, y);
+				}
+			}
+
+			const TArray<int32> Triangles = FTerrainGrid::CalculateTriangles(256, 256);
+			Checksum += Sum + Triangles.Last();
+
+			TimesMs.Emplace((FPlatformTime::Seconds() - Start) * 1000.0);
+		}
+
+		TimesMs.Sort();
+		UE_LOG(LogTemp, Verbose, TEXT("MapBuildKernelTests::RunCalibration %fms, checksum %f"), TimesMs[TimesMs.Num() / 2], Checksum);
+
+		return FMath::Max(TimesMs[TimesMs.Num() / 2], UE_DOUBLE_SMALL_NUMBER);
+	}
+
+	// Loads the source pixels of a texture asset, so nothing depends on the RHI or the platform's compressed format
+	bool LoadHeightMap(const FString& TexturePath, TArray<FColor>& OutColors, uint32& OutWidth, uint32& OutHeight)
+	{
+		UTexture2D* Texture = LoadObject<UTexture2D>(nullptr, *TexturePath);
+		FImage SourceImage;
+
+		if (Texture == nullptr || !Texture->Source.GetMipImage(SourceImage, 0, 0, 0))
+		{
+			return false;
+		}
+
+		SourceImage.ChangeFormat(ERawImageFormat::BGRA8, EGammaSpace::sRGB);
+
+		const TArrayView64<FColor> SourceColors = SourceImage.AsBGRA8();
+		OutColors = TArray<FColor>(SourceColors.GetData(), SourceColors.Num());
+		OutWidth = SourceImage.SizeX;
+		OutHeight = SourceImage.SizeY;
+
+		return true;
+	}
+
+	void RunKernels(FAutomationTestBase& Test, const FString& Name, TConstArrayView<FColor> SourceColors, const uint32 Width, const uint32 Height,
+		TArray<FKernelResult>& OutResults)
+	{
+		const FString Prefix = Name + TEXT(".");
+
+		// Laid out like a locked mip, narrow textures have their rows padded to 256 bytes
+		constexpr uint32 RowAlignment = 256;
+		const uint32 RowPitch = Width < RowAlignment / sizeof(FColor) ? RowAlignment : Width * sizeof(FColor);
+
+		TArray<uint8> MipData;
+		MipData.SetNumZeroed(RowPitch * Height);
+		for (uint32 y = 0; y < Height; y++)
+		{
+			FMemory::Memcpy(MipData.GetData() + y * RowPitch, SourceColors.GetData() + y * Width, Width * sizeof(FColor));
+		}
+
+		TArray<FColor> Colors;
+		OutResults.Emplace(RunKernel(Test, Prefix + TEXT("GetColors"), [&]
+			{
+				Colors.SetNumUninitialized(Width * Height);
+				AMapManager::GetColors(Colors, MipData.GetData(), Width, Height);
+				return HashBytes(Colors.GetData(), Colors.Num() * sizeof(FColor));
+			}));
+
+		const uint8 NodeToSkip = AMapManager::CalculateNodeToSkip(Height, Width);
+		const FVector VertScale = AMapManager::CalculateVertScale(Height, Width);
+
+		OutResults.Emplace(RunKernel(Test, Prefix + TEXT("CreateTrack"), [&]
+			{
+				const TArray<FVector2D> TrackNodes = AMapManager::CreateTrack(Colors, Height, Width, NodeToSkip);
+				return HashBytes(TrackNodes.GetData(), TrackNodes.Num() * sizeof(FVector2D));
+			}));
+
+		OutResults.Emplace(RunKernel(Test, Prefix + TEXT("FindNextTrackNode"), [&]
+			{
+				TArray<FTrackNode> Nodes;
+				Nodes.Emplace(AMapManager::FindFirstTrackNode(Colors, Height, Width));
+
+				for (int32 Step = 0; Step < FindNextSteps; Step++)
+				{
+					Nodes.Emplace(AMapManager::FindNextTrackNode(Colors, Width, Nodes.Last()));
+				}
+
+				FBlake3 Hasher;
+				for (const FTrackNode& Node : Nodes)
+				{
+					Hasher.Update(&Node.Position, sizeof(Node.Position));
+					Hasher.Update(&Node.PrevPointDirection, sizeof(Node.PrevPointDirection));
+				}
+				return LexToString(Hasher.Finalize());
+			}));
+
+		TArray<uint8> Heights;
+		OutResults.Emplace(RunKernel(Test, Prefix + TEXT("GenerateHeightFromNoise"), [&]
+			{
+				Heights = AMapManager::GenerateHeightFromNoise(Height, Width, 0.01f, 42);
+				return HashBytes(Heights.GetData(), Heights.Num());
+			}));
+
+		TArray<int32> Triangles;
+		OutResults.Emplace(RunKernel(Test, Prefix + TEXT("CalculateTriangles"), [&]
+			{
+				Triangles = ATerrainGenerator::CalculateTriangles(Width, Height);
+				return HashBytes(Triangles.GetData(), Triangles.Num() * sizeof(int32));
+			}));
+
+		OutResults.Emplace(RunKernel(Test, Prefix + TEXT("CalculateUVs"), [&]
+			{
+				return HashQuantized(ATerrainGenerator::CalculateUVs(Width, Height), 1e-5);
+			}));
+
+		// Terrain without the track carved in, the normals only need a non flat surface
+		TArray<FVector3f> Vertices;
+		Vertices.SetNumUninitialized(Width * Height);
+		for (uint32 y = 0; y < Height; y++)
+		{
+			for (uint32 x = 0; x < Width; x++)
+			{
+				FVector Vertex = FMapBuildPipeline::GetTexelLocation(x, y, Width, Height, VertScale);
+				Vertex.Z = (Heights[y * Width + x] - 127) / 255.0 * VertScale.Z;
+				Vertices[y * Width + x] = FVector3f(Vertex);
+			}
+		}
+
+		OutResults.Emplace(RunKernel(Test, Prefix + TEXT("CalculateNormals"), [&]
+			{
+				// Packing already quantises the normals
+				const TArray<FOctahedralNormal> Normals = ATerrainGenerator::CalculateNormals(Vertices, Triangles, Width, Height);
+				return HashBytes(Normals.GetData(), Normals.Num() * sizeof(FOctahedralNormal));
+			}));
+	}
+
+	TSharedPtr<FJsonObject> ReadGolden()
+	{
+		FString GoldenString;
+		TSharedPtr<FJsonObject> Golden;
+
+		if (!FFileHelper::LoadFileToString(GoldenString, *GetGoldenPath())
+			|| !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(GoldenString), Golden) || !Golden.IsValid()
+			|| Golden->GetIntegerField(TEXT("version")) != GoldenVersion)
+		{
+			return nullptr;
+		}
+
+		return Golden;
+	}
+
+	// Every height map is its own test, so each one adds its kernels to what the others recorded
+	bool RecordGolden(FAutomationTestBase& Test, const TArray<FKernelResult>& Results, double CalibrationMs)
+	{
+		TSharedPtr<FJsonObject> Golden = ReadGolden();
+		if (!Golden.IsValid())
+		{
+			Golden = MakeShared<FJsonObject>();
+			Golden->SetNumberField(TEXT("version"), GoldenVersion);
+			Golden->SetObjectField(TEXT("kernels"), MakeShared<FJsonObject>());
+		}
+
+		const TSharedPtr<FJsonObject> Kernels = Golden->GetObjectField(TEXT("kernels"));
+		for (const FKernelResult& Result : Results)
+		{
+			TSharedRef<FJsonObject> Kernel = MakeShared<FJsonObject>();
+			Kernel->SetStringField(TEXT("hash"), Result.Hash);
+			Kernel->SetNumberField(TEXT("cost"), Result.MedianMs / CalibrationMs);
+			Kernels->SetObjectField(Result.Name, Kernel);
+		}
+
+		FString GoldenString;
+		FJsonSerializer::Serialize(Golden.ToSharedRef(), TJsonWriterFactory<>::Create(&GoldenString));
+
+		if (!FFileHelper::SaveStringToFile(GoldenString, *GetGoldenPath()))
+		{
+			Test.AddError(FString::Printf(TEXT("Failed to write %s"), *GetGoldenPath()));
+			return false;
+		}
+
+		Test.AddInfo(FString::Printf(TEXT("Recorded %d kernels to %s"), Results.Num(), *GetGoldenPath()));
+		return true;
+	}
+
+	void CheckGolden(FAutomationTestBase& Test, const TArray<FKernelResult>& Results, double CalibrationMs)
+	{
+		const TSharedPtr<FJsonObject> Golden = ReadGolden();
+		if (!Golden.IsValid())
+		{
+			Test.AddError(FString::Printf(TEXT("No golden file of version %d at %s, run the tests once with -MapBuildRecordGolden"),
+				GoldenVersion, *GetGoldenPath()));
+			return;
+		}
+
+		// Costs are relative to a fixed workload timed in the same run, so a golden file holds on faster and slower machines
+		double BudgetTolerance = 3.0;
+		FParse::Value(FCommandLine::Get(), TEXT("MapBuildBudgetTolerance="), BudgetTolerance);
+		const bool bIgnoreBudgets = FParse::Param(FCommandLine::Get(), TEXT("MapBuildIgnoreBudgets"));
+
+		const TSharedPtr<FJsonObject> Kernels = Golden->GetObjectField(TEXT("kernels"));
+
+		for (const FKernelResult& Result : Results)
+		{
+			const TSharedPtr<FJsonObject>* Kernel = nullptr;
+			if (!Kernels->TryGetObjectField(Result.Name, Kernel))
+			{
+				Test.AddError(FString::Printf(TEXT("%s has no golden output, run the tests once with -MapBuildRecordGolden"), *Result.Name));
+				continue;
+			}
+
+			if (Result.Hash != (*Kernel)->GetStringField(TEXT("hash")))
+			{
+				Test.AddError(FString::Printf(TEXT("%s output differs from golden"), *Result.Name));
+			}
+
+			const double BudgetMs = FMath::Max((*Kernel)->GetNumberField(TEXT("cost")) * CalibrationMs * BudgetTolerance, MinBudgetMs);
+			const FString Timing = FString::Printf(TEXT("%s took %fms, budget is %fms"), *Result.Name, Result.MedianMs, BudgetMs);
+
+			if (Result.MedianMs <= BudgetMs)
+			{
+				Test.AddInfo(Timing);
+			}
+			else if (bIgnoreBudgets)
+			{
+				Test.AddWarning(Timing);
+			}
+			else
+			{
+				Test.AddError(Timing);
+			}
+		}
+	}
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FMapBuildKernelsTest, "RacingEngineer.MapBuild.KernelsMatchGolden",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+void FMapBuildKernelsTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	// Every height map bundled with the game, 16, 256 and 512 texels
+	TArray<FString> HeightMapFiles;
+	IFileManager::Get().FindFiles(HeightMapFiles, *FPaths::Combine(FPaths::ProjectContentDir(), TEXT("HeightMaps")), TEXT(".uasset"));
+	HeightMapFiles.Sort();
+
+	for (const FString& HeightMapFile : HeightMapFiles)
+	{
+		const FString AssetName = FPaths::GetBaseFilename(HeightMapFile);
+
+		OutBeautifiedNames.Emplace(AssetName);
+		OutTestCommands.Emplace(FString::Printf(TEXT("/Game/HeightMaps/%s.%s"), *AssetName, *AssetName));
+	}
+}
+
+bool FMapBuildKernelsTest::RunTest(const FString& Parameters)
+{
+	TArray<FColor> Colors;
+	uint32 Width = 0;
+	uint32 Height = 0;
+
+	if (!MapBuildKernelTests::LoadHeightMap(Parameters, Colors, Width, Height))
+	{
+		AddError(FString::Printf(TEXT("Failed to load %s"), *Parameters));
+		return false;
+	}
+
+	TArray<MapBuildKernelTests::FKernelResult> Results;
+	MapBuildKernelTests::RunKernels(*this, FPackageName::ObjectPathToObjectName(Parameters), Colors, Width, Height, Results);
+
+	const double CalibrationMs = MapBuildKernelTests::RunCalibration();
+
+	if (FParse::Param(FCommandLine::Get(), TEXT("MapBuildRecordGolden")))
+	{
+		return MapBuildKernelTests::RecordGolden(*this, Results, CalibrationMs);
+	}
+
+	MapBuildKernelTests::CheckGolden(*this, Results, CalibrationMs);
+	return true;
+}
+
+#endif
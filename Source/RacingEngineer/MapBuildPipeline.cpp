@@ -0,0 +1,1218 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MapBuildPipeline.h"
+
+#include "RacingEngineer.h"
+#include "MapManager.h"
+#include "MapBuildCache.h"
+#include "TerrainGenerator.h"
+#include "FoliageScatter.h"
+#include "RacingLine.h"
+#include "TerrainErosion.h"
+#include "TerrainHeightFile.h"
+#include "TerrainQuerySubsystem.h"
+#include "Async/ParallelFor.h"
+#include "Async/Async.h"
+#include "Engine/Texture2D.h"
+#include "ImageUtils.h"
+#include "HAL/PlatformFileManager.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "RenderingThread.h"
+#include "TextureResource.h"
+
+#if PLATFORM_WINDOWS
+#include "Windows/WindowsHWrapper.h"
+#elif PLATFORM_UNIX || PLATFORM_MAC
+#include <sys/resource.h>
+#endif
+
+bool FMapBuildSettings::IsCompatibleWith(const FMapBuildSettings& Other) const
+{
+	return FMath::IsNearlyEqual(NoiseFrequency, Other.NoiseFrequency)
+		&& NodeToSkip == Other.NodeToSkip
+		&& VertScale.Equals(Other.VertScale)
+		&& FMath::IsNearlyEqual(TrackWidth, Other.TrackWidth)
+		&& FMath::IsNearlyEqual(TrackDepth, Other.TrackDepth)
+		&& FMath::IsNearlyEqual(GrassFoliageProbability, Other.GrassFoliageProbability)
+		&& FMath::IsNearlyEqual(RocksProbability, Other.RocksProbability)
+		&& FMath::IsNearlyEqual(TreesProbability, Other.TreesProbability)
+		&& bLightWeightMode == Other.bLightWeightMode
+		&& bStreamTerrain == Other.bStreamTerrain
+		&& bLandscapeTerrain == Other.bLandscapeTerrain
+		&& BandRows == Other.BandRows
+		&& ErosionIterations == Other.ErosionIterations;
+}
+
+#pragma region TrackFrameTable
+
+float FTrackFrameTable::WrapDistance(float Distance) const
+{
+	if (Length <= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	Distance = FMath::Fmod(Distance, Length);
+	return Distance < 0.0f ? Distance + Length : Distance;
+}
+
+FVector FTrackFrameTable::GetLocationAtDistance(float Distance) const
+{
+	if (IsEmpty())
+	{
+		return FVector::ZeroVector;
+	}
+
+	const float Sample = WrapDistance(Distance) / SampleSpacing;
+	const int32 Index = FMath::Min(FMath::FloorToInt32(Sample), Num() - 1);
+
+	return FMath::Lerp(Locations[Index], Locations[(Index + 1) % Num()], Sample - Index);
+}
+
+FVector FTrackFrameTable::GetDirectionAtDistance(float Distance) const
+{
+	if (IsEmpty())
+	{
+		return FVector::ForwardVector;
+	}
+
+	const float Sample = WrapDistance(Distance) / SampleSpacing;
+	const int32 Index = FMath::Min(FMath::FloorToInt32(Sample), Num() - 1);
+
+	return FMath::Lerp(Directions[Index], Directions[(Index + 1) % Num()], Sample - Index).GetSafeNormal();
+}
+
+FVector FTrackFrameTable::GetRightVectorAtIndex(int32 Index) const
+{
+	return FVector::CrossProduct(FVector::UpVector, Directions[Index]).GetSafeNormal();
+}
+
+int32 FTrackFrameTable::FindClosestIndex(const FVector& Location, int32 HintIndex, int32 SearchRadius) const
+{
+	const int32 SamplesNum = Num();
+	if (SamplesNum == 0)
+	{
+		return INDEX_NONE;
+	}
+
+	const bool bWholeLoop = !Locations.IsValidIndex(HintIndex) || SearchRadius * 2 + 1 >= SamplesNum;
+	if (bWholeLoop && !SpatialIndex.IsEmpty())
+	{
+		float Alpha = 0.0f;
+		const int32 Segment = SpatialIndex.FindClosestSegment(FVector2D(Location), Alpha);
+
+		return Alpha < 0.5f ? Segment : (Segment + 1) % SamplesNum;
+	}
+
+	if (bWholeLoop)
+	{
+		HintIndex = 0;
+		SearchRadius = SamplesNum / 2;
+	}
+
+	int32 ClosestIndex = HintIndex;
+	int32 ClosestOffset = 0;
+	double ClosestDistanceSquared = TNumericLimits<double>::Max();
+
+	for (int32 Offset = -SearchRadius; Offset <= SearchRadius; Offset++)
+	{
+		const int32 Index = ((HintIndex + Offset) % SamplesNum + SamplesNum) % SamplesNum;
+		const double DistanceSquared = FVector::DistSquared2D(Locations[Index], Location);
+
+		if (DistanceSquared < ClosestDistanceSquared)
+		{
+			ClosestDistanceSquared = DistanceSquared;
+			ClosestIndex = Index;
+			ClosestOffset = Offset;
+		}
+	}
+
+	if (!bWholeLoop && FMath::Abs(ClosestOffset) == SearchRadius)
+	{
+		return FindClosestIndex(Location, INDEX_NONE, SamplesNum);
+	}
+
+	return ClosestIndex;
+}
+
+float FTrackFrameTable::FindClosestDistance(const FVector& Location) const
+{
+	if (IsEmpty())
+	{
+		return 0.0f;
+	}
+
+	if (SpatialIndex.IsEmpty())
+	{
+		return FindClosestIndex(Location, INDEX_NONE, 0) * SampleSpacing;
+	}
+
+	float Alpha = 0.0f;
+	const int32 Segment = SpatialIndex.FindClosestSegment(FVector2D(Location), Alpha);
+
+	return WrapDistance((Segment + Alpha) * SampleSpacing);
+}
+
+void FTrackFrameTable::BuildSpatialIndex()
+{
+	// A few samples per cell keeps both the cells and the segments per cell few
+	constexpr float SamplesPerCell = 8.0f;
+
+	SpatialIndex.Build(Locations, FMath::Max(SampleSpacing * SamplesPerCell, 1.0f));
+}
+
+FVector FTrackFrameTable::GetRacingLineLocationAtIndex(int32 Index) const
+{
+	return Locations[Index] + GetRightVectorAtIndex(Index) * RacingLineOffsets[Index];
+}
+
+FVector FTrackFrameTable::GetRacingLineLocationAtDistance(float Distance) const
+{
+	if (!HasRacingLine())
+	{
+		return GetLocationAtDistance(Distance);
+	}
+
+	const float Sample = WrapDistance(Distance) / SampleSpacing;
+	const int32 Index = FMath::Min(FMath::FloorToInt32(Sample), Num() - 1);
+
+	return FMath::Lerp(GetRacingLineLocationAtIndex(Index), GetRacingLineLocationAtIndex((Index + 1) % Num()), Sample - Index);
+}
+
+float FTrackFrameTable::GetRacingLineSpeedAtDistance(float Distance) const
+{
+	if (!HasRacingLine())
+	{
+		return 0.0f;
+	}
+
+	const float Sample = WrapDistance(Distance) / SampleSpacing;
+	const int32 Index = FMath::Min(FMath::FloorToInt32(Sample), Num() - 1);
+
+	return FMath::Lerp(RacingLineSpeeds[Index], RacingLineSpeeds[(Index + 1) % Num()], Sample - Index);
+}
+
+#pragma endregion
+
+#pragma region MapBuildTask
+
+FMapBuildTask::FMapBuildTask(UTexture2D* InTexture, const FMapBuildSettings& InSettings)
+	: Texture(InTexture)
+	, Data(MakeShared<FMapBuildData>())
+	, bCancelled(MakeShared<std::atomic<bool>>(false))
+{
+	check(IsInGameThread());
+	check(InTexture != nullptr);
+
+	Data->Settings = InSettings;
+	Data->Width = InTexture->GetSizeX();
+	Data->Height = InTexture->GetSizeY();
+
+	UE::Tasks::FTaskEvent ColorsReadEvent(UE_SOURCE_LOCATION);
+	FMapBuildPipeline::ReadTextureColors(InTexture, Data, ColorsReadEvent);
+
+	// Everything the task reads is owned by it, so the handle can go away while it runs
+	Task = UE::Tasks::Launch(UE_SOURCE_LOCATION, [BuildData = Data, bCancelled = bCancelled]
+		{
+			if (*bCancelled)
+			{
+				return;
+			}
+
+			// The key needs the texture colors, which are released by the stages
+			const FString CacheKey = FMapBuildCache::MakeKey(BuildData->TextureColors, BuildData->Width, BuildData->Height, BuildData->Settings);
+
+			if (FMapBuildCache::Load(CacheKey, *BuildData))
+			{
+				BuildData->bLoadedFromCache = true;
+				UE_LOG(LogTemp, Log, TEXT("FMapBuildTask Loaded map build from cache %s"), *CacheKey);
+			}
+			else
+			{
+				FMapBuildPipeline::RunStages(*BuildData, nullptr, &bCancelled.Get());
+
+				// A cancelled build skipped stages, it must not end up in the cache
+				if (!*bCancelled)
+				{
+					FMapBuildCache::Save(CacheKey, *BuildData);
+				}
+			}
+		},
+		UE::Tasks::Prerequisites(ColorsReadEvent));
+}
+
+FMapBuildTask::~FMapBuildTask()
+{
+	Cancel();
+}
+
+void FMapBuildTask::Cancel()
+{
+	*bCancelled = true;
+}
+
+void FMapBuildTask::OnCompleted(FOnMapBuildCompleted Callback) const
+{
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [BuildData = Data, bCancelled = bCancelled, Callback = MoveTemp(Callback)]() mutable
+		{
+			AsyncTask(ENamedThreads::GameThread, [BuildData, bCancelled, Callback = MoveTemp(Callback)]
+				{
+					if (!*bCancelled)
+					{
+						Callback.ExecuteIfBound(BuildData);
+					}
+				});
+		},
+		UE::Tasks::Prerequisites(Task));
+}
+
+#pragma endregion
+
+TSharedRef<FMapBuildTask> FMapBuildPipeline::Launch(UTexture2D* Texture, const FMapBuildSettings& Settings)
+{
+	return MakeShared<FMapBuildTask>(Texture, Settings);
+}
+
+bool FMapBuildPipeline::LoadImageColors(const FString& ImagePath, FMapBuildData& OutData)
+{
+	FImage Image;
+	if (!FImageUtils::LoadImage(*ImagePath, Image))
+	{
+		UE_LOG(LogTemp, Error, TEXT("FMapBuildPipeline::LoadImageColors Failed to load image from %s"), *ImagePath);
+		return false;
+	}
+
+	// Same layout ReadTextureColors gets from a PF_B8G8R8A8 texture
+	Image.ChangeFormat(ERawImageFormat::BGRA8, EGammaSpace::sRGB);
+
+	OutData.Width = Image.SizeX;
+	OutData.Height = Image.SizeY;
+	const TArrayView64<FColor> ImageColors = Image.AsBGRA8();
+	OutData.TextureColors = TArray<FColor>(ImageColors.GetData(), static_cast<int32>(ImageColors.Num()));
+
+	return true;
+}
+
+bool FMapBuildPipeline::LoadImageTrackMask(const FString& ImagePath, FMapBuildData& OutData)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FMapBuildPipeline::LoadImageTrackMask);
+
+	const FString Extension = FPaths::GetExtension(ImagePath);
+
+	if (Extension.Equals(TEXT("r8"), ESearchCase::IgnoreCase) || Extension.Equals(TEXT("raw"), ESearchCase::IgnoreCase))
+	{
+		TUniquePtr<IFileHandle> FileHandle(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*ImagePath));
+		if (!FileHandle.IsValid())
+		{
+			UE_LOG(LogTemp, Error, TEXT("FMapBuildPipeline::LoadImageTrackMask Failed to open %s"), *ImagePath);
+			return false;
+		}
+
+		// Raw images have no header, they are expected to be square
+		const int64 FileSize = FileHandle->Size();
+		const uint32 Side = static_cast<uint32>(FMath::Sqrt(static_cast<double>(FileSize)));
+		if (Side < 2 || static_cast<int64>(Side) * Side != FileSize)
+		{
+			UE_LOG(LogTemp, Error, TEXT("FMapBuildPipeline::LoadImageTrackMask %s isn't a square 8 bit image"), *ImagePath);
+			return false;
+		}
+
+		OutData.Width = Side;
+		OutData.Height = Side;
+		OutData.TrackMask.Init(Side, Side);
+
+		constexpr uint32 RowsPerRead = 64;
+		TArray<uint8> Rows;
+
+		for (uint32 FirstRow = 0; FirstRow < Side; FirstRow += RowsPerRead)
+		{
+			const uint32 RowsNum = FMath::Min(RowsPerRead, Side - FirstRow);
+			Rows.SetNumUninitialized(RowsNum * Side, false);
+
+			if (!FileHandle->Read(Rows.GetData(), Rows.Num()))
+			{
+				UE_LOG(LogTemp, Error, TEXT("FMapBuildPipeline::LoadImageTrackMask Failed to read %s"), *ImagePath);
+				OutData.TrackMask.Reset();
+				return false;
+			}
+
+			for (uint32 Row = 0; Row < RowsNum; Row++)
+			{
+				OutData.TrackMask.SetRow(FirstRow + Row, TConstArrayView<uint8>(Rows).Slice(Row * Side, Side));
+			}
+		}
+
+		return true;
+	}
+
+	// Compressed formats have to be decoded whole, only the mask is kept afterwards
+	FImage Image;
+	if (!FImageUtils::LoadImage(*ImagePath, Image))
+	{
+		UE_LOG(LogTemp, Error, TEXT("FMapBuildPipeline::LoadImageTrackMask Failed to load image from %s"), *ImagePath);
+		return false;
+	}
+
+	Image.ChangeFormat(ERawImageFormat::BGRA8, EGammaSpace::sRGB);
+
+	OutData.Width = Image.SizeX;
+	OutData.Height = Image.SizeY;
+	OutData.TrackMask.Init(OutData.Width, OutData.Height);
+
+	const TArrayView64<FColor> ImageColors = Image.AsBGRA8();
+	for (uint32 Y = 0; Y < OutData.Height; Y++)
+	{
+		OutData.TrackMask.SetRow(Y, TConstArrayView<FColor>(ImageColors.GetData() + static_cast<int64>(Y) * OutData.Width, OutData.Width));
+	}
+
+	return true;
+}
+
+void FMapBuildPipeline::ReadTextureColors(UTexture2D* Texture, const TSharedRef<FMapBuildData>& OutData, UE::Tasks::FTaskEvent ColorsReadEvent)
+{
+	TArray<FColor>& OutColors = OutData->TextureColors;
+
+	const uint32 Width = Texture->GetSizeX();
+	const uint32 Height = Texture->GetSizeY();
+	const EPixelFormat TexturePixelFormat = Texture->GetPixelFormat();
+	FTextureResource* Resource = Texture->GetResource();
+
+	// Banded builds only keep the track mask, the colors of the whole texture are never held at once
+	const bool bBanded = OutData->Settings.BandRows > 0;
+	if (!bBanded)
+	{
+		OutColors.SetNumUninitialized(Width * Height);
+	}
+
+	ENQUEUE_RENDER_COMMAND(ReadColorsFromTexture)(
+		[OutData, &OutColors, Width, Height, TexturePixelFormat, Resource, bBanded, ColorsReadEvent](FRHICommandListImmediate& RHICmdList) mutable
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(FMapBuildPipeline::ReadTextureColors);
+
+			if (Resource != nullptr && TexturePixelFormat == PF_B8G8R8A8)
+			{
+				uint32 Stride = 0;
+				void* MipData = RHILockTexture2D(
+					Resource->GetTexture2DRHI(),
+					0,
+					RLM_ReadOnly,
+					Stride,
+					false
+				);
+
+				if (bBanded)
+				{
+					OutData->TrackMask.Init(Width, Height);
+					for (uint32 Y = 0; Y < Height; Y++)
+					{
+						const FColor* RowColors = reinterpret_cast<const FColor*>(static_cast<const uint8*>(MipData) + static_cast<SIZE_T>(Y) * Stride);
+						OutData->TrackMask.SetRow(Y, TConstArrayView<FColor>(RowColors, Width));
+					}
+				}
+				else
+				{
+					AMapManager::GetColors(OutColors, MipData, Width, Height);
+				}
+
+				RHIUnlockTexture2D(Resource->GetTexture2DRHI(), 0, false);
+			}
+			else
+			{
+				UE_LOG(LogTemp, Warning, TEXT("FMapBuildPipeline::ReadTextureColors() unhandeled PixelFormat or missing resource"));
+				OutColors.Empty();
+			}
+
+			ColorsReadEvent.Trigger();
+		});
+}
+
+void FMapBuildPipeline::RunStages(FMapBuildData& Data, TArray<FMapBuildStageTiming>* OutStageTimings, const std::atomic<bool>* bCancelled)
+{
+	const uint32 StagesTimer = FPlatformTime::Cycles();
+
+	const FMapBuildSettings& Settings = Data.Settings;
+	const bool bBanded = Settings.BandRows > 0;
+	const bool bHasTrackMask = Data.TrackMask.Width == Data.Width && Data.TrackMask.Height == Data.Height && !Data.TrackMask.IsEmpty();
+
+	if (static_cast<uint32>(Data.TextureColors.Num()) != Data.Width * Data.Height && !(bBanded && bHasTrackMask))
+	{
+		UE_LOG(LogTemp, Error, TEXT("FMapBuildPipeline::RunStages Texture colors couldn't be read"));
+		return;
+	}
+
+	if (bBanded && !Settings.bStreamTerrain)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FMapBuildPipeline::RunStages Banded builds need bStreamTerrain, there is no whole map mesh to build"));
+		return;
+	}
+
+	// Read only, so every stage and every worker thread in it shares the one instance
+	const FTerrainNoise Noise(Settings.Seed, Settings.NoiseFrequency);
+
+	auto RunStage = [OutStageTimings, bCancelled](const FName Stage, auto&& StageFunction)
+	{
+		if (bCancelled != nullptr && *bCancelled)
+		{
+			return;
+		}
+
+		TRACE_CPUPROFILER_EVENT_SCOPE_TEXT(*WriteToString<64>(TEXT("MapBuild."), Stage));
+
+		if (OutStageTimings == nullptr)
+		{
+			StageFunction();
+			return;
+		}
+
+		const double WallStart = FPlatformTime::Seconds();
+		const double CPUStart = GetProcessCPUSeconds();
+
+		StageFunction();
+
+		FMapBuildStageTiming& Timing = OutStageTimings->AddDefaulted_GetRef();
+		Timing.Stage = Stage;
+		Timing.WallSeconds = FPlatformTime::Seconds() - WallStart;
+		Timing.CPUSeconds = GetProcessCPUSeconds() - CPUStart;
+	};
+
+	// Banded builds never hold the heights of the whole map, they are sampled from the noise where they are needed
+	if (!bBanded)
+	{
+		RunStage(TEXT("Noise"), [&]
+			{
+				LLM_SCOPE_BYTAG(RacingEngineer_Terrain);
+				Data.Heights = GenerateHeights(Noise, Data.Width, Data.Height);
+			});
+	}
+
+	RunStage(TEXT("CreateTrack"), [&]
+		{
+			LLM_SCOPE_BYTAG(RacingEngineer_Track);
+
+			if (bBanded)
+			{
+				// Colors read from a texture are packed a row at a time, the mask is an eighth of a byte per pixel
+				if (!bHasTrackMask)
+				{
+					Data.TrackMask.Init(Data.Width, Data.Height);
+					for (uint32 Y = 0; Y < Data.Height; Y++)
+					{
+						Data.TrackMask.SetRow(Y, TConstArrayView<FColor>(Data.TextureColors).Slice(Y * Data.Width, Data.Width));
+					}
+					Data.TextureColors.Empty();
+				}
+
+				Data.TrackNodes = FTrackContour::CreateTrack(Data.TrackMask, Settings.NodeToSkip);
+				Data.TrackMask.Reset();
+				return;
+			}
+
+			// The mask is only needed for tracing
+			Data.TrackNodes = AMapManager::CreateTrack(Data.TextureColors, Data.Height, Data.Width, Settings.NodeToSkip);
+			Data.TextureColors.Empty();
+		});
+
+	RunStage(TEXT("Spline"), [&]
+		{
+			LLM_SCOPE_BYTAG(RacingEngineer_Track);
+
+			if (bBanded)
+			{
+				Data.SplinePoints = CalculateSplinePoints(Data.TrackNodes, [&Noise](uint32 X, uint32 Y) { return GetNoiseHeight(Noise, X, Y); },
+					Data.Width, Data.Height, Settings.VertScale);
+			}
+			else
+			{
+				Data.SplinePoints = CalculateSplinePoints(Data.TrackNodes, Data.Heights, Data.Width, Data.Height, Settings.VertScale);
+			}
+
+			Data.TrackFrames = BuildTrackFrames(Data.SplinePoints, 0.5f * FMath::Min(Settings.VertScale.X, Settings.VertScale.Y));
+		});
+
+	RunStage(TEXT("RacingLine"), [&]
+		{
+			LLM_SCOPE_BYTAG(RacingEngineer_Track);
+			BuildRacingLine(Settings, Data.TrackFrames);
+		});
+
+	if (bBanded)
+	{
+		RunStage(TEXT("TerrainBands"), [&]
+			{
+				LLM_SCOPE_BYTAG(RacingEngineer_Terrain);
+				BuildTerrainBands(Data, Noise);
+			});
+	}
+	else
+	{
+		RunStage(TEXT("TrackDistanceField"), [&]
+			{
+				LLM_SCOPE_BYTAG(RacingEngineer_Track);
+				BuildTrackDistanceField(Data.TrackFrames, Data.Width, Data.Height, Settings.VertScale, Data.TrackDistance, Data.TrackHeight);
+			});
+
+		if (Settings.ErosionIterations > 0)
+		{
+			RunStage(TEXT("Erosion"), [&]
+				{
+					LLM_SCOPE_BYTAG(RacingEngineer_Terrain);
+					ErodeHeights(Data);
+				});
+		}
+
+		RunStage(TEXT("TerrainMesh"), [&]
+			{
+				LLM_SCOPE_BYTAG(RacingEngineer_Terrain);
+				Data.TerrainVertices = CalculateTerrainVertices(Data.Heights, Data.ErodedHeights, Data.TrackDistance, Data.TrackHeight, Data.Width, Data.Height, Settings);
+
+				// Streamed terrain builds its tiles from the heights and the distance field, the vertices are only kept for the foliage.
+				// A landscape only takes the vertex heights
+				if (Settings.NeedsTerrainMesh())
+				{
+					Data.TerrainTriangles = ATerrainGenerator::CalculateTriangles(Data.Width, Data.Height);
+					Data.TerrainNormals = ATerrainGenerator::CalculateNormals(Data.TerrainVertices, Data.TerrainTriangles, Data.Width, Data.Height);
+				}
+			});
+
+		RunStage(TEXT("HeightField"), [&]
+			{
+				LLM_SCOPE_BYTAG(RacingEngineer_Terrain);
+				Data.HeightField = FTerrainHeightField::Build(Data);
+			});
+
+		RunStage(TEXT("Foliage"), [&]
+			{
+				LLM_SCOPE_BYTAG(RacingEngineer_Foliage);
+				PlaceFoliage(Data);
+
+				if (Settings.bStreamTerrain)
+				{
+					Data.TerrainVertices.Empty();
+				}
+			});
+	}
+
+	SET_DWORD_STAT(STAT_RacingEngineer_TerrainVertices, Data.TerrainVertices.Num());
+	SET_DWORD_STAT(STAT_RacingEngineer_TerrainTriangles, Data.TerrainTriangles.Num() / 3);
+	SET_DWORD_STAT(STAT_RacingEngineer_SplinePoints, Data.SplinePoints.Num());
+	SET_DWORD_STAT(STAT_RacingEngineer_FoliageInstances,
+		Data.GrassFoliageTransforms.Num() + Data.RocksTransforms.Num() + Data.TreesTransforms.Num());
+
+	const uint32 StagesTimerStop = FPlatformTime::Cycles();
+
+	UE_LOG(LogTemp, Log, TEXT("FMapBuildPipeline::RunStages elapsed time %fms"),
+		FPlatformTime::ToMilliseconds(StagesTimerStop - StagesTimer));
+}
+
+double FMapBuildPipeline::GetProcessCPUSeconds()
+{
+#if PLATFORM_WINDOWS
+	FILETIME CreationTime, ExitTime, KernelTime, UserTime;
+	if (::GetProcessTimes(::GetCurrentProcess(), &CreationTime, &ExitTime, &KernelTime, &UserTime))
+	{
+		// FILETIME counts 100ns intervals
+		const uint64 Kernel = (static_cast<uint64>(KernelTime.dwHighDateTime) << 32) | KernelTime.dwLowDateTime;
+		const uint64 User = (static_cast<uint64>(UserTime.dwHighDateTime) << 32) | UserTime.dwLowDateTime;
+		return (Kernel + User) * 1e-7;
+	}
+	return 0.0;
+#elif PLATFORM_UNIX || PLATFORM_MAC
+	struct rusage Usage;
+	if (getrusage(RUSAGE_SELF, &Usage) == 0)
+	{
+		return Usage.ru_utime.tv_sec + Usage.ru_stime.tv_sec + (Usage.ru_utime.tv_usec + Usage.ru_stime.tv_usec) * 1e-6;
+	}
+	return 0.0;
+#else
+	return 0.0;
+#endif
+}
+
+TArray<uint8> FMapBuildPipeline::GenerateHeights(const FTerrainNoise& Noise, const uint32 Width, const uint32 Height)
+{
+	TArray<uint8> Heights;
+	Heights.SetNumUninitialized(Width * Height);
+
+	// The generator is only read, so rows can be sampled in parallel
+	ParallelFor(Height, [&Heights, &Noise, Width](int32 y)
+		{
+			for (uint32 x = 0; x < Width; x++)
+			{
+				Heights[y * Width + x] = GetNoiseHeight(Noise, x, y);
+			}
+		});
+
+	return Heights;
+}
+
+uint8 FMapBuildPipeline::GetNoiseHeight(const FTerrainNoise& Noise, const uint32 X, const uint32 Y)
+{
+	const float NoiseValue = Noise.GetNoise2D(X, Y);
+	return static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(NoiseValue * 255.0f), 0, 255));
+}
+
+TArray<FVector> FMapBuildPipeline::CalculateSplinePoints(const TArray<FVector2D>& Nodes, const TArray<uint8>& Heights,
+	const uint32 Width, const uint32 Height, const FVector& VertScale)
+{
+	return CalculateSplinePoints(Nodes, [&Heights, Width](uint32 X, uint32 Y) { return Heights[Y * Width + X]; }, Width, Height, VertScale);
+}
+
+TArray<FVector> FMapBuildPipeline::CalculateSplinePoints(const TArray<FVector2D>& Nodes, TFunctionRef<uint8(uint32 X, uint32 Y)> GetHeight,
+	const uint32 Width, const uint32 Height, const FVector& VertScale)
+{
+	TArray<FVector> SplinePoints;
+	SplinePoints.Reserve(Nodes.Num());
+
+	for (const FVector2D& TrackNode : Nodes)
+	{
+		const uint8 HeightValue = GetHeight(static_cast<uint32>(TrackNode.X), static_cast<uint32>(TrackNode.Y));
+
+		SplinePoints.Emplace(
+			(TrackNode.X - Width / 2) * VertScale.X,
+			(TrackNode.Y - Height / 2) * VertScale.Y,
+			(HeightValue - 255 / 2) / 255.0 * VertScale.Z
+		);
+	}
+
+	return SplinePoints;
+}
+
+FTrackFrameTable FMapBuildPipeline::BuildTrackFrames(const TArray<FVector>& SplinePoints, const float SampleSpacing)
+{
+	FTrackFrameTable TrackFrames;
+
+	const int32 PointsNum = SplinePoints.Num();
+	if (PointsNum < 2 || SampleSpacing <= 0.0f)
+	{
+		return TrackFrames;
+	}
+
+	// Same curve as a closed loop USplineComponent with CurveAuto points
+	FInterpCurveVector Curve;
+	Curve.Points.Reserve(PointsNum);
+
+	for (int32 PointIndex = 0; PointIndex < PointsNum; PointIndex++)
+	{
+		Curve.Points.Emplace(static_cast<float>(PointIndex), SplinePoints[PointIndex], FVector::ZeroVector, FVector::ZeroVector, CIM_CurveAuto);
+	}
+
+	Curve.SetLoopKey(static_cast<float>(PointsNum));
+	Curve.AutoSetTangents(0.0f, false);
+
+	constexpr int32 StepsPerSegment = 16;
+	const int32 StepsNum = PointsNum * StepsPerSegment;
+
+	TArray<float> StepDistances;
+	StepDistances.Reserve(StepsNum + 1);
+	StepDistances.Emplace(0.0f);
+
+	FVector PrevLocation = Curve.Eval(0.0f);
+	for (int32 Step = 1; Step <= StepsNum; Step++)
+	{
+		const FVector Location = Curve.Eval(static_cast<float>(Step) / StepsPerSegment);
+		StepDistances.Emplace(StepDistances.Last() + FVector::Dist(PrevLocation, Location));
+		PrevLocation = Location;
+	}
+
+	TrackFrames.Length = StepDistances.Last();
+
+	// Spacing is stretched a little so the last sample closes the loop exactly
+	const int32 SamplesNum = FMath::Max(1, FMath::FloorToInt32(TrackFrames.Length / SampleSpacing));
+	TrackFrames.SampleSpacing = TrackFrames.Length / SamplesNum;
+	TrackFrames.Locations.Reserve(SamplesNum);
+	TrackFrames.Directions.Reserve(SamplesNum);
+
+	int32 Step = 0;
+	for (int32 SampleIndex = 0; SampleIndex < SamplesNum; SampleIndex++)
+	{
+		const float Distance = SampleIndex * TrackFrames.SampleSpacing;
+
+		while (Step < StepsNum - 1 && StepDistances[Step + 1] < Distance)
+		{
+			Step++;
+		}
+
+		const float StepLength = StepDistances[Step + 1] - StepDistances[Step];
+		const float Alpha = StepLength > UE_KINDA_SMALL_NUMBER ? (Distance - StepDistances[Step]) / StepLength : 0.0f;
+		const float Key = (Step + Alpha) / StepsPerSegment;
+
+		TrackFrames.Locations.Emplace(Curve.Eval(Key));
+		TrackFrames.Directions.Emplace(Curve.EvalDerivative(Key).GetSafeNormal());
+	}
+
+	TrackFrames.BuildSpatialIndex();
+
+	return TrackFrames;
+}
+
+FVector FMapBuildPipeline::GetTexelLocation(const uint32 X, const uint32 Y, const uint32 Width, const uint32 Height, const FVector& VertScale)
+{
+	return FVector((X - Width / 2.0) * VertScale.X, (Y - Height / 2.0) * VertScale.Y, 0.0);
+}
+
+void FMapBuildPipeline::BuildRacingLine(const FMapBuildSettings& Settings, FTrackFrameTable& TrackFrames)
+{
+	// Half the width of the vehicle plus a little margin to the track mesh edge
+	constexpr float VehicleHalfWidth = 120.0f;
+
+	FRacingLineSettings RacingLineSettings;
+	RacingLineSettings.MaxOffset = FMath::Max(0.0f, 0.5f * Settings.TrackWidth - VehicleHalfWidth);
+
+	FRacingLine::SolveOffsets(TrackFrames.Locations, TrackFrames.Directions, RacingLineSettings, TrackFrames.RacingLineOffsets);
+
+	TArray<FVector> LinePoints;
+	LinePoints.SetNumUninitialized(TrackFrames.Num());
+	for (int32 Index = 0; Index < TrackFrames.Num(); Index++)
+	{
+		LinePoints[Index] = TrackFrames.GetRacingLineLocationAtIndex(Index);
+	}
+
+	FRacingLine::SolveSpeeds(LinePoints, RacingLineSettings, TrackFrames.RacingLineSpeeds);
+}
+
+void FMapBuildPipeline::BuildTrackDistanceField(const FTrackFrameTable& TrackFrames, const uint32 Width, const uint32 Height,
+	const FVector& VertScale, TArray<float>& OutDistance, TArray<float>& OutHeight)
+{
+	const int32 TexelsNum = Width * Height;
+	OutDistance.Init(MAX_flt, TexelsNum);
+	OutHeight.Init(0.0f, TexelsNum);
+
+	if (TrackFrames.IsEmpty())
+	{
+		return;
+	}
+
+	auto DistSquaredToSample = [&TrackFrames, Width, Height, &VertScale](int32 X, int32 Y, int32 SampleIndex)
+	{
+		return FVector2D::DistSquared(FVector2D(GetTexelLocation(X, Y, Width, Height, VertScale)), FVector2D(TrackFrames.Locations[SampleIndex]));
+	};
+
+	// Every texel the centre line passes through is seeded with its closest frame sample
+	TArray<int32> Seeds;
+	Seeds.Init(INDEX_NONE, TexelsNum);
+
+	for (int32 SampleIndex = 0; SampleIndex < TrackFrames.Num(); SampleIndex++)
+	{
+		const FVector& Location = TrackFrames.Locations[SampleIndex];
+		const int32 X = FMath::RoundToInt32(Location.X / VertScale.X + Width / 2.0);
+		const int32 Y = FMath::RoundToInt32(Location.Y / VertScale.Y + Height / 2.0);
+
+		if (X >= 0 && X < static_cast<int32>(Width) && Y >= 0 && Y < static_cast<int32>(Height))
+		{
+			int32& Seed = Seeds[Y * Width + X];
+			if (Seed == INDEX_NONE || DistSquaredToSample(X, Y, SampleIndex) < DistSquaredToSample(X, Y, Seed))
+			{
+				Seed = SampleIndex;
+			}
+		}
+	}
+
+	// Jump flooding, every pass reads Seeds and writes NextSeeds so rows can run in parallel
+	TArray<int32> NextSeeds;
+	NextSeeds.SetNumUninitialized(TexelsNum);
+
+	auto JumpFloodPass = [&](const int32 StepSize)
+	{
+		ParallelFor(Height, [&](int32 Y)
+			{
+				for (int32 X = 0; X < static_cast<int32>(Width); X++)
+				{
+					int32 BestSeed = Seeds[Y * Width + X];
+					double BestDistSquared = BestSeed != INDEX_NONE ? DistSquaredToSample(X, Y, BestSeed) : MAX_dbl;
+
+					for (int32 OffsetY = -StepSize; OffsetY <= StepSize; OffsetY += StepSize)
+					{
+						for (int32 OffsetX = -StepSize; OffsetX <= StepSize; OffsetX += StepSize)
+						{
+							const int32 NeighbourX = X + OffsetX;
+							const int32 NeighbourY = Y + OffsetY;
+
+							if (NeighbourX < 0 || NeighbourX >= static_cast<int32>(Width) || NeighbourY < 0 || NeighbourY >= static_cast<int32>(Height))
+							{
+								continue;
+							}
+
+							const int32 CandidateSeed = Seeds[NeighbourY * Width + NeighbourX];
+							if (CandidateSeed != INDEX_NONE && CandidateSeed != BestSeed)
+							{
+								const double CandidateDistSquared = DistSquaredToSample(X, Y, CandidateSeed);
+								if (CandidateDistSquared < BestDistSquared)
+								{
+									BestSeed = CandidateSeed;
+									BestDistSquared = CandidateDistSquared;
+								}
+							}
+						}
+					}
+
+					NextSeeds[Y * Width + X] = BestSeed;
+				}
+			});
+
+		Swap(Seeds, NextSeeds);
+	};
+
+	for (int32 StepSize = FMath::RoundUpToPowerOfTwo(FMath::Max(Width, Height)) / 2; StepSize >= 1; StepSize /= 2)
+	{
+		JumpFloodPass(StepSize);
+	}
+
+	// One more single texel pass removes most of the jump flooding errors
+	JumpFloodPass(1);
+
+	// The closest sample is refined against both centre line segments it belongs to
+	ParallelFor(Height, [&](int32 Y)
+		{
+			for (int32 X = 0; X < static_cast<int32>(Width); X++)
+			{
+				const int32 SampleIndex = Seeds[Y * Width + X];
+				if (SampleIndex == INDEX_NONE)
+				{
+					continue;
+				}
+
+				const FVector2D TexelLocation(GetTexelLocation(X, Y, Width, Height, VertScale));
+				double BestDistSquared = MAX_dbl;
+				float BestHeight = 0.0f;
+
+				for (const int32 OtherIndex : { (SampleIndex + TrackFrames.Num() - 1) % TrackFrames.Num(), (SampleIndex + 1) % TrackFrames.Num() })
+				{
+					const FVector& SegmentStart = TrackFrames.Locations[SampleIndex];
+					const FVector& SegmentEnd = TrackFrames.Locations[OtherIndex];
+					const FVector2D Segment = FVector2D(SegmentEnd - SegmentStart);
+					const double SegmentLengthSquared = Segment.SizeSquared();
+
+					const double Alpha = SegmentLengthSquared > UE_SMALL_NUMBER
+						? FMath::Clamp(FVector2D::DotProduct(TexelLocation - FVector2D(SegmentStart), Segment) / SegmentLengthSquared, 0.0, 1.0)
+						: 0.0;
+
+					const double DistSquared = FVector2D::DistSquared(TexelLocation, FVector2D(SegmentStart) + Segment * Alpha);
+					if (DistSquared < BestDistSquared)
+					{
+						BestDistSquared = DistSquared;
+						BestHeight = FMath::Lerp(SegmentStart.Z, SegmentEnd.Z, Alpha);
+					}
+				}
+
+				OutDistance[Y * Width + X] = FMath::Sqrt(BestDistSquared);
+				OutHeight[Y * Width + X] = BestHeight;
+			}
+		});
+}
+
+void FMapBuildPipeline::BuildTrackDistanceBand(const FTrackFrameTable& TrackFrames, TConstArrayView<int32> Segments, const uint32 Width, const uint32 Height,
+	const uint32 FirstRow, const uint32 RowsNum, const FVector& VertScale, const float MaxDistance, TArray<float>& OutDistance, TArray<float>& OutHeight)
+{
+	const int32 TexelsNum = Width * RowsNum;
+	OutDistance.Init(MAX_flt, TexelsNum);
+	OutHeight.Init(0.0f, TexelsNum);
+
+	const int32 SamplesNum = TrackFrames.Num();
+	if (SamplesNum == 0)
+	{
+		return;
+	}
+
+	const double MaxDistSquared = FMath::Square(static_cast<double>(MaxDistance));
+
+	// Rows are independent, each one only visits the texels within MaxDistance of every segment crossing it
+	ParallelFor(RowsNum, [&](int32 Row)
+		{
+			const uint32 Y = FirstRow + Row;
+			const double RowY = GetTexelLocation(0, Y, Width, Height, VertScale).Y;
+
+			for (const int32 SegmentIndex : Segments)
+			{
+				const FVector& SegmentStart = TrackFrames.Locations[SegmentIndex];
+				const FVector& SegmentEnd = TrackFrames.Locations[(SegmentIndex + 1) % SamplesNum];
+
+				if (RowY < FMath::Min(SegmentStart.Y, SegmentEnd.Y) - MaxDistance || RowY > FMath::Max(SegmentStart.Y, SegmentEnd.Y) + MaxDistance)
+				{
+					continue;
+				}
+
+				const int32 FirstColumn = FMath::Max(0,
+					FMath::FloorToInt32((FMath::Min(SegmentStart.X, SegmentEnd.X) - MaxDistance) / VertScale.X + Width / 2.0));
+				const int32 LastColumn = FMath::Min(static_cast<int32>(Width) - 1,
+					FMath::CeilToInt32((FMath::Max(SegmentStart.X, SegmentEnd.X) + MaxDistance) / VertScale.X + Width / 2.0));
+
+				const FVector2D Segment = FVector2D(SegmentEnd - SegmentStart);
+				const double SegmentLengthSquared = Segment.SizeSquared();
+
+				for (int32 X = FirstColumn; X <= LastColumn; X++)
+				{
+					const FVector2D TexelLocation(GetTexelLocation(X, Y, Width, Height, VertScale));
+
+					const double Alpha = SegmentLengthSquared > UE_SMALL_NUMBER
+						? FMath::Clamp(FVector2D::DotProduct(TexelLocation - FVector2D(SegmentStart), Segment) / SegmentLengthSquared, 0.0, 1.0)
+						: 0.0;
+
+					const double DistSquared = FVector2D::DistSquared(TexelLocation, FVector2D(SegmentStart) + Segment * Alpha);
+					const int32 Index = Row * Width + X;
+
+					if (DistSquared <= MaxDistSquared && DistSquared < FMath::Square(static_cast<double>(OutDistance[Index])))
+					{
+						OutDistance[Index] = FMath::Sqrt(DistSquared);
+						OutHeight[Index] = FMath::Lerp(SegmentStart.Z, SegmentEnd.Z, Alpha);
+					}
+				}
+			}
+		});
+}
+
+void FMapBuildPipeline::BuildTerrainBands(FMapBuildData& Data, const FTerrainNoise& Noise)
+{
+	const FMapBuildSettings& Settings = Data.Settings;
+	const FVector& VertScale = Settings.VertScale;
+	const uint32 Width = Data.Width;
+	const uint32 Height = Data.Height;
+	const uint32 BandRows = FMath::Clamp<uint32>(Settings.BandRows, 1, Height);
+	const uint32 BandsNum = FMath::DivideAndRoundUp(Height, BandRows);
+	const float MaxTrackDistance = GetTrackInfluenceDistance(Settings);
+
+	// Every centre line segment is listed in the bands its influence reaches, so a band only looks at the track near it
+	TArray<TArray<int32>> BandSegments;
+	BandSegments.SetNum(BandsNum);
+
+	const int32 SamplesNum = Data.TrackFrames.Num();
+	for (int32 SegmentIndex = 0; SegmentIndex < SamplesNum; SegmentIndex++)
+	{
+		const FVector& SegmentStart = Data.TrackFrames.Locations[SegmentIndex];
+		const FVector& SegmentEnd = Data.TrackFrames.Locations[(SegmentIndex + 1) % SamplesNum];
+
+		const int32 FirstRow = FMath::Max(0,
+			FMath::FloorToInt32((FMath::Min(SegmentStart.Y, SegmentEnd.Y) - MaxTrackDistance) / VertScale.Y + Height / 2.0));
+		const int32 LastRow = FMath::Min(static_cast<int32>(Height) - 1,
+			FMath::CeilToInt32((FMath::Max(SegmentStart.Y, SegmentEnd.Y) + MaxTrackDistance) / VertScale.Y + Height / 2.0));
+
+		for (int32 Band = FirstRow / static_cast<int32>(BandRows); Band <= LastRow / static_cast<int32>(BandRows); Band++)
+		{
+			BandSegments[Band].Add(SegmentIndex);
+		}
+	}
+
+	FTerrainHeightFileWriter Writer;
+	if (!Writer.Open(Width, Height))
+	{
+		return;
+	}
+
+	// Bands are scattered in map order from one stream, like a single pass over the whole map
+	const FFoliageScatterSettings ScatterSettings = MakeFoliageScatterSettings(Settings, Width, Height);
+	FRandomStream RandomStream(ScatterSettings.Seed);
+
+	// Track texels of the height field, the only part of the distance field kept past its band
+	const float TrackHalfWidth = 0.5f * Settings.TrackWidth;
+	TBitArray<> TrackTexels;
+	TrackTexels.Init(false, Width * Height);
+
+	Data.GrassFoliageTransforms.Reset(ScatterSettings.MaxGrass);
+	Data.RocksTransforms.Reset(ScatterSettings.MaxRocks);
+	Data.TreesTransforms.Reset(ScatterSettings.MaxTrees);
+
+	// Reused by every band, nothing here grows with the map height
+	TArray<float> BandDistance;
+	TArray<float> BandTrackHeight;
+	TArray<FVector3f> BandVertices;
+	TArray<float> BandZ;
+
+	for (uint32 Band = 0; Band < BandsNum; Band++)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FMapBuildPipeline::BuildTerrainBand);
+
+		const uint32 FirstRow = Band * BandRows;
+		const uint32 RowsNum = FMath::Min(BandRows, Height - FirstRow);
+
+		BuildTrackDistanceBand(Data.TrackFrames, BandSegments[Band], Width, Height, FirstRow, RowsNum, VertScale, MaxTrackDistance,
+			BandDistance, BandTrackHeight);
+
+		BandVertices.SetNumUninitialized(Width * RowsNum, false);
+		BandZ.SetNumUninitialized(Width * RowsNum, false);
+
+		ParallelFor(RowsNum, [&](int32 Row)
+			{
+				const uint32 Y = FirstRow + Row;
+
+				for (uint32 X = 0; X < Width; X++)
+				{
+					const int32 Index = Row * Width + X;
+					BandVertices[Index] = CalculateTerrainVertex(GetNoiseZ(GetNoiseHeight(Noise, X, Y), Settings), BandDistance[Index], BandTrackHeight[Index],
+						X, Y, Width, Height, Settings);
+					BandZ[Index] = BandVertices[Index].Z;
+				}
+			});
+
+		for (int32 Index = 0; Index < BandDistance.Num(); Index++)
+		{
+			if (BandDistance[Index] <= TrackHalfWidth)
+			{
+				TrackTexels[FirstRow * Width + Index] = true;
+			}
+		}
+
+		FFoliageScatter::ScatterBand(BandVertices, BandDistance, ScatterSettings, RandomStream,
+			Data.GrassFoliageTransforms, Data.RocksTransforms, Data.TreesTransforms);
+
+		if (!Writer.WriteRows(BandZ))
+		{
+			return;
+		}
+	}
+
+	Data.TerrainHeightFile = Writer.Finish();
+	Data.HeightField = FTerrainHeightField::Build(Data, Data.TerrainHeightFile, MoveTemp(TrackTexels));
+}
+
+void FMapBuildPipeline::ErodeHeights(FMapBuildData& Data)
+{
+	const FMapBuildSettings& Settings = Data.Settings;
+	const int32 TexelsNum = Data.Width * Data.Height;
+
+	if (Data.Heights.Num() != TexelsNum || Data.TrackDistance.Num() != TexelsNum)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FMapBuildPipeline::ErodeHeights Heights and the track distance field are needed"));
+		return;
+	}
+
+	FTerrainErosionSettings ErosionSettings;
+	ErosionSettings.Seed = Settings.Seed;
+	ErosionSettings.Iterations = Settings.ErosionIterations;
+	ErosionSettings.CellSize = FMath::Min(Settings.VertScale.X, Settings.VertScale.Y);
+	// Half a height step of the noise per iteration
+	ErosionSettings.RainAmount = Settings.VertScale.Z / 255.0f * 0.5f;
+
+	// 11 floats per texel on top of the build, maps over the budget aren't eroded
+	if (FTerrainErosion::GetMemoryBytes(Data.Width, Data.Height) > ErosionSettings.MaxMemoryBytes)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("FMapBuildPipeline::ErodeHeights %u x %u needs %lld MB to erode, more than the %lld MB allowed, it is left as it is"),
+			Data.Width, Data.Height, FTerrainErosion::GetMemoryBytes(Data.Width, Data.Height) >> 20, ErosionSettings.MaxMemoryBytes >> 20);
+		return;
+	}
+
+	// Eroded in world units so the talus angle and slopes mean what they say, with the corridor the terrain is blended into kept as it is
+	const float InfluenceDistance = GetTrackInfluenceDistance(Settings);
+	const float FadeDistance = FMath::Max(Settings.TrackWidth, Settings.VertScale.X);
+
+	TArray<float> Heights;
+	TArray<float> Erodability;
+	Heights.SetNumUninitialized(TexelsNum);
+	Erodability.SetNumUninitialized(TexelsNum);
+
+	ParallelFor(TexelsNum, [&](int32 Index)
+		{
+			Heights[Index] = GetNoiseZ(Data.Heights[Index], Settings);
+			Erodability[Index] = FMath::SmoothStep(InfluenceDistance, InfluenceDistance + FadeDistance, Data.TrackDistance[Index]);
+		});
+
+	const int32 Iterations = FTerrainErosion::Erode(Heights, Erodability, Data.Width, Data.Height, ErosionSettings);
+
+	// Kept as floats, rounding them back to 8 bit would flatten most of what the erosion carved
+	Data.ErodedHeights = MoveTemp(Heights);
+
+	UE_LOG(LogTemp, Log, TEXT("FMapBuildPipeline::ErodeHeights %d of %d iterations"), Iterations, Settings.ErosionIterations);
+}
+
+TArray<FVector3f> FMapBuildPipeline::CalculateTerrainVertices(const TArray<uint8>& Heights, const TArray<float>& ErodedHeights,
+	const TArray<float>& TrackDistance, const TArray<float>& TrackHeight, const uint32 Width, const uint32 Height, const FMapBuildSettings& Settings)
+{
+	TArray<FVector3f> Vertices;
+	Vertices.SetNumUninitialized(Width * Height);
+
+	ParallelFor(Height, [&](int32 y)
+		{
+			for (uint32 x = 0; x < Width; x++)
+			{
+				Vertices[y * Width + x] = CalculateTerrainVertex(Heights, ErodedHeights, TrackDistance, TrackHeight, x, y, Width, Height, Settings);
+			}
+		});
+
+	return Vertices;
+}
+
+FVector3f FMapBuildPipeline::CalculateTerrainVertex(const TArray<uint8>& Heights, const TArray<float>& ErodedHeights, const TArray<float>& TrackDistance,
+	const TArray<float>& TrackHeight, const uint32 X, const uint32 Y, const uint32 Width, const uint32 Height, const FMapBuildSettings& Settings)
+{
+	const int32 Index = Y * Width + X;
+	const float NoiseZ = ErodedHeights.IsEmpty() ? GetNoiseZ(Heights[Index], Settings) : ErodedHeights[Index];
+	return CalculateTerrainVertex(NoiseZ, TrackDistance[Index], TrackHeight[Index], X, Y, Width, Height, Settings);
+}
+
+FVector3f FMapBuildPipeline::CalculateTerrainVertex(const float NoiseZ, const float TrackDistanceValue, const float TrackHeightValue,
+	const uint32 X, const uint32 Y, const uint32 Width, const uint32 Height, const FMapBuildSettings& Settings)
+{
+	const FVector& VertScale = Settings.VertScale;
+	const float MeshWidth = Settings.TrackWidth;
+	const float MeshOffset = MeshWidth * 0.35f;
+
+	FVector Vertex = GetTexelLocation(X, Y, Width, Height, VertScale);
+	Vertex.Z = NoiseZ;
+
+	const float Distance = TrackDistanceValue;
+	const float TrackZ = TrackHeightValue - Settings.TrackDepth;
+
+	// If it's under the track mesh with some offset
+	if (Distance <= MeshWidth / 2 + MeshOffset)
+	{
+		Vertex.Z = TrackZ;
+	}
+	// If it's near the track mesh but not under it
+	else if (Distance <= MeshWidth + MeshOffset)
+	{
+		const float Alpha = (MeshWidth + MeshOffset) / Distance - 1.0f;
+		Vertex.Z = FMath::Lerp(Vertex.Z, TrackZ, Alpha);
+	}
+
+	return FVector3f(Vertex);
+}
+
+float FMapBuildPipeline::GetNoiseZ(const uint8 HeightValue, const FMapBuildSettings& Settings)
+{
+	constexpr uint8 Offset = 127;
+	return (HeightValue - Offset) / 255.0 * Settings.VertScale.Z;
+}
+
+TSharedRef<const FTerrainMeshData> FMapBuildData::TakeTerrainMesh()
+{
+	TSharedRef<FTerrainMeshData> TerrainMesh = MakeShared<FTerrainMeshData>();
+	TerrainMesh->Width = Width;
+	TerrainMesh->Height = Height;
+	TerrainMesh->Vertices = MoveTemp(TerrainVertices);
+	TerrainMesh->Triangles = MoveTemp(TerrainTriangles);
+	TerrainMesh->Normals = MoveTemp(TerrainNormals);
+
+	return TerrainMesh;
+}
+
+float FMapBuildPipeline::GetTrackInfluenceDistance(const FMapBuildSettings& Settings)
+{
+	// MeshWidth + MeshOffset of the terrain blend, which is also where the foliage starts
+	return Settings.TrackWidth * 1.35f;
+}
+
+void FMapBuildPipeline::PlaceFoliage(FMapBuildData& Data)
+{
+	FFoliageScatter::Scatter(Data.TerrainVertices, Data.TrackDistance, MakeFoliageScatterSettings(Data.Settings, Data.Width, Data.Height),
+		Data.GrassFoliageTransforms, Data.RocksTransforms, Data.TreesTransforms);
+}
+
+FFoliageScatterSettings FMapBuildPipeline::MakeFoliageScatterSettings(const FMapBuildSettings& Settings, const uint32 Width, const uint32 Height)
+{
+	const uint64 VerticesNum = static_cast<uint64>(Width) * Height;
+	const float VertScaleXYNum = Settings.VertScale.X * Settings.VertScale.Y;
+	const float LightWeightScale = Settings.bLightWeightMode ? 1.0f / 3.0f : 1.0f;
+
+	FFoliageScatterSettings ScatterSettings;
+
+	// Seeded from the map so the same map always gets the same foliage
+	ScatterSettings.Seed = Settings.Seed;
+	ScatterSettings.GrassProbability = Settings.GrassFoliageProbability * VertScaleXYNum / VerticesNum * LightWeightScale;
+	ScatterSettings.RocksProbability = Settings.RocksProbability * VertScaleXYNum / VerticesNum * LightWeightScale;
+	ScatterSettings.TreesProbability = Settings.TreesProbability * VertScaleXYNum / VerticesNum * LightWeightScale;
+	ScatterSettings.MaxGrass = FMath::FloorToInt32(VerticesNum * ScatterSettings.GrassProbability);
+	ScatterSettings.MaxRocks = FMath::FloorToInt32(VerticesNum * ScatterSettings.RocksProbability);
+	ScatterSettings.MaxTrees = FMath::FloorToInt32(VerticesNum * ScatterSettings.TreesProbability);
+	ScatterSettings.MinTrackDistance = GetTrackInfluenceDistance(Settings);
+
+	return ScatterSettings;
+}
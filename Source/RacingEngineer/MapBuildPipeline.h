@@ -0,0 +1,318 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tasks/Task.h"
+#include "TerrainGrid.h"
+#include "TrackContour.h"
+#include "TrackSpatialIndex.h"
+#include "FoliageScatter.h"
+#include "TerrainNoise.h"
+#include "UObject/StrongObjectPtr.h"
+#include "MapBuildPipeline.generated.h"
+
+class FTerrainHeightFile;
+class FTerrainHeightField;
+class UTexture2D;
+
+/**
+ *  Every input of the CPU side of the map build.
+ *  Two builds with equal settings and the same texture produce the same data.
+ */
+USTRUCT(BlueprintType)
+struct FMapBuildSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Map Build")
+	int32 Seed = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Map Build")
+	float NoiseFrequency = 0.01f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Map Build")
+	uint8 NodeToSkip = 1;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Map Build")
+	FVector VertScale = FVector::OneVector;
+
+	// Width of the track mesh, the terrain is flattened under it and blended around it
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Map Build")
+	float TrackWidth = 0.0f;
+
+	// How deep the terrain is pushed under the track spline
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Map Build")
+	float TrackDepth = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Map Build")
+	float GrassFoliageProbability = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Map Build")
+	float RocksProbability = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Map Build")
+	float TreesProbability = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Map Build")
+	bool bLightWeightMode = false;
+
+	// The terrain is built in tiles around the player instead of as one mesh, the build keeps no whole map triangles or normals
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Map Build")
+	bool bStreamTerrain = false;
+
+	// The terrain is imported as an ALandscape, the build keeps the vertices for its heights but no triangles or normals
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Map Build")
+	bool bLandscapeTerrain = false;
+
+	// Builds the terrain this many texel rows at a time and writes it to a file instead of keeping whole map arrays, 0 builds it in one go.
+	// Peak memory then follows the band size instead of the image size. Needs bStreamTerrain, banded builds aren't cached
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Map Build", meta = (ClampMin = "0"))
+	int32 BandRows = 0;
+
+	// Hydraulic and thermal erosion passes over the noise heights, 0 leaves them as they are.
+	// Large maps run fewer so the stage keeps a bounded cost, maps over its memory budget and banded builds skip it.
+	// The track corridor is never eroded
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Map Build", meta = (ClampMin = "0"))
+	int32 ErosionIterations = 0;
+
+	// Compares everything but the seed, which is resolved per build
+	bool IsCompatibleWith(const FMapBuildSettings& Other) const;
+
+	// Whether the build makes the whole map mesh with triangles and normals, streamed and landscape terrain don't need it
+	bool NeedsTerrainMesh() const { return !bStreamTerrain && !bLandscapeTerrain; }
+};
+
+/**
+ *  Track centre line resampled at a constant distance.
+ *  Index i is at distance i * SampleSpacing along the closed loop.
+ */
+struct FTrackFrameTable
+{
+	float SampleSpacing = 0.0f;
+	float Length = 0.0f;
+
+	TArray<FVector> Locations;
+	TArray<FVector> Directions;
+
+	// Minimum curvature line as offsets along each sample's right vector, and the speed it can be driven at in cm/s
+	TArray<float> RacingLineOffsets;
+	TArray<float> RacingLineSpeeds;
+
+	int32 Num() const { return Locations.Num(); }
+	bool IsEmpty() const { return Locations.IsEmpty(); }
+	bool HasRacingLine() const { return !IsEmpty() && RacingLineOffsets.Num() == Num() && RacingLineSpeeds.Num() == Num(); }
+
+	float WrapDistance(float Distance) const;
+	FVector GetLocationAtDistance(float Distance) const;
+	FVector GetDirectionAtDistance(float Distance) const;
+	FVector GetRightVectorAtIndex(int32 Index) const;
+
+	FVector GetRacingLineLocationAtIndex(int32 Index) const;
+	FVector GetRacingLineLocationAtDistance(float Distance) const;
+	float GetRacingLineSpeedAtDistance(float Distance) const;
+
+	// Closest sample in the XY plane within SearchRadius samples of HintIndex.
+	// Falls back to the whole loop when the closest one is on the edge of the window, like after a teleport.
+	// The whole loop is a spatial index lookup once BuildSpatialIndex has run
+	int32 FindClosestIndex(const FVector& Location, int32 HintIndex, int32 SearchRadius) const;
+
+	// Distance along the track of the closest centre line point in the XY plane, from anywhere on the map
+	float FindClosestDistance(const FVector& Location) const;
+
+	// Grid over the samples for FindClosestDistance, derived from the locations and never serialized
+	void BuildSpatialIndex();
+
+	FTrackSpatialIndex SpatialIndex;
+};
+
+// Whole map terrain mesh in the compact layout it is built in, never modified once it has been taken out of FMapBuildData
+struct FTerrainMeshData
+{
+	uint32 Width = 0;
+	uint32 Height = 0;
+
+	TArray<FVector3f> Vertices;
+	TArray<int32> Triangles;
+	TArray<FOctahedralNormal> Normals;
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Vertices.GetAllocatedSize() + Triangles.GetAllocatedSize() + Normals.GetAllocatedSize();
+	}
+};
+
+/**
+ *  Output of the CPU side of the map build, everything is in map local space
+ *  with the map centred on the origin of the AMapManager.
+ */
+struct FMapBuildData
+{
+	FMapBuildSettings Settings;
+
+	uint32 Width = 0;
+	uint32 Height = 0;
+
+	TArray<FColor> TextureColors;
+	TArray<uint8> Heights;
+
+	// Noise heights in map units after the erosion stage, the terrain is built from these instead of Heights when set
+	TArray<float> ErodedHeights;
+
+	// Track pixels of the image, what banded builds trace instead of the colors
+	FTrackMask TrackMask;
+
+	TArray<FVector2D> TrackNodes;
+	TArray<FVector> SplinePoints;
+	FTrackFrameTable TrackFrames;
+
+	// Per texel distance to the track centre line in the XY plane and height of the closest centre line point
+	TArray<float> TrackDistance;
+	TArray<float> TrackHeight;
+
+	// Relative to the map, which keeps them well inside float precision. UVs follow from the grid
+	TArray<FVector3f> TerrainVertices;
+	TArray<int32> TerrainTriangles;
+	TArray<FOctahedralNormal> TerrainNormals;
+
+	// Banded builds keep the terrain heights in this file instead of the arrays above
+	TSharedPtr<FTerrainHeightFile> TerrainHeightFile;
+
+	// Final terrain heights for UTerrainQuerySubsystem, kept after the workers took the rest
+	TSharedPtr<const FTerrainHeightField> HeightField;
+
+	TArray<FTransform> GrassFoliageTransforms;
+	TArray<FTransform> RocksTransforms;
+	TArray<FTransform> TreesTransforms;
+
+	// Set when the stages were skipped and everything was read from FMapBuildCache
+	bool bLoadedFromCache = false;
+
+	// Moves the terrain arrays out, the build data has no terrain mesh afterwards
+	TSharedRef<const FTerrainMeshData> TakeTerrainMesh();
+};
+
+struct FMapBuildStageTiming
+{
+	FName Stage;
+	double WallSeconds = 0.0;
+
+	// Process wide, so stages running ParallelFor count the time of every worker thread
+	double CPUSeconds = 0.0;
+};
+
+DECLARE_DELEGATE_OneParam(FOnMapBuildCompleted, const TSharedRef<FMapBuildData>&);
+
+/**
+ *  Handle of a map build running in the background.
+ *  Has to be released on the game thread, it keeps the texture alive. Releasing it cancels the build instead of waiting for it,
+ *  the stage that is running finishes on its own and the rest are skipped.
+ */
+class RACINGENGINEER_API FMapBuildTask
+{
+public:
+	FMapBuildTask(UTexture2D* InTexture, const FMapBuildSettings& InSettings);
+	~FMapBuildTask();
+
+	bool IsCompleted() const { return Task.IsCompleted(); }
+
+	void Cancel();
+	bool IsCancelled() const { return *bCancelled; }
+
+	// Runs on the game thread once all stages have finished, also when they already had.
+	// Never runs for a cancelled build, a delegate bound to a UObject is skipped once the object is gone
+	void OnCompleted(FOnMapBuildCompleted Callback) const;
+
+	const UTexture2D* GetTexture() const { return Texture.Get(); }
+	const FMapBuildSettings& GetSettings() const { return Data->Settings; }
+
+private:
+	TStrongObjectPtr<UTexture2D> Texture;
+	TSharedRef<FMapBuildData> Data;
+	TSharedRef<std::atomic<bool>> bCancelled;
+	UE::Tasks::FTask Task;
+};
+
+/**
+ *  Stages of the map build that don't need the world.
+ *  Apart from reading the texture on the render thread they are safe to run on any thread.
+ */
+class RACINGENGINEER_API FMapBuildPipeline
+{
+public:
+	// Starts the whole CPU side of the build, the texture is read on the render thread
+	static TSharedRef<FMapBuildTask> Launch(UTexture2D* Texture, const FMapBuildSettings& Settings);
+
+	// Decodes an image file straight into OutData, for builds without a texture or RHI
+	static bool LoadImageColors(const FString& ImagePath, FMapBuildData& OutData);
+
+	// Decodes an image file straight into the track mask of OutData, for banded builds.
+	// Only raw 8 bit square images (.r8, .raw) are read a few rows at a time and stay bounded in memory,
+	// PNG and every other compressed format is decoded whole first
+	static bool LoadImageTrackMask(const FString& ImagePath, FMapBuildData& OutData);
+
+	// Fills OutData's texture colors on the render thread, which keeps OutData alive until it has.
+	// Banded builds get the track mask instead, read from the locked texture a row at a time
+	static void ReadTextureColors(UTexture2D* Texture, const TSharedRef<FMapBuildData>& OutData, UE::Tasks::FTaskEvent ColorsReadEvent);
+
+	// OutStageTimings is filled with one entry per stage when given. Stages left when bCancelled is set are skipped,
+	// the data is then incomplete and must be dropped
+	static void RunStages(FMapBuildData& Data, TArray<FMapBuildStageTiming>* OutStageTimings = nullptr, const std::atomic<bool>* bCancelled = nullptr);
+
+	static TArray<uint8> GenerateHeights(const FTerrainNoise& Noise, const uint32 Width, const uint32 Height);
+
+	// Height of a single texel, the same one GenerateHeights gives it
+	static uint8 GetNoiseHeight(const FTerrainNoise& Noise, const uint32 X, const uint32 Y);
+
+	static TArray<FVector> CalculateSplinePoints(const TArray<FVector2D>& Nodes, const TArray<uint8>& Heights,
+		const uint32 Width, const uint32 Height, const FVector& VertScale);
+
+	static TArray<FVector> CalculateSplinePoints(const TArray<FVector2D>& Nodes, TFunctionRef<uint8(uint32 X, uint32 Y)> GetHeight,
+		const uint32 Width, const uint32 Height, const FVector& VertScale);
+
+	static FTrackFrameTable BuildTrackFrames(const TArray<FVector>& SplinePoints, const float SampleSpacing);
+
+	// Fills the racing line of TrackFrames, kept inside the track mesh with room for half a car
+	static void BuildRacingLine(const FMapBuildSettings& Settings, FTrackFrameTable& TrackFrames);
+
+	static void BuildTrackDistanceField(const FTrackFrameTable& TrackFrames, const uint32 Width, const uint32 Height,
+		const FVector& VertScale, TArray<float>& OutDistance, TArray<float>& OutHeight);
+
+	// Exact distance field of RowsNum rows starting at FirstRow, against the given centre line segments only.
+	// Segment i runs from sample i to the next one, texels farther than MaxDistance from all of them are left at MAX_flt
+	static void BuildTrackDistanceBand(const FTrackFrameTable& TrackFrames, TConstArrayView<int32> Segments, const uint32 Width, const uint32 Height,
+		const uint32 FirstRow, const uint32 RowsNum, const FVector& VertScale, const float MaxDistance, TArray<float>& OutDistance, TArray<float>& OutHeight);
+
+	// Erodes the noise heights away from the track into ErodedHeights, needs the distance field
+	static void ErodeHeights(FMapBuildData& Data);
+
+	// Noise, distance field, terrain heights and foliage one band of rows at a time, the heights are written to Data.TerrainHeightFile
+	static void BuildTerrainBands(FMapBuildData& Data, const FTerrainNoise& Noise);
+
+	// ErodedHeights is used instead of Heights when it isn't empty
+	static TArray<FVector3f> CalculateTerrainVertices(const TArray<uint8>& Heights, const TArray<float>& ErodedHeights,
+		const TArray<float>& TrackDistance, const TArray<float>& TrackHeight, const uint32 Width, const uint32 Height, const FMapBuildSettings& Settings);
+
+	// Terrain vertex of a single texel, the same one the whole map mesh has there
+	static FVector3f CalculateTerrainVertex(const TArray<uint8>& Heights, const TArray<float>& ErodedHeights, const TArray<float>& TrackDistance,
+		const TArray<float>& TrackHeight, const uint32 X, const uint32 Y, const uint32 Width, const uint32 Height, const FMapBuildSettings& Settings);
+
+	// NoiseZ is the height of the terrain before it is blended into the track, in map units
+	static FVector3f CalculateTerrainVertex(const float NoiseZ, const float TrackDistanceValue, const float TrackHeightValue,
+		const uint32 X, const uint32 Y, const uint32 Width, const uint32 Height, const FMapBuildSettings& Settings);
+
+	// Map units of an 8 bit noise height
+	static float GetNoiseZ(const uint8 HeightValue, const FMapBuildSettings& Settings);
+
+	// Terrain further than this from the track centre line is neither blended into the track nor kept free of foliage
+	static float GetTrackInfluenceDistance(const FMapBuildSettings& Settings);
+
+	static void PlaceFoliage(FMapBuildData& Data);
+
+	static FFoliageScatterSettings MakeFoliageScatterSettings(const FMapBuildSettings& Settings, const uint32 Width, const uint32 Height);
+
+	// User and system time of the whole process so far
+	static double GetProcessCPUSeconds();
+
+	static FVector GetTexelLocation(const uint32 X, const uint32 Y, const uint32 Width, const uint32 Height, const FVector& VertScale);
+};
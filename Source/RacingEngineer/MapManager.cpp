@@ -3,13 +3,73 @@
 
 #include "MapManager.h"
 
+#include "RacingEngineer.h"
 #include "WheeledVehiclePawn.h"
 #include "Components/SplineComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "Async/Async.h"
 #include "WorkerActor.h"
-#include "FastNoiseWrapper.h"
 #include "RacingEngineerGameInstance.h"
+#include "MapBuildPipeline.h"
+#include "TerrainQuerySubsystem.h"
+#include "TerrainGenerator.h"
+#include "DrawDebugHelpers.h"
+#include "EngineUtils.h"
+
+static void DrawRacingLine(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+{
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	const float Seconds = Args.IsEmpty() ? 30.0f : FCString::Atof(*Args[0]);
+
+	for (TActorIterator<AMapManager> It(World); It; ++It)
+	{
+		const FTrackFrameTable& TrackFrames = It->GetTrackFrames();
+		if (!TrackFrames.HasRacingLine())
+		{
+			Ar.Logf(TEXT("%s has no racing line"), *It->GetName());
+			continue;
+		}
+
+		const FTransform MapTransform = It->GetActorTransform();
+		const float MaxSpeed = FMath::Max(UE_KINDA_SMALL_NUMBER, FMath::Max(TrackFrames.RacingLineSpeeds));
+		const int32 SamplesNum = TrackFrames.Num();
+		int32 BrakingPoints = 0;
+
+		for (int32 Index = 0; Index < SamplesNum; Index++)
+		{
+			const int32 Previous = (Index + SamplesNum - 1) % SamplesNum;
+			const int32 Next = (Index + 1) % SamplesNum;
+
+			// Lifted a little off the track, red is slow and green is the fastest part of the lap
+			const FVector Start = MapTransform.TransformPosition(TrackFrames.GetRacingLineLocationAtIndex(Index)) + FVector(0.0f, 0.0f, 20.0f);
+			const FVector End = MapTransform.TransformPosition(TrackFrames.GetRacingLineLocationAtIndex(Next)) + FVector(0.0f, 0.0f, 20.0f);
+			const FColor Color = FLinearColor::LerpUsingHSV(FLinearColor::Red, FLinearColor::Green, TrackFrames.RacingLineSpeeds[Index] / MaxSpeed).ToFColor(true);
+
+			DrawDebugLine(World, Start, End, Color, false, Seconds, 0, 8.0f);
+
+			// Braking starts where the profile stops gaining speed and starts losing it
+			const bool bBrakingPoint = TrackFrames.RacingLineSpeeds[Next] < TrackFrames.RacingLineSpeeds[Index]
+				&& TrackFrames.RacingLineSpeeds[Previous] <= TrackFrames.RacingLineSpeeds[Index];
+			if (bBrakingPoint)
+			{
+				DrawDebugLine(World, Start, Start + FVector(0.0f, 0.0f, 300.0f), FColor::White, false, Seconds, 0, 16.0f);
+				BrakingPoints++;
+			}
+		}
+
+		Ar.Logf(TEXT("%s racing line of %d samples, %d braking points, top speed %.0f km/h"),
+			*It->GetName(), SamplesNum, BrakingPoints, MaxSpeed * 0.036f);
+	}
+}
+
+static FAutoConsoleCommandWithWorldArgsAndOutputDevice DrawRacingLineCommand(
+	TEXT("RacingEngineer.DrawRacingLine"),
+	TEXT("Draws the racing line coloured by its speed profile and marks the braking points, optionally for the given seconds"),
+	FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&DrawRacingLine));
 
 // Sets default values
 AMapManager::AMapManager()
@@ -31,78 +91,256 @@ void AMapManager::BeginPlay()
 
 }
 
+void AMapManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Cancels a build that is still running, its callback then never comes
+	PendingBuild.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void AMapManager::InitializeMap()
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(AMapManager::InitializeMap);
+
 	URacingEngineerGameInstance* RacingEngineerGameInstance = Cast<URacingEngineerGameInstance>(GetGameInstance());
 	if (RacingEngineerGameInstance != nullptr)
 	{
+		int32 Seed = 0;
 		if (RacingEngineerGameInstance->bStartedFromMainMenu)
 		{
 			TrackTexture = RacingEngineerGameInstance->SelectedMapTexture;
+			Seed = RacingEngineerGameInstance->Seed;
 		}
 
-		if (TrackTexture != nullptr && SplineComponent != nullptr)
+		BuildMap(Seed, RacingEngineerGameInstance->bStartedFromMainMenu);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("AMapManager::InitializeMap() RacingEngineerGameInstance is nullptr"));
+	}
+}
+
+void AMapManager::RegenerateMap(UTexture2D* NewTrackTexture, int32 NewSeed)
+{
+	if (bIsBuildingMap)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("AMapManager::RegenerateMap() Map is still being built"));
+		return;
+	}
+
+	// A new texture gets the node skip and vertex spacing of its own size, the same one keeps what it had
+	const bool bScaleToTexture = NewTrackTexture != nullptr && NewTrackTexture != TrackTexture;
+	if (NewTrackTexture != nullptr)
+	{
+		TrackTexture = NewTrackTexture;
+	}
+
+	URacingEngineerGameInstance* RacingEngineerGameInstance = Cast<URacingEngineerGameInstance>(GetGameInstance());
+	if (RacingEngineerGameInstance != nullptr)
+	{
+		RacingEngineerGameInstance->SelectedMapTexture = TrackTexture;
+		RacingEngineerGameInstance->Seed = NewSeed;
+	}
+
+	// The workers keep the old map live while the new one builds, they are reset in BuildMapFromData
+	BuildMap(NewSeed, bScaleToTexture);
+}
+
+void AMapManager::BuildMap(int32 Seed, bool bScaleToTexture)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(AMapManager::BuildMap);
+
+	if (TrackTexture != nullptr && SplineComponent != nullptr)
+	{
+		bIsBuildingMap = true;
+
+		const uint32 MapManagerTimer = FPlatformTime::Cycles();
+
+		TextureWidth = TrackTexture->GetSizeX();
+		TextureHeight = TrackTexture->GetSizeY();
+
+		if (bScaleToTexture)
 		{
-			const uint32 MapManagerTimer = FPlatformTime::Cycles();
+			NodeToSkip = CalculateNodeToSkip(TextureHeight, TextureWidth);
+			VertSpacingScale = CalculateVertScale(TextureHeight, TextureWidth);
+		}
 
-			TextureHeight = TrackTexture->GetSizeX();
-			TextureWidth = TrackTexture->GetSizeY();
-			TextureColors = GetColorsFromTexture(TrackTexture);
+		const bool bRandomSeed = Seed == 0;
+		const FMapBuildSettings Settings = MakeBuildSettings(bRandomSeed ? FMath::RandRange(-1000, 1000) : Seed);
 
-			SplineComponent->ClearSplinePoints();
+		// The CPU stages may already have been started from the main menu
+		URacingEngineerGameInstance* RacingEngineerGameInstance = Cast<URacingEngineerGameInstance>(GetGameInstance());
+		if (RacingEngineerGameInstance != nullptr)
+		{
+			PendingBuild = RacingEngineerGameInstance->TakePregenerationTask(TrackTexture, Settings, bRandomSeed);
+		}
 
-			int32 Seed = 0;
-			if (RacingEngineerGameInstance->bStartedFromMainMenu)
-			{
-				NodeToSkip = CalculateNodeToSkip(TextureHeight, TextureWidth);
-				VertSpacingScale = CalculateVertScale(TextureHeight, TextureWidth);
-				Seed = RacingEngineerGameInstance->Seed;
-			}
+		if (!PendingBuild.IsValid())
+		{
+			PendingBuild = FMapBuildPipeline::Launch(TrackTexture, Settings);
+		}
+
+		// The game thread keeps running while the stages do, the workers are started once they are done
+		PendingBuild->OnCompleted(FOnMapBuildCompleted::CreateUObject(this, &AMapManager::OnMapBuildCompleted));
+
+		const uint32 MapManagerTimerStop = FPlatformTime::Cycles();
 
-			Seed = Seed == 0 ? FMath::RandRange(-1000, 1000) : Seed;
-			TArray<uint8> GeneratedHeights = GenerateHeightFromNoise(TextureHeight, TextureWidth, NoiseFrequency, Seed);
+		UE_LOG(LogTemp, Log, TEXT("MapManager launched the map build in %fms"),
+			FPlatformTime::ToMilliseconds(MapManagerTimerStop - MapManagerTimer));
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("AMapManager::BuildMap() HeightMapTexture or SplineComponent is nullptr"))
+	}
+}
+
+void AMapManager::OnMapBuildCompleted(const TSharedRef<FMapBuildData>& BuildData)
+{
+	PendingBuild.Reset();
 
-			TrackNodes = CreateTrack(TextureColors, TextureHeight, TextureWidth, NodeToSkip);
-			CreateTrackSpline(SplineComponent, TrackNodes, GeneratedHeights, TextureHeight, TextureWidth, VertSpacingScale);
+	URacingEngineerGameInstance* RacingEngineerGameInstance = Cast<URacingEngineerGameInstance>(GetGameInstance());
+	if (RacingEngineerGameInstance != nullptr)
+	{
+		RacingEngineerGameInstance->SetLastBuildSettings(BuildData->Settings);
+	}
 
-			const uint32 MapManagerTimerStop = FPlatformTime::Cycles();
+	BuildMapFromData(BuildData);
+}
 
-			UE_LOG(LogTemp, Warning, TEXT("MapManager elapsed time %fms"),
-				FPlatformTime::ToMilliseconds(MapManagerTimerStop - MapManagerTimer));
+void AMapManager::BuildMapFromData(const TSharedRef<FMapBuildData>& BuildData)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(AMapManager::BuildMapFromData);
 
-			TSharedRef<FWorkerData> WorkerData = MakeShared<FWorkerData>(GeneratedHeights, TextureWidth, TextureHeight, SplineComponent, VertSpacingScale);
+	if (SplineComponent == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("AMapManager::BuildMapFromData() SplineComponent is nullptr"));
+		return;
+	}
 
-			for (const TObjectPtr<AWorkerActor>& Worker : Workers)
-			{
-				if (Worker != nullptr)
-				{
-					AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [&Worker, this, WorkerData]
-						{
-							Worker->DoWork(WorkerData.Get(), FOnWorkFinished::CreateUObject(this, &AMapManager::WorkerFinished));
-						});
-				}
-			}
+	if (BuildData->TrackNodes.IsEmpty())
+	{
+		UE_LOG(LogTemp, Error, TEXT("AMapManager::BuildMapFromData() Map build produced no track"));
+		bIsBuildingMap = false;
+		return;
+	}
 
-			//TODO finish properly if no workers
+	bIsBuildingMap = true;
+	FinishedWorkersCounter = 0;
+	BuildStartSeconds = FPlatformTime::Seconds();
+	WorkerElapsedSeconds.Init(0.0, Workers.Num());
+
+	// The old map stayed drivable during the CPU stages, it is only torn down now that the new one replaces it
+	for (const TObjectPtr<AWorkerActor>& Worker : Workers)
+	{
+		if (Worker != nullptr)
+		{
+			Worker->ResetWork();
+		}
+	}
+
+	TextureWidth = BuildData->Width;
+	TextureHeight = BuildData->Height;
+	TrackNodes = BuildData->TrackNodes;
+	TrackFrames = BuildData->TrackFrames;
+	BuildGeneration++;
+
+	if (UTerrainQuerySubsystem* TerrainQuery = GetWorld()->GetSubsystem<UTerrainQuerySubsystem>())
+	{
+		TerrainQuery->SetHeightField(BuildData->HeightField, GetTerrainTransform());
+	}
+
+	SplineComponent->ClearSplinePoints();
+	CreateTrackSpline(SplineComponent, BuildData->SplinePoints);
+
+	TSharedRef<FWorkerData> WorkerData = MakeShared<FWorkerData>(BuildData, SplineComponent);
+
+	// Handed over before any worker runs, so none of them has to empty the build data the others and the caller still read
+	WorkerData->TerrainMesh = BuildData->TakeTerrainMesh();
+
+	if (Workers.IsEmpty())
+	{
+		bIsBuildingMap = false;
+		MovePlayerToStart();
+		return;
+	}
+
+	for (int32 WorkerIndex = 0; WorkerIndex < Workers.Num(); WorkerIndex++)
+	{
+		AWorkerActor* Worker = Workers[WorkerIndex];
+		if (Worker != nullptr)
+		{
+			AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [Worker, WorkerIndex, this, WorkerData]
+				{
+					Worker->DoWork(WorkerData.Get(), FOnWorkFinished::CreateUObject(this, &AMapManager::WorkerFinished, WorkerIndex));
+				});
 		}
 		else
 		{
-			UE_LOG(LogTemp, Error, TEXT("AMapManager::BeginPlay() HeightMapTexture or SplineComponent is nullptr"))
+			WorkerFinished(WorkerIndex);
 		}
 	}
-	else
+}
+
+FTransform AMapManager::GetTerrainTransform() const
+{
+	// The terrain is built in its own local space, which only matches the map manager's while the two are placed together
+	for (const TObjectPtr<AWorkerActor>& Worker : Workers)
 	{
-		UE_LOG(LogTemp, Error, TEXT("AMapManager::InitializeMap() RacingEngineerGameInstance is nullptr"));
+		if (const ATerrainGenerator* TerrainGenerator = Cast<ATerrainGenerator>(Worker))
+		{
+			return TerrainGenerator->GetActorTransform();
+		}
 	}
+
+	return GetActorTransform();
+}
+
+void AMapManager::SetWorkers(const TArray<AWorkerActor*>& InWorkers)
+{
+	Workers = InWorkers;
+}
+
+FMapBuildSettings AMapManager::MakeBuildSettings(int32 Seed) const
+{
+	FMapBuildSettings Settings;
+	Settings.Seed = Seed;
+	Settings.NoiseFrequency = NoiseFrequency;
+	Settings.NodeToSkip = NodeToSkip;
+	Settings.VertScale = VertSpacingScale;
+
+	const URacingEngineerGameInstance* RacingEngineerGameInstance = Cast<URacingEngineerGameInstance>(GetGameInstance());
+	if (RacingEngineerGameInstance != nullptr)
+	{
+		Settings.bLightWeightMode = RacingEngineerGameInstance->bLightWeightMode;
+	}
+
+	for (const TObjectPtr<AWorkerActor>& Worker : Workers)
+	{
+		if (Worker != nullptr)
+		{
+			Worker->GatherBuildSettings(Settings);
+		}
+	}
+
+	return Settings;
 }
 
-void AMapManager::WorkerFinished()
+void AMapManager::WorkerFinished(int32 WorkerIndex)
 {
 	++FinishedWorkersCounter;
-	UE_LOG(LogTemp, Log, TEXT("Worker has finished its work"));
+
+	if (WorkerElapsedSeconds.IsValidIndex(WorkerIndex))
+	{
+		WorkerElapsedSeconds[WorkerIndex] = FPlatformTime::Seconds() - BuildStartSeconds;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Worker %s has finished its work"),
+		Workers[WorkerIndex] != nullptr ? *Workers[WorkerIndex]->GetName() : TEXT("None"));
 
 	if (FinishedWorkersCounter == Workers.Num())
 	{
+		bIsBuildingMap = false;
 		MovePlayerToStart();
 		UE_LOG(LogTemp, Log, TEXT("All workers have finished their work"));
 	}
@@ -113,6 +351,43 @@ void AMapManager::WorkerFinished()
 	}
 }
 
+bool AMapManager::FindClosestTrackPoint(const FVector& WorldLocation, float& OutTrackDistance, float& OutDistanceFromTrack) const
+{
+	if (TrackFrames.IsEmpty())
+	{
+		return false;
+	}
+
+	const FVector MapLocation = GetActorTransform().InverseTransformPosition(WorldLocation);
+
+	OutTrackDistance = TrackFrames.FindClosestDistance(MapLocation);
+	OutDistanceFromTrack = FVector::Dist2D(TrackFrames.GetLocationAtDistance(OutTrackDistance), MapLocation);
+
+	return true;
+}
+
+FTransform AMapManager::GetTrackResetTransform(float TrackDistance) const
+{
+	const float ResetDistance = TrackFrames.WrapDistance(TrackDistance - ResetBackOffset);
+	const FTransform& MapTransform = GetActorTransform();
+
+	FVector ResetLocation = MapTransform.TransformPosition(TrackFrames.GetLocationAtDistance(ResetDistance));
+	const FVector ResetDirection = MapTransform.TransformVectorNoScale(TrackFrames.GetDirectionAtDistance(ResetDistance));
+
+	// The track mesh lies on the spline, the terrain under it is carved TrackDepth below. Off the track texels the terrain can be higher
+	const UTerrainQuerySubsystem* TerrainQuery = GetWorld()->GetSubsystem<UTerrainQuerySubsystem>();
+	FTerrainSample Sample;
+	if (TerrainQuery != nullptr && TerrainQuery->QueryTerrain(ResetLocation, Sample))
+	{
+		ResetLocation.Z = FMath::Max(ResetLocation.Z, Sample.Location.Z);
+	}
+
+	// Heading only, pitch and roll are left to the suspension
+	const FRotator ResetRotation(0.0f, ResetDirection.Rotation().Yaw, 0.0f);
+
+	return FTransform(ResetRotation, ResetLocation + FVector(0.0f, 0.0f, ResetHeight));
+}
+
 void AMapManager::MovePlayerToStart()
 {
 	if (SplineComponent != nullptr)
@@ -162,78 +437,15 @@ void AMapManager::Tick(float DeltaTime)
 
 }
 
-TArray<FColor> AMapManager::GetColorsFromTexture(UTexture2D* Texture)
-{
-	TArray<FColor> ColorData;
-
-	if (Texture != nullptr)
-	{
-		FRenderCommandFence RenderFence;
-
-		ColorData.SetNumUninitialized(TextureWidth * TextureHeight);
-
-		ENQUEUE_RENDER_COMMAND(ReadColorsFromTexture)(
-			[&ColorData, Width = TextureWidth, Height = TextureHeight, Texture](FRHICommandListImmediate& RHICmdList)
-			{
-				FTextureResource* Resource = Texture->GetResource();
-				uint32 Stride = 0;
-				void* MipData = RHILockTexture2D(
-					Resource->GetTexture2DRHI(),
-					0,
-					RLM_ReadOnly,
-					Stride,
-					false
-				);
-
-				EPixelFormat TexturePixelFormat = Texture->GetPlatformData()->PixelFormat;
-				if (TexturePixelFormat == PF_B8G8R8A8)
-				{
-					 GetColors(ColorData, MipData, Width, Height);
-				}
-				else
-				{
-					UE_LOG(LogTemp, Warning, TEXT("AMapManager::GetColorsFromTexture() unhandeled PixelFormat"))
-				}
-
-				RHIUnlockTexture2D(Resource->GetTexture2DRHI(), 0, false);
-			});
-
-		RenderFence.BeginFence();
-		RenderFence.Wait();
-
-	}
-
-	return ColorData;
-}
-
 TArray<uint8> AMapManager::GenerateHeightFromNoise(const uint32 TextureHeight, const uint32 TextureWidth, const float Frequency, const int32 Seed)
 {
-	TArray<uint8> Heights;
-
-	Heights.Reserve(TextureWidth * TextureHeight);
-
-	UFastNoiseWrapper* FastNoiseWrapper = NewObject<UFastNoiseWrapper>();
-
-	if (FastNoiseWrapper != nullptr)
-	{
-		FastNoiseWrapper->SetupFastNoise(EFastNoise_NoiseType::Perlin, Seed, Frequency, EFastNoise_Interp::Quintic);
-
-		for (uint32 y = 0; y < TextureWidth; y++)
-		{
-			for (uint32 x = 0; x < TextureHeight; x++)
-			{
-				const float NoiseValue = FastNoiseWrapper->GetNoise2D(x, y);
-				const uint8 NoiseValueByte = FMath::Clamp(FMath::RoundToInt(NoiseValue * 255.0f), 0, 255);
-				Heights.Emplace(NoiseValueByte);
-			}
-		}
-	}
-	
-	return Heights;
+	return FMapBuildPipeline::GenerateHeights(FTerrainNoise(Seed, Frequency), TextureWidth, TextureHeight);
 }
 
 void AMapManager::GetColors(TArray<FColor>& ColorData, void* SrcData, uint32 TextureWidth, uint32 TextureHeight)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(AMapManager::GetColors);
+
 	constexpr uint32 BufferSize = 256;
 	const uint64 TextureResolution = TextureWidth * TextureHeight;
 
@@ -255,161 +467,44 @@ void AMapManager::GetColors(TArray<FColor>& ColorData, void* SrcData, uint32 Tex
 
 #pragma region TextureToSpline
 
+// The tracing itself lives in FTrackContour in RacingEngineerCore, these stay for the callers of AMapManager
+
 FVector2D AMapManager::AddDirectionToPosition(const FVector2D& Vector2D, const EDirection& Direction)
 {
-	FVector2D MoveVec;
-
-	switch (Direction)
-	{
-	case EDirection::UpLeft:
-		MoveVec = FVector2D(-1.0, -1.0);
-		break;
-	case EDirection::Up:
-		MoveVec = FVector2D(0.0, -1.0);
-		break;
-	case EDirection::UpRight:
-		MoveVec = FVector2D(1.0, -1.0);
-		break;
-	case EDirection::Right:
-		MoveVec = FVector2D(1.0, 0.0);
-		break;
-	case EDirection::DownRight:
-		MoveVec = FVector2D(1.0, 1.0);
-		break;
-	case EDirection::Down:
-		MoveVec = FVector2D(0.0, 1.0);
-		break;
-	case EDirection::DownLeft:
-		MoveVec = FVector2D(-1.0, 1.0);
-		break;
-	case EDirection::Left:
-		MoveVec = FVector2D(-1.0, 0.0);
-		break;
-	default:
-		MoveVec = FVector2D(0.0, 0.0);
-		break;
-	}
-
-	return Vector2D + MoveVec;
+	return FTrackContour::AddDirectionToPosition(Vector2D, Direction);
 }
 
 TArray<FVector2D> AMapManager::CreateTrack(const TArray<FColor>& HeightTextureColors, const uint32 TextureHeight, const uint32 TextureWidth, const uint8 SkipNodesCount)
 {
-	TArray<FVector2D> TrackNodes;
-
-	FTrackNode TrackNode = FindFirstTrackNode(HeightTextureColors, TextureHeight, TextureWidth);
-	TrackNodes.Add(TrackNode.Position);
-	constexpr uint8 MinNumberOfNodes = 3;
-
-	for (uint8 i = 0; i < MinNumberOfNodes; i++)
-	{
-		TrackNode = FindNextTrackNode(HeightTextureColors, TextureWidth, TrackNode);
-		TrackNodes.Add(TrackNode.Position);
-	}
-
-	while (ShouldFindAnotherTrackNode(TrackNodes))
-	{
-		TrackNode = FindNextTrackNode(HeightTextureColors, TextureWidth, TrackNode);
-		TrackNodes.Add(TrackNode.Position);
-	}
-
-	if (SkipNodesCount > 0)
-	{
-		TArray<FVector2D> TrackNodesReduced;
-		TrackNodesReduced.Reserve(TrackNodes.Num() / SkipNodesCount);
-		// Reduce the number of nodes
-		for (SIZE_T i = 0; i < TrackNodes.Num(); i += SkipNodesCount)
-		{
-			TrackNodesReduced.Add(TrackNodes[i]);
-		}
-
-		return TrackNodesReduced;
-	}
-	else
-	{
-		return TrackNodes;
-	}
+	return FTrackContour::CreateTrack(HeightTextureColors, TextureHeight, TextureWidth, SkipNodesCount);
 }
 
 FTrackNode AMapManager::FindFirstTrackNode(const TArray<FColor>& HeightTextureColors, const uint32 TextureHeight, const uint32 TextureWidth)
 {
-	// search from the bottom left corner
-	for (uint32 y = TextureHeight - 1; y > 0 / 2; y--)
-	{
-		for (uint32 x = 0; x < TextureWidth; x++)
-		{
-			FColor pixelColor = HeightTextureColors[y * TextureWidth + x];
-
-			if (pixelColor.R < 127)
-			{
-				return FTrackNode(FVector2D(x, y), EDirection::Left);
-			}
-		}
-	}
-
-	UE_LOG(LogTemp, Warning, TEXT("AMapManager::FindFirstTrackNode Couldn't find the first node"));
-	return FTrackNode(FVector2D(0, TextureWidth - 1), EDirection::Left);
+	return FTrackContour::FindFirstTrackNode(HeightTextureColors, TextureHeight, TextureWidth);
 }
 
 FTrackNode AMapManager::FindNextTrackNode(const TArray<FColor>& HeightTextureColors, const uint32 TextureWidth, const FTrackNode& CurrentNode)
 {
-	EDirection CurrentDirection = CurrentNode.PrevPointDirection + 1;
-	bool bFound = false;
-
-	for (int i = 0; i < 7; i++)
-	{
-		const FVector2D NeighbourPos = AddDirectionToPosition(CurrentNode.Position, CurrentDirection);
-
-		if (NeighbourPos.X > 0 && NeighbourPos.X < TextureWidth &&
-			NeighbourPos.Y > 0 && NeighbourPos.Y < TextureWidth)
-		{
-			const FColor PixelColor = HeightTextureColors[NeighbourPos.Y * TextureWidth + NeighbourPos.X];
-
-			if (PixelColor.R < 127)
-			{
-				bFound = true;
-				break;
-			}
-		}
-
-		CurrentDirection = CurrentDirection + 1;
-	}
-
-	if (!bFound)
-	{
-		UE_LOG(LogTemp, Error, TEXT("AMapManager::FindNextTrackNode Couldn't find the next node"));
-		check(false);
-	}
-
-	const EDirection DirectionToOrigin = CurrentDirection + 4;
-	return FTrackNode(AddDirectionToPosition(CurrentNode.Position, CurrentDirection), DirectionToOrigin);
+	return FTrackContour::FindNextTrackNode(HeightTextureColors, TextureWidth, CurrentNode);
 }
 
 bool AMapManager::ShouldFindAnotherTrackNode(const TArray<FVector2D>& TrackNodes)
 {
-	check(TrackNodes.Num() >= 3);
-
-	const FVector2D FirstNode = TrackNodes[0];
-	const FVector2D LastNode = TrackNodes.Last();
-
-	return FVector2D::DistSquared(FirstNode, LastNode) > 2;
+	return FTrackContour::ShouldFindAnotherTrackNode(TrackNodes);
 }
 
-void AMapManager::CreateTrackSpline(USplineComponent* Spline, const TArray<FVector2D>& Nodes, const TArray<uint8>& Heights, const uint32 Height, const uint32 Width, const FVector& VertScale)
+void AMapManager::CreateTrackSpline(USplineComponent* Spline, const TArray<FVector>& SplinePoints)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(AMapManager::CreateTrackSpline);
+	LLM_SCOPE_BYTAG(RacingEngineer_Track);
+
 	if (Spline != nullptr)
 	{
-		for (const FVector2D& TrackNode : Nodes)
+		// The spline is updated once when the loop is closed instead of after every point
+		for (const FVector& SplinePos : SplinePoints)
 		{
-			const uint8 HeightValue = Heights[TrackNode.Y * Width + TrackNode.X];
-			FVector SplinePos =
-			{
-				(TrackNode.X - Width / 2) * VertScale.X,
-				(TrackNode.Y - Height / 2) * VertScale.Y,
-				(HeightValue - 255 / 2) / 255.0 * VertScale.Z
-			};
-
-			Spline->AddSplinePoint(SplinePos, ESplineCoordinateSpace::Local);
+			Spline->AddSplinePoint(SplinePos, ESplineCoordinateSpace::Local, false);
 		}
 
 		Spline->SetClosedLoop(true);
@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "TrackContour.h"
+#include "MapBuildPipeline.h"
 #include "MapManager.generated.h"
 
 class USplineComponent;
@@ -14,36 +16,6 @@ class ATrackGenerator;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnInitializationUpdate, float, CompletePercentage);
 
-UENUM()
-enum class EDirection : uint8
-{
-	Left = 0,
-	DownLeft = 1,
-	Down = 2,
-	DownRight = 3,
-	Right = 4,
-	UpRight = 5,
-	Up = 6,
-	UpLeft = 7,
-};
-
-inline EDirection operator+(const EDirection& Dir, const int& Val)
-{
-	return static_cast<EDirection>((static_cast<int>(Dir) + Val) % 8);
-}
-
-USTRUCT()
-struct FTrackNode
-{
-	GENERATED_BODY()
-
-	UPROPERTY(EditAnywhere)
-	FVector2D Position = FVector2D::ZeroVector;
-
-	UPROPERTY(EditAnywhere)
-	EDirection PrevPointDirection = EDirection::Left;
-};
-
 UCLASS()
 class RACINGENGINEER_API AMapManager : public AActor
 {
@@ -56,6 +28,7 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:	
 	// Called every frame
@@ -64,13 +37,19 @@ public:
 	UFUNCTION(BlueprintCallable)
 	void InitializeMap();
 
+	// Rebuilds the map in place, NewTrackTexture == nullptr keeps the current texture and NewSeed == 0 picks a random one
+	UFUNCTION(BlueprintCallable)
+	void RegenerateMap(UTexture2D* NewTrackTexture, int32 NewSeed);
+
+	UFUNCTION(BlueprintCallable)
+	bool IsBuildingMap() const { return bIsBuildingMap; }
+
 	UPROPERTY(BlueprintAssignable)
 	FOnInitializationUpdate OnInitializationUpdate;
 
 	UFUNCTION(BlueprintCallable)
 	void MovePlayerToStart();
 
-	TArray<FColor> GetColorsFromTexture(UTexture2D* Texture);
 	static TArray<uint8> GenerateHeightFromNoise(const uint32 TextureHeight, const uint32 TextureWidth, const float Frequency, const int32 Seed = 42);
 
 	static void GetColors(TArray<FColor>& ColorData, void* SrcData, uint32 TextureWidth, uint32 TextureHeight);
@@ -83,14 +62,47 @@ public:
 	static TArray<FVector2D> CreateTrack(const TArray<FColor>& HeightTextureColors, const uint32 TextureHeight,
 		const uint32 TextureWidth, const uint8 SkipNodesCount);
 
-	static void CreateTrackSpline(USplineComponent* Spline, const TArray<FVector2D>& Nodes, const TArray<uint8>& Heights,
-		const uint32 Height, const uint32 Width, const FVector& VertScale);
+	static void CreateTrackSpline(USplineComponent* Spline, const TArray<FVector>& SplinePoints);
+
+	// Spawns the spline and starts the workers on an already finished CPU build, the terrain mesh is taken out of BuildData
+	void BuildMapFromData(const TSharedRef<FMapBuildData>& BuildData);
+
+	FMapBuildSettings MakeBuildSettings(int32 Seed) const;
+
+	// Used when there is no level to place the workers in, like the benchmark commandlet
+	void SetWorkers(const TArray<AWorkerActor*>& InWorkers);
+
+	const TArray<TObjectPtr<AWorkerActor>>& GetWorkers() const { return Workers; }
+
+	// Centre line of the current track in the map manager's space, empty before the first build
+	const FTrackFrameTable& GetTrackFrames() const { return TrackFrames; }
+
+	// Raised by every build, what the track and terrain were derived from changed when it differs from a kept value
+	uint32 GetBuildGeneration() const { return BuildGeneration; }
+
+	// Closest centre line point to a world location, as a distance along the track and a distance from it in the XY plane.
+	// Cheap enough to call every frame, false before the first build
+	bool FindClosestTrackPoint(const FVector& WorldLocation, float& OutTrackDistance, float& OutDistanceFromTrack) const;
+
+	// World transform to put a car back on the track at TrackDistance, ResetBackOffset behind it and facing along the lap
+	FTransform GetTrackResetTransform(float TrackDistance) const;
+
+	// Seconds from the start of the worker stage to each worker's callback, indexed like the workers
+	const TArray<double>& GetWorkerElapsedSeconds() const { return WorkerElapsedSeconds; }
 
 	static uint8 CalculateNodeToSkip(const uint32 TextureHeight, const uint32 TextureWidth);
 	static FVector CalculateVertScale(const uint32 TextureHeight, const uint32 TextureWidth);
 
 private:
-	void WorkerFinished();
+	void BuildMap(int32 Seed, bool bScaleToTexture);
+
+	// Game thread, once the CPU stages of PendingBuild have finished
+	void OnMapBuildCompleted(const TSharedRef<FMapBuildData>& BuildData);
+
+	void WorkerFinished(int32 WorkerIndex);
+
+	// Of the terrain generator among the workers, the map manager's own without one
+	FTransform GetTerrainTransform() const;
 
 private:
 	UPROPERTY()
@@ -110,11 +122,28 @@ private:
 
 	UPROPERTY(EditAnywhere)
 	float NoiseFrequency = 0.01f;
-	TArray<FColor> TextureColors;
+
+	// How far back along the lap a reset car is put, so it does not land in the corner it left the track in
+	UPROPERTY(EditAnywhere, Category = "Vehicle Reset")
+	float ResetBackOffset = 500.0f;
+
+	// Above the track surface, so the wheels settle instead of starting inside it
+	UPROPERTY(EditAnywhere, Category = "Vehicle Reset")
+	float ResetHeight = 50.0f;
 
 	std::atomic_uint8_t FinishedWorkersCounter = 0;
 
+	bool bIsBuildingMap = false;
+
+	// CPU side of the build while it runs, released when it completes or the actor goes away
+	TSharedPtr<FMapBuildTask> PendingBuild;
+
+	double BuildStartSeconds = 0.0;
+	TArray<double> WorkerElapsedSeconds;
+
 	TArray<FVector2D> TrackNodes;
+	FTrackFrameTable TrackFrames;
+	uint32 BuildGeneration = 0;
 
 	uint32 TextureHeight = 0;
 	uint32 TextureWidth = 0;
@@ -16,18 +16,23 @@ public class RacingEngineer : ModuleRules
 	        "EnhancedInput", 
 			"ChaosVehicles", 
 			"PhysicsCore", 
+			"Chaos", 
 			"Landscape", 
 			"SlateCore", 
 			"Foliage", 
-			"FastNoiseGenerator",
-			"FastNoise"
+			"RacingEngineerCore"
         });
 
 		PrivateDependencyModuleNames.AddRange( new string[]
 		{
 			"ProceduralMeshComponent", 
 			"RenderCore", 
-			"RHI"
+			"RHI",
+			"ImageCore",
+			"ImageWrapper",
+			"Json",
+			"Sockets",
+			"Networking"
 		});
 		
         if (Target.Platform == UnrealTargetPlatform.Win64)
@@ -1,7 +1,31 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "RacingEngineer.h"
+#include "TerrainHeightFile.h"
 #include "Modules/ModuleManager.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, RacingEngineer, "RacingEngineer" );
- 
\ No newline at end of file
+DEFINE_STAT(STAT_RacingEngineer_TerrainVertices);
+DEFINE_STAT(STAT_RacingEngineer_TerrainTriangles);
+DEFINE_STAT(STAT_RacingEngineer_SplinePoints);
+DEFINE_STAT(STAT_RacingEngineer_FoliageInstances);
+DEFINE_STAT(STAT_RacingEngineer_Checkpoints);
+DEFINE_STAT(STAT_RacingEngineer_SpawnQueueDepth);
+DEFINE_STAT(STAT_RacingEngineer_AIDrivers);
+DEFINE_STAT(STAT_RacingEngineer_AIDriversUpdate);
+
+LLM_DEFINE_TAG(RacingEngineer_Terrain);
+LLM_DEFINE_TAG(RacingEngineer_Foliage);
+LLM_DEFINE_TAG(RacingEngineer_Track);
+LLM_DEFINE_TAG(RacingEngineer_Checkpoints);
+
+class FRacingEngineerModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+		// A crashed banded build never got to delete its heights
+		FTerrainHeightFile::DeleteOrphanedFiles();
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FRacingEngineerModule, RacingEngineer, "RacingEngineer" );
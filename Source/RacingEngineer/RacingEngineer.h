@@ -3,3 +3,26 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "HAL/LowLevelMemTracker.h"
+
+DECLARE_STATS_GROUP(TEXT("RacingEngineer"), STATGROUP_RacingEngineer, STATCAT_Advanced);
+
+// Size of the last built map, kept until the next build sets them again
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Terrain Vertices"), STAT_RacingEngineer_TerrainVertices, STATGROUP_RacingEngineer, RACINGENGINEER_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Terrain Triangles"), STAT_RacingEngineer_TerrainTriangles, STATGROUP_RacingEngineer, RACINGENGINEER_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Spline Points"), STAT_RacingEngineer_SplinePoints, STATGROUP_RacingEngineer, RACINGENGINEER_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Foliage Instances"), STAT_RacingEngineer_FoliageInstances, STATGROUP_RacingEngineer, RACINGENGINEER_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Checkpoints"), STAT_RacingEngineer_Checkpoints, STATGROUP_RacingEngineer, RACINGENGINEER_API);
+
+// Track meshes and checkpoints still waiting for a game thread spawn batch
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Spawn Queue Depth"), STAT_RacingEngineer_SpawnQueueDepth, STATGROUP_RacingEngineer, RACINGENGINEER_API);
+
+// Opponents driven by UAIDriverSubsystem and the physics thread time of their batched update
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("AI Drivers"), STAT_RacingEngineer_AIDrivers, STATGROUP_RacingEngineer, RACINGENGINEER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("AI Drivers Update"), STAT_RacingEngineer_AIDriversUpdate, STATGROUP_RacingEngineer, RACINGENGINEER_API);
+
+LLM_DECLARE_TAG_API(RacingEngineer_Terrain, RACINGENGINEER_API);
+LLM_DECLARE_TAG_API(RacingEngineer_Foliage, RACINGENGINEER_API);
+LLM_DECLARE_TAG_API(RacingEngineer_Track, RACINGENGINEER_API);
+LLM_DECLARE_TAG_API(RacingEngineer_Checkpoints, RACINGENGINEER_API);
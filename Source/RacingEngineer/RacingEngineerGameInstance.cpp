@@ -3,4 +3,95 @@
 
 #include "RacingEngineerGameInstance.h"
 #include "RacingEngineerSaveGame.h"
+#include "MapManager.h"
+#include "Engine/Texture2D.h"
 
+void URacingEngineerGameInstance::Shutdown()
+{
+	PregenerationTask.Reset();
+
+	Super::Shutdown();
+}
+
+void URacingEngineerGameInstance::SelectMap(UTexture2D* MapTexture, int32 MapSeed)
+{
+	SelectedMapTexture = MapTexture;
+	Seed = MapSeed;
+
+	StartMapPregeneration();
+}
+
+void URacingEngineerGameInstance::SetSelectedMapTexture(UTexture2D* MapTexture)
+{
+	SelectMap(MapTexture, Seed);
+}
+
+void URacingEngineerGameInstance::SetSeed(int32 MapSeed)
+{
+	if (MapSeed == Seed && PregenerationTask.IsValid())
+	{
+		return;
+	}
+
+	Seed = MapSeed;
+
+	// Nothing to build before a map is picked
+	if (SelectedMapTexture != nullptr)
+	{
+		StartMapPregeneration();
+	}
+}
+
+void URacingEngineerGameInstance::StartMapPregeneration()
+{
+	if (SelectedMapTexture != nullptr)
+	{
+		const uint32 TextureWidth = SelectedMapTexture->GetSizeX();
+		const uint32 TextureHeight = SelectedMapTexture->GetSizeY();
+
+		FMapBuildSettings Settings = LastBuildSettings;
+		Settings.Seed = Seed != 0 ? Seed : FMath::RandRange(-1000, 1000);
+		Settings.NodeToSkip = AMapManager::CalculateNodeToSkip(TextureHeight, TextureWidth);
+		Settings.VertScale = AMapManager::CalculateVertScale(TextureHeight, TextureWidth);
+		Settings.bLightWeightMode = bLightWeightMode;
+
+		// A previous pre-generation is dropped, which cancels it
+		PregenerationTask = FMapBuildPipeline::Launch(SelectedMapTexture, Settings);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("URacingEngineerGameInstance::StartMapPregeneration SelectedMapTexture is nullptr"));
+	}
+}
+
+TSharedPtr<FMapBuildTask> URacingEngineerGameInstance::TakePregenerationTask(const UTexture2D* Texture, const FMapBuildSettings& Settings, bool bAnySeed)
+{
+	TSharedPtr<FMapBuildTask> Task = MoveTemp(PregenerationTask);
+
+	if (Task.IsValid())
+	{
+		const FMapBuildSettings& PregeneratedSettings = Task->GetSettings();
+
+		if (Task->GetTexture() != Texture || !PregeneratedSettings.IsCompatibleWith(Settings)
+			|| (!bAnySeed && PregeneratedSettings.Seed != Settings.Seed))
+		{
+			UE_LOG(LogTemp, Log, TEXT("URacingEngineerGameInstance::TakePregenerationTask Pre-generated map doesn't match, it will be rebuilt"));
+			Task.Reset();
+		}
+	}
+
+	return Task;
+}
+
+void URacingEngineerGameInstance::SetLastBuildSettings(const FMapBuildSettings& Settings)
+{
+	// The seed is resolved per build, so the ini is only written when a setting the menu reuses changed
+	const bool bChanged = !LastBuildSettings.IsCompatibleWith(Settings);
+
+	LastBuildSettings = Settings;
+
+	if (bChanged)
+	{
+		SaveConfig();
+	}
+}
@@ -4,13 +4,14 @@
 
 #include "CoreMinimal.h"
 #include "Engine/GameInstance.h"
+#include "MapBuildPipeline.h"
 #include "RacingEngineerGameInstance.generated.h"
 
 class URacingEngineerSaveGame;
 /**
  * 
  */
-UCLASS()
+UCLASS(Config = Game)
 class RACINGENGINEER_API URacingEngineerGameInstance : public UGameInstance
 {
 	GENERATED_BODY()
@@ -19,7 +20,8 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GameInstance")
 	bool bStartedFromMainMenu = false;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GameInstance")
+	// Setting it from the level selection starts building the map in the background
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, BlueprintSetter = SetSelectedMapTexture, Category = "GameInstance")
 	TObjectPtr<UTexture2D> SelectedMapTexture;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GameInstance")
@@ -28,6 +30,36 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GameInstance")
 	bool bLightWeightMode = false;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GameInstance")
+	// A new seed restarts a pre-generation that is already running
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, BlueprintSetter = SetSeed, Category = "GameInstance")
 	int32 Seed = 42;
+
+	virtual void Shutdown() override;
+
+	// Selects the map to play and starts building it in the background while the menu is still open
+	UFUNCTION(BlueprintCallable, Category = "GameInstance")
+	void SelectMap(UTexture2D* MapTexture, int32 MapSeed);
+
+	UFUNCTION(BlueprintSetter)
+	void SetSelectedMapTexture(UTexture2D* MapTexture);
+
+	UFUNCTION(BlueprintSetter)
+	void SetSeed(int32 MapSeed);
+
+	UFUNCTION(BlueprintCallable, Category = "GameInstance")
+	void StartMapPregeneration();
+
+	// Hands over the pre-generation, finished or not, if it builds the same texture with the same settings, nullptr otherwise.
+	// One that doesn't match is cancelled
+	TSharedPtr<FMapBuildTask> TakePregenerationTask(const UTexture2D* Texture, const FMapBuildSettings& Settings, bool bAnySeed);
+
+	void SetLastBuildSettings(const FMapBuildSettings& Settings);
+	const FMapBuildSettings& GetLastBuildSettings() const { return LastBuildSettings; }
+
+private:
+	// Worker dependent settings of the last build, the menu has no workers to ask
+	UPROPERTY(Config)
+	FMapBuildSettings LastBuildSettings;
+
+	TSharedPtr<FMapBuildTask> PregenerationTask;
 };
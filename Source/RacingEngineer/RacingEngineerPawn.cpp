@@ -10,6 +10,8 @@
 #include "EnhancedInputSubsystems.h"
 #include "InputActionValue.h"
 #include "ChaosWheeledVehicleMovementComponent.h"
+#include "MapManager.h"
+#include "EngineUtils.h"
 
 #define LOCTEXT_NAMESPACE "VehiclePawn"
 
@@ -92,6 +94,32 @@ void ARacingEngineerPawn::SetupPlayerInputComponent(class UInputComponent* Playe
 	}
 }
 
+void ARacingEngineerPawn::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Looked up once instead of on every tick, a map manager spawned after the pawn is caught when it spawns
+	TActorIterator<AMapManager> It(GetWorld());
+	MapManager = It ? *It : nullptr;
+
+	if (!MapManager.IsValid())
+	{
+		ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(
+			FOnActorSpawned::FDelegate::CreateUObject(this, &ARacingEngineerPawn::OnActorSpawned));
+	}
+}
+
+void ARacingEngineerPawn::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (ActorSpawnedHandle.IsValid())
+	{
+		GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+		ActorSpawnedHandle.Reset();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void ARacingEngineerPawn::Tick(float Delta)
 {
 	Super::Tick(Delta);
@@ -105,6 +133,27 @@ void ARacingEngineerPawn::Tick(float Delta)
 	CameraYaw = FMath::FInterpTo(CameraYaw, 0.0f, Delta, 1.0f);
 
 	BackSpringArm->SetRelativeRotation(FRotator(0.0f, CameraYaw, 0.0f));
+
+	// put the vehicle back on the track once it has been off it for long enough
+	if (bResetWhenOffTrack)
+	{
+		const AMapManager* Map = GetMapManager();
+
+		float TrackDistance = 0.0f;
+		float DistanceFromTrack = 0.0f;
+		if (Map != nullptr && Map->FindClosestTrackPoint(GetActorLocation(), TrackDistance, DistanceFromTrack) && DistanceFromTrack > OffTrackResetDistance)
+		{
+			OffTrackSeconds += Delta;
+			if (OffTrackSeconds >= OffTrackResetSeconds)
+			{
+				ResetVehicleToTrack();
+			}
+		}
+		else
+		{
+			OffTrackSeconds = 0.0f;
+		}
+	}
 }
 
 void ARacingEngineerPawn::Steering(const FInputActionValue& Value)
@@ -187,21 +236,60 @@ void ARacingEngineerPawn::ToggleCamera(const FInputActionValue& Value)
 
 void ARacingEngineerPawn::ResetVehicle(const FInputActionValue& Value)
 {
-	// reset to a location slightly above our current one
-	FVector ResetLocation = GetActorLocation() + FVector(0.0f, 0.0f, 50.0f);
+	ResetVehicleToTrack();
+}
+
+void ARacingEngineerPawn::ResetVehicleToTrack()
+{
+	FTransform ResetTransform;
+
+	// reset onto the closest point of the track, facing along the lap
+	const AMapManager* Map = GetMapManager();
+
+	float TrackDistance = 0.0f;
+	float DistanceFromTrack = 0.0f;
+	if (Map != nullptr && Map->FindClosestTrackPoint(GetActorLocation(), TrackDistance, DistanceFromTrack))
+	{
+		ResetTransform = Map->GetTrackResetTransform(TrackDistance);
+	}
+	else
+	{
+		// reset to a location slightly above our current one
+		FVector ResetLocation = GetActorLocation() + FVector(0.0f, 0.0f, 50.0f);
+
+		// reset to our yaw. Ignore pitch and roll
+		FRotator ResetRotation = GetActorRotation();
+		ResetRotation.Pitch = 0.0f;
+		ResetRotation.Roll = 0.0f;
+
+		ResetTransform = FTransform(ResetRotation, ResetLocation, FVector::OneVector);
+	}
 
-	// reset to our yaw. Ignore pitch and roll
-	FRotator ResetRotation = GetActorRotation();
-	ResetRotation.Pitch = 0.0f;
-	ResetRotation.Roll = 0.0f;
-	
 	// teleport the actor to the reset spot and reset physics
-	SetActorTransform(FTransform(ResetRotation, ResetLocation, FVector::OneVector), false, nullptr, ETeleportType::TeleportPhysics);
+	SetActorTransform(ResetTransform, false, nullptr, ETeleportType::TeleportPhysics);
 
 	GetMesh()->SetPhysicsAngularVelocityInDegrees(FVector::ZeroVector);
 	GetMesh()->SetPhysicsLinearVelocity(FVector::ZeroVector);
 
-	UE_LOG(LogTemplateVehicle, Error, TEXT("Reset Vehicle"));
+	OffTrackSeconds = 0.0f;
+
+	UE_LOG(LogTemplateVehicle, Log, TEXT("Reset Vehicle"));
+}
+
+AMapManager* ARacingEngineerPawn::GetMapManager() const
+{
+	return MapManager.Get();
+}
+
+void ARacingEngineerPawn::OnActorSpawned(AActor* SpawnedActor)
+{
+	if (AMapManager* SpawnedMapManager = Cast<AMapManager>(SpawnedActor))
+	{
+		MapManager = SpawnedMapManager;
+
+		GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+		ActorSpawnedHandle.Reset();
+	}
 }
 
 #undef LOCTEXT_NAMESPACE
\ No newline at end of file
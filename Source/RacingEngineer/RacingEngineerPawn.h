@@ -10,6 +10,7 @@ class UCameraComponent;
 class USpringArmComponent;
 class UInputAction;
 class UChaosWheeledVehicleMovementComponent;
+class AMapManager;
 struct FInputActionValue;
 
 DECLARE_LOG_CATEGORY_EXTERN(LogTemplateVehicle, Log, All);
@@ -78,6 +79,29 @@ protected:
 	/** Keeps track of which camera is active */
 	bool bFrontCameraActive = false;
 
+	/** Puts the vehicle back on the track by itself once it has been off it for a while */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Reset)
+	bool bResetWhenOffTrack = false;
+
+	/** Distance from the track centre line past which the vehicle counts as off the track */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Reset, meta = (EditCondition = "bResetWhenOffTrack"))
+	float OffTrackResetDistance = 3000.0f;
+
+	/** Seconds off the track before the vehicle is reset */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Reset, meta = (EditCondition = "bResetWhenOffTrack"))
+	float OffTrackResetSeconds = 2.0f;
+
+	/** Seconds the vehicle has been off the track for */
+	float OffTrackSeconds = 0.0f;
+
+	/** Map whose track the vehicle is reset to, found on BeginPlay or when it spawns later */
+	TWeakObjectPtr<AMapManager> MapManager;
+
+	/** Set while there was no map manager on BeginPlay */
+	FDelegateHandle ActorSpawnedHandle;
+
+	void OnActorSpawned(AActor* SpawnedActor);
+
 public:
 	ARacingEngineerPawn();
 
@@ -91,6 +115,10 @@ public:
 
 	virtual void Tick(float Delta) override;
 
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	// End Actor interface
 
 protected:
@@ -121,6 +149,12 @@ protected:
 	/** Handles reset vehicle input */
 	void ResetVehicle(const FInputActionValue& Value);
 
+	/** Teleports the vehicle onto the closest point of the track, or just above where it is when there is no track */
+	void ResetVehicleToTrack();
+
+	/** Returns the map manager of the world, if there is one */
+	AMapManager* GetMapManager() const;
+
 	/** Called when the brake lights are turned on or off */
 	UFUNCTION(BlueprintImplementableEvent, Category="Vehicle")
 	void BrakeLights(bool bBraking);
@@ -6,6 +6,13 @@
 #include "ImageUtils.h"
 #include "RacingEngineerSaveGame.h"
 #include "Kismet/GameplayStatics.h"
+#include "Async/Async.h"
+#include "UObject/StrongObjectPtr.h"
+#include "SaveSlotIndexSubsystem.h"
+#include "LapHistorySubsystem.h"
+#include "Engine/Engine.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
 
 URacingEngineerSaveGame* USaveManager::CreateSaveSlot(const FString& SaveSlotName, const FString& MapTexturePath)
 {
@@ -13,40 +20,19 @@ URacingEngineerSaveGame* USaveManager::CreateSaveSlot(const FString& SaveSlotNam
 	{
 		if (!MapTexturePath.IsEmpty())
 		{
-			URacingEngineerSaveGame* SaveGame = Cast<URacingEngineerSaveGame>(UGameplayStatics::CreateSaveGameObject(URacingEngineerSaveGame::StaticClass()));
+			FSaveSlotMetadata Metadata;
+			Metadata.SaveSlotName = SaveSlotName;
 
-			if (SaveGame != nullptr)
+			if (StoreMapImage(GetSlotIndex(), MapTexturePath, Metadata))
 			{
-				SaveGame->SaveSlotName = SaveSlotName;
-
-				const FString SaveSlotsDirPath = FPaths::Combine(FPaths::ProjectSavedDir(), SaveSlotsDirName);
-				const FString MapImageDestinationPath = FPaths::Combine(SaveSlotsDirPath, SaveSlotName + FPaths::GetExtension(MapTexturePath, true));
-
-				SaveGame->MapImagePath = MapImageDestinationPath;
-				if (UGameplayStatics::SaveGameToSlot(SaveGame, SaveSlotName, 0))
-				{
-					UE_LOG(LogTemp, Log, TEXT("USaveManager::CreateSaveSlot Save game object created successfully"));
-				}
-				else
-				{
-					UE_LOG(LogTemp, Error, TEXT("USaveManager::CreateSaveSlot Failed to save game object to slot"));
-					return nullptr;
-				}
+				URacingEngineerSaveGame* SaveGame = FinishCreateSaveSlot(Metadata);
+				GetSlotIndex().ReleaseMapImage(Metadata.MapImagePath);
 
-				if (FPlatformFileManager::Get().GetPlatformFile().CopyFile(*MapImageDestinationPath, *MapTexturePath))
-				{
-					UE_LOG(LogTemp, Log, TEXT("USaveManager::CreateSaveSlot File copied successfully to %s"), *MapImageDestinationPath);
-					return SaveGame;
-				}
-				else
-				{
-					UE_LOG(LogTemp, Error, TEXT("USaveManager::CreateSaveSlot Failed to copy file to %s"), *MapImageDestinationPath);
-					return nullptr;
-				}
+				return SaveGame;
 			}
 			else
 			{
-				UE_LOG(LogTemp, Error, TEXT("USaveManager::CreateSaveSlot Failed to create save game object"));
+				UE_LOG(LogTemp, Error, TEXT("USaveManager::CreateSaveSlot Failed to store %s"), *MapTexturePath);
 			}
 		}
 		else
@@ -62,6 +48,85 @@ URacingEngineerSaveGame* USaveManager::CreateSaveSlot(const FString& SaveSlotNam
 	return nullptr;
 }
 
+void USaveManager::CreateSaveSlotAsync(const FString& SaveSlotName, const FString& MapTexturePath, FOnSaveSlotCreated OnCreated)
+{
+	if (SaveSlotName.IsEmpty() || MapTexturePath.IsEmpty())
+	{
+		UE_LOG(LogTemp, Error, TEXT("USaveManager::CreateSaveSlotAsync SaveSlotName or MapTexturePath is empty"));
+		OnCreated.ExecuteIfBound(false, nullptr);
+		return;
+	}
+
+	// The image is read, hashed and stored on a worker thread, only the small save object is written on the game thread
+	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [SlotIndex = GetSlotIndex().AsShared(), SaveSlotName, MapTexturePath, OnCreated]
+		{
+			FSaveSlotMetadata Metadata;
+			Metadata.SaveSlotName = SaveSlotName;
+
+			const bool bStored = StoreMapImage(*SlotIndex, MapTexturePath, Metadata);
+
+			AsyncTask(ENamedThreads::GameThread, [MapTexturePath, Metadata, bStored, OnCreated]
+				{
+					URacingEngineerSaveGame* SaveGame = nullptr;
+
+					if (bStored)
+					{
+						SaveGame = FinishCreateSaveSlot(Metadata);
+						GetSlotIndex().ReleaseMapImage(Metadata.MapImagePath);
+					}
+					else
+					{
+						UE_LOG(LogTemp, Error, TEXT("USaveManager::CreateSaveSlotAsync Failed to store %s"), *MapTexturePath);
+					}
+
+					// The widget that asked for the slot may have been closed in the meantime
+					OnCreated.ExecuteIfBound(SaveGame != nullptr, SaveGame);
+				});
+		});
+}
+
+URacingEngineerSaveGame* USaveManager::FinishCreateSaveSlot(FSaveSlotMetadata Metadata)
+{
+	URacingEngineerSaveGame* SaveGame = Cast<URacingEngineerSaveGame>(UGameplayStatics::CreateSaveGameObject(URacingEngineerSaveGame::StaticClass()));
+
+	if (SaveGame != nullptr)
+	{
+		SaveGame->SaveSlotName = Metadata.SaveSlotName;
+		SaveGame->MapImagePath = Metadata.MapImagePath;
+
+		if (UGameplayStatics::SaveGameToSlot(SaveGame, Metadata.SaveSlotName, 0))
+		{
+			UE_LOG(LogTemp, Log, TEXT("USaveManager::CreateSaveSlot Save game object created successfully"));
+
+			const FSaveSlotMetadata* ReplacedMetadata = GetSlotIndex().FindSlot(Metadata.SaveSlotName);
+			const FString ReplacedMapImagePath = ReplacedMetadata != nullptr ? ReplacedMetadata->MapImagePath : FString();
+
+			// The image was hashed when it was stored, it isn't read again
+			Metadata.BestLapTime = SaveGame->BestLapTime;
+			Metadata.LastPlayed = FDateTime::UtcNow();
+			GetSlotIndex().AddOrUpdateSlot(Metadata);
+
+			// A recreated slot may have been the last one using its previous image
+			if (!ReplacedMapImagePath.IsEmpty())
+			{
+				GetSlotIndex().DeleteMapImageIfUnused(ReplacedMapImagePath);
+			}
+
+			return SaveGame;
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error, TEXT("USaveManager::CreateSaveSlot Failed to save game object to slot"));
+		}
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("USaveManager::CreateSaveSlot Failed to create save game object"));
+	}
+
+	return nullptr;
+}
+
 bool USaveManager::LoadSaveSlot(const FString& SaveSlotName, URacingEngineerSaveGame*& OutSaveGame, UTexture2D*& OutMapTexture)
 {
 	if (UGameplayStatics::DoesSaveGameExist(SaveSlotName, 0))
@@ -80,6 +145,7 @@ bool USaveManager::LoadSaveSlot(const FString& SaveSlotName, URacingEngineerSave
 				
 				if (OutMapTexture != nullptr)
 				{
+					GetSlotIndex().MarkSlotPlayed(SaveSlotName);
 					return true;
 				}
 				else
@@ -108,24 +174,112 @@ bool USaveManager::LoadSaveSlot(const FString& SaveSlotName, URacingEngineerSave
 	
 }
 
-bool USaveManager::OverrideSaveSlot(URacingEngineerSaveGame* SaveGame)
+void USaveManager::LoadSaveSlotAsync(const FString& SaveSlotName, int32 PreviewSize, FOnSaveSlotLoaded OnLoaded)
 {
-	if (SaveGame != nullptr)
+	if (!UGameplayStatics::DoesSaveGameExist(SaveSlotName, 0))
 	{
-		const FString SaveSlotName = SaveGame->SaveSlotName;
+		UE_LOG(LogTemp, Error, TEXT("USaveManager::LoadSaveSlotAsync Save game object does not exist"));
+		FinishLoadSaveSlot(false, nullptr, nullptr, nullptr, OnLoaded);
+		return;
+	}
 
-		if (UGameplayStatics::DoesSaveGameExist(SaveSlotName, 0))
+	// The slot file is read on a worker thread, only the small save object is deserialised back on the game thread
+	FAsyncLoadGameFromSlotDelegate OnSlotLoaded;
+	OnSlotLoaded.BindLambda([PreviewSize, OnLoaded](const FString& LoadedSlotName, const int32 UserIndex, USaveGame* LoadedSaveGame)
 		{
-			if (UGameplayStatics::SaveGameToSlot(SaveGame, SaveSlotName, 0))
+			URacingEngineerSaveGame* SaveGame = Cast<URacingEngineerSaveGame>(LoadedSaveGame);
+
+			if (SaveGame != nullptr)
 			{
-				UE_LOG(LogTemp, Log, TEXT("USaveManager::OverrideSaveSlot Save game object overriden successfully"));
-				return true;
+				DecodeMapImageAsync(SaveGame, PreviewSize, OnLoaded);
 			}
 			else
 			{
-				UE_LOG(LogTemp, Error, TEXT("USaveManager::OverrideSaveSlot Failed to override save game object"));
-				return false;
+				UE_LOG(LogTemp, Error, TEXT("USaveManager::LoadSaveSlotAsync Failed to load save game object %s"), *LoadedSlotName);
+				FinishLoadSaveSlot(false, nullptr, nullptr, nullptr, OnLoaded);
 			}
+		});
+
+	UGameplayStatics::AsyncLoadGameFromSlot(SaveSlotName, 0, OnSlotLoaded);
+}
+
+void USaveManager::DecodeMapImageAsync(URacingEngineerSaveGame* SaveGame, int32 PreviewSize, FOnSaveSlotLoaded OnLoaded)
+{
+	TStrongObjectPtr<URacingEngineerSaveGame> SaveGamePtr(SaveGame);
+	const FString MapImagePath = SaveGame->MapImagePath;
+
+	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [SaveGamePtr = MoveTemp(SaveGamePtr), MapImagePath, PreviewSize, OnLoaded]() mutable
+		{
+			TSharedRef<FImage> MapImage = MakeShared<FImage>();
+			TSharedPtr<FImage> PreviewImage;
+
+			const bool bDecoded = FImageUtils::LoadImage(*MapImagePath, MapImage.Get());
+
+			if (bDecoded && PreviewSize > 0)
+			{
+				// Longer side is scaled down to PreviewSize, small images are kept as they are
+				const float PreviewScale = FMath::Min(1.0f, static_cast<float>(PreviewSize) / FMath::Max(MapImage->SizeX, MapImage->SizeY));
+
+				PreviewImage = MakeShared<FImage>();
+				MapImage->ResizeTo(
+					*PreviewImage,
+					FMath::Max(1, FMath::RoundToInt32(MapImage->SizeX * PreviewScale)),
+					FMath::Max(1, FMath::RoundToInt32(MapImage->SizeY * PreviewScale)),
+					ERawImageFormat::BGRA8,
+					EGammaSpace::sRGB);
+			}
+
+			AsyncTask(ENamedThreads::GameThread, [SaveGamePtr = MoveTemp(SaveGamePtr), MapImagePath, MapImage, PreviewImage, bDecoded, OnLoaded]
+				{
+					if (!bDecoded)
+					{
+						UE_LOG(LogTemp, Error, TEXT("USaveManager::LoadSaveSlotAsync Failed to load image from %s"), *MapImagePath);
+						FinishLoadSaveSlot(false, SaveGamePtr.Get(), nullptr, nullptr, OnLoaded);
+						return;
+					}
+
+					UTexture2D* MapTexture = FImageUtils::CreateTexture2DFromImage(MapImage.Get());
+					UTexture2D* PreviewTexture = PreviewImage.IsValid() ? FImageUtils::CreateTexture2DFromImage(*PreviewImage) : nullptr;
+
+					if (MapTexture != nullptr)
+					{
+						GetSlotIndex().MarkSlotPlayed(SaveGamePtr->SaveSlotName);
+						FinishLoadSaveSlot(true, SaveGamePtr.Get(), MapTexture, PreviewTexture, OnLoaded);
+					}
+					else
+					{
+						UE_LOG(LogTemp, Error, TEXT("USaveManager::LoadSaveSlotAsync Failed to create texture from image"));
+						FinishLoadSaveSlot(false, SaveGamePtr.Get(), nullptr, nullptr, OnLoaded);
+					}
+				});
+		});
+}
+
+void USaveManager::FinishLoadSaveSlot(bool bSuccess, URacingEngineerSaveGame* SaveGame, UTexture2D* MapTexture,
+	UTexture2D* PreviewTexture, const FOnSaveSlotLoaded& OnLoaded)
+{
+	// The widget that asked for the slot may have been closed in the meantime
+	if (OnLoaded.IsBound())
+	{
+		OnLoaded.Execute(bSuccess, SaveGame, MapTexture, PreviewTexture);
+	}
+}
+
+bool USaveManager::OverrideSaveSlot(URacingEngineerSaveGame* SaveGame)
+{
+	if (SaveGame != nullptr)
+	{
+		// Called during a session, so the object is only serialised here and everything touching the disk runs on the index's write pipe
+		TArray<uint8> SaveData;
+		if (!UGameplayStatics::SaveGameToMemory(SaveGame, SaveData))
+		{
+			UE_LOG(LogTemp, Error, TEXT("USaveManager::OverrideSaveSlot Failed to serialise save game object"));
+			return false;
+		}
+
+		if (GetSlotIndex().OverrideSlot(*SaveGame, MoveTemp(SaveData)))
+		{
+			return true;
 		}
 		else
 		{
@@ -144,36 +298,39 @@ bool USaveManager::DeleteSaveSlot(const FString& SaveSlotName)
 {
 	if (UGameplayStatics::DoesSaveGameExist(SaveSlotName, 0))
 	{
-		URacingEngineerSaveGame* SaveGame = Cast<URacingEngineerSaveGame>(UGameplayStatics::LoadGameFromSlot(SaveSlotName, 0));
+		FString MapImagePath;
 
-		if (SaveGame != nullptr)
+		// The image path comes from the index, the slot is only loaded if the index doesn't know it
+		if (const FSaveSlotMetadata* Metadata = GetSlotIndex().FindSlot(SaveSlotName))
 		{
-			if (FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*SaveGame->MapImagePath))
-			{
-				UE_LOG(LogTemp, Log, TEXT("USaveManager::DeleteSaveSlot MapImage file deleted successfully"));
-
-				if (UGameplayStatics::DeleteGameInSlot(SaveSlotName, 0))
-				{
-					UE_LOG(LogTemp, Log, TEXT("USaveManager::DeleteSaveSlot Save game object deleted successfully"));
-					return true;
-				}
-				else
-				{
-					UE_LOG(LogTemp, Error, TEXT("USaveManager::DeleteSaveSlot Failed to delete save game object"));
-					return false;
-				}
-			}
-			else
-			{
-				UE_LOG(LogTemp, Error, TEXT("USaveManager::DeleteSaveSlot Failed to delete file"));
-				return false;
-			}
+			MapImagePath = Metadata->MapImagePath;
+		}
+		else if (const URacingEngineerSaveGame* SaveGame = Cast<URacingEngineerSaveGame>(UGameplayStatics::LoadGameFromSlot(SaveSlotName, 0)))
+		{
+			MapImagePath = SaveGame->MapImagePath;
 		}
 		else
 		{
 			UE_LOG(LogTemp, Error, TEXT("USaveManager::DeleteSaveSlot Failed to load save game object"));
 			return false;
 		}
+
+		if (UGameplayStatics::DeleteGameInSlot(SaveSlotName, 0))
+		{
+			UE_LOG(LogTemp, Log, TEXT("USaveManager::DeleteSaveSlot Save game object deleted successfully"));
+			GetSlotIndex().RemoveSlot(SaveSlotName);
+			ULapHistorySubsystem::DeleteLapHistory(SaveSlotName);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error, TEXT("USaveManager::DeleteSaveSlot Failed to delete save game object"));
+			return false;
+		}
+
+		// Images are shared between slots, the last slot using one deletes it
+		GetSlotIndex().DeleteMapImageIfUnused(MapImagePath);
+
+		return true;
 	}
 	else
 	{
@@ -184,15 +341,72 @@ bool USaveManager::DeleteSaveSlot(const FString& SaveSlotName)
 
 TArray<FString> USaveManager::GetSaveSlotNames()
 {
-	TArray<FString> SaveSlotNames;
+	GetSlotIndex().RefreshIfStale();
 
-	const FString SaveSlotsDirPath = FPaths::Combine(FPaths::ProjectSavedDir(), SaveSlotsDirName);
-	FPlatformFileManager::Get().GetPlatformFile().FindFiles(SaveSlotNames, *SaveSlotsDirPath, *SaveSlotExtension);
+	TArray<FString> SaveSlotNames;
 
-	for (FString& SaveSlotName : SaveSlotNames)
+	for (const FSaveSlotMetadata& Metadata : GetSlotIndex().GetSlots())
 	{
-		SaveSlotName = FPaths::GetBaseFilename(SaveSlotName);
+		SaveSlotNames.Emplace(Metadata.SaveSlotName);
 	}
 
 	return SaveSlotNames;
 }
+
+TArray<FSaveSlotMetadata> USaveManager::GetSaveSlotsMetadata()
+{
+	GetSlotIndex().RefreshIfStale();
+
+	return GetSlotIndex().GetSlots();
+}
+
+int32 USaveManager::DeleteUnreferencedMapImages()
+{
+	const FString MapImagesDirPath = FPaths::Combine(FPaths::ProjectSavedDir(), MapImagesDirName);
+
+	TArray<FString> MapImageFiles;
+	IFileManager::Get().FindFiles(MapImageFiles, *MapImagesDirPath, nullptr);
+
+	TArray<UE::Tasks::TTask<bool>> DeleteTasks;
+	for (const FString& MapImageFile : MapImageFiles)
+	{
+		DeleteTasks.Add(GetSlotIndex().DeleteMapImageIfUnused(FPaths::Combine(MapImagesDirPath, MapImageFile)));
+	}
+
+	int32 DeletedNum = 0;
+	for (UE::Tasks::TTask<bool>& DeleteTask : DeleteTasks)
+	{
+		if (DeleteTask.GetResult())
+		{
+			DeletedNum++;
+		}
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("USaveManager::DeleteUnreferencedMapImages Deleted %d map images"), DeletedNum);
+
+	return DeletedNum;
+}
+
+FSaveSlotIndex& USaveManager::GetSlotIndex()
+{
+	check(IsInGameThread() && GEngine != nullptr);
+
+	return GEngine->GetEngineSubsystem<USaveSlotIndexSubsystem>()->GetSlotIndex();
+}
+
+bool USaveManager::StoreMapImage(FSaveSlotIndex& SlotIndex, const FString& MapTexturePath, FSaveSlotMetadata& OutMetadata)
+{
+	TArray<uint8> MapImageData;
+	if (!FFileHelper::LoadFileToArray(MapImageData, *MapTexturePath))
+	{
+		return false;
+	}
+
+	// The one read of the image gives the hash for the name and the metadata for the index
+	FSaveSlotIndex::FillMapImageMetadata(MapImageData, OutMetadata);
+
+	OutMetadata.MapImagePath = FPaths::Combine(FPaths::ProjectSavedDir(), MapImagesDirName,
+		OutMetadata.MapImageHash + FPaths::GetExtension(MapTexturePath, true));
+
+	return SlotIndex.StoreMapImage(OutMetadata.MapImagePath, MoveTemp(MapImageData));
+}
@@ -4,10 +4,17 @@
 
 #include "CoreMinimal.h"
 #include "UObject/NoExportTypes.h"
+#include "SaveSlotIndex.h"
 #include "SaveManager.generated.h"
 
 
 class URacingEngineerSaveGame;
+
+DECLARE_DYNAMIC_DELEGATE_TwoParams(FOnSaveSlotCreated, bool, bSuccess, URacingEngineerSaveGame*, SaveGame);
+
+DECLARE_DYNAMIC_DELEGATE_FourParams(FOnSaveSlotLoaded, bool, bSuccess, URacingEngineerSaveGame*, SaveGame,
+	UTexture2D*, MapTexture, UTexture2D*, PreviewTexture);
+
 /**
  * 
  */
@@ -16,16 +23,27 @@ class RACINGENGINEER_API USaveManager : public UObject
 {
 	GENERATED_BODY()
 
+	friend class USaveSlotIndexSubsystem;
+
 	static inline FString SaveSlotsDirName = TEXT("SaveGames");
 	static inline FString SaveSlotExtension = TEXT("sav");
+	static inline FString MapImagesDirName = TEXT("MapImages");
 public:
 
+	// Reads and hashes the map image on the calling thread, CreateSaveSlotAsync keeps that off the game thread
 	UFUNCTION(BlueprintCallable, Category = "Racing Enginner Saves")
 	static URacingEngineerSaveGame* CreateSaveSlot(const FString& SaveSlotName, const FString& MapTexturePath);
 
+	UFUNCTION(BlueprintCallable, Category = "Racing Enginner Saves")
+	static void CreateSaveSlotAsync(const FString& SaveSlotName, const FString& MapTexturePath, FOnSaveSlotCreated OnCreated);
+
 	UFUNCTION(BlueprintCallable, Category = "Racing Enginner Saves")
 	static bool LoadSaveSlot(const FString& SaveSlotName, URacingEngineerSaveGame*& OutSaveGame, UTexture2D*& OutMapTexture);
 
+	// Reads the slot and decodes its map image on worker threads, PreviewSize == 0 skips the preview texture
+	UFUNCTION(BlueprintCallable, Category = "Racing Enginner Saves")
+	static void LoadSaveSlotAsync(const FString& SaveSlotName, int32 PreviewSize, FOnSaveSlotLoaded OnLoaded);
+
 	UFUNCTION(BlueprintCallable, Category = "Racing Enginner Saves")
 	static bool OverrideSaveSlot(URacingEngineerSaveGame* SaveGame);
 
@@ -34,4 +52,25 @@ public:
 
 	UFUNCTION(BlueprintCallable, Category = "Racing Enginner Saves")
 	static TArray<FString> GetSaveSlotNames();
+
+	UFUNCTION(BlueprintCallable, Category = "Racing Enginner Saves")
+	static TArray<FSaveSlotMetadata> GetSaveSlotsMetadata();
+
+	// Deletes stored map images that no slot references anymore, returns how many were deleted
+	UFUNCTION(BlueprintCallable, Category = "Racing Enginner Saves")
+	static int32 DeleteUnreferencedMapImages();
+
+private:
+	static void DecodeMapImageAsync(URacingEngineerSaveGame* SaveGame, int32 PreviewSize, FOnSaveSlotLoaded OnLoaded);
+
+	static void FinishLoadSaveSlot(bool bSuccess, URacingEngineerSaveGame* SaveGame, UTexture2D* MapTexture,
+		UTexture2D* PreviewTexture, const FOnSaveSlotLoaded& OnLoaded);
+
+	static URacingEngineerSaveGame* FinishCreateSaveSlot(FSaveSlotMetadata Metadata);
+
+	static FSaveSlotIndex& GetSlotIndex();
+
+	// Stores the image once under its content hash and fills the image part of the metadata, safe on any thread.
+	// The image stays referenced until the caller hands it to FSaveSlotIndex::ReleaseMapImage
+	static bool StoreMapImage(FSaveSlotIndex& SlotIndex, const FString& MapTexturePath, FSaveSlotMetadata& OutMetadata);
 };
@@ -0,0 +1,482 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SaveSlotIndex.h"
+
+#include "RacingEngineerSaveGame.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Hash/Blake3.h"
+#include "HAL/FileManager.h"
+#include "Async/Async.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/FileHelper.h"
+#include "Modules/ModuleManager.h"
+#include "Serialization/MemoryWriter.h"
+
+FArchive& operator<<(FArchive& Ar, FSaveSlotMetadata& Metadata)
+{
+	Ar << Metadata.SaveSlotName;
+	Ar << Metadata.MapImagePath;
+	Ar << Metadata.MapImageHash;
+	Ar << Metadata.MapImageWidth;
+	Ar << Metadata.MapImageHeight;
+	Ar << Metadata.BestLapTime;
+	Ar << Metadata.LastPlayed;
+
+	return Ar;
+}
+
+FSaveSlotIndex::FSaveSlotIndex(const FString& InSaveSlotsDirPath, const FString& InSaveSlotExtension)
+	: SaveSlotsDirPath(InSaveSlotsDirPath)
+	, SaveSlotExtension(InSaveSlotExtension)
+	, IndexFilePath(FPaths::Combine(InSaveSlotsDirPath, TEXT("SaveSlotIndex.bin")))
+{
+}
+
+FSaveSlotIndex::~FSaveSlotIndex()
+{
+	Flush();
+}
+
+void FSaveSlotIndex::Flush()
+{
+	WritePipe.WaitUntilEmpty();
+}
+
+void FSaveSlotIndex::RefreshIfStale()
+{
+	check(IsInGameThread());
+
+	if (!bLoaded)
+	{
+		EnsureLoaded();
+		return;
+	}
+
+	// Queued writes leave the index newer than the directory once they land, the next call checks again
+	if (WritePipe.HasWork())
+	{
+		return;
+	}
+
+	if (IsIndexFileStale())
+	{
+		UE_LOG(LogTemp, Log, TEXT("FSaveSlotIndex::RefreshIfStale Slots changed on disk, rebuilding the index"));
+		RebuildFromSlots();
+	}
+}
+
+const TArray<FSaveSlotMetadata>& FSaveSlotIndex::GetSlots()
+{
+	EnsureLoaded();
+	return Slots;
+}
+
+const FSaveSlotMetadata* FSaveSlotIndex::FindSlot(const FString& SaveSlotName)
+{
+	EnsureLoaded();
+	return FindSlotMutable(SaveSlotName);
+}
+
+const FSaveSlotMetadata* FSaveSlotIndex::FindSlotByMapImage(const FString& MapImagePath)
+{
+	EnsureLoaded();
+
+	return Slots.FindByPredicate([&MapImagePath](const FSaveSlotMetadata& Metadata)
+		{
+			return FPaths::IsSamePath(Metadata.MapImagePath, MapImagePath);
+		});
+}
+
+int32 FSaveSlotIndex::GetMapImageReferenceCount(const FString& MapImagePath)
+{
+	EnsureLoaded();
+
+	int32 ReferenceCount = 0;
+	for (const FSaveSlotMetadata& Metadata : Slots)
+	{
+		if (FPaths::IsSamePath(Metadata.MapImagePath, MapImagePath))
+		{
+			ReferenceCount++;
+		}
+	}
+
+	return ReferenceCount;
+}
+
+FSaveSlotMetadata* FSaveSlotIndex::FindSlotMutable(const FString& SaveSlotName)
+{
+	return Slots.FindByPredicate([&SaveSlotName](const FSaveSlotMetadata& Metadata)
+		{
+			return Metadata.SaveSlotName == SaveSlotName;
+		});
+}
+
+void FSaveSlotIndex::AddOrUpdateSlot(const FSaveSlotMetadata& Metadata)
+{
+	EnsureLoaded();
+
+	if (FSaveSlotMetadata* ExistingMetadata = FindSlotMutable(Metadata.SaveSlotName))
+	{
+		*ExistingMetadata = Metadata;
+	}
+	else
+	{
+		Slots.Emplace(Metadata);
+	}
+
+	WriteIndexFile();
+}
+
+bool FSaveSlotIndex::OverrideSlot(const URacingEngineerSaveGame& SaveGame, TArray<uint8>&& SaveData)
+{
+	check(IsInGameThread());
+
+	// Loading the index here would read or rebuild it on the game thread in the middle of a session
+	const bool bIndexLoaded = bLoaded;
+
+	if (bIndexLoaded)
+	{
+		FSaveSlotMetadata* ExistingMetadata = FindSlotMutable(SaveGame.SaveSlotName);
+		if (ExistingMetadata == nullptr)
+		{
+			return false;
+		}
+
+		ExistingMetadata->BestLapTime = SaveGame.BestLapTime;
+		ExistingMetadata->LastPlayed = FDateTime::UtcNow();
+	}
+
+	WritePipe.Launch(UE_SOURCE_LOCATION, [SaveSlotName = SaveGame.SaveSlotName, SaveData = MoveTemp(SaveData), IndexFilePath = IndexFilePath, bIndexLoaded]
+		{
+			if (!bIndexLoaded && !UGameplayStatics::DoesSaveGameExist(SaveSlotName, 0))
+			{
+				UE_LOG(LogTemp, Error, TEXT("FSaveSlotIndex::OverrideSlot Save game object %s does not exist"), *SaveSlotName);
+				return;
+			}
+
+			if (!UGameplayStatics::SaveDataToSlot(SaveData, SaveSlotName, 0))
+			{
+				UE_LOG(LogTemp, Error, TEXT("FSaveSlotIndex::OverrideSlot Failed to override save game object %s"), *SaveSlotName);
+				return;
+			}
+
+			UE_LOG(LogTemp, Log, TEXT("FSaveSlotIndex::OverrideSlot Save game object %s overriden successfully"), *SaveSlotName);
+
+			// The index file doesn't know the new best lap, the next load rebuilds it from the slots
+			if (!bIndexLoaded)
+			{
+				IFileManager::Get().Delete(*IndexFilePath, false, false, true);
+			}
+		});
+
+	if (bIndexLoaded)
+	{
+		WriteIndexFile();
+	}
+
+	return true;
+}
+
+void FSaveSlotIndex::MarkSlotPlayed(const FString& SaveSlotName)
+{
+	EnsureLoaded();
+
+	if (FSaveSlotMetadata* ExistingMetadata = FindSlotMutable(SaveSlotName))
+	{
+		ExistingMetadata->LastPlayed = FDateTime::UtcNow();
+		WriteIndexFile();
+	}
+}
+
+void FSaveSlotIndex::RemoveSlot(const FString& SaveSlotName)
+{
+	EnsureLoaded();
+
+	const int32 RemovedNum = Slots.RemoveAll([&SaveSlotName](const FSaveSlotMetadata& Metadata)
+		{
+			return Metadata.SaveSlotName == SaveSlotName;
+		});
+
+	if (RemovedNum > 0)
+	{
+		WriteIndexFile();
+	}
+}
+
+bool FSaveSlotIndex::StoreMapImage(const FString& MapImagePath, TArray<uint8>&& ImageData)
+{
+	// The index outlives every caller, the game thread flushes the pipe before it goes away
+	UE::Tasks::TTask<bool> StoreTask = WritePipe.Launch(UE_SOURCE_LOCATION, [this, MapImagePath, ImageData = MoveTemp(ImageData)]
+		{
+			PendingMapImages.FindOrAdd(MapImagePath)++;
+
+			// Same content means same name, an existing image is simply shared
+			if (IFileManager::Get().FileExists(*MapImagePath))
+			{
+				return true;
+			}
+
+			return FFileHelper::SaveArrayToFile(ImageData, *MapImagePath);
+		});
+
+	return StoreTask.GetResult();
+}
+
+void FSaveSlotIndex::ReleaseMapImage(const FString& MapImagePath)
+{
+	WritePipe.Launch(UE_SOURCE_LOCATION, [this, MapImagePath]
+		{
+			int32* PendingNum = PendingMapImages.Find(MapImagePath);
+			if (PendingNum != nullptr && --(*PendingNum) <= 0)
+			{
+				PendingMapImages.Remove(MapImagePath);
+			}
+		});
+}
+
+UE::Tasks::TTask<bool> FSaveSlotIndex::DeleteMapImageIfUnused(const FString& MapImagePath)
+{
+	check(IsInGameThread());
+
+	// Slots are only added on the game thread, a slot being created holds its image through PendingMapImages until it is
+	if (GetMapImageReferenceCount(MapImagePath) > 0)
+	{
+		return UE::Tasks::MakeCompletedTask<bool>(false);
+	}
+
+	return WritePipe.Launch(UE_SOURCE_LOCATION, [this, MapImagePath]
+		{
+			if (PendingMapImages.Contains(MapImagePath))
+			{
+				return false;
+			}
+
+			if (!IFileManager::Get().Delete(*MapImagePath, false, false, true))
+			{
+				UE_LOG(LogTemp, Warning, TEXT("FSaveSlotIndex::DeleteMapImageIfUnused Failed to delete file %s"), *MapImagePath);
+				return false;
+			}
+
+			UE_LOG(LogTemp, Log, TEXT("FSaveSlotIndex::DeleteMapImageIfUnused %s deleted successfully"), *MapImagePath);
+			return true;
+		});
+}
+
+void FSaveSlotIndex::FillMapImageMetadata(TConstArrayView<uint8> ImageData, FSaveSlotMetadata& Metadata)
+{
+	Metadata.MapImageHash = LexToString(FBlake3::HashBuffer(ImageData.GetData(), ImageData.Num()));
+
+	// Only the header is parsed for the dimensions, the image isn't decoded
+	IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+	const EImageFormat ImageFormat = ImageWrapperModule.DetectImageFormat(ImageData.GetData(), ImageData.Num());
+	const TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(ImageFormat);
+
+	if (ImageWrapper.IsValid() && ImageWrapper->SetCompressed(ImageData.GetData(), ImageData.Num()))
+	{
+		Metadata.MapImageWidth = ImageWrapper->GetWidth();
+		Metadata.MapImageHeight = ImageWrapper->GetHeight();
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("FSaveSlotIndex::FillMapImageMetadata Unknown image format %s"), *Metadata.MapImagePath);
+	}
+}
+
+void FSaveSlotIndex::EnsureLoaded()
+{
+	check(IsInGameThread());
+
+	if (bLoaded)
+	{
+		return;
+	}
+
+	bLoaded = true;
+
+	// Slots overridden before the load may still be dropping the index file
+	WritePipe.WaitUntilEmpty();
+
+	if (IsIndexFileStale() || !ReadIndexFile())
+	{
+		RebuildFromSlots();
+	}
+	else
+	{
+		// The last session may have ended before every image was scanned
+		ScanMapImages();
+	}
+}
+
+bool FSaveSlotIndex::IsIndexFileStale() const
+{
+	IFileManager& FileManager = IFileManager::Get();
+
+	const FDateTime IndexTimeStamp = FileManager.GetTimeStamp(*IndexFilePath);
+	if (IndexTimeStamp == FDateTime::MinValue())
+	{
+		return true;
+	}
+
+	// Adding, removing or renaming a slot outside of USaveManager touches the directory
+	const FFileStatData DirStatData = FileManager.GetStatData(*SaveSlotsDirPath);
+	return DirStatData.bIsValid && DirStatData.ModificationTime > IndexTimeStamp;
+}
+
+bool FSaveSlotIndex::ReadIndexFile()
+{
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*IndexFilePath));
+	if (!Reader.IsValid())
+	{
+		return false;
+	}
+
+	uint32 Magic = 0;
+	int32 Version = 0;
+	*Reader << Magic;
+	*Reader << Version;
+
+	if (Reader->IsError() || Magic != IndexMagic || Version != IndexVersion)
+	{
+		return false;
+	}
+
+	*Reader << Slots;
+
+	if (Reader->IsError())
+	{
+		Slots.Empty();
+		return false;
+	}
+
+	return true;
+}
+
+void FSaveSlotIndex::RebuildFromSlots()
+{
+	const uint32 RebuildTimer = FPlatformTime::Cycles();
+
+	Slots.Empty();
+
+	TArray<FString> SaveSlotFiles;
+	IFileManager::Get().FindFiles(SaveSlotFiles, *SaveSlotsDirPath, *SaveSlotExtension);
+
+	for (const FString& SaveSlotFile : SaveSlotFiles)
+	{
+		const FString SaveSlotName = FPaths::GetBaseFilename(SaveSlotFile);
+		const URacingEngineerSaveGame* SaveGame = Cast<URacingEngineerSaveGame>(UGameplayStatics::LoadGameFromSlot(SaveSlotName, 0));
+
+		if (SaveGame != nullptr)
+		{
+			FSaveSlotMetadata& Metadata = Slots.Emplace_GetRef();
+			Metadata.SaveSlotName = SaveGame->SaveSlotName;
+			Metadata.MapImagePath = SaveGame->MapImagePath;
+			Metadata.BestLapTime = SaveGame->BestLapTime;
+			Metadata.LastPlayed = IFileManager::Get().GetTimeStamp(*FPaths::Combine(SaveSlotsDirPath, SaveSlotFile));
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("FSaveSlotIndex::RebuildFromSlots Failed to load %s"), *SaveSlotName);
+		}
+	}
+
+	WriteIndexFile();
+	ScanMapImages();
+
+	UE_LOG(LogTemp, Log, TEXT("FSaveSlotIndex::RebuildFromSlots Indexed %d slots in %fms"), Slots.Num(),
+		FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - RebuildTimer));
+}
+
+void FSaveSlotIndex::ScanMapImages()
+{
+	TArray<FSaveSlotMetadata> ScannedSlots = Slots.FilterByPredicate([](const FSaveSlotMetadata& Metadata)
+		{
+			return Metadata.MapImageHash.IsEmpty();
+		});
+
+	if (ScannedSlots.IsEmpty())
+	{
+		return;
+	}
+
+	TWeakPtr<FSaveSlotIndex> WeakThis = AsShared();
+	WritePipe.Launch(UE_SOURCE_LOCATION, [WeakThis, ScannedSlots = MoveTemp(ScannedSlots)]() mutable
+		{
+			for (FSaveSlotMetadata& Metadata : ScannedSlots)
+			{
+				TArray<uint8> ImageData;
+				if (FFileHelper::LoadFileToArray(ImageData, *Metadata.MapImagePath))
+				{
+					FillMapImageMetadata(ImageData, Metadata);
+				}
+				else
+				{
+					UE_LOG(LogTemp, Warning, TEXT("FSaveSlotIndex::ScanMapImages Failed to read %s"), *Metadata.MapImagePath);
+				}
+			}
+
+			AsyncTask(ENamedThreads::GameThread, [WeakThis, ScannedSlots = MoveTemp(ScannedSlots)]
+				{
+					if (const TSharedPtr<FSaveSlotIndex> SlotIndex = WeakThis.Pin())
+					{
+						SlotIndex->ApplyMapImageMetadata(ScannedSlots);
+					}
+				});
+		});
+}
+
+void FSaveSlotIndex::ApplyMapImageMetadata(const TArray<FSaveSlotMetadata>& ScannedSlots)
+{
+	bool bChanged = false;
+
+	// Slots may have been recreated or removed while the images were read
+	for (const FSaveSlotMetadata& ScannedMetadata : ScannedSlots)
+	{
+		FSaveSlotMetadata* ExistingMetadata = FindSlotMutable(ScannedMetadata.SaveSlotName);
+
+		if (ExistingMetadata != nullptr && ExistingMetadata->MapImageHash.IsEmpty() && !ScannedMetadata.MapImageHash.IsEmpty()
+			&& FPaths::IsSamePath(ExistingMetadata->MapImagePath, ScannedMetadata.MapImagePath))
+		{
+			ExistingMetadata->MapImageHash = ScannedMetadata.MapImageHash;
+			ExistingMetadata->MapImageWidth = ScannedMetadata.MapImageWidth;
+			ExistingMetadata->MapImageHeight = ScannedMetadata.MapImageHeight;
+			bChanged = true;
+		}
+	}
+
+	if (bChanged)
+	{
+		WriteIndexFile();
+	}
+}
+
+void FSaveSlotIndex::WriteIndexFile()
+{
+	// Serialised on the game thread, only the file access is moved to the pipe
+	TArray<uint8> IndexData;
+	FMemoryWriter Writer(IndexData);
+
+	uint32 Magic = IndexMagic;
+	int32 Version = IndexVersion;
+	Writer << Magic;
+	Writer << Version;
+	Writer << Slots;
+
+	WritePipe.Launch(UE_SOURCE_LOCATION, [IndexFilePath = IndexFilePath, IndexData = MoveTemp(IndexData)]
+		{
+			IFileManager& FileManager = IFileManager::Get();
+			const FString TempFilePath = IndexFilePath + TEXT(".tmp");
+
+			if (FFileHelper::SaveArrayToFile(IndexData, *TempFilePath) && FileManager.Move(*IndexFilePath, *TempFilePath, true, true))
+			{
+				// Moving the file in touches the directory, the index has to stay newer than it to be trusted
+				FileManager.SetTimeStamp(*IndexFilePath, FDateTime::UtcNow());
+			}
+			else
+			{
+				UE_LOG(LogTemp, Error, TEXT("FSaveSlotIndex::WriteIndexFile Failed to write %s"), *IndexFilePath);
+				FileManager.Delete(*TempFilePath, false, false, true);
+			}
+		});
+}
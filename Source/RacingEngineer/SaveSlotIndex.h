@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tasks/Pipe.h"
+#include "SaveSlotIndex.generated.h"
+
+class URacingEngineerSaveGame;
+
+USTRUCT(BlueprintType)
+struct FSaveSlotMetadata
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "SaveSlotMetadata")
+	FString SaveSlotName;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "SaveSlotMetadata")
+	FString MapImagePath;
+
+	// Blake3 of the map image file
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "SaveSlotMetadata")
+	FString MapImageHash;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "SaveSlotMetadata")
+	int32 MapImageWidth = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "SaveSlotMetadata")
+	int32 MapImageHeight = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "SaveSlotMetadata")
+	float BestLapTime = 0.0f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "SaveSlotMetadata")
+	FDateTime LastPlayed;
+
+	friend FArchive& operator<<(FArchive& Ar, FSaveSlotMetadata& Metadata);
+};
+
+/**
+ *  Metadata of every save slot in one small file next to the slots, so the menu never has to
+ *  scan the directory or deserialise the slots. Only used on the game thread but for StoreMapImage, owned by USaveSlotIndexSubsystem.
+ *  The index is rebuilt from the slots when the file is missing, damaged or older than the directory.
+ */
+class RACINGENGINEER_API FSaveSlotIndex : public TSharedFromThis<FSaveSlotIndex>
+{
+public:
+	FSaveSlotIndex(const FString& InSaveSlotsDirPath, const FString& InSaveSlotExtension);
+	~FSaveSlotIndex();
+
+	// Waits for the queued index and slot writes
+	void Flush();
+
+	// Rebuilds the index if slots were added, removed or renamed outside of USaveManager since it was written
+	void RefreshIfStale();
+
+	const TArray<FSaveSlotMetadata>& GetSlots();
+	const FSaveSlotMetadata* FindSlot(const FString& SaveSlotName);
+	const FSaveSlotMetadata* FindSlotByMapImage(const FString& MapImagePath);
+
+	// Number of slots using the image, stored images are shared between slots with the same map
+	int32 GetMapImageReferenceCount(const FString& MapImagePath);
+
+	void AddOrUpdateSlot(const FSaveSlotMetadata& Metadata);
+
+	// Writes the serialised slot on the write pipe, the metadata is only updated in memory on the calling thread.
+	// Before the index is loaded the existence check runs on the pipe too and the index file is dropped to be rebuilt.
+	// Returns false if the loaded index doesn't know the slot
+	bool OverrideSlot(const URacingEngineerSaveGame& SaveGame, TArray<uint8>&& SaveData);
+
+	void MarkSlotPlayed(const FString& SaveSlotName);
+	void RemoveSlot(const FString& SaveSlotName);
+
+	// Any thread, blocks until done. Writes the image on the write pipe unless it is already stored and takes a reference to it first,
+	// so a slot deleted meanwhile never deletes the image of the slot being created. ReleaseMapImage drops the reference once the slot is added
+	bool StoreMapImage(const FString& MapImagePath, TArray<uint8>&& ImageData);
+	void ReleaseMapImage(const FString& MapImagePath);
+
+	// Deletes the image on the write pipe unless a slot or a StoreMapImage still holds it, the task's result is whether it was deleted
+	UE::Tasks::TTask<bool> DeleteMapImageIfUnused(const FString& MapImagePath);
+
+	// Fills the hash and dimensions from the map image file data, meant for worker threads
+	static void FillMapImageMetadata(TConstArrayView<uint8> ImageData, FSaveSlotMetadata& Metadata);
+
+private:
+	void EnsureLoaded();
+	bool IsIndexFileStale() const;
+	bool ReadIndexFile();
+	void RebuildFromSlots();
+
+	// Reads the map images of slots without a hash on the write pipe and fills them in back on the game thread
+	void ScanMapImages();
+	void ApplyMapImageMetadata(const TArray<FSaveSlotMetadata>& ScannedSlots);
+	void WriteIndexFile();
+
+	FSaveSlotMetadata* FindSlotMutable(const FString& SaveSlotName);
+
+	static constexpr uint32 IndexMagic = 0x52455349; // RESI
+	static constexpr int32 IndexVersion = 1;
+
+	FString SaveSlotsDirPath;
+	FString SaveSlotExtension;
+	FString IndexFilePath;
+
+	TArray<FSaveSlotMetadata> Slots;
+	bool bLoaded = false;
+
+	// Images of slots still being created and how many creations hold each, only touched on the write pipe
+	TMap<FString, int32> PendingMapImages;
+
+	// Index writes run one after another off the game thread
+	UE::Tasks::FPipe WritePipe{ UE_SOURCE_LOCATION };
+};
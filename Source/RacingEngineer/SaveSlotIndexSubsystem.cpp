@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SaveSlotIndexSubsystem.h"
+
+#include "SaveManager.h"
+
+void USaveSlotIndexSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	SlotIndex = MakeShared<FSaveSlotIndex>(FPaths::Combine(FPaths::ProjectSavedDir(), USaveManager::SaveSlotsDirName),
+		USaveManager::SaveSlotExtension);
+}
+
+void USaveSlotIndexSubsystem::Deinitialize()
+{
+	// Slots overridden at the end of the last session still have to reach the disk
+	SlotIndex->Flush();
+	SlotIndex.Reset();
+
+	Super::Deinitialize();
+}
@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "SaveSlotIndex.h"
+#include "SaveSlotIndexSubsystem.generated.h"
+
+/**
+ *  Owns the save slot index for USaveManager, whose functions are static and have no world to ask.
+ *  Queued index and slot writes are flushed when the engine shuts down, not during static destruction.
+ */
+UCLASS()
+class RACINGENGINEER_API USaveSlotIndexSubsystem : public UEngineSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	FSaveSlotIndex& GetSlotIndex() const { return *SlotIndex; }
+
+private:
+	TSharedPtr<FSaveSlotIndex> SlotIndex;
+};
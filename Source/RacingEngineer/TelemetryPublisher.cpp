@@ -0,0 +1,200 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TelemetryPublisher.h"
+
+#include "HAL/RunnableThread.h"
+#include "Common/UdpSocketBuilder.h"
+#include "IPAddress.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+
+FTelemetryPublisher::FTelemetryPublisher(const FTelemetryPublisherSettings& InSettings)
+	: Settings(InSettings)
+	, WorkEvent(FPlatformProcess::GetSynchEventFromPool())
+{
+	Thread = FRunnableThread::Create(this, TEXT("TelemetryPublisher"), 0, TPri_BelowNormal);
+}
+
+FTelemetryPublisher::~FTelemetryPublisher()
+{
+	if (Thread != nullptr)
+	{
+		// Kill waits for the thread, which publishes whatever is still queued before it exits
+		Thread->Kill(true);
+		delete Thread;
+	}
+
+	FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+}
+
+bool FTelemetryPublisher::Push(const FTelemetrySample& Sample)
+{
+	if (!PendingSamples.Push(Sample))
+	{
+		DroppedSamples.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	return true;
+}
+
+void FTelemetryPublisher::Stop()
+{
+	bStopping = true;
+	WorkEvent->Trigger();
+}
+
+uint32 FTelemetryPublisher::Run()
+{
+	const bool bSharedMemoryOpen = !Settings.SharedMemoryName.IsEmpty() && OpenSharedMemory();
+	const bool bSocketOpen = Settings.UdpPort > 0 && OpenSocket();
+
+	if (!bSharedMemoryOpen && !bSocketOpen)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FTelemetryPublisher::Run Neither shared memory nor a socket could be opened, telemetry is not published"));
+		return 1;
+	}
+
+	while (!bStopping)
+	{
+		// Polled instead of triggered, so pushing a sample never touches the event
+		WorkEvent->Wait(Settings.PublishIntervalMs);
+		PublishPendingSamples();
+	}
+
+	PublishPendingSamples();
+	Close();
+
+	return 0;
+}
+
+bool FTelemetryPublisher::OpenSharedMemory()
+{
+	const SIZE_T Size = sizeof(FTelemetrySharedHeader) + SharedMemoryCapacity * sizeof(FTelemetrySharedSlot);
+
+	SharedMemory = FPlatformMemory::MapNamedSharedMemoryRegion(Settings.SharedMemoryName, true,
+		FPlatformMemory::ESharedMemoryAccess::Read | FPlatformMemory::ESharedMemoryAccess::Write, Size);
+
+	if (SharedMemory == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FTelemetryPublisher::OpenSharedMemory Failed to map %s"), *Settings.SharedMemoryName);
+		return false;
+	}
+
+	uint8* Block = static_cast<uint8*>(SharedMemory->GetAddress());
+	FMemory::Memzero(Block, Size);
+
+	SharedHeader = reinterpret_cast<FTelemetrySharedHeader*>(Block);
+	SharedSlots = reinterpret_cast<FTelemetrySharedSlot*>(Block + sizeof(FTelemetrySharedHeader));
+
+	SharedHeader->SampleSize = sizeof(FTelemetrySample);
+	SharedHeader->SampleCapacity = SharedMemoryCapacity;
+	SharedHeader->Version = TelemetryVersion;
+
+	// Written last, readers wait for it before trusting the rest of the header
+	FPlatformAtomics::AtomicStore(reinterpret_cast<volatile int32*>(&SharedHeader->Magic), static_cast<int32>(TelemetryMagic));
+
+	return true;
+}
+
+bool FTelemetryPublisher::OpenSocket()
+{
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	if (SocketSubsystem == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FTelemetryPublisher::OpenSocket There is no socket subsystem"));
+		return false;
+	}
+
+	Socket = FUdpSocketBuilder(TEXT("RacingEngineerTelemetry")).AsNonBlocking().Build();
+	if (Socket == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FTelemetryPublisher::OpenSocket Failed to create the socket"));
+		return false;
+	}
+
+	DestinationAddr = SocketSubsystem->CreateInternetAddr();
+	DestinationAddr->SetLoopbackAddress();
+	DestinationAddr->SetPort(Settings.UdpPort);
+
+	return true;
+}
+
+void FTelemetryPublisher::Close()
+{
+	if (SharedMemory != nullptr)
+	{
+		FPlatformMemory::UnmapNamedSharedMemoryRegion(SharedMemory);
+		SharedMemory = nullptr;
+		SharedHeader = nullptr;
+		SharedSlots = nullptr;
+	}
+
+	if (Socket != nullptr)
+	{
+		Socket->Close();
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+		Socket = nullptr;
+	}
+}
+
+void FTelemetryPublisher::PublishPendingSamples()
+{
+	FTelemetrySample Batch[MaxSamplesPerDatagram];
+	int32 BatchCount = 0;
+
+	FTelemetrySample Sample;
+	while (PendingSamples.Pop(Sample))
+	{
+		if (SharedHeader != nullptr)
+		{
+			const int64 SamplesWritten = SharedHeader->SamplesWritten;
+			FTelemetrySharedSlot& Slot = SharedSlots[SamplesWritten % SharedMemoryCapacity];
+			const int32 WriteCount = static_cast<int32>(Slot.WriteCount);
+
+			// Odd before the sample changes and even again after, the barrier keeps the copy from moving above the first store
+			FPlatformAtomics::AtomicStore(reinterpret_cast<volatile int32*>(&Slot.WriteCount), WriteCount + 1);
+			FPlatformMisc::MemoryBarrier();
+			Slot.Sample = Sample;
+			FPlatformAtomics::AtomicStore(reinterpret_cast<volatile int32*>(&Slot.WriteCount), WriteCount + 2);
+
+			FPlatformAtomics::AtomicStore(&SharedHeader->SamplesWritten, SamplesWritten + 1);
+		}
+
+		Batch[BatchCount++] = Sample;
+		if (BatchCount == MaxSamplesPerDatagram)
+		{
+			SendSamples(Batch, BatchCount);
+			BatchCount = 0;
+		}
+	}
+
+	if (BatchCount > 0)
+	{
+		SendSamples(Batch, BatchCount);
+	}
+}
+
+void FTelemetryPublisher::SendSamples(const FTelemetrySample* Samples, int32 SampleCount)
+{
+	if (Socket == nullptr)
+	{
+		return;
+	}
+
+	uint8 Datagram[sizeof(FTelemetryPacketHeader) + MaxSamplesPerDatagram * sizeof(FTelemetrySample)];
+
+	FTelemetryPacketHeader Header;
+	Header.Magic = TelemetryMagic;
+	Header.Version = TelemetryVersion;
+	Header.SampleCount = SampleCount;
+
+	const int32 DatagramSize = sizeof(FTelemetryPacketHeader) + SampleCount * sizeof(FTelemetrySample);
+	FMemory::Memcpy(Datagram, &Header, sizeof(FTelemetryPacketHeader));
+	FMemory::Memcpy(Datagram + sizeof(FTelemetryPacketHeader), Samples, SampleCount * sizeof(FTelemetrySample));
+
+	// Nobody listening isn't an error, the datagram is simply lost
+	int32 BytesSent = 0;
+	Socket->SendTo(Datagram, DatagramSize, BytesSent, *DestinationAddr);
+}
@@ -0,0 +1,152 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/PlatformMemory.h"
+#include "SpscRingBuffer.h"
+
+class FSocket;
+class FInternetAddr;
+
+/**
+ *  One vehicle state sample, the layout is read by external tools as is, in the host's byte order.
+ *  Every field is 4 bytes, so there is no padding on any platform. Bump TelemetryVersion when it changes.
+ */
+struct FTelemetrySample
+{
+	uint32 Sequence = 0;
+	float GameTime = 0.0f;
+
+	float SpeedKmh = 0.0f;
+	float EngineRPM = 0.0f;
+	int32 Gear = 0;
+
+	float Throttle = 0.0f;
+	float Brake = 0.0f;
+	float Steering = 0.0f;
+
+	// ETelemetryFlags
+	uint32 Flags = 0;
+
+	// Distance along the centre line from the start, as a fraction of the lap and in cm
+	float TrackProgress = 0.0f;
+	float TrackDistance = 0.0f;
+
+	// Distance from the centre line in cm, positive to the right
+	float LateralOffset = 0.0f;
+
+	// Front left, front right, rear left, rear right
+	float WheelSlipAngle[4] = {};
+	float WheelSlipMagnitude[4] = {};
+	float WheelSuspension[4] = {};
+};
+
+static_assert(sizeof(FTelemetrySample) == 96, "FTelemetrySample layout changed, bump TelemetryVersion");
+
+enum class ETelemetryFlags : uint32
+{
+	None = 0,
+	Handbrake = 1 << 0,
+	// Set when there is a track to measure the progress and offset on
+	TrackValid = 1 << 1,
+	// Bits 4 to 7 are set for wheels touching the ground
+	WheelContactShift = 4
+};
+
+/**
+ *  Start of the shared memory block, followed by SampleCapacity FTelemetrySharedSlot.
+ *  Sample i is written to slot i % SampleCapacity before SamplesWritten is raised past it.
+ */
+struct FTelemetrySharedHeader
+{
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	uint32 SampleSize = 0;
+	uint32 SampleCapacity = 0;
+	volatile int64 SamplesWritten = 0;
+};
+
+/**
+ *  Per slot seqlock, WriteCount is odd while the sample is being written.
+ *  Readers load WriteCount, retry while it's odd, copy the sample and load WriteCount again.
+ *  The copy is torn, because the publisher wrapped around onto the slot, unless both loads match.
+ */
+struct FTelemetrySharedSlot
+{
+	volatile uint32 WriteCount = 0;
+	FTelemetrySample Sample;
+};
+
+static_assert(sizeof(FTelemetrySharedSlot) == 100, "FTelemetrySharedSlot layout changed, bump TelemetryVersion");
+
+// Every datagram is this header followed by SampleCount samples
+struct FTelemetryPacketHeader
+{
+	uint32 Magic = 0;
+	uint16 Version = 0;
+	uint16 SampleCount = 0;
+};
+
+struct FTelemetryPublisherSettings
+{
+	FString SharedMemoryName;
+	// 0 disables the socket
+	int32 UdpPort = 0;
+	int32 PublishIntervalMs = 5;
+};
+
+/**
+ *  Owns the thread publishing telemetry samples to shared memory and to a UDP socket on the local host.
+ *  Samples are handed over through a lock free ring buffer, the producer never blocks or allocates.
+ */
+class RACINGENGINEER_API FTelemetryPublisher : public FRunnable
+{
+public:
+	static constexpr uint32 TelemetryMagic = 0x524C544D; // RLTM
+	static constexpr uint32 TelemetryVersion = 2;
+
+	explicit FTelemetryPublisher(const FTelemetryPublisherSettings& InSettings);
+	virtual ~FTelemetryPublisher() override;
+
+	// Producer thread only, returns false when the publisher fell behind and the sample was dropped
+	bool Push(const FTelemetrySample& Sample);
+
+	// Any thread
+	uint32 GetDroppedSamples() const { return DroppedSamples.load(std::memory_order_relaxed); }
+
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	bool OpenSharedMemory();
+	bool OpenSocket();
+	void Close();
+
+	void PublishPendingSamples();
+	void SendSamples(const FTelemetrySample* Samples, int32 SampleCount);
+
+	static constexpr uint32 RingBufferCapacity = 1024;
+	static constexpr uint32 SharedMemoryCapacity = 256;
+
+	// Keeps datagrams under the usual 1500 byte MTU
+	static constexpr int32 MaxSamplesPerDatagram = 12;
+
+	FTelemetryPublisherSettings Settings;
+
+	TSpscRingBuffer<FTelemetrySample, RingBufferCapacity> PendingSamples;
+	std::atomic<uint32> DroppedSamples = 0;
+
+	FPlatformMemory::FSharedMemoryRegion* SharedMemory = nullptr;
+	FTelemetrySharedHeader* SharedHeader = nullptr;
+	FTelemetrySharedSlot* SharedSlots = nullptr;
+
+	FSocket* Socket = nullptr;
+	TSharedPtr<FInternetAddr> DestinationAddr;
+
+	FEvent* WorkEvent = nullptr;
+	std::atomic_bool bStopping = false;
+
+	FRunnableThread* Thread = nullptr;
+};
@@ -0,0 +1,232 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TelemetrySubsystem.h"
+
+#include "MapManager.h"
+#include "RacingEngineerPawn.h"
+#include "ChaosWheeledVehicleMovementComponent.h"
+#include "EngineUtils.h"
+#include "Kismet/GameplayStatics.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "Chaos/SimCallbackInput.h"
+#include "Chaos/SimCallbackObject.h"
+#include "PBDRigidsSolver.h"
+#include "PhysicsProxy/SingleParticlePhysicsProxy.h"
+
+namespace Telemetry
+{
+	constexpr float CmPerSecondToKmh = 0.036f;
+	constexpr int32 MaxWheels = 4;
+
+	// Samples searched either way of the last closest one, further jumps fall back to a full search
+	constexpr int32 TrackSearchRadius = 32;
+}
+
+struct FTelemetrySimInput : public Chaos::FSimCallbackInput
+{
+	void Reset()
+	{
+		Publisher.Reset();
+		ChassisProxy = nullptr;
+		bHasVehicle = false;
+	}
+
+	TSharedPtr<FTelemetryPublisher> Publisher;
+
+	// What only the game thread can read, sampled once for the frame
+	FTelemetrySample VehicleState;
+	Chaos::FSingleParticlePhysicsProxy* ChassisProxy = nullptr;
+	bool bHasVehicle = false;
+
+	// Centre line sample closest to the vehicle at the start of the frame, the steps measure the chassis against it
+	FTransform MapTransform;
+	FVector TrackLocation = FVector::ZeroVector;
+	FVector TrackDirection = FVector::ForwardVector;
+	FVector TrackRight = FVector::RightVector;
+	float TrackDistance = 0.0f;
+	float TrackLength = 0.0f;
+};
+
+class FTelemetrySimCallback : public Chaos::TSimCallbackObject<FTelemetrySimInput>
+{
+	virtual void OnPreSimulate_Internal() override
+	{
+		const FTelemetrySimInput* Input = GetConsumerInput_Internal();
+		if (Input == nullptr || !Input->bHasVehicle || !Input->Publisher.IsValid())
+		{
+			return;
+		}
+
+		FTelemetrySample Sample = Input->VehicleState;
+		Sample.Sequence = NextSequence++;
+		Sample.GameTime = GetSimTime_Internal();
+
+		// The chassis state is the step's own, a vehicle moves less than a sample spacing in a frame so the frame's closest sample still holds
+		if (const Chaos::FRigidBodyHandle_Internal* Chassis = Input->ChassisProxy != nullptr ? Input->ChassisProxy->GetPhysicsThreadAPI() : nullptr)
+		{
+			Sample.SpeedKmh = FVector::DotProduct(Chassis->V(), Chassis->R().GetForwardVector()) * Telemetry::CmPerSecondToKmh;
+
+			if (Input->TrackLength > 0.0f)
+			{
+				const FVector Offset = Input->MapTransform.InverseTransformPosition(Chassis->X()) - Input->TrackLocation;
+
+				Sample.TrackDistance = FMath::Fmod(Input->TrackDistance + FVector::DotProduct(Offset, Input->TrackDirection) + Input->TrackLength, Input->TrackLength);
+				Sample.TrackProgress = Sample.TrackDistance / Input->TrackLength;
+				Sample.LateralOffset = FVector::DotProduct(Offset, Input->TrackRight);
+			}
+		}
+
+		// The physics thread is the only producer
+		Input->Publisher->Push(Sample);
+	}
+
+	uint32 NextSequence = 0;
+};
+
+bool UTelemetrySubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	if (World == nullptr || !World->IsGameWorld() || !Super::ShouldCreateSubsystem(Outer))
+	{
+		return false;
+	}
+
+	return bEnabled || FParse::Param(FCommandLine::Get(), TEXT("Telemetry"));
+}
+
+void UTelemetrySubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	TActorIterator<AMapManager> MapManagerIterator(&InWorld);
+	MapManager = MapManagerIterator ? *MapManagerIterator : nullptr;
+
+	BoundPhysScene = InWorld.GetPhysicsScene();
+	if (BoundPhysScene == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("UTelemetrySubsystem::OnWorldBeginPlay World has no physics scene"));
+		return;
+	}
+
+	FTelemetryPublisherSettings Settings;
+	Settings.SharedMemoryName = SharedMemoryName;
+	Settings.UdpPort = UdpPort;
+	Settings.PublishIntervalMs = FMath::Max(1, PublishIntervalMs);
+	Publisher = MakeShared<FTelemetryPublisher>(Settings);
+
+	// Runs for every step the solver takes, so the rate follows the physics substeps and not the frame rate
+	SimCallback = BoundPhysScene->GetSolver()->CreateAndRegisterSimCallbackObject_External<FTelemetrySimCallback>();
+	PhysScenePreTickHandle = BoundPhysScene->OnPhysScenePreTick.AddUObject(this, &UTelemetrySubsystem::OnPhysScenePreTick);
+}
+
+void UTelemetrySubsystem::Deinitialize()
+{
+	if (BoundPhysScene != nullptr)
+	{
+		BoundPhysScene->OnPhysScenePreTick.Remove(PhysScenePreTickHandle);
+
+		if (SimCallback != nullptr)
+		{
+			BoundPhysScene->GetSolver()->UnregisterAndFreeSimCallbackObject_External(SimCallback);
+			SimCallback = nullptr;
+		}
+
+		BoundPhysScene = nullptr;
+	}
+
+	// Waits for the queued samples to be published, unless a physics step still holds on to the publisher
+	Publisher.Reset();
+
+	Super::Deinitialize();
+}
+
+int32 UTelemetrySubsystem::GetDroppedSamples() const
+{
+	return Publisher.IsValid() ? Publisher->GetDroppedSamples() : 0;
+}
+
+void UTelemetrySubsystem::OnPhysScenePreTick(FPhysScene_Chaos* PhysScene, float DeltaTime)
+{
+	if (SimCallback == nullptr)
+	{
+		return;
+	}
+
+	FTelemetrySimInput* Input = SimCallback->GetProducerInputData_External();
+	Input->Publisher = Publisher;
+	Input->bHasVehicle = SampleVehicle(Input->VehicleState);
+	Input->TrackLength = 0.0f;
+
+	const FTrackFrameTable* TrackFrames = MapManager.IsValid() ? &MapManager->GetTrackFrames() : nullptr;
+	if (Input->bHasVehicle && TrackFrames != nullptr && TrackFrames->Locations.IsValidIndex(ClosestTrackSample))
+	{
+		Input->MapTransform = MapManager->GetActorTransform();
+		Input->TrackLocation = TrackFrames->Locations[ClosestTrackSample];
+		Input->TrackDirection = TrackFrames->Directions[ClosestTrackSample];
+		Input->TrackRight = TrackFrames->GetRightVectorAtIndex(ClosestTrackSample);
+		Input->TrackDistance = ClosestTrackSample * TrackFrames->SampleSpacing;
+		Input->TrackLength = TrackFrames->Length;
+	}
+
+	const ARacingEngineerPawn* VehiclePawn = Cast<ARacingEngineerPawn>(UGameplayStatics::GetPlayerPawn(this, 0));
+	const FBodyInstance* ChassisBody = VehiclePawn != nullptr && VehiclePawn->GetMesh() != nullptr ? VehiclePawn->GetMesh()->GetBodyInstance() : nullptr;
+	Input->ChassisProxy = ChassisBody != nullptr ? ChassisBody->GetPhysicsActorHandle() : nullptr;
+}
+
+bool UTelemetrySubsystem::SampleVehicle(FTelemetrySample& OutSample)
+{
+	const ARacingEngineerPawn* VehiclePawn = Cast<ARacingEngineerPawn>(UGameplayStatics::GetPlayerPawn(this, 0));
+	if (VehiclePawn == nullptr || VehiclePawn->GetChaosVehicleMovement() == nullptr)
+	{
+		return false;
+	}
+
+	const UChaosWheeledVehicleMovementComponent* VehicleMovement = VehiclePawn->GetChaosVehicleMovement();
+
+	// Sequence and time are set by the physics step, the speed is replaced by the step's own when the chassis is there
+	OutSample.GameTime = GetWorld()->GetTimeSeconds();
+
+	OutSample.SpeedKmh = VehicleMovement->GetForwardSpeed() * Telemetry::CmPerSecondToKmh;
+	OutSample.EngineRPM = VehicleMovement->GetEngineRotationSpeed();
+	OutSample.Gear = VehicleMovement->GetCurrentGear();
+
+	OutSample.Throttle = VehicleMovement->GetThrottleInput();
+	OutSample.Brake = VehicleMovement->GetBrakeInput();
+	OutSample.Steering = VehicleMovement->GetSteeringInput();
+
+	uint32 Flags = VehicleMovement->GetHandbrakeInput() ? static_cast<uint32>(ETelemetryFlags::Handbrake) : 0;
+
+	const int32 WheelsNum = FMath::Min(VehicleMovement->Wheels.Num(), Telemetry::MaxWheels);
+	for (int32 WheelIndex = 0; WheelIndex < WheelsNum; WheelIndex++)
+	{
+		const FWheelStatus& WheelState = VehicleMovement->GetWheelState(WheelIndex);
+
+		OutSample.WheelSlipAngle[WheelIndex] = WheelState.SlipAngle;
+		OutSample.WheelSlipMagnitude[WheelIndex] = WheelState.SlipMagnitude;
+		OutSample.WheelSuspension[WheelIndex] = WheelState.NormalizedSuspensionLength;
+
+		if (WheelState.bInContact)
+		{
+			Flags |= 1u << (static_cast<uint32>(ETelemetryFlags::WheelContactShift) + WheelIndex);
+		}
+	}
+
+	const FTrackFrameTable* TrackFrames = MapManager.IsValid() ? &MapManager->GetTrackFrames() : nullptr;
+	if (TrackFrames != nullptr && !TrackFrames->IsEmpty())
+	{
+		const FVector MapLocation = MapManager->GetActorTransform().InverseTransformPosition(VehiclePawn->GetActorLocation());
+		ClosestTrackSample = TrackFrames->FindClosestIndex(MapLocation, ClosestTrackSample, Telemetry::TrackSearchRadius);
+
+		OutSample.TrackDistance = ClosestTrackSample * TrackFrames->SampleSpacing;
+		OutSample.TrackProgress = TrackFrames->Length > 0.0f ? OutSample.TrackDistance / TrackFrames->Length : 0.0f;
+		OutSample.LateralOffset = FVector::DotProduct(MapLocation - TrackFrames->Locations[ClosestTrackSample],
+			TrackFrames->GetRightVectorAtIndex(ClosestTrackSample));
+
+		Flags |= static_cast<uint32>(ETelemetryFlags::TrackValid);
+	}
+
+	OutSample.Flags = Flags;
+
+	return true;
+}
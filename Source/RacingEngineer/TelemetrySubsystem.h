@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TelemetryPublisher.h"
+#include "TelemetrySubsystem.generated.h"
+
+class AMapManager;
+class FPhysScene_Chaos;
+class FTelemetrySimCallback;
+
+/**
+ *  Samples the player vehicle on the physics thread once per physics step and hands the samples to FTelemetryPublisher.
+ *  That is once per frame, more only where substepping or async physics is turned on, which telemetry leaves to the project.
+ *  Time, chassis speed, track distance and lateral offset come from the step itself. Inputs, engine, gear and wheels are
+ *  read from the components once per frame, so every step of a frame repeats them.
+ *  Off unless enabled in the config or with -Telemetry, the sampling itself is a few component reads.
+ */
+UCLASS(Config = Game)
+class RACINGENGINEER_API UTelemetrySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	// Samples the publisher thread couldn't keep up with
+	UFUNCTION(BlueprintCallable, Category = "Telemetry")
+	int32 GetDroppedSamples() const;
+
+private:
+	// Hands the frame's vehicle state to the physics steps that follow
+	void OnPhysScenePreTick(FPhysScene_Chaos* PhysScene, float DeltaTime);
+
+	bool SampleVehicle(FTelemetrySample& OutSample);
+
+	UPROPERTY(Config)
+	bool bEnabled = false;
+
+	// Local host port the samples are sent to, 0 disables the socket
+	UPROPERTY(Config)
+	int32 UdpPort = 20777;
+
+	// Empty disables the shared memory block
+	UPROPERTY(Config)
+	FString SharedMemoryName = TEXT("RacingEngineerTelemetry");
+
+	UPROPERTY(Config)
+	int32 PublishIntervalMs = 5;
+
+	// Shared with the inputs of the sim callback, the physics thread may still push after the callback is unregistered
+	TSharedPtr<FTelemetryPublisher> Publisher;
+
+	FTelemetrySimCallback* SimCallback = nullptr;
+
+	TWeakObjectPtr<AMapManager> MapManager;
+
+	FPhysScene_Chaos* BoundPhysScene = nullptr;
+	FDelegateHandle PhysScenePreTickHandle;
+
+	int32 ClosestTrackSample = INDEX_NONE;
+};
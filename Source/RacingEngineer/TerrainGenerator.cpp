@@ -2,11 +2,15 @@
 
 
 #include "TerrainGenerator.h"
-#include "ProceduralMeshComponent.h"
+#include "RacingEngineer.h"
 #include "KismetProceduralMeshLibrary.h"
-#include "RacingEngineerGameInstance.h"
+#include "TerrainMeshComponent.h"
 #include "TrackGenerator.h"
-#include "Components/SplineComponent.h"
+#include "TerrainGrid.h"
+#include "TerrainTileStreaming.h"
+#include "Async/ParallelFor.h"
+#include "Landscape.h"
+#include "LandscapeDataAccess.h"
 #include "Runtime/Foliage/Public/FoliageInstancedStaticMeshComponent.h"
 
 using UE::Math::TVector;
@@ -16,13 +20,15 @@ ATerrainGenerator::ATerrainGenerator()
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = false;
 
-	ProceduralMesh = CreateDefaultSubobject<UProceduralMeshComponent>(TEXT("ProceduralMesh"));
-	if (ProceduralMesh != nullptr)
+	TerrainMesh = CreateDefaultSubobject<UTerrainMeshComponent>(TEXT("TerrainMesh"));
+	if (TerrainMesh != nullptr)
 	{
-		ProceduralMesh->SetCanEverAffectNavigation(false);
-		SetRootComponent(ProceduralMesh);
+		TerrainMesh->SetCanEverAffectNavigation(false);
+		SetRootComponent(TerrainMesh);
 	}
 
+	TerrainStreaming = CreateDefaultSubobject<UTerrainTileStreamingComponent>(TEXT("TerrainStreaming"));
+
 	TerrainWalls.Reserve(4);
 	
 	for (uint8 i = 0; i < 4; i++)
@@ -77,49 +83,53 @@ void ATerrainGenerator::Tick(float DeltaTime)
 
 void ATerrainGenerator::DoWork(const FWorkerData& Data, const FOnWorkFinished Callback)
 {
-	const uint64 VerticesNum = Data.TextureWidth * Data.TextureHeight;
-	const float VertScaleXYNum = Data.VertScale.X * Data.VertScale.Y;
-	GrassFoliageProbability *= VertScaleXYNum / VerticesNum;
-	RocksProbability *= VertScaleXYNum / VerticesNum;
-	TreesProbability *= VertScaleXYNum / VerticesNum;
-
-	URacingEngineerGameInstance* RacingEngineerGameInstance = Cast<URacingEngineerGameInstance>(GetGameInstance());
-	if (RacingEngineerGameInstance != nullptr)
+	TRACE_CPUPROFILER_EVENT_SCOPE(ATerrainGenerator::DoWork);
+	LLM_SCOPE_BYTAG(RacingEngineer_Terrain);
+
+	if (!Data.BuildData.IsValid())
 	{
-		if (RacingEngineerGameInstance->bLightWeightMode)
+		UE_LOG(LogTemp, Error, TEXT("ATerrainGenerator::DoWork BuildData is nullptr"));
+
+		if (Callback.IsBound())
 		{
-			GrassFoliageProbability /= 3.0;
-			RocksProbability /= 3.0;
-			TreesProbability /= 3.0;
+			Callback.Execute();
 		}
+		return;
 	}
 
-	GrassFoliageLocations.Reserve(VerticesNum * GrassFoliageProbability);
-	RocksLocations.Reserve(VerticesNum * RocksProbability);
-	TreesLocations.Reserve(VerticesNum * TreesProbability);
-
 	CreateTerrain(Data);
 
 	AsyncTask(ENamedThreads::GameThread, [this, Data, Callback]
 	{
-		ProceduralMesh->CreateMeshSection(
-				0,
-				Vertices,
-				TriangleIndices,
-				Normals,
-				UV,
-				TArray<FColor>(),
-				TArray<FProcMeshTangent>(),
-				true);
-
-		ProceduralMesh->SetMaterial(0, MeshMaterial);
-		ProceduralMesh->SetCanEverAffectNavigation(true);
+		TRACE_CPUPROFILER_EVENT_SCOPE(ATerrainGenerator::CreateMeshSection);
+		LLM_SCOPE_BYTAG(RacingEngineer_Terrain);
+
+		if (Data.BuildData->Settings.bStreamTerrain)
+		{
+			TerrainMesh->ClearTerrainMesh();
+			TerrainStreaming->StartStreaming(MeshMaterial);
+		}
+		else if (Data.BuildData->Settings.bLandscapeTerrain)
+		{
+			TerrainMesh->ClearTerrainMesh();
+			CreateLandscape(Data);
+		}
+		else
+		{
+			// The compact mesh goes to the GPU and the cooker without being widened into double precision vertices
+			TerrainMesh->SetTerrainMesh(PendingTerrainMesh, PendingTerrainBounds);
+		}
+
+		ReleaseMeshBuffers();
+
+		TerrainMesh->SetMaterial(0, MeshMaterial);
+		TerrainMesh->SetCanEverAffectNavigation(true);
 
 		SetupWalls(Data.TextureWidth, Data.TextureHeight, Data.VertScale);
 
-		SpawnInstancedMeshes(GrassFoliageLocations, GrassFoliageComponent, false);
-		SpawnInstancedMeshes(RocksLocations, RockInstancedStaticMeshComponent, true);
-		SpawnInstancedMeshes(TreesLocations, TreesInstancedStaticMeshComponent, true);
+		SpawnInstancedMeshes(GrassFoliageTransforms, GrassFoliageComponent, false);
+		SpawnInstancedMeshes(RocksTransforms, RockInstancedStaticMeshComponent, true);
+		SpawnInstancedMeshes(TreesTransforms, TreesInstancedStaticMeshComponent, true);
 
 		if (Callback.IsBound())
 		{
@@ -129,87 +139,276 @@ void ATerrainGenerator::DoWork(const FWorkerData& Data, const FOnWorkFinished Ca
 }
 
 
-void ATerrainGenerator::CreateTerrain(const FWorkerData& Data)
+void ATerrainGenerator::ResetWork()
 {
-	UV = CalculateUVs(Data.TextureWidth, Data.TextureHeight);
-	Vertices = CalculateVertices(Data.TextureWidth, Data.TextureHeight, Data.VertScale);
-	AlterVerticesHeight(Vertices, Data);
-	TriangleIndices = CalculateTriangles(Data.TextureWidth, Data.TextureHeight);
+	ReleaseMeshBuffers();
+	TerrainStreaming->StopStreaming();
+	DestroyLandscape();
 
-	if (UseBuiltInNormalsAndTangents)
+	GrassFoliageTransforms.Empty();
+	RocksTransforms.Empty();
+	TreesTransforms.Empty();
+
+	// Instanced components are kept and only emptied, the mesh section is reused by the next DoWork
+	const TArray<UInstancedStaticMeshComponent*, TInlineAllocator<3>> InstancedStaticMeshComponents =
+		{ GrassFoliageComponent, RockInstancedStaticMeshComponent, TreesInstancedStaticMeshComponent };
+
+	for (UInstancedStaticMeshComponent* InstancedStaticMeshComponent : InstancedStaticMeshComponents)
 	{
-		TArray<FProcMeshTangent> Tangents;
-		UKismetProceduralMeshLibrary::CalculateTangentsForMesh(Vertices, TriangleIndices, UV, Normals, Tangents);
+		if (InstancedStaticMeshComponent != nullptr)
+		{
+			InstancedStaticMeshComponent->ClearInstances();
+		}
 	}
-	else
+}
+
+void ATerrainGenerator::GatherBuildSettings(FMapBuildSettings& OutSettings) const
+{
+	if (TrackGenerator.IsValid())
 	{
-		Normals = CalculateNormals(Vertices, TriangleIndices, Data.TextureWidth, Data.TextureHeight);
+		const FVector MeshSize = TrackGenerator->GetTrackMeshSize();
+		OutSettings.TrackWidth = MeshSize.Y;
+		OutSettings.TrackDepth = MeshSize.Z * MeshHeightScalar;
 	}
+
+	OutSettings.BandRows = BandRows;
+	FParse::Value(FCommandLine::Get(), TEXT("BandRows="), OutSettings.BandRows);
+
+	OutSettings.ErosionIterations = ErosionIterations;
+	FParse::Value(FCommandLine::Get(), TEXT("ErosionIterations="), OutSettings.ErosionIterations);
+
+	// Banded builds keep no whole map mesh, so they are always streamed
+	OutSettings.bStreamTerrain = bStreamTerrain || OutSettings.BandRows > 0 || FParse::Param(FCommandLine::Get(), TEXT("StreamTerrain"));
+
+	// Streamed terrain has no whole map heights to import
+	OutSettings.bLandscapeTerrain = WITH_EDITOR && !OutSettings.bStreamTerrain
+		&& (bLandscapeTerrain || FParse::Param(FCommandLine::Get(), TEXT("LandscapeTerrain")));
+
+	OutSettings.GrassFoliageProbability = GrassFoliageProbability;
+	OutSettings.RocksProbability = RocksProbability;
+	OutSettings.TreesProbability = TreesProbability;
 }
 
-void ATerrainGenerator::AlterVerticesHeight(TArray<FVector>& outVertices, const FWorkerData& Data)
+FWorkerMemoryUsage ATerrainGenerator::GetRetainedMemory() const
 {
-	for (uint32 y = 0; y < Data.TextureHeight; y++)
+	FWorkerMemoryUsage Usage;
+	Usage.BuildBuffers = (PendingTerrainMesh.IsValid() ? PendingTerrainMesh->GetAllocatedSize() : 0)
+		+ GrassFoliageTransforms.GetAllocatedSize() + RocksTransforms.GetAllocatedSize()
+		+ TreesTransforms.GetAllocatedSize() + LandscapeHeights.GetAllocatedSize();
+
+	Usage.ComponentData = TerrainMesh->GetTerrainMeshSize() + TerrainStreaming->GetResidentMeshSize();
+
+	// Streamed terrain keeps the heights and distance field to build its tiles from
+	Usage.BuildBuffers += TerrainStreaming->GetSourceSize();
+
+	const TArray<const UInstancedStaticMeshComponent*, TInlineAllocator<3>> InstancedStaticMeshComponents =
+		{ GrassFoliageComponent, RockInstancedStaticMeshComponent, TreesInstancedStaticMeshComponent };
+
+	for (const UInstancedStaticMeshComponent* InstancedStaticMeshComponent : InstancedStaticMeshComponents)
 	{
-		for (uint32 x = 0; x < Data.TextureWidth; x++)
+		if (InstancedStaticMeshComponent != nullptr)
 		{
-			constexpr uint8 Offset = 127;
-			FVector& CurrentVert = outVertices[y * Data.TextureWidth + x];
+			Usage.ComponentData += InstancedStaticMeshComponent->PerInstanceSMData.GetAllocatedSize();
+		}
+	}
 
-			const uint8 HeightValue = Data.HeightData[y * Data.TextureWidth + x];
-			;
-			CurrentVert.Z += (HeightValue - Offset) / 255.0 * Data.VertScale.Z;
-			
-			float MeshWidth = 0.0f;
-			float MeshHeight = 0.0f;
+	return Usage;
+}
 
-			if (TrackGenerator.IsValid())
-			{
-				const FVector MeshSize = TrackGenerator->GetTrackMeshSize();
-				MeshWidth = MeshSize.Y;
-				MeshHeight = MeshSize.Z * MeshHeightScalar;
-			}
+void ATerrainGenerator::ReleaseMeshBuffers()
+{
+	PendingTerrainMesh.Reset();
+	PendingTerrainBounds.Init();
+}
+
+TSharedRef<const FTerrainMeshData> ATerrainGenerator::MakeBuiltInNormalsMesh(const FTerrainMeshData& MeshData)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(ATerrainGenerator::MakeBuiltInNormalsMesh);
+
+	// The library only takes double precision arrays, they are only widened for this opt in path
+	TArray<FVector> Vertices;
+	Vertices.SetNumUninitialized(MeshData.Vertices.Num());
+	for (int32 Index = 0; Index < Vertices.Num(); Index++)
+	{
+		Vertices[Index] = FVector(MeshData.Vertices[Index]);
+	}
+
+	TArray<FVector> Normals;
+	TArray<FProcMeshTangent> Tangents;
+	UKismetProceduralMeshLibrary::CalculateTangentsForMesh(Vertices, MeshData.Triangles, CalculateUVs(MeshData.Width, MeshData.Height),
+		Normals, Tangents);
+
+	// The mesh from the build data is shared, so the new normals go into a copy
+	TSharedRef<FTerrainMeshData> BuiltInNormalsMesh = MakeShared<FTerrainMeshData>();
+	BuiltInNormalsMesh->Width = MeshData.Width;
+	BuiltInNormalsMesh->Height = MeshData.Height;
+	BuiltInNormalsMesh->Vertices = MeshData.Vertices;
+	BuiltInNormalsMesh->Triangles = MeshData.Triangles;
+
+	BuiltInNormalsMesh->Normals.Reserve(Normals.Num());
+	for (const FVector& Normal : Normals)
+	{
+		BuiltInNormalsMesh->Normals.Emplace(FVector3f(Normal));
+	}
+
+	return BuiltInNormalsMesh;
+}
+
+void ATerrainGenerator::PrepareLandscape(const FMapBuildData& BuildData, const FTerrainMeshData& MeshData)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(ATerrainGenerator::PrepareLandscape);
+
+	const int32 Width = BuildData.Width;
+	const int32 Height = BuildData.Height;
+	const TArray<FVector3f>& SourceVertices = MeshData.Vertices;
+
+	LandscapeHeights.Empty();
 
-			if (Data.TrackSpline != nullptr)
+	if (Width < 2 || Height < 2 || SourceVertices.Num() != Width * Height)
+	{
+		UE_LOG(LogTemp, Error, TEXT("ATerrainGenerator::PrepareLandscape The build has no terrain vertices"));
+		return;
+	}
+
+	LandscapeLayout = FLandscapeLayout::Choose(Width, Height, MaxLandscapeComponents);
+	const FIntPoint VerticesNum = LandscapeLayout.GetVerticesNum();
+	const FIntPoint QuadsNum = LandscapeLayout.GetQuadsNum();
+
+	// Z is scaled so the highest and the lowest vertex still fit into the 16 bit heights
+	float MaxAbsZ = 1.0f;
+	for (const FVector3f& Vertex : SourceVertices)
+	{
+		MaxAbsZ = FMath::Max(MaxAbsZ, FMath::Abs(Vertex.Z));
+	}
+
+	const double HeightRange = LandscapeDataAccess::MaxValue - LandscapeDataAccess::MidValue;
+	const double ZScale = MaxAbsZ / (HeightRange * LANDSCAPE_ZSCALE);
+	const double HeightPerUnit = 1.0 / (ZScale * LANDSCAPE_ZSCALE);
+
+	// The landscape spans the same extent as the grid, its quads are just sized differently
+	LandscapeScale = FVector(
+		(Width - 1) * BuildData.Settings.VertScale.X / QuadsNum.X,
+		(Height - 1) * BuildData.Settings.VertScale.Y / QuadsNum.Y,
+		ZScale);
+
+	LandscapeHeights.SetNumUninitialized(VerticesNum.X * VerticesNum.Y);
+
+	ParallelFor(VerticesNum.Y, [&](int32 Y)
+		{
+			const double SourceY = Y * (Height - 1.0) / QuadsNum.Y;
+			const int32 Y0 = FMath::Min(FMath::FloorToInt32(SourceY), Height - 2);
+			const float AlphaY = SourceY - Y0;
+
+			for (int32 X = 0; X < VerticesNum.X; X++)
 			{
-				const FVector ClosestSplinePos = Data.TrackSpline->FindLocationClosestToWorldLocation(CurrentVert, ESplineCoordinateSpace::World);
-				const float Distance = FVector::Dist(CurrentVert, ClosestSplinePos);
-				const float MeshOffset = MeshWidth * 0.35f;
+				const double SourceX = X * (Width - 1.0) / QuadsNum.X;
+				const int32 X0 = FMath::Min(FMath::FloorToInt32(SourceX), Width - 2);
+				const float AlphaX = SourceX - X0;
 
-				// If it's under the track mesh with some offset
-				if (Distance <= MeshWidth / 2 + MeshOffset)
-				{
-					CurrentVert.Z = ClosestSplinePos.Z - MeshHeight;
-				}
-				// If it's near the track mesh but not under it
-				else if (Distance <= MeshWidth + MeshOffset)
-				{
-					const float Alpha = (MeshWidth + MeshOffset) / Distance - 1.0f;
-					CurrentVert.Z = FMath::Lerp(CurrentVert.Z, ClosestSplinePos.Z - MeshHeight, Alpha);
-				}
-				else
-				{
-					TryAddFoliageLocation(CurrentVert);
-				}
+				const int32 Index = Y0 * Width + X0;
+				const float Z = FMath::BiLerp(SourceVertices[Index].Z, SourceVertices[Index + 1].Z,
+					SourceVertices[Index + Width].Z, SourceVertices[Index + Width + 1].Z, AlphaX, AlphaY);
+
+				LandscapeHeights[Y * VerticesNum.X + X] = static_cast<uint16>(
+					FMath::Clamp(FMath::RoundToInt32(Z * HeightPerUnit + LandscapeDataAccess::MidValue), 0, LandscapeDataAccess::MaxValue));
 			}
-		}
+		});
+}
+
+void ATerrainGenerator::CreateLandscape(const FWorkerData& Data)
+{
+#if WITH_EDITOR
+	TRACE_CPUPROFILER_EVENT_SCOPE(ATerrainGenerator::CreateLandscape);
+
+	DestroyLandscape();
+
+	if (LandscapeHeights.IsEmpty())
+	{
+		return;
+	}
+
+	// The landscape's origin is its first vertex, the corner of the map
+	const FVector Corner = FMapBuildPipeline::GetTexelLocation(0, 0, Data.TextureWidth, Data.TextureHeight, Data.VertScale);
+	const FTransform LandscapeTransform = FTransform(FQuat::Identity, Corner, LandscapeScale) * GetActorTransform();
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.Owner = this;
+	SpawnParameters.ObjectFlags = RF_Transient;
+
+	Landscape = GetWorld()->SpawnActor<ALandscape>(ALandscape::StaticClass(), LandscapeTransform, SpawnParameters);
+	if (Landscape == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("ATerrainGenerator::CreateLandscape Failed to spawn the landscape"));
+		LandscapeHeights.Empty();
+		return;
 	}
+
+	Landscape->LandscapeMaterial = LandscapeMaterial != nullptr ? LandscapeMaterial : MeshMaterial;
+
+	const FIntPoint VerticesNum = LandscapeLayout.GetVerticesNum();
+
+	TMap<FGuid, TArray<uint16>> HeightDataPerLayer;
+	HeightDataPerLayer.Add(FGuid(), MoveTemp(LandscapeHeights));
+
+	TMap<FGuid, TArray<FLandscapeImportLayerInfo>> MaterialLayerDataPerLayer;
+	MaterialLayerDataPerLayer.Add(FGuid(), TArray<FLandscapeImportLayerInfo>());
+
+	Landscape->Import(FGuid::NewGuid(), 0, 0, VerticesNum.X - 1, VerticesNum.Y - 1, LandscapeLayout.SectionsPerComponent,
+		LandscapeLayout.QuadsPerSection, HeightDataPerLayer, nullptr, MaterialLayerDataPerLayer, ELandscapeImportAlphamapType::Additive);
+
+	LandscapeHeights.Empty();
+#else
+	UE_LOG(LogTemp, Error, TEXT("ATerrainGenerator::CreateLandscape Landscapes can only be imported in editor builds"));
+	LandscapeHeights.Empty();
+#endif
 }
 
-void ATerrainGenerator::TryAddFoliageLocation(const FVector& LocationToSpawn)
+void ATerrainGenerator::DestroyLandscape()
 {
-	if (FMath::FRand() < GrassFoliageProbability && GrassFoliageLocations.Num() < GrassFoliageLocations.Max())
+	if (Landscape != nullptr)
 	{
-		GrassFoliageLocations.Emplace(LocationToSpawn);
+		Landscape->Destroy();
+		Landscape = nullptr;
 	}
-	else if (FMath::FRand() < RocksProbability && RocksLocations.Num() < RocksLocations.Max())
+}
+
+void ATerrainGenerator::CreateTerrain(const FWorkerData& Data)
+{
+	// The terrain is the only worker placing foliage, so the transforms are moved out. The mesh itself was handed over in FWorkerData
+	FMapBuildData& BuildData = *Data.BuildData;
+
+	GrassFoliageTransforms = MoveTemp(BuildData.GrassFoliageTransforms);
+	RocksTransforms = MoveTemp(BuildData.RocksTransforms);
+	TreesTransforms = MoveTemp(BuildData.TreesTransforms);
+
+	if (BuildData.Settings.bStreamTerrain)
+	{
+		// Only the tiles around the start line are built before the map is shown
+		const FVector StartLocation = BuildData.TrackFrames.IsEmpty() ? FVector::ZeroVector : BuildData.TrackFrames.Locations[0];
+		TerrainStreaming->PrepareStreaming(BuildData, StartLocation);
+		return;
+	}
+
+	if (!Data.TerrainMesh.IsValid())
 	{
-		RocksLocations.Emplace(LocationToSpawn);
+		UE_LOG(LogTemp, Error, TEXT("ATerrainGenerator::CreateTerrain The terrain mesh wasn't handed over"));
+		return;
 	}
-	else if (FMath::FRand() < TreesProbability && TreesLocations.Num() < TreesLocations.Max())
+
+	// Everything but the import itself is done here, off the game thread
+	if (BuildData.Settings.bLandscapeTerrain)
+	{
+		PrepareLandscape(BuildData, *Data.TerrainMesh);
+		return;
+	}
+
+	PendingTerrainMesh = Data.TerrainMesh;
+	if (UseBuiltInNormalsAndTangents)
 	{
-		TreesLocations.Emplace(LocationToSpawn);
+		PendingTerrainMesh = MakeBuiltInNormalsMesh(*Data.TerrainMesh);
 	}
+
+	PendingTerrainBounds = FBox3f(PendingTerrainMesh->Vertices);
 }
 
 void ATerrainGenerator::SetupWalls(const uint32 TextureWidth, const uint32 TextureHeight, const FVector& VertScale)
@@ -287,27 +486,16 @@ void ATerrainGenerator::SetupWalls(const uint32 TextureWidth, const uint32 Textu
 	}
 }
 
-void ATerrainGenerator::SpawnInstancedMeshes(TArray<FVector>& Locations, UInstancedStaticMeshComponent* InstancedStaticMeshComponent, bool bUpdateNavigation)
+void ATerrainGenerator::SpawnInstancedMeshes(TArray<FTransform>& Transforms, UInstancedStaticMeshComponent* InstancedStaticMeshComponent, bool bUpdateNavigation)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(ATerrainGenerator::SpawnInstancedMeshes);
+	LLM_SCOPE_BYTAG(RacingEngineer_Foliage);
+
 	if (InstancedStaticMeshComponent != nullptr)
 	{
-		TArray<FTransform> Transforms;
-		Transforms.Reserve(Locations.Num());
-
-		for (const FVector& Location : Locations)
-		{
-			float RandomScale = FMath::RandRange(0.5, 3.0);
-			float RandomYaw = FMath::RandRange(0, 360);
-			FTransform Transform(Location);
-
-			Transform.SetScale3D(FVector(RandomScale));
-			Transform.SetRotation(FRotator(0, RandomYaw, 0).Quaternion());
-
-			Transforms.Emplace(Transform);
-		}
-
-		InstancedStaticMeshComponent->AddInstances(Transforms, false, true);
-		Locations.Empty();
+		// Transforms are in map local space, same as the terrain mesh
+		InstancedStaticMeshComponent->AddInstances(Transforms, false, false);
+		Transforms.Empty();
 	}
 	else
 	{
@@ -315,123 +503,22 @@ void ATerrainGenerator::SpawnInstancedMeshes(TArray<FVector>& Locations, UInstan
 	}
 }
 
-TArray<FVector> ATerrainGenerator::CalculateVertices(const uint32 Width, const uint32 Height, const FVector& VertScale) const
-{
-	TArray<FVector> Verts;
-	const uint64 VertCount = Width * Height;
-	Verts.Reserve(VertCount);
-
-	TVector LocalPosition = GetTransform().GetLocation();
-
-	LocalPosition -= FVector(Width / 2.0 * VertScale.X, Height/ 2.0 * VertScale.Y, 0.0);
-
-	for (uint32 y = 0; y < Height; y++)
-	{
-		for (uint32 x = 0; x < Width; x++)
-		{
-			Verts.Emplace
-			(
-			x * VertScale.X + LocalPosition.X,
-			y * VertScale.Y + LocalPosition.Y,
-				LocalPosition.Z
-			);
-		}
-	}
-
-	return Verts;
-}
-
 TArray<FVector2D> ATerrainGenerator::CalculateUVs(const uint32 Width, const uint32 Height)
 {
-	TArray<FVector2D> UVs;
-	UVs.Reserve(Width * Height);
-	for (uint32 y = 0; y < Height; y++)
-	{
-		for (uint32 x = 0; x < Width; x++)
-		{
-			UVs.Emplace(x / (Width - 1.0), y / (Height - 1.0));
-		}
-	}
-	return UVs;
+	return FTerrainGrid::CalculateUVs(Width, Height);
 }
 
 TArray<int32> ATerrainGenerator::CalculateTriangles(const uint32 Width, const uint32 Height)
 {
-	const uint32 TriangleNodesCount = (Width - 1) * (Height - 1) * 2 * 3;
-	TArray<int32> TriangleNodes;
-	TriangleNodes.Reserve(TriangleNodesCount);
-
-	for (uint32 y = 0; y < Height - 1; y++)
-	{
-		for (uint32 x = 0; x < Width - 1; x++)
-		{
-			TriangleNodes.Emplace(x + y * Width);
-			TriangleNodes.Emplace(x + (y + 1) * Width);
-			TriangleNodes.Emplace(x + 1 + y * Width);
-
-			TriangleNodes.Emplace(x + 1 + y * Width);
-			TriangleNodes.Emplace(x + (y + 1) * Width);
-			TriangleNodes.Emplace(x + 1 + (y + 1) * Width);
-		}
-	}
-
-	return TriangleNodes;
+	return FTerrainGrid::CalculateTriangles(Width, Height);
 }
 
-FORCEINLINE void NormalizeVector(FVector& v)
+FVector3f ATerrainGenerator::GetNormal(const FVector3f& V0, const FVector3f& V1, const FVector3f& V2)
 {
-	if (!v.Normalize())
-	{
-		UE_LOG(LogTemp, Error, TEXT("Failed to Normalize %s"), *v.ToString());
-	}
+	return FTerrainGrid::GetNormal(V0, V1, V2);
 }
 
-FVector ATerrainGenerator::GetNormal(const FVector& V0, const FVector& V1, const FVector& V2)
+TArray<FOctahedralNormal> ATerrainGenerator::CalculateNormals(const TArray<FVector3f>& Verts, const TArray<int32>& Triangles, const uint32 Width, const uint32 Height)
 {
-	const FVector Edge1 = V1 - V0;
-	const FVector Edge2 = V2 - V0;
-
-	FVector crossVector = FVector::CrossProduct(Edge2, Edge1);
-
-	NormalizeVector(crossVector);
-
-	return crossVector;
+	return FTerrainGrid::CalculateNormals(Verts, Triangles, Width, Height);
 }
-
-TArray<FVector> ATerrainGenerator::CalculateNormals(const TArray<FVector>& Verts, const TArray<int32>& Triangles, const uint32 Width, const uint32 Height)
-{
-	const uint32 NormalCount = Width * Height;
-	const uint32 TriangleIndicesCount = (Width - 1) * (Height - 1) * 2 * 3;
-
-	check(Verts.Num() == NormalCount)
-	check(Triangles.Num() == TriangleIndicesCount)
-
-	TArray<FVector> Normals;
-	Normals.Empty(NormalCount);
-	Normals.AddZeroed(NormalCount);
-
-	for (uint32 i = 0; i < TriangleIndicesCount; i += 3)
-	{
-		const uint32 I0 = Triangles[i];
-		const uint32 I1 = Triangles[i + 1];
-		const uint32 I2 = Triangles[i + 2];
-		
-		FVector Normal = GetNormal
-		(
-			Verts[I0],
-			Verts[I1],
-			Verts[I2]
-		);
-
-		Normals[I0] += Normal;
-		Normals[I1] += Normal;
-		Normals[I2] += Normal;
-	}
-
-	for (size_t i = 0; i < NormalCount; i++)
-	{
-		NormalizeVector(Normals[i]);
-	}
-
-	return Normals;
-}
\ No newline at end of file
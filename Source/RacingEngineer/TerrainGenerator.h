@@ -11,8 +11,9 @@ class UHierarchicalInstancedStaticMeshComponent;
 class UFoliageInstancedStaticMeshComponent;
 class ATrackGenerator;
 class USplineComponent;
-struct FProcMeshTangent;
-class UProceduralMeshComponent;
+class UTerrainMeshComponent;
+class UTerrainTileStreamingComponent;
+class ALandscape;
 
 UENUM()
 enum class EColorChannel : uint8
@@ -59,29 +60,23 @@ public:
 	UFUNCTION()
 	static TArray<int32> CalculateTriangles(const uint32 Width, const uint32 Height);
 
-	UFUNCTION()
-	static FVector GetNormal(const FVector& V0, const FVector& V1, const FVector& V2);
+	static FVector3f GetNormal(const FVector3f& V0, const FVector3f& V1, const FVector3f& V2);
 
-	UFUNCTION()
-	static TArray<FVector> CalculateNormals(const TArray<FVector>& Verts, const TArray<int32>& Triangles, const uint32 Width, const uint32 Height);
+	static TArray<FOctahedralNormal> CalculateNormals(const TArray<FVector3f>& Verts, const TArray<int32>& Triangles, const uint32 Width, const uint32 Height);
 
 	UFUNCTION()
 	static TArray<FVector2D> CalculateUVs(const uint32 Width, const uint32 Height);
 
 	ATerrainGenerator();
 
-	UFUNCTION()
-	TArray<FVector> CalculateVertices(const uint32 Width, const uint32 Height, const FVector& VertScale) const;
-	UFUNCTION()
-	void AlterVerticesHeight(TArray<FVector>& outVertices, const FWorkerData& Data);
-
 	void SetupWalls(const uint32 TextureWidth, const uint32 TextureHeight, const FVector& VertScale);
 
 	virtual void DoWork(const FWorkerData& Data, const FOnWorkFinished Callback) override;
+	virtual void ResetWork() override;
+	virtual void GatherBuildSettings(FMapBuildSettings& OutSettings) const override;
+	virtual FWorkerMemoryUsage GetRetainedMemory() const override;
 
-	void TryAddFoliageLocation(const FVector& LocationToSpawn);
-
-	void SpawnInstancedMeshes(TArray<FVector>& Locations, UInstancedStaticMeshComponent* InstancedStaticMeshComponent, bool bUpdateNavigation);
+	void SpawnInstancedMeshes(TArray<FTransform>& Transforms, UInstancedStaticMeshComponent* InstancedStaticMeshComponent, bool bUpdateNavigation);
 
 protected:
 	// Called when the game starts or when spawned
@@ -93,28 +88,70 @@ public:
 
 private:
 
-	UFUNCTION()
 	void CreateTerrain(const FWorkerData& Data);
 
+	// The component holds the mesh from then on, so it is freed with the component's reference
+	void ReleaseMeshBuffers();
+
+	// Worker thread, normals of UKismetProceduralMeshLibrary::CalculateTangentsForMesh instead of the build's own
+	static TSharedRef<const FTerrainMeshData> MakeBuiltInNormalsMesh(const FTerrainMeshData& MeshData);
+
+	// Worker thread, resamples the vertex heights onto the landscape grid and quantizes them
+	void PrepareLandscape(const FMapBuildData& BuildData, const FTerrainMeshData& MeshData);
+
+	// Game thread, spawns the landscape and imports the prepared heights
+	void CreateLandscape(const FWorkerData& Data);
+	void DestroyLandscape();
+
 	UPROPERTY(VisibleAnywhere)
-	UProceduralMeshComponent* ProceduralMesh;
+	UTerrainMeshComponent* TerrainMesh;
 
+	// Builds the terrain in tiles around the player instead of one mesh, also enabled with -StreamTerrain
 	UPROPERTY(EditAnywhere)
-	bool UseBuiltInNormalsAndTangents = false;
+	bool bStreamTerrain = false;
+
+	// Builds the terrain this many rows at a time out of core for very large images, streams it too, also set with -BandRows=<rows>
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "0"))
+	int32 BandRows = 0;
+
+	// Hydraulic and thermal erosion passes over the noise heights before the terrain is built, also set with -ErosionIterations=<count>
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "0"))
+	int32 ErosionIterations = 0;
 
+	UPROPERTY(VisibleAnywhere)
+	UTerrainTileStreamingComponent* TerrainStreaming;
+
+	// Imports the terrain as an ALandscape for its LOD, heightfield collision and per component culling, also enabled with -LandscapeTerrain.
+	// Landscapes can only import in editor builds, packaged games keep the terrain mesh
 	UPROPERTY(EditAnywhere)
-	UMaterialInterface* MeshMaterial;
+	bool bLandscapeTerrain = false;
+
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "1"))
+	int32 MaxLandscapeComponents = 1024;
 
+	// Falls back to MeshMaterial
 	UPROPERTY(EditAnywhere)
-	EColorChannel TextureChannel = EColorChannel::Red;
+	UMaterialInterface* LandscapeMaterial = nullptr;
+
+	UPROPERTY(VisibleAnywhere)
+	TObjectPtr<ALandscape> Landscape;
 
-	TArray<FVector> Vertices;
+	FLandscapeLayout LandscapeLayout;
+	TArray<uint16> LandscapeHeights;
+	FVector LandscapeScale = FVector::OneVector;
 
-	TArray<int32> TriangleIndices;
+	UPROPERTY(EditAnywhere)
+	bool UseBuiltInNormalsAndTangents = false;
 
-	TArray<FVector2D> UV;
+	UPROPERTY(EditAnywhere)
+	UMaterialInterface* MeshMaterial;
+
+	UPROPERTY(EditAnywhere)
+	EColorChannel TextureChannel = EColorChannel::Red;
 
-	TArray<FVector> Normals;
+	// Handed over by the map manager, passed on to TerrainMesh as it is
+	TSharedPtr<const FTerrainMeshData> PendingTerrainMesh;
+	FBox3f PendingTerrainBounds = FBox3f(ForceInit);
 
 	UPROPERTY(EditAnywhere)
 	TWeakObjectPtr<ATrackGenerator> TrackGenerator;
@@ -132,18 +169,18 @@ private:
 	UFoliageInstancedStaticMeshComponent* GrassFoliageComponent;
 	UPROPERTY(EditAnywhere)
 	float GrassFoliageProbability = 0.0f;
-	TArray<FVector> GrassFoliageLocations;
+	TArray<FTransform> GrassFoliageTransforms;
 
 	UPROPERTY(EditAnywhere)
 	UHierarchicalInstancedStaticMeshComponent* RockInstancedStaticMeshComponent;
 	UPROPERTY(EditAnywhere)
 	float RocksProbability = 0.0f;
-	TArray<FVector> RocksLocations;
+	TArray<FTransform> RocksTransforms;
 
 	UPROPERTY(EditAnywhere)
 	UHierarchicalInstancedStaticMeshComponent* TreesInstancedStaticMeshComponent;
 	UPROPERTY(EditAnywhere)
 	float TreesProbability = 0.0f;
-	TArray<FVector> TreesLocations;
+	TArray<FTransform> TreesTransforms;
 
 };
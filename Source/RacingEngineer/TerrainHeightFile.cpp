@@ -0,0 +1,207 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainHeightFile.h"
+
+#include "Async/MappedFileHandle.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+
+namespace TerrainHeightFile
+{
+	const TCHAR* DirName = TEXT("MapBuildBands");
+
+	struct FHeader
+	{
+		uint32 Magic = 0;
+		uint32 Version = 0;
+		uint32 Width = 0;
+		uint32 Height = 0;
+	};
+}
+
+#pragma region TerrainHeightFile
+
+FTerrainHeightFile::~FTerrainHeightFile()
+{
+	// Unmapped before deleting, some platforms refuse to delete a mapped file
+	MappedRegion.Reset();
+	MappedFile.Reset();
+
+	if (!FilePath.IsEmpty())
+	{
+		FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*FilePath);
+	}
+}
+
+TSharedPtr<FTerrainHeightFile> FTerrainHeightFile::Open(const FString& FilePath)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTerrainHeightFile::Open);
+
+	TSharedPtr<FTerrainHeightFile> File = MakeShared<FTerrainHeightFile>();
+	File->FilePath = FilePath;
+
+	File->MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*FilePath));
+	if (!File->MappedFile.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("FTerrainHeightFile::Open Failed to map %s"), *FilePath);
+		return nullptr;
+	}
+
+	File->MappedRegion.Reset(File->MappedFile->MapRegion(0, File->MappedFile->GetFileSize()));
+	if (!File->MappedRegion.IsValid() || File->MappedRegion->GetMappedSize() < sizeof(TerrainHeightFile::FHeader))
+	{
+		UE_LOG(LogTemp, Error, TEXT("FTerrainHeightFile::Open Failed to map region of %s"), *FilePath);
+		return nullptr;
+	}
+
+	TerrainHeightFile::FHeader Header;
+	FMemory::Memcpy(&Header, File->MappedRegion->GetMappedPtr(), sizeof(Header));
+
+	const uint64 ExpectedSize = sizeof(Header) + static_cast<uint64>(Header.Width) * Header.Height * sizeof(float);
+	if (Header.Magic != FileMagic || Header.Version != FileVersion || File->MappedRegion->GetMappedSize() != ExpectedSize)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FTerrainHeightFile::Open %s is damaged"), *FilePath);
+		return nullptr;
+	}
+
+	File->Width = Header.Width;
+	File->Height = Header.Height;
+	File->Heights = reinterpret_cast<const float*>(File->MappedRegion->GetMappedPtr() + sizeof(Header));
+
+	return File;
+}
+
+void FTerrainHeightFile::DeleteOrphanedFiles()
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const FString DirPath = FPaths::Combine(FPaths::ProjectSavedDir(), TerrainHeightFile::DirName);
+
+	TArray<FString> FilePaths;
+	PlatformFile.FindFiles(FilePaths, *DirPath, TEXT("heights"));
+
+	int32 DeletedNum = 0;
+	for (const FString& OrphanPath : FilePaths)
+	{
+		// Files of other processes still running are in use, a name without a process id is from before they had one
+		FString ProcessIdString;
+		FString GuidString;
+		if (FPaths::GetBaseFilename(OrphanPath).Split(TEXT("-"), &ProcessIdString, &GuidString) && ProcessIdString.IsNumeric())
+		{
+			const uint32 ProcessId = FCString::Atoi(*ProcessIdString);
+			if (ProcessId == FPlatformProcess::GetCurrentProcessId() || FPlatformProcess::IsApplicationRunning(ProcessId))
+			{
+				continue;
+			}
+		}
+
+		if (PlatformFile.DeleteFile(*OrphanPath))
+		{
+			DeletedNum++;
+		}
+	}
+
+	if (DeletedNum > 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("FTerrainHeightFile::DeleteOrphanedFiles Deleted %d height files left behind"), DeletedNum);
+	}
+}
+
+#pragma endregion
+
+#pragma region TerrainHeightFileWriter
+
+FTerrainHeightFileWriter::~FTerrainHeightFileWriter()
+{
+	if (FileHandle.IsValid())
+	{
+		Abort();
+	}
+}
+
+bool FTerrainHeightFileWriter::Open(const uint32 InWidth, const uint32 InHeight)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	const FString DirPath = FPaths::Combine(FPaths::ProjectSavedDir(), TerrainHeightFile::DirName);
+	PlatformFile.CreateDirectoryTree(*DirPath);
+
+	FilePath = FPaths::Combine(DirPath, FString::Printf(TEXT("%u-%s.heights"), FPlatformProcess::GetCurrentProcessId(), *FGuid::NewGuid().ToString()));
+	Width = InWidth;
+	Height = InHeight;
+	RowsWritten = 0;
+	bFailed = false;
+
+	FileHandle.Reset(PlatformFile.OpenWrite(*FilePath));
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("FTerrainHeightFileWriter::Open Failed to create %s"), *FilePath);
+		return false;
+	}
+
+	TerrainHeightFile::FHeader Header;
+	Header.Magic = FTerrainHeightFile::FileMagic;
+	Header.Version = FTerrainHeightFile::FileVersion;
+	Header.Width = Width;
+	Header.Height = Height;
+
+	if (!FileHandle->Write(reinterpret_cast<const uint8*>(&Header), sizeof(Header)))
+	{
+		UE_LOG(LogTemp, Error, TEXT("FTerrainHeightFileWriter::Open Failed to write %s"), *FilePath);
+		Abort();
+		return false;
+	}
+
+	return true;
+}
+
+bool FTerrainHeightFileWriter::WriteRows(TConstArrayView<float> RowHeights)
+{
+	if (!FileHandle.IsValid() || bFailed)
+	{
+		return false;
+	}
+
+	check(Width > 0 && RowHeights.Num() % Width == 0);
+
+	if (!FileHandle->Write(reinterpret_cast<const uint8*>(RowHeights.GetData()), RowHeights.NumBytes()))
+	{
+		UE_LOG(LogTemp, Error, TEXT("FTerrainHeightFileWriter::WriteRows Failed to write %s"), *FilePath);
+		bFailed = true;
+		return false;
+	}
+
+	RowsWritten += RowHeights.Num() / Width;
+	return true;
+}
+
+TSharedPtr<FTerrainHeightFile> FTerrainHeightFileWriter::Finish()
+{
+	if (!FileHandle.IsValid())
+	{
+		return nullptr;
+	}
+
+	const bool bFlushed = FileHandle->Flush();
+	if (bFailed || !bFlushed || RowsWritten != Height)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FTerrainHeightFileWriter::Finish %s is incomplete, %u of %u rows"), *FilePath, RowsWritten, Height);
+		Abort();
+		return nullptr;
+	}
+
+	// Closed before mapping, the file isn't written again after this
+	FileHandle.Reset();
+
+	return FTerrainHeightFile::Open(FilePath);
+}
+
+void FTerrainHeightFileWriter::Abort()
+{
+	FileHandle.Reset();
+	FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*FilePath);
+}
+
+#pragma endregion
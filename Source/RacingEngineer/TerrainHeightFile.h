@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IFileHandle;
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/**
+ *  Terrain vertex heights of a banded map build, one float per texel, row major after a small header.
+ *  Written band by band while the map is built and memory mapped read only afterwards, so the heights never have to fit in memory at once.
+ *  The file is deleted when the last reader lets go of it.
+ */
+class RACINGENGINEER_API FTerrainHeightFile
+{
+public:
+	static constexpr uint32 FileMagic = 0x54484552;
+	static constexpr uint32 FileVersion = 1;
+
+	~FTerrainHeightFile();
+
+	// Maps a file written by FTerrainHeightFileWriter, which from then on belongs to this reader
+	static TSharedPtr<FTerrainHeightFile> Open(const FString& FilePath);
+
+	// Deletes the files of processes that ended without deleting theirs, run once at startup
+	static void DeleteOrphanedFiles();
+
+	uint32 GetWidth() const { return Width; }
+	uint32 GetHeight() const { return Height; }
+
+	float GetZ(const uint32 X, const uint32 Y) const { return Heights[static_cast<SIZE_T>(Y) * Width + X]; }
+
+	const FString& GetFilePath() const { return FilePath; }
+
+private:
+	FString FilePath;
+	uint32 Width = 0;
+	uint32 Height = 0;
+
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	const float* Heights = nullptr;
+};
+
+class RACINGENGINEER_API FTerrainHeightFileWriter
+{
+public:
+	~FTerrainHeightFileWriter();
+
+	// A new file under Saved/MapBuildBands, named uniquely so builds running at the same time don't share it.
+	// The name starts with the process id, which tells DeleteOrphanedFiles whose file it is
+	bool Open(const uint32 InWidth, const uint32 InHeight);
+
+	// Appends whole rows, bands have to be written top to bottom
+	bool WriteRows(TConstArrayView<float> RowHeights);
+
+	// Closes the file and maps it for reading, nullptr if anything failed on the way
+	TSharedPtr<FTerrainHeightFile> Finish();
+
+private:
+	void Abort();
+
+	FString FilePath;
+	uint32 Width = 0;
+	uint32 Height = 0;
+	uint32 RowsWritten = 0;
+
+	TUniquePtr<IFileHandle> FileHandle;
+	bool bFailed = false;
+};
@@ -0,0 +1,276 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainMeshComponent.h"
+
+#include "RacingEngineer.h"
+#include "Async/ParallelFor.h"
+#include "Engine/CollisionProfile.h"
+#include "LocalVertexFactory.h"
+#include "MaterialDomain.h"
+#include "Materials/Material.h"
+#include "Materials/MaterialRenderProxy.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "PrimitiveSceneProxy.h"
+#include "RawIndexBuffer.h"
+#include "Rendering/ColorVertexBuffer.h"
+#include "Rendering/PositionVertexBuffer.h"
+#include "Rendering/StaticMeshVertexBuffer.h"
+#include "SceneInterface.h"
+
+namespace TerrainMesh
+{
+	class FTerrainMeshSceneProxy final : public FPrimitiveSceneProxy
+	{
+	public:
+		FTerrainMeshSceneProxy(UTerrainMeshComponent* Component, const FTerrainMeshData& MeshData)
+			: FPrimitiveSceneProxy(Component)
+			, VertexFactory(GetScene().GetFeatureLevel(), "FTerrainMeshSceneProxy")
+			, MaterialRelevance(Component->GetMaterialRelevance(GetScene().GetFeatureLevel()))
+			, VerticesNum(MeshData.Vertices.Num())
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(FTerrainMeshSceneProxy::FTerrainMeshSceneProxy);
+			LLM_SCOPE_BYTAG(RacingEngineer_Terrain);
+
+			Material = Component->GetMaterial(0);
+			if (Material == nullptr)
+			{
+				Material = UMaterial::GetDefaultMaterial(MD_Surface);
+			}
+
+			// None of the buffers keeps a CPU copy once it has been uploaded, the component still has the compact mesh
+			PositionVertexBuffer.Init(MeshData.Vertices, false);
+
+			StaticMeshVertexBuffer.SetUseFullPrecisionUVs(false);
+			StaticMeshVertexBuffer.Init(VerticesNum, 1, false);
+
+			const uint32 Width = MeshData.Width;
+			const uint32 Height = MeshData.Height;
+
+			ParallelFor(Height, [&](int32 Y)
+				{
+					for (uint32 X = 0; X < Width; X++)
+					{
+						const uint32 Index = Y * Width + X;
+
+						// Same basis the procedural mesh built from its default tangent
+						const FVector3f TangentX = FVector3f::XAxisVector;
+						const FVector3f TangentZ = MeshData.Normals[Index].Unpack();
+
+						StaticMeshVertexBuffer.SetVertexTangents(Index, TangentX, TangentZ ^ TangentX, TangentZ);
+						StaticMeshVertexBuffer.SetVertexUV(Index, 0, FVector2f(X / (Width - 1.0f), Y / (Height - 1.0f)));
+					}
+				});
+
+			// Same bits as the int32 triangles, 16 bit indices are used when the map is small enough
+			TArray<uint32> Indices(reinterpret_cast<const uint32*>(MeshData.Triangles.GetData()), MeshData.Triangles.Num());
+			IndexBuffer.SetIndices(Indices, EIndexBufferStride::AutoDetect);
+
+			ENQUEUE_RENDER_COMMAND(InitTerrainMeshResources)(
+				[this](FRHICommandListImmediate& RHICmdList)
+				{
+					PositionVertexBuffer.InitResource(RHICmdList);
+					StaticMeshVertexBuffer.InitResource(RHICmdList);
+					IndexBuffer.InitResource(RHICmdList);
+
+					FLocalVertexFactory::FDataType Data;
+					PositionVertexBuffer.BindPositionVertexBuffer(&VertexFactory, Data);
+					StaticMeshVertexBuffer.BindTangentVertexBuffer(&VertexFactory, Data);
+					StaticMeshVertexBuffer.BindPackedTexCoordVertexBuffer(&VertexFactory, Data);
+					StaticMeshVertexBuffer.BindLightMapVertexBuffer(&VertexFactory, Data, 0);
+					FColorVertexBuffer::BindDefaultColorVertexBuffer(&VertexFactory, Data, FColorVertexBuffer::NullBindStride::ZeroForDefaultBufferBind);
+
+					VertexFactory.SetData(RHICmdList, Data);
+					VertexFactory.InitResource(RHICmdList);
+				});
+		}
+
+		virtual ~FTerrainMeshSceneProxy() override
+		{
+			PositionVertexBuffer.ReleaseResource();
+			StaticMeshVertexBuffer.ReleaseResource();
+			IndexBuffer.ReleaseResource();
+			VertexFactory.ReleaseResource();
+		}
+
+		virtual SIZE_T GetTypeHash() const override
+		{
+			static size_t UniquePointer;
+			return reinterpret_cast<size_t>(&UniquePointer);
+		}
+
+		// The terrain doesn't change while the proxy exists, a new mesh recreates the render state
+		virtual void DrawStaticElements(FStaticPrimitiveDrawInterface* PDI) override
+		{
+			FMeshBatch Mesh;
+			Mesh.VertexFactory = &VertexFactory;
+			Mesh.MaterialRenderProxy = Material->GetRenderProxy();
+			Mesh.ReverseCulling = IsLocalToWorldDeterminantNegative();
+			Mesh.Type = PT_TriangleList;
+			Mesh.DepthPriorityGroup = SDPG_World;
+			Mesh.LODIndex = 0;
+			Mesh.CastShadow = true;
+			Mesh.bCanApplyViewModeOverrides = true;
+
+			FMeshBatchElement& BatchElement = Mesh.Elements[0];
+			BatchElement.IndexBuffer = &IndexBuffer;
+			BatchElement.FirstIndex = 0;
+			BatchElement.NumPrimitives = IndexBuffer.GetNumIndices() / 3;
+			BatchElement.MinVertexIndex = 0;
+			BatchElement.MaxVertexIndex = VerticesNum - 1;
+
+			PDI->DrawMesh(Mesh, FLT_MAX);
+		}
+
+		virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) const override
+		{
+			FPrimitiveViewRelevance Result;
+			Result.bDrawRelevance = IsShown(View);
+			Result.bShadowRelevance = IsShadowCast(View);
+			Result.bStaticRelevance = true;
+			Result.bRenderInMainPass = ShouldRenderInMainPass();
+			Result.bUsesLightingChannels = GetLightingChannelMask() != GetDefaultLightingChannelMask();
+			Result.bRenderCustomDepth = ShouldRenderCustomDepth();
+			MaterialRelevance.SetPrimitiveViewRelevance(Result);
+			return Result;
+		}
+
+		virtual bool CanBeOccluded() const override
+		{
+			return !MaterialRelevance.bDisableDepthTest;
+		}
+
+		virtual uint32 GetMemoryFootprint() const override
+		{
+			return sizeof(*this) + GetAllocatedSize();
+		}
+
+	private:
+		UMaterialInterface* Material = nullptr;
+		FPositionVertexBuffer PositionVertexBuffer;
+		FStaticMeshVertexBuffer StaticMeshVertexBuffer;
+		FRawStaticIndexBuffer IndexBuffer;
+		FLocalVertexFactory VertexFactory;
+		FMaterialRelevance MaterialRelevance;
+		int32 VerticesNum = 0;
+	};
+}
+
+UTerrainMeshComponent::UTerrainMeshComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+}
+
+void UTerrainMeshComponent::SetTerrainMesh(const TSharedPtr<const FTerrainMeshData>& InMeshData, const FBox3f& InLocalBounds)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTerrainMeshComponent::SetTerrainMesh);
+	LLM_SCOPE_BYTAG(RacingEngineer_Terrain);
+
+	MeshData = InMeshData;
+	LocalBounds = FBox(InLocalBounds);
+
+	UpdateBounds();
+	UpdateCollision();
+	MarkRenderStateDirty();
+}
+
+void UTerrainMeshComponent::ClearTerrainMesh()
+{
+	if (!MeshData.IsValid())
+	{
+		return;
+	}
+
+	MeshData.Reset();
+	LocalBounds.Init();
+
+	UpdateBounds();
+	UpdateCollision();
+	MarkRenderStateDirty();
+}
+
+SIZE_T UTerrainMeshComponent::GetTerrainMeshSize() const
+{
+	return MeshData.IsValid() ? MeshData->GetAllocatedSize() : 0;
+}
+
+bool UTerrainMeshComponent::GetPhysicsTriMeshData(FTriMeshCollisionData* CollisionData, bool InUseAllTriData)
+{
+	if (!ContainsPhysicsTriMeshData(InUseAllTriData))
+	{
+		return false;
+	}
+
+	// The cooker takes float positions, so they are copied as they are
+	CollisionData->Vertices = MeshData->Vertices;
+
+	const TArray<int32>& Triangles = MeshData->Triangles;
+	CollisionData->Indices.SetNumUninitialized(Triangles.Num() / 3);
+
+	for (int32 TriangleIndex = 0; TriangleIndex < CollisionData->Indices.Num(); TriangleIndex++)
+	{
+		FTriIndices& Triangle = CollisionData->Indices[TriangleIndex];
+		Triangle.v0 = Triangles[TriangleIndex * 3];
+		Triangle.v1 = Triangles[TriangleIndex * 3 + 1];
+		Triangle.v2 = Triangles[TriangleIndex * 3 + 2];
+	}
+
+	// Same flags the procedural mesh cooked the terrain with
+	CollisionData->bFlipNormals = true;
+	CollisionData->bDeformableMesh = true;
+	CollisionData->bFastCook = true;
+
+	return true;
+}
+
+bool UTerrainMeshComponent::ContainsPhysicsTriMeshData(bool InUseAllTriData) const
+{
+	return MeshData.IsValid() && !MeshData->Vertices.IsEmpty() && !MeshData->Triangles.IsEmpty();
+}
+
+FPrimitiveSceneProxy* UTerrainMeshComponent::CreateSceneProxy()
+{
+	if (!MeshData.IsValid() || MeshData->Vertices.IsEmpty() || MeshData->Triangles.IsEmpty()
+		|| MeshData->Normals.Num() != MeshData->Vertices.Num())
+	{
+		return nullptr;
+	}
+
+	return new TerrainMesh::FTerrainMeshSceneProxy(this, *MeshData);
+}
+
+UBodySetup* UTerrainMeshComponent::GetBodySetup()
+{
+	return TerrainBodySetup;
+}
+
+FBoxSphereBounds UTerrainMeshComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	if (!LocalBounds.IsValid)
+	{
+		return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0.0);
+	}
+
+	return FBoxSphereBounds(LocalBounds).TransformBy(LocalToWorld);
+}
+
+void UTerrainMeshComponent::UpdateCollision()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTerrainMeshComponent::UpdateCollision);
+
+	if (TerrainBodySetup == nullptr)
+	{
+		TerrainBodySetup = NewObject<UBodySetup>(this, NAME_None, RF_Transient);
+		TerrainBodySetup->bGenerateMirroredCollision = false;
+		TerrainBodySetup->bDoubleSidedGeometry = true;
+		TerrainBodySetup->CollisionTraceFlag = CTF_UseComplexAsSimple;
+	}
+
+	TerrainBodySetup->BodySetupGuid = FGuid::NewGuid();
+	TerrainBodySetup->bHasCookedCollisionData = true;
+	TerrainBodySetup->InvalidatePhysicsData();
+	TerrainBodySetup->CreatePhysicsMeshes();
+
+	RecreatePhysicsState();
+}
@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/MeshComponent.h"
+#include "Interfaces/Interface_CollisionDataProvider.h"
+#include "MapBuildPipeline.h"
+#include "TerrainMeshComponent.generated.h"
+
+class UBodySetup;
+
+/**
+ *  Draws and collides with the whole map terrain straight from its compact build output.
+ *  Float positions go to the position buffer and the cooker as they are, the octahedral normals are
+ *  unpacked into the packed tangent basis and the UVs follow from the grid at half precision.
+ */
+UCLASS()
+class RACINGENGINEER_API UTerrainMeshComponent : public UMeshComponent, public IInterface_CollisionDataProvider
+{
+	GENERATED_BODY()
+
+public:
+	UTerrainMeshComponent(const FObjectInitializer& ObjectInitializer);
+
+	// Only a reference is kept, the mesh is shared with whoever built it and never modified
+	void SetTerrainMesh(const TSharedPtr<const FTerrainMeshData>& InMeshData, const FBox3f& InLocalBounds);
+	void ClearTerrainMesh();
+
+	SIZE_T GetTerrainMeshSize() const;
+
+	//~ Begin IInterface_CollisionDataProvider Interface
+	virtual bool GetPhysicsTriMeshData(FTriMeshCollisionData* CollisionData, bool InUseAllTriData) override;
+	virtual bool ContainsPhysicsTriMeshData(bool InUseAllTriData) const override;
+	virtual bool WantsNegXTriMesh() override { return false; }
+	//~ End IInterface_CollisionDataProvider Interface
+
+	//~ Begin UPrimitiveComponent Interface
+	virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
+	virtual UBodySetup* GetBodySetup() override;
+	//~ End UPrimitiveComponent Interface
+
+	//~ Begin UMeshComponent Interface
+	virtual int32 GetNumMaterials() const override { return 1; }
+	//~ End UMeshComponent Interface
+
+private:
+	//~ Begin USceneComponent Interface
+	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+	//~ End USceneComponent Interface
+
+	// Cooked right away, like the procedural mesh the terrain used before, the car is placed on it as soon as the workers finish
+	void UpdateCollision();
+
+	TSharedPtr<const FTerrainMeshData> MeshData;
+	FBox LocalBounds = FBox(ForceInit);
+
+	UPROPERTY(Transient)
+	TObjectPtr<UBodySetup> TerrainBodySetup;
+};
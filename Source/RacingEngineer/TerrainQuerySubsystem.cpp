@@ -0,0 +1,179 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainQuerySubsystem.h"
+
+#include "MapBuildPipeline.h"
+#include "TerrainHeightFile.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "Misc/ScopeRWLock.h"
+
+#pragma region TerrainHeightField
+
+TSharedPtr<const FTerrainHeightField> FTerrainHeightField::Build(const FMapBuildData& Data)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTerrainHeightField::Build);
+
+	const int32 Width = Data.Width;
+	const int32 Height = Data.Height;
+	const int32 TexelsNum = Width * Height;
+
+	const bool bHasVertices = Data.TerrainVertices.Num() == TexelsNum;
+	const bool bHasHeights = Data.Heights.Num() == TexelsNum && Data.TrackHeight.Num() == TexelsNum;
+
+	if (Width < 2 || Height < 2 || Data.TrackDistance.Num() != TexelsNum || (!bHasVertices && !bHasHeights))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("FTerrainHeightField::Build The build kept no terrain heights to query"));
+		return nullptr;
+	}
+
+	TSharedRef<FTerrainHeightField> HeightField = MakeShared<FTerrainHeightField>();
+	HeightField->Width = Width;
+	HeightField->Height = Height;
+	HeightField->VertScale = Data.Settings.VertScale;
+	HeightField->Heights.SetNumUninitialized(TexelsNum);
+	HeightField->TrackTexels.Init(false, TexelsNum);
+
+	// Streamed terrain has no vertices left, they are the same ones its tiles compute
+	ParallelFor(Height, [&](int32 Y)
+		{
+			for (int32 X = 0; X < Width; X++)
+			{
+				const int32 Index = Y * Width + X;
+				HeightField->Heights[Index] = bHasVertices
+					? Data.TerrainVertices[Index].Z
+					: FMapBuildPipeline::CalculateTerrainVertex(Data.Heights, Data.ErodedHeights, Data.TrackDistance, Data.TrackHeight, X, Y, Width, Height, Data.Settings).Z;
+			}
+		});
+
+	// Bits share words, so they are set on one thread
+	const float TrackHalfWidth = 0.5f * Data.Settings.TrackWidth;
+	for (int32 Index = 0; Index < TexelsNum; Index++)
+	{
+		if (Data.TrackDistance[Index] <= TrackHalfWidth)
+		{
+			HeightField->TrackTexels[Index] = true;
+		}
+	}
+
+	return HeightField;
+}
+
+TSharedPtr<const FTerrainHeightField> FTerrainHeightField::Build(const FMapBuildData& Data, const TSharedPtr<const FTerrainHeightFile>& HeightFile,
+	TBitArray<>&& TrackTexels)
+{
+	if (!HeightFile.IsValid() || HeightFile->GetWidth() != Data.Width || HeightFile->GetHeight() != Data.Height
+		|| TrackTexels.Num() != static_cast<int32>(Data.Width * Data.Height) || Data.Width < 2 || Data.Height < 2)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("FTerrainHeightField::Build The banded build kept no terrain heights to query"));
+		return nullptr;
+	}
+
+	TSharedRef<FTerrainHeightField> HeightField = MakeShared<FTerrainHeightField>();
+	HeightField->Width = Data.Width;
+	HeightField->Height = Data.Height;
+	HeightField->VertScale = Data.Settings.VertScale;
+	HeightField->HeightFile = HeightFile;
+	HeightField->TrackTexels = MoveTemp(TrackTexels);
+
+	return HeightField;
+}
+
+float FTerrainHeightField::GetZ(const uint32 X, const uint32 Y) const
+{
+	return HeightFile.IsValid() ? HeightFile->GetZ(X, Y) : Heights[Y * Width + X];
+}
+
+bool FTerrainHeightField::Sample(const FVector2D& MapLocation, FTerrainSample& OutSample) const
+{
+	// Inverse of FMapBuildPipeline::GetTexelLocation
+	const double TexelX = MapLocation.X / VertScale.X + Width / 2.0;
+	const double TexelY = MapLocation.Y / VertScale.Y + Height / 2.0;
+
+	if (TexelX < 0.0 || TexelY < 0.0 || TexelX > Width - 1.0 || TexelY > Height - 1.0)
+	{
+		return false;
+	}
+
+	const uint32 X0 = FMath::Min(static_cast<uint32>(TexelX), Width - 2);
+	const uint32 Y0 = FMath::Min(static_cast<uint32>(TexelY), Height - 2);
+	const float AlphaX = TexelX - X0;
+	const float AlphaY = TexelY - Y0;
+
+	const float Z00 = GetZ(X0, Y0);
+	const float Z10 = GetZ(X0 + 1, Y0);
+	const float Z01 = GetZ(X0, Y0 + 1);
+	const float Z11 = GetZ(X0 + 1, Y0 + 1);
+
+	OutSample.Location = FVector(MapLocation, FMath::BiLerp(Z00, Z10, Z01, Z11, AlphaX, AlphaY));
+
+	// Gradient of the same bilinear patch, so the normal matches the sampled height
+	const double SlopeX = FMath::Lerp(Z10 - Z00, Z11 - Z01, AlphaY) / VertScale.X;
+	const double SlopeY = FMath::Lerp(Z01 - Z00, Z11 - Z10, AlphaX) / VertScale.Y;
+	OutSample.Normal = FVector(-SlopeX, -SlopeY, 1.0).GetSafeNormal(UE_SMALL_NUMBER, FVector::UpVector);
+
+	const uint32 NearestX = FMath::Min(static_cast<uint32>(FMath::RoundToInt32(TexelX)), Width - 1);
+	const uint32 NearestY = FMath::Min(static_cast<uint32>(FMath::RoundToInt32(TexelY)), Height - 1);
+	OutSample.Surface = IsTrack(NearestX, NearestY) ? ETerrainSurface::Track : ETerrainSurface::Terrain;
+
+	return true;
+}
+
+#pragma endregion
+
+bool UTerrainQuerySubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World != nullptr && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UTerrainQuerySubsystem::Deinitialize()
+{
+	SetHeightField(nullptr, FTransform::Identity);
+
+	Super::Deinitialize();
+}
+
+void UTerrainQuerySubsystem::SetHeightField(const TSharedPtr<const FTerrainHeightField>& InHeightField, const FTransform& InMapTransform)
+{
+	FWriteScopeLock WriteLock(Lock);
+	HeightField = InHeightField;
+	MapTransform = InMapTransform;
+}
+
+bool UTerrainQuerySubsystem::QueryTerrain(const FVector& WorldLocation, FTerrainSample& OutSample) const
+{
+	TSharedPtr<const FTerrainHeightField> QueriedHeightField;
+	FTransform QueriedMapTransform;
+	{
+		FReadScopeLock ReadLock(Lock);
+		QueriedHeightField = HeightField;
+		QueriedMapTransform = MapTransform;
+	}
+
+	if (!QueriedHeightField.IsValid())
+	{
+		return false;
+	}
+
+	const FVector MapLocation = QueriedMapTransform.InverseTransformPosition(WorldLocation);
+	if (!QueriedHeightField->Sample(FVector2D(MapLocation), OutSample))
+	{
+		return false;
+	}
+
+	OutSample.Location = QueriedMapTransform.TransformPosition(OutSample.Location);
+
+	// Normals take the inverse transpose, for a scale and a rotation that is the normal divided by the scale, then rotated
+	const FVector MapNormal = OutSample.Normal * FTransform::GetSafeScaleReciprocal(QueriedMapTransform.GetScale3D());
+	OutSample.Normal = QueriedMapTransform.TransformVectorNoScale(MapNormal).GetSafeNormal(UE_SMALL_NUMBER, FVector::UpVector);
+
+	return true;
+}
+
+bool UTerrainQuerySubsystem::HasHeightField() const
+{
+	FReadScopeLock ReadLock(Lock);
+	return HeightField.IsValid();
+}
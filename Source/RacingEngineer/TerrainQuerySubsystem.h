@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TerrainQuerySubsystem.generated.h"
+
+struct FMapBuildData;
+class FTerrainHeightFile;
+
+UENUM(BlueprintType)
+enum class ETerrainSurface : uint8
+{
+	None,
+	Terrain,
+	Track
+};
+
+USTRUCT(BlueprintType)
+struct FTerrainSample
+{
+	GENERATED_BODY()
+
+	// On the ground, only XY of the queried location is used
+	UPROPERTY(BlueprintReadOnly, Category = "Terrain Query")
+	FVector Location = FVector::ZeroVector;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Terrain Query")
+	FVector Normal = FVector::UpVector;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Terrain Query")
+	ETerrainSurface Surface = ETerrainSurface::None;
+};
+
+/**
+ *  Final terrain heights of a map build, after the track was pressed into it, with one bit per texel telling track from terrain.
+ *  Never changed once built, so any number of threads can sample it at the same time.
+ */
+class RACINGENGINEER_API FTerrainHeightField
+{
+public:
+	// From the whole map vertices, or the heights and distance field of streamed terrain
+	static TSharedPtr<const FTerrainHeightField> Build(const FMapBuildData& Data);
+
+	// Banded builds keep the heights in their file, the track texels are gathered band by band
+	static TSharedPtr<const FTerrainHeightField> Build(const FMapBuildData& Data, const TSharedPtr<const FTerrainHeightFile>& HeightFile,
+		TBitArray<>&& TrackTexels);
+
+	// Map local XY, bilinear over the four surrounding texels. False outside the map
+	bool Sample(const FVector2D& MapLocation, FTerrainSample& OutSample) const;
+
+	uint32 GetWidth() const { return Width; }
+	uint32 GetHeight() const { return Height; }
+
+	float GetZ(const uint32 X, const uint32 Y) const;
+	bool IsTrack(const uint32 X, const uint32 Y) const { return TrackTexels[Y * Width + X]; }
+
+	SIZE_T GetAllocatedSize() const { return Heights.GetAllocatedSize() + TrackTexels.GetAllocatedSize(); }
+
+private:
+	uint32 Width = 0;
+	uint32 Height = 0;
+	FVector VertScale = FVector::OneVector;
+
+	// One of the two is set
+	TArray<float> Heights;
+	TSharedPtr<const FTerrainHeightFile> HeightFile;
+
+	TBitArray<> TrackTexels;
+};
+
+/**
+ *  Ground height, normal and surface type anywhere on the map without a physics trace.
+ *  Every query is a few texel reads. Safe on any thread, the height field of the current map is swapped in under a lock
+ *  and queries hold on to the one they started with.
+ */
+UCLASS()
+class RACINGENGINEER_API UTerrainQuerySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+
+	// Game thread, called by the map manager for every built map. InMapTransform is the one of the terrain, which the heights are local to
+	void SetHeightField(const TSharedPtr<const FTerrainHeightField>& InHeightField, const FTransform& InMapTransform);
+
+	// World space, false when there is no map or the location is outside of it
+	UFUNCTION(BlueprintCallable, Category = "Terrain Query")
+	bool QueryTerrain(const FVector& WorldLocation, FTerrainSample& OutSample) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Terrain Query")
+	bool HasHeightField() const;
+
+private:
+	mutable FRWLock Lock;
+
+	TSharedPtr<const FTerrainHeightField> HeightField;
+	FTransform MapTransform;
+};
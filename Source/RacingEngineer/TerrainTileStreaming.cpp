@@ -0,0 +1,459 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainTileStreaming.h"
+
+#include "RacingEngineer.h"
+#include "ProceduralMeshComponent.h"
+#include "TerrainGrid.h"
+#include "Kismet/GameplayStatics.h"
+
+namespace TerrainTileStreaming
+{
+	// Proxies hang a skirt below their edges, which hides the gaps to tiles of another resolution
+	constexpr float SkirtDepthScale = 0.05f;
+}
+
+#pragma region TerrainTileSource
+
+FIntPoint FTerrainTileSource::GetTilesNum() const
+{
+	return FIntPoint(
+		FMath::DivideAndRoundUp(static_cast<int32>(Width) - 1, TileTexels),
+		FMath::DivideAndRoundUp(static_cast<int32>(Height) - 1, TileTexels));
+}
+
+FIntPoint FTerrainTileSource::GetTileAt(const FVector& MapLocation) const
+{
+	// Inverse of FMapBuildPipeline::GetTexelLocation
+	const double X = MapLocation.X / Settings.VertScale.X + Width / 2.0;
+	const double Y = MapLocation.Y / Settings.VertScale.Y + Height / 2.0;
+
+	const FIntPoint TilesNum = GetTilesNum();
+
+	return FIntPoint(
+		FMath::Clamp(FMath::FloorToInt32(X / TileTexels), 0, TilesNum.X - 1),
+		FMath::Clamp(FMath::FloorToInt32(Y / TileTexels), 0, TilesNum.Y - 1));
+}
+
+bool FTerrainTileSource::IsValid() const
+{
+	const int32 TexelsNum = Width * Height;
+
+	if (HeightFile.IsValid())
+	{
+		return HeightFile->GetWidth() == Width && HeightFile->GetHeight() == Height;
+	}
+
+	return Heights.Num() == TexelsNum && (ErodedHeights.IsEmpty() || ErodedHeights.Num() == TexelsNum)
+		&& TrackDistance.Num() == TexelsNum && TrackHeight.Num() == TexelsNum;
+}
+
+FVector3f FTerrainTileSource::GetVertex(const uint32 X, const uint32 Y) const
+{
+	if (HeightFile.IsValid())
+	{
+		const FVector Location = FMapBuildPipeline::GetTexelLocation(X, Y, Width, Height, Settings.VertScale);
+		return FVector3f(Location.X, Location.Y, HeightFile->GetZ(X, Y));
+	}
+
+	return FMapBuildPipeline::CalculateTerrainVertex(Heights, ErodedHeights, TrackDistance, TrackHeight, X, Y, Width, Height, Settings);
+}
+
+SIZE_T FTerrainTileSource::GetAllocatedSize() const
+{
+	return Heights.GetAllocatedSize() + ErodedHeights.GetAllocatedSize() + TrackDistance.GetAllocatedSize() + TrackHeight.GetAllocatedSize();
+}
+
+#pragma endregion
+
+#pragma region TerrainTileMesh
+
+TSharedRef<FTerrainTileMesh> FTerrainTileMesh::Build(const FTerrainTileSource& Source, const FIntPoint& Tile, int32 Step)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTerrainTileMesh::Build);
+	LLM_SCOPE_BYTAG(RacingEngineer_Terrain);
+
+	TSharedRef<FTerrainTileMesh> TileMesh = MakeShared<FTerrainTileMesh>();
+	TileMesh->Tile = Tile;
+	TileMesh->Step = Step;
+
+	const int32 Width = Source.Width;
+	const int32 Height = Source.Height;
+
+	const int32 StartX = Tile.X * Source.TileTexels;
+	const int32 StartY = Tile.Y * Source.TileTexels;
+	const int32 EndX = FMath::Min(StartX + Source.TileTexels, Width - 1);
+	const int32 EndY = FMath::Min(StartY + Source.TileTexels, Height - 1);
+
+	// Every Step-th texel, the last row and column are always included so neighbouring tiles share their edges
+	TArray<int32, TInlineAllocator<256>> Columns;
+	TArray<int32, TInlineAllocator<256>> Rows;
+	for (int32 X = StartX; X < EndX; X += Step)
+	{
+		Columns.Add(X);
+	}
+	Columns.Add(EndX);
+	for (int32 Y = StartY; Y < EndY; Y += Step)
+	{
+		Rows.Add(Y);
+	}
+	Rows.Add(EndY);
+
+	auto GetVertex = [&Source, Width, Height](int32 X, int32 Y)
+	{
+		X = FMath::Clamp(X, 0, Width - 1);
+		Y = FMath::Clamp(Y, 0, Height - 1);
+
+		return Source.GetVertex(X, Y);
+	};
+
+	const int32 GridWidth = Columns.Num();
+	const int32 GridHeight = Rows.Num();
+
+	TileMesh->Vertices.Reserve(GridWidth * GridHeight);
+	TileMesh->Normals.Reserve(GridWidth * GridHeight);
+	TileMesh->UVs.Reserve(GridWidth * GridHeight);
+
+	for (const int32 Y : Rows)
+	{
+		for (const int32 X : Columns)
+		{
+			TileMesh->Vertices.Emplace(GetVertex(X, Y));
+			TileMesh->UVs.Emplace(X / (Width - 1.0), Y / (Height - 1.0));
+
+			// Central differences over the map, not the tile, so the shading matches across tile edges
+			const FVector3f AlongX = GetVertex(X + Step, Y) - GetVertex(X - Step, Y);
+			const FVector3f AlongY = GetVertex(X, Y + Step) - GetVertex(X, Y - Step);
+			TileMesh->Normals.Emplace(FVector3f::CrossProduct(AlongX, AlongY).GetSafeNormal(UE_SMALL_NUMBER, FVector3f::UpVector));
+		}
+	}
+
+	TileMesh->Triangles = FTerrainGrid::CalculateTriangles(GridWidth, GridHeight);
+
+	if (Step > 1)
+	{
+		const float SkirtDepth = Source.Settings.VertScale.Z * TerrainTileStreaming::SkirtDepthScale;
+
+		// Perimeter walked once around, each edge gets a quad down to the skirt, drawn from both sides
+		TArray<int32> Perimeter;
+		for (int32 X = 0; X < GridWidth; X++) { Perimeter.Add(X); }
+		for (int32 Y = 1; Y < GridHeight; Y++) { Perimeter.Add(Y * GridWidth + GridWidth - 1); }
+		for (int32 X = GridWidth - 2; X >= 0; X--) { Perimeter.Add((GridHeight - 1) * GridWidth + X); }
+		for (int32 Y = GridHeight - 2; Y >= 0; Y--) { Perimeter.Add(Y * GridWidth); }
+
+		const int32 SkirtStart = TileMesh->Vertices.Num();
+		TileMesh->Vertices.Reserve(SkirtStart + Perimeter.Num());
+		TileMesh->Normals.Reserve(SkirtStart + Perimeter.Num());
+		TileMesh->UVs.Reserve(SkirtStart + Perimeter.Num());
+
+		for (const int32 Index : Perimeter)
+		{
+			const FVector Vertex = TileMesh->Vertices[Index] - FVector(0.0, 0.0, SkirtDepth);
+			const FVector Normal = TileMesh->Normals[Index];
+			const FVector2D UV = TileMesh->UVs[Index];
+
+			TileMesh->Vertices.Add(Vertex);
+			TileMesh->Normals.Add(Normal);
+			TileMesh->UVs.Add(UV);
+		}
+
+		for (int32 Edge = 0; Edge + 1 < Perimeter.Num(); Edge++)
+		{
+			const int32 Top0 = Perimeter[Edge];
+			const int32 Top1 = Perimeter[Edge + 1];
+			const int32 Bottom0 = SkirtStart + Edge;
+			const int32 Bottom1 = SkirtStart + Edge + 1;
+
+			TileMesh->Triangles.Append({ Top0, Bottom0, Top1, Top1, Bottom0, Bottom1 });
+			TileMesh->Triangles.Append({ Top0, Top1, Bottom0, Top1, Bottom1, Bottom0 });
+		}
+	}
+
+	return TileMesh;
+}
+
+#pragma endregion
+
+UTerrainTileStreamingComponent::UTerrainTileStreamingComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+}
+
+void UTerrainTileStreamingComponent::PrepareStreaming(FMapBuildData& BuildData, const FVector& StartLocation)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTerrainTileStreamingComponent::PrepareStreaming);
+
+	TSharedRef<FTerrainTileSource> NewSource = MakeShared<FTerrainTileSource>();
+	NewSource->Settings = BuildData.Settings;
+	NewSource->Width = BuildData.Width;
+	NewSource->Height = BuildData.Height;
+	NewSource->TileTexels = FMath::Max(ProxyStep, TileTexels);
+
+	// The terrain is the only worker using these
+	NewSource->Heights = MoveTemp(BuildData.Heights);
+	NewSource->ErodedHeights = MoveTemp(BuildData.ErodedHeights);
+	NewSource->TrackDistance = MoveTemp(BuildData.TrackDistance);
+	NewSource->TrackHeight = MoveTemp(BuildData.TrackHeight);
+	NewSource->HeightFile = MoveTemp(BuildData.TerrainHeightFile);
+
+	PreparedTiles.Reset();
+
+	if (NewSource->Width < 2 || NewSource->Height < 2)
+	{
+		UE_LOG(LogTemp, Error, TEXT("UTerrainTileStreamingComponent::PrepareStreaming Map is too small for tiles"));
+		return;
+	}
+
+	if (!NewSource->IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("UTerrainTileStreamingComponent::PrepareStreaming The build has no terrain heights"));
+		return;
+	}
+
+	// Only the full resolution tiles around the start are built up front, everything else streams in
+	const FIntPoint StartTile = NewSource->GetTileAt(StartLocation);
+	const FIntPoint TilesNum = NewSource->GetTilesNum();
+
+	for (int32 Y = FMath::Max(0, StartTile.Y - NearTileRadius); Y <= FMath::Min(TilesNum.Y - 1, StartTile.Y + NearTileRadius); Y++)
+	{
+		for (int32 X = FMath::Max(0, StartTile.X - NearTileRadius); X <= FMath::Min(TilesNum.X - 1, StartTile.X + NearTileRadius); X++)
+		{
+			PreparedTiles.Add(FTerrainTileMesh::Build(*NewSource, FIntPoint(X, Y), 1));
+		}
+	}
+
+	Source = NewSource;
+}
+
+void UTerrainTileStreamingComponent::StartStreaming(UMaterialInterface* InMaterial)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTerrainTileStreamingComponent::StartStreaming);
+
+	Material = InMaterial;
+
+	for (const TSharedRef<FTerrainTileMesh>& TileMesh : PreparedTiles)
+	{
+		UploadTile(*TileMesh, true);
+	}
+	PreparedTiles.Empty();
+
+	bStreaming = Source.IsValid();
+	SetComponentTickEnabled(bStreaming);
+}
+
+void UTerrainTileStreamingComponent::StopStreaming()
+{
+	TArray<FIntPoint> Tiles;
+	ResidentTiles.GetKeys(Tiles);
+	for (const FIntPoint& Tile : Tiles)
+	{
+		ReleaseTile(Tile);
+	}
+
+	// The tasks hold their own reference to the source
+	PendingTiles.Empty();
+	PreparedTiles.Empty();
+	Source.Reset();
+
+	bStreaming = false;
+	SetComponentTickEnabled(false);
+}
+
+SIZE_T UTerrainTileStreamingComponent::GetSourceSize() const
+{
+	return Source.IsValid() ? Source->GetAllocatedSize() : 0;
+}
+
+SIZE_T UTerrainTileStreamingComponent::GetResidentMeshSize() const
+{
+	SIZE_T Size = 0;
+
+	for (const TPair<FIntPoint, FResidentTile>& ResidentTile : ResidentTiles)
+	{
+		const FProcMeshSection* Section = ResidentTile.Value.Mesh->GetProcMeshSection(0);
+		if (Section != nullptr)
+		{
+			Size += Section->ProcVertexBuffer.GetAllocatedSize() + Section->ProcIndexBuffer.GetAllocatedSize();
+		}
+	}
+
+	return Size;
+}
+
+void UTerrainTileStreamingComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	StopStreaming();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UTerrainTileStreamingComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTerrainTileStreamingComponent::TickComponent);
+	LLM_SCOPE_BYTAG(RacingEngineer_Terrain);
+
+	const APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(this, 0);
+	if (!bStreaming || PlayerPawn == nullptr)
+	{
+		return;
+	}
+
+	// Finished builds are uploaded first, a build of a resolution that is no longer wanted is dropped
+	const FIntPoint CentreTile = Source->GetTileAt(GetOwner()->GetActorTransform().InverseTransformPosition(PlayerPawn->GetActorLocation()));
+
+	for (auto It = PendingTiles.CreateIterator(); It; ++It)
+	{
+		if (It->Value.Task.IsCompleted())
+		{
+			if (GetWantedStep(It->Key, CentreTile) == It->Value.Step)
+			{
+				UploadTile(It->Value.Task.GetResult().Get());
+			}
+			It.RemoveCurrent();
+		}
+	}
+
+	// Closest tiles first, so the one under the player is never waiting behind the horizon
+	const FIntPoint TilesNum = Source->GetTilesNum();
+	TArray<FIntPoint, TInlineAllocator<256>> MissingTiles;
+
+	for (int32 Y = FMath::Max(0, CentreTile.Y - FarTileRadius); Y <= FMath::Min(TilesNum.Y - 1, CentreTile.Y + FarTileRadius); Y++)
+	{
+		for (int32 X = FMath::Max(0, CentreTile.X - FarTileRadius); X <= FMath::Min(TilesNum.X - 1, CentreTile.X + FarTileRadius); X++)
+		{
+			const FIntPoint Tile(X, Y);
+			const int32 WantedStep = GetWantedStep(Tile, CentreTile);
+
+			FResidentTile* ResidentTile = ResidentTiles.Find(Tile);
+			if (ResidentTile != nullptr)
+			{
+				// A tile of the wrong resolution stays visible until its replacement is uploaded
+				ResidentTile->LastWantedFrame = GFrameCounter;
+				if (ResidentTile->Step == WantedStep)
+				{
+					continue;
+				}
+			}
+
+			const FPendingTile* PendingTile = PendingTiles.Find(Tile);
+			if (PendingTile == nullptr || PendingTile->Step != WantedStep)
+			{
+				MissingTiles.Add(Tile);
+			}
+		}
+	}
+
+	MissingTiles.Sort([&CentreTile](const FIntPoint& A, const FIntPoint& B)
+		{
+			return (A - CentreTile).SizeSquared() < (B - CentreTile).SizeSquared();
+		});
+
+	for (const FIntPoint& Tile : MissingTiles)
+	{
+		if (PendingTiles.Num() >= MaxTileBuildsInFlight)
+		{
+			break;
+		}
+
+		LaunchTileBuild(Tile, GetWantedStep(Tile, CentreTile));
+	}
+}
+
+int32 UTerrainTileStreamingComponent::GetWantedStep(const FIntPoint& Tile, const FIntPoint& CentreTile) const
+{
+	const int32 Distance = FMath::Max(FMath::Abs(Tile.X - CentreTile.X), FMath::Abs(Tile.Y - CentreTile.Y));
+	return Distance <= NearTileRadius ? 1 : FMath::Max(1, ProxyStep);
+}
+
+void UTerrainTileStreamingComponent::LaunchTileBuild(const FIntPoint& Tile, int32 Step)
+{
+	FPendingTile& PendingTile = PendingTiles.Add(Tile);
+	PendingTile.Step = Step;
+	PendingTile.Task = UE::Tasks::Launch(UE_SOURCE_LOCATION, [TileSource = Source.ToSharedRef(), Tile, Step]
+		{
+			return FTerrainTileMesh::Build(*TileSource, Tile, Step);
+		});
+}
+
+void UTerrainTileStreamingComponent::UploadTile(const FTerrainTileMesh& TileMesh, const bool bCookCollisionNow)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTerrainTileStreamingComponent::UploadTile);
+
+	FResidentTile* ResidentTile = ResidentTiles.Find(TileMesh.Tile);
+	UProceduralMeshComponent* Mesh = ResidentTile != nullptr ? ResidentTile->Mesh : AcquireMesh();
+	if (Mesh == nullptr)
+	{
+		return;
+	}
+
+	// Only the full resolution tiles around the player are driven on
+	const bool bCreateCollision = TileMesh.Step == 1;
+
+	// Async cooking leaves a tile without collision for a few frames, the tiles the player starts on can't wait for it
+	Mesh->bUseAsyncCooking = !bCookCollisionNow;
+
+	Mesh->CreateMeshSection(0, TileMesh.Vertices, TileMesh.Triangles, TileMesh.Normals, TileMesh.UVs,
+		TArray<FColor>(), TArray<FProcMeshTangent>(), bCreateCollision);
+	Mesh->SetMaterial(0, Material);
+	Mesh->SetVisibility(true);
+
+	FResidentTile& Tile = ResidentTiles.FindOrAdd(TileMesh.Tile);
+	Tile.Mesh = Mesh;
+	Tile.Step = TileMesh.Step;
+	Tile.LastWantedFrame = GFrameCounter;
+}
+
+UProceduralMeshComponent* UTerrainTileStreamingComponent::AcquireMesh()
+{
+	if (FreeMeshes.IsEmpty() && MeshPool.Num() >= MaxResidentTiles)
+	{
+		const FIntPoint* OldestTile = nullptr;
+		uint64 OldestFrame = GFrameCounter;
+
+		for (const TPair<FIntPoint, FResidentTile>& ResidentTile : ResidentTiles)
+		{
+			if (ResidentTile.Value.LastWantedFrame < OldestFrame)
+			{
+				OldestFrame = ResidentTile.Value.LastWantedFrame;
+				OldestTile = &ResidentTile.Key;
+			}
+		}
+
+		// Every resident tile is still wanted, the budget is too small for the radii
+		if (OldestTile == nullptr)
+		{
+			return nullptr;
+		}
+
+		ReleaseTile(*OldestTile);
+	}
+
+	if (!FreeMeshes.IsEmpty())
+	{
+		return FreeMeshes.Pop(false);
+	}
+
+	UProceduralMeshComponent* Mesh = NewObject<UProceduralMeshComponent>(GetOwner());
+	Mesh->bUseAsyncCooking = true;
+	Mesh->SetupAttachment(GetOwner()->GetRootComponent());
+	Mesh->RegisterComponent();
+
+	MeshPool.Add(Mesh);
+
+	return Mesh;
+}
+
+void UTerrainTileStreamingComponent::ReleaseTile(const FIntPoint& Tile)
+{
+	FResidentTile ResidentTile;
+	if (ResidentTiles.RemoveAndCopyValue(Tile, ResidentTile))
+	{
+		ResidentTile.Mesh->ClearAllMeshSections();
+		ResidentTile.Mesh->SetVisibility(false);
+		FreeMeshes.Add(ResidentTile.Mesh);
+	}
+}
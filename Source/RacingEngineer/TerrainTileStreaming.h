@@ -0,0 +1,157 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "MapBuildPipeline.h"
+#include "TerrainHeightFile.h"
+#include "Tasks/Task.h"
+#include "TerrainTileStreaming.generated.h"
+
+class UMaterialInterface;
+class UProceduralMeshComponent;
+
+/**
+ *  Everything a terrain tile is built from, taken over from the map build and shared read only with the tile build tasks.
+ *  Per texel that is the height and the track distance field, a fraction of the whole map mesh.
+ */
+struct FTerrainTileSource
+{
+	FMapBuildSettings Settings;
+	uint32 Width = 0;
+	uint32 Height = 0;
+
+	TArray<uint8> Heights;
+	TArray<float> ErodedHeights;
+	TArray<float> TrackDistance;
+	TArray<float> TrackHeight;
+
+	// Banded builds hand over the finished heights instead of the arrays above
+	TSharedPtr<const FTerrainHeightFile> HeightFile;
+
+	// Quads along a tile side at full resolution
+	int32 TileTexels = 128;
+
+	FIntPoint GetTilesNum() const;
+	FIntPoint GetTileAt(const FVector& MapLocation) const;
+
+	bool IsValid() const;
+
+	// The vertex the whole map mesh would have at the texel
+	FVector3f GetVertex(const uint32 X, const uint32 Y) const;
+
+	SIZE_T GetAllocatedSize() const;
+};
+
+struct FTerrainTileMesh
+{
+	FIntPoint Tile = FIntPoint::ZeroValue;
+
+	// Texels between two vertices, 1 is the full resolution
+	int32 Step = 1;
+
+	TArray<FVector> Vertices;
+	TArray<int32> Triangles;
+	TArray<FVector> Normals;
+	TArray<FVector2D> UVs;
+
+	// Safe on any thread, the vertices are the ones the whole map mesh would have at the same texels
+	static TSharedRef<FTerrainTileMesh> Build(const FTerrainTileSource& Source, const FIntPoint& Tile, int32 Step);
+};
+
+/**
+ *  Builds the terrain in tiles around the player instead of one mesh sized to the texture.
+ *  Tiles within NearTileRadius are at full resolution with collision, further ones up to FarTileRadius are coarse proxies.
+ *  Mesh components are pooled, at most MaxResidentTiles are kept and the least recently wanted one is evicted first.
+ */
+UCLASS(ClassGroup = (RacingEngineer), meta = (BlueprintSpawnableComponent))
+class RACINGENGINEER_API UTerrainTileStreamingComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UTerrainTileStreamingComponent();
+
+	// Takes the heights and distance field out of the build data and builds the tiles around StartLocation.
+	// Runs on the worker thread, the tiles are only made visible by StartStreaming
+	void PrepareStreaming(FMapBuildData& BuildData, const FVector& StartLocation);
+
+	// Game thread, uploads the prepared tiles with their collision cooked, so the player can be placed on them right away,
+	// and starts following the player
+	void StartStreaming(UMaterialInterface* InMaterial);
+
+	// Returns every tile to the pool, builds still running are discarded when they finish
+	void StopStreaming();
+
+	bool IsStreaming() const { return bStreaming; }
+
+	SIZE_T GetSourceSize() const;
+	SIZE_T GetResidentMeshSize() const;
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UPROPERTY(EditAnywhere, Category = "Terrain Streaming")
+	int32 TileTexels = 128;
+
+	UPROPERTY(EditAnywhere, Category = "Terrain Streaming")
+	int32 NearTileRadius = 2;
+
+	UPROPERTY(EditAnywhere, Category = "Terrain Streaming")
+	int32 FarTileRadius = 6;
+
+	// Texels between two proxy vertices, TileTexels should be a multiple of it
+	UPROPERTY(EditAnywhere, Category = "Terrain Streaming")
+	int32 ProxyStep = 8;
+
+	UPROPERTY(EditAnywhere, Category = "Terrain Streaming")
+	int32 MaxResidentTiles = 192;
+
+	UPROPERTY(EditAnywhere, Category = "Terrain Streaming")
+	int32 MaxTileBuildsInFlight = 4;
+
+private:
+	struct FResidentTile
+	{
+		UProceduralMeshComponent* Mesh = nullptr;
+		int32 Step = 0;
+		uint64 LastWantedFrame = 0;
+	};
+
+	struct FPendingTile
+	{
+		int32 Step = 0;
+		UE::Tasks::TTask<TSharedRef<FTerrainTileMesh>> Task;
+	};
+
+	int32 GetWantedStep(const FIntPoint& Tile, const FIntPoint& CentreTile) const;
+
+	void LaunchTileBuild(const FIntPoint& Tile, int32 Step);
+	// Collision is cooked in the background unless bCookCollisionNow is set
+	void UploadTile(const FTerrainTileMesh& TileMesh, const bool bCookCollisionNow = false);
+
+	// A pooled component, evicting the least recently wanted tile when the budget is used up
+	UProceduralMeshComponent* AcquireMesh();
+	void ReleaseTile(const FIntPoint& Tile);
+
+	TSharedPtr<const FTerrainTileSource> Source;
+
+	// Built by PrepareStreaming before the component is allowed to touch the world
+	TArray<TSharedRef<FTerrainTileMesh>> PreparedTiles;
+
+	TMap<FIntPoint, FResidentTile> ResidentTiles;
+	TMap<FIntPoint, FPendingTile> PendingTiles;
+
+	UPROPERTY()
+	TArray<TObjectPtr<UProceduralMeshComponent>> MeshPool;
+
+	TArray<UProceduralMeshComponent*> FreeMeshes;
+
+	UPROPERTY()
+	TObjectPtr<UMaterialInterface> Material;
+
+	bool bStreaming = false;
+};
@@ -0,0 +1,442 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TrackCorpusCommandlet.h"
+
+#include "MapManager.h"
+#include "Dom/JsonObject.h"
+#include "HAL/FileManager.h"
+#include "ImageCore.h"
+#include "ImageUtils.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+namespace TrackCorpus
+{
+	const TCHAR* DefaultSizes = TEXT("64,128,256,512,1024,2048,4096,8192");
+
+	// Spacing of the centre line samples, small enough for the stamped discs to overlap
+	constexpr float SampleSpacing = 0.5f;
+
+	// Track pixels are dark, CreateTrack follows everything with R < 127
+	constexpr uint8 TrackValue = 0;
+	constexpr uint8 BackgroundValue = 255;
+}
+
+UTrackCorpusCommandlet::UTrackCorpusCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UTrackCorpusCommandlet::Main(const FString& Params)
+{
+	FString OutputDir = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("TrackCorpus"));
+	FString SizesString = TrackCorpus::DefaultSizes;
+	int32 Variants = 3;
+	int32 Seed = 1;
+	int32 MaxAttempts = 50;
+	float Clearance = 0.02f;
+
+	FTrackShape Shape;
+
+	FParse::Value(*Params, TEXT("OutputDir="), OutputDir);
+	FParse::Value(*Params, TEXT("Sizes="), SizesString, false);
+	FParse::Value(*Params, TEXT("Variants="), Variants);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("MaxAttempts="), MaxAttempts);
+	FParse::Value(*Params, TEXT("Corners="), Shape.Corners);
+	FParse::Value(*Params, TEXT("Sharpness="), Shape.Sharpness);
+	FParse::Value(*Params, TEXT("TrackWidth="), Shape.TrackWidth);
+	FParse::Value(*Params, TEXT("Clearance="), Clearance);
+
+	Variants = FMath::Max(1, Variants);
+	Shape.Corners = FMath::Max(3, Shape.Corners);
+	Shape.Sharpness = FMath::Clamp(Shape.Sharpness, 0.0f, 0.85f);
+
+	// The tracer needs a track at least two pixels wide to never reach a dead end
+	Shape.TrackWidth = FMath::Max(2.0f, Shape.TrackWidth);
+
+	TArray<FString> SizeStrings;
+	SizesString.ParseIntoArray(SizeStrings, TEXT(","));
+
+	TArray<int32> Sizes;
+	for (const FString& SizeString : SizeStrings)
+	{
+		Sizes.Emplace(FCString::Atoi(*SizeString));
+	}
+	Sizes.Sort();
+
+	IFileManager::Get().MakeDirectory(*OutputDir, true);
+
+	TArray<TSharedPtr<FJsonValue>> ManifestImages;
+	TArray<FString> ImagePaths;
+
+	for (const int32 Size : Sizes)
+	{
+		if (Size < 16)
+		{
+			UE_LOG(LogTemp, Error, TEXT("UTrackCorpusCommandlet::Main Size %d is too small"), Size);
+			return 1;
+		}
+
+		Shape.Size = Size;
+		Shape.MinCentreLineGap = Shape.TrackWidth + FMath::Max(2.0f, Clearance * Size);
+
+		for (int32 Variant = 0; Variant < Variants; Variant++)
+		{
+			FRandomStream RandomStream(Seed * 7919 + Size * 31 + Variant);
+
+			TArray<FVector2f> CentreLine;
+			int32 Attempt = 1;
+			for (; Attempt <= MaxAttempts; Attempt++)
+			{
+				CentreLine = MakeCentreLine(Shape, RandomStream);
+				if (IsCentreLineValid(CentreLine, Shape))
+				{
+					break;
+				}
+				CentreLine.Reset();
+			}
+
+			if (CentreLine.IsEmpty())
+			{
+				UE_LOG(LogTemp, Error, TEXT("UTrackCorpusCommandlet::Main No valid %dpx loop in %d attempts, lower -Sharpness or -Clearance"),
+					Size, MaxAttempts);
+				return 1;
+			}
+
+			const float CentreLineLength = GetLoopLength(CentreLine);
+
+			FImage Image;
+			RasterizeTrack(CentreLine, Shape, Image);
+
+			if (!IsTraceable(Image, CentreLineLength))
+			{
+				UE_LOG(LogTemp, Error, TEXT("UTrackCorpusCommandlet::Main The %dpx track variant %d can't be traced"), Size, Variant);
+				return 1;
+			}
+
+			const FString ImagePath = FPaths::Combine(OutputDir, FString::Printf(TEXT("Track_%d_%d.png"), Size, Variant));
+			if (!FImageUtils::SaveImageByExtension(*ImagePath, Image))
+			{
+				UE_LOG(LogTemp, Error, TEXT("UTrackCorpusCommandlet::Main Failed to write %s"), *ImagePath);
+				return 1;
+			}
+
+			TSharedRef<FJsonObject> ImageJson = MakeShared<FJsonObject>();
+			ImageJson->SetStringField(TEXT("file"), FPaths::GetCleanFilename(ImagePath));
+			ImageJson->SetNumberField(TEXT("size"), Size);
+			ImageJson->SetNumberField(TEXT("variant"), Variant);
+			ImageJson->SetNumberField(TEXT("corners"), Shape.Corners);
+			ImageJson->SetNumberField(TEXT("sharpness"), Shape.Sharpness);
+			ImageJson->SetNumberField(TEXT("track_width"), Shape.TrackWidth);
+			ImageJson->SetNumberField(TEXT("min_centre_line_gap"), Shape.MinCentreLineGap);
+			ImageJson->SetNumberField(TEXT("centre_line_length"), CentreLineLength);
+			ImageJson->SetNumberField(TEXT("attempts"), Attempt);
+			ManifestImages.Emplace(MakeShared<FJsonValueObject>(ImageJson));
+
+			ImagePaths.Emplace(ImagePath);
+
+			UE_LOG(LogTemp, Display, TEXT("UTrackCorpusCommandlet::Main Wrote %s"), *ImagePath);
+		}
+	}
+
+	TSharedRef<FJsonObject> Manifest = MakeShared<FJsonObject>();
+	Manifest->SetNumberField(TEXT("seed"), Seed);
+	Manifest->SetArrayField(TEXT("images"), ManifestImages);
+
+	FString ManifestString;
+	FJsonSerializer::Serialize(Manifest, TJsonWriterFactory<>::Create(&ManifestString));
+
+	const FString ManifestPath = FPaths::Combine(OutputDir, TEXT("manifest.json"));
+	if (!FFileHelper::SaveStringToFile(ManifestString, *ManifestPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("UTrackCorpusCommandlet::Main Failed to write %s"), *ManifestPath);
+		return 1;
+	}
+
+	if (FParse::Param(*Params, TEXT("Benchmark")) && !RunBenchmarks(ImagePaths, OutputDir, Params))
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+TArray<FVector2f> UTrackCorpusCommandlet::MakeCentreLine(const FTrackShape& Shape, FRandomStream& RandomStream)
+{
+	const float Centre = Shape.Size * 0.5f;
+
+	// Catmull-Rom overshoots its control points a little, the margin check catches the rest
+	const float MaxRadius = (Centre - Shape.TrackWidth - 2.0f) * 0.9f;
+	const float MinRadius = MaxRadius * (1.0f - Shape.Sharpness);
+
+	// Angles only jitter within their own slice, so the loop goes around the centre once
+	TArray<FVector2f> ControlPoints;
+	ControlPoints.Reserve(Shape.Corners);
+
+	for (int32 Corner = 0; Corner < Shape.Corners; Corner++)
+	{
+		const float Angle = (Corner + RandomStream.FRandRange(-0.3f, 0.3f)) * UE_TWO_PI / Shape.Corners;
+		const float Radius = RandomStream.FRandRange(MinRadius, MaxRadius);
+
+		ControlPoints.Emplace(Centre + Radius * FMath::Cos(Angle), Centre + Radius * FMath::Sin(Angle));
+	}
+
+	TArray<FVector2f> CentreLine;
+
+	for (int32 Corner = 0; Corner < Shape.Corners; Corner++)
+	{
+		const FVector2f& P0 = ControlPoints[(Corner + Shape.Corners - 1) % Shape.Corners];
+		const FVector2f& P1 = ControlPoints[Corner];
+		const FVector2f& P2 = ControlPoints[(Corner + 1) % Shape.Corners];
+		const FVector2f& P3 = ControlPoints[(Corner + 2) % Shape.Corners];
+
+		// The curve is longer than the chord, twice as many samples keeps the spacing under SampleSpacing
+		const int32 StepsNum = FMath::Max(1, FMath::CeilToInt32(2.0f * FVector2f::Distance(P1, P2) / TrackCorpus::SampleSpacing));
+
+		for (int32 Step = 0; Step < StepsNum; Step++)
+		{
+			const float T = Step / static_cast<float>(StepsNum);
+			const float T2 = T * T;
+			const float T3 = T2 * T;
+
+			CentreLine.Emplace(0.5f * (2.0f * P1 + (P2 - P0) * T + (2.0f * P0 - 5.0f * P1 + 4.0f * P2 - P3) * T2
+				+ (3.0f * P1 - P0 - 3.0f * P2 + P3) * T3));
+		}
+	}
+
+	return CentreLine;
+}
+
+bool UTrackCorpusCommandlet::IsCentreLineValid(const TArray<FVector2f>& CentreLine, const FTrackShape& Shape)
+{
+	// CreateTrack never looks at the first row and column
+	const float Margin = Shape.TrackWidth + 2.0f;
+
+	for (const FVector2f& Point : CentreLine)
+	{
+		if (Point.X < Margin || Point.Y < Margin || Point.X > Shape.Size - Margin || Point.Y > Shape.Size - Margin)
+		{
+			return false;
+		}
+	}
+
+	TArray<float> ArcLengths;
+	ArcLengths.SetNumUninitialized(CentreLine.Num());
+	ArcLengths[0] = 0.0f;
+	for (int32 Index = 1; Index < CentreLine.Num(); Index++)
+	{
+		ArcLengths[Index] = ArcLengths[Index - 1] + FVector2f::Distance(CentreLine[Index - 1], CentreLine[Index]);
+	}
+
+	const float LoopLength = GetLoopLength(CentreLine);
+	const float Gap = Shape.MinCentreLineGap;
+
+	// Neighbours along the loop are always close, so only points further apart than twice the gap are compared.
+	// The legs of a hairpin tighter than the gap are still caught once they run side by side
+	const float ArcWindow = 2.0f * Gap;
+
+	// Points are hashed into cells as big as the gap, so only the neighbouring cells have to be checked
+	TMap<FIntPoint, TArray<int32>> Cells;
+	for (int32 Index = 0; Index < CentreLine.Num(); Index++)
+	{
+		Cells.FindOrAdd(FIntPoint(FMath::FloorToInt32(CentreLine[Index].X / Gap), FMath::FloorToInt32(CentreLine[Index].Y / Gap))).Emplace(Index);
+	}
+
+	for (int32 Index = 0; Index < CentreLine.Num(); Index++)
+	{
+		const FVector2f& Point = CentreLine[Index];
+		const FIntPoint Cell(FMath::FloorToInt32(Point.X / Gap), FMath::FloorToInt32(Point.Y / Gap));
+
+		for (int32 OffsetY = -1; OffsetY <= 1; OffsetY++)
+		{
+			for (int32 OffsetX = -1; OffsetX <= 1; OffsetX++)
+			{
+				const TArray<int32>* CellPoints = Cells.Find(Cell + FIntPoint(OffsetX, OffsetY));
+				if (CellPoints == nullptr)
+				{
+					continue;
+				}
+
+				for (const int32 OtherIndex : *CellPoints)
+				{
+					const float ArcDistance = FMath::Abs(ArcLengths[Index] - ArcLengths[OtherIndex]);
+					if (FMath::Min(ArcDistance, LoopLength - ArcDistance) > ArcWindow
+						&& FVector2f::DistSquared(Point, CentreLine[OtherIndex]) < Gap * Gap)
+					{
+						return false;
+					}
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+void UTrackCorpusCommandlet::RasterizeTrack(const TArray<FVector2f>& CentreLine, const FTrackShape& Shape, FImage& OutImage)
+{
+	OutImage.Init(Shape.Size, Shape.Size, ERawImageFormat::G8, EGammaSpace::sRGB);
+
+	const TArrayView64<uint8> Pixels = OutImage.AsG8();
+	FMemory::Memset(Pixels.GetData(), TrackCorpus::BackgroundValue, Pixels.Num());
+
+	const float Radius = Shape.TrackWidth * 0.5f;
+	const int32 RadiusCeil = FMath::CeilToInt32(Radius);
+
+	// Discs stamped along the centre line, sampled densely enough to overlap
+	for (const FVector2f& Point : CentreLine)
+	{
+		const int32 CentreX = FMath::FloorToInt32(Point.X);
+		const int32 CentreY = FMath::FloorToInt32(Point.Y);
+
+		for (int32 Y = CentreY - RadiusCeil; Y <= CentreY + RadiusCeil; Y++)
+		{
+			for (int32 X = CentreX - RadiusCeil; X <= CentreX + RadiusCeil; X++)
+			{
+				if (FVector2f::DistSquared(FVector2f(X + 0.5f, Y + 0.5f), Point) <= Radius * Radius)
+				{
+					Pixels[static_cast<int64>(Y) * Shape.Size + X] = TrackCorpus::TrackValue;
+				}
+			}
+		}
+	}
+}
+
+bool UTrackCorpusCommandlet::IsTraceable(const FImage& Image, const float CentreLineLength)
+{
+	const TArrayView64<const uint8> Pixels = Image.AsG8();
+
+	TArray<FColor> Colors;
+	Colors.SetNumUninitialized(static_cast<int32>(Pixels.Num()));
+	for (int32 Index = 0; Index < Colors.Num(); Index++)
+	{
+		Colors[Index] = FColor(Pixels[Index], Pixels[Index], Pixels[Index]);
+	}
+
+	// The tracer follows the outline, one node per pixel step. Diagonal steps cover up to sqrt(2) pixels,
+	// so a full loop has at least half as many nodes as the centre line is long
+	const TArray<FVector2D> TrackNodes = AMapManager::CreateTrack(Colors, Image.SizeY, Image.SizeX, 0);
+
+	return TrackNodes.Num() >= CentreLineLength * 0.5f;
+}
+
+float UTrackCorpusCommandlet::GetLoopLength(const TArray<FVector2f>& CentreLine)
+{
+	float Length = 0.0f;
+	for (int32 Index = 0; Index < CentreLine.Num(); Index++)
+	{
+		Length += FVector2f::Distance(CentreLine[Index], CentreLine[(Index + 1) % CentreLine.Num()]);
+	}
+	return Length;
+}
+
+bool UTrackCorpusCommandlet::RunBenchmarks(const TArray<FString>& ImagePaths, const FString& OutputDir, const FString& Params) const
+{
+	int32 Iterations = 3;
+	FString WorkerClassPaths;
+
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	FParse::Value(*Params, TEXT("Workers="), WorkerClassPaths, false);
+
+	const FString SharedParams = FString::Printf(TEXT("-Iterations=%d%s%s"), Iterations,
+		WorkerClassPaths.IsEmpty() ? TEXT("") : *FString::Printf(TEXT(" -Workers=\"%s\""), *WorkerClassPaths),
+		FParse::Param(*Params, TEXT("LightWeight")) ? TEXT(" -LightWeight") : TEXT(""));
+
+	FString ScalingCsv = TEXT("image,size,stage,wall_median_ms,cpu_median_ms,output_bytes,peak_used_physical_bytes,build_peak_physical_bytes\n");
+
+	// Peak memory is a high-water mark of the whole process, so every image gets a process of its own
+	const FString ExecutablePath = FPlatformProcess::ExecutablePath();
+	const FString ProjectFilePath = FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath());
+
+	for (const FString& ImagePath : ImagePaths)
+	{
+		const FString ReportPath = FPaths::ChangeExtension(ImagePath, TEXT("bench.json"));
+		IFileManager::Get().Delete(*ReportPath, false, false, true);
+
+		const FString BenchmarkParams = FString::Printf(TEXT("\"%s\" -run=MapBuildBenchmark -Image=\"%s\" -Output=\"%s\" %s -nullrhi -unattended -nopause -nosplash"),
+			*ProjectFilePath, *FPaths::ConvertRelativePathToFull(ImagePath), *FPaths::ConvertRelativePathToFull(ReportPath), *SharedParams);
+
+		FProcHandle Process = FPlatformProcess::CreateProc(*ExecutablePath, *BenchmarkParams, false, true, true, nullptr, 0, nullptr, nullptr);
+		if (!Process.IsValid())
+		{
+			UE_LOG(LogTemp, Error, TEXT("UTrackCorpusCommandlet::RunBenchmarks Failed to start %s"), *ExecutablePath);
+			return false;
+		}
+
+		FPlatformProcess::WaitForProc(Process);
+
+		int32 Result = -1;
+		FPlatformProcess::GetProcReturnCode(Process, &Result);
+		FPlatformProcess::CloseProc(Process);
+
+		if (Result != 0)
+		{
+			UE_LOG(LogTemp, Error, TEXT("UTrackCorpusCommandlet::RunBenchmarks Benchmark of %s failed with %d"), *ImagePath, Result);
+			return false;
+		}
+
+		AppendScalingRows(ReportPath, ImagePath, ScalingCsv);
+	}
+
+	const FString ScalingPath = FPaths::Combine(OutputDir, TEXT("scaling.csv"));
+	if (!FFileHelper::SaveStringToFile(ScalingCsv, *ScalingPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("UTrackCorpusCommandlet::RunBenchmarks Failed to write %s"), *ScalingPath);
+		return false;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("UTrackCorpusCommandlet::RunBenchmarks Wrote %s"), *ScalingPath);
+	return true;
+}
+
+void UTrackCorpusCommandlet::AppendScalingRows(const FString& ReportPath, const FString& ImagePath, FString& InOutCsv)
+{
+	FString ReportString;
+	TSharedPtr<FJsonObject> Report;
+	if (!FFileHelper::LoadFileToString(ReportString, *ReportPath)
+		|| !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(ReportString), Report) || !Report.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("UTrackCorpusCommandlet::AppendScalingRows Failed to read %s"), *ReportPath);
+		return;
+	}
+
+	// Sum of every output array of the build, the image size is the width
+	double OutputBytes = 0.0;
+	int32 Size = 0;
+
+	const TSharedPtr<FJsonObject>* Outputs = nullptr;
+	if (Report->TryGetObjectField(TEXT("outputs"), Outputs))
+	{
+		Size = (*Outputs)->GetIntegerField(TEXT("width"));
+
+		for (const TPair<FString, TSharedPtr<FJsonValue>>& Output : (*Outputs)->Values)
+		{
+			const TSharedPtr<FJsonObject>* OutputArray = nullptr;
+			if (Output.Value->TryGetObject(OutputArray))
+			{
+				OutputBytes += (*OutputArray)->GetNumberField(TEXT("bytes"));
+			}
+		}
+	}
+
+	const double PeakBytes = Report->GetNumberField(TEXT("peak_used_physical_bytes"));
+	const double BuildPeakBytes = Report->GetNumberField(TEXT("build_peak_physical_bytes"));
+	const FString ImageName = FPaths::GetCleanFilename(ImagePath);
+
+	for (const TSharedPtr<FJsonValue>& StageValue : Report->GetArrayField(TEXT("stages")))
+	{
+		const TSharedPtr<FJsonObject>& Stage = StageValue->AsObject();
+
+		InOutCsv += FString::Printf(TEXT("%s,%d,%s,%f,%f,%.0f,%.0f,%.0f\n"), *ImageName, Size, *Stage->GetStringField(TEXT("name")),
+			Stage->GetObjectField(TEXT("wall_ms"))->GetNumberField(TEXT("median")),
+			Stage->GetObjectField(TEXT("cpu_ms"))->GetNumberField(TEXT("median")),
+			OutputBytes, PeakBytes, BuildPeakBytes);
+	}
+}
@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "TrackCorpusCommandlet.generated.h"
+
+struct FImage;
+
+/**
+ *  Generates closed loop track masks of many sizes and optionally benchmarks the map build on all of them.
+ *
+ *  UnrealEditor-Cmd RacingEngineer.uproject -run=TrackCorpus -nullrhi -unattended
+ *      [-OutputDir=<dir>] [-Sizes=64,128,...,8192] [-Variants=3] [-Seed=1]
+ *      [-Corners=12] [-Sharpness=0.4] [-TrackWidth=3] [-Clearance=0.02] [-MaxAttempts=50]
+ *      [-Benchmark [-Iterations=3] [-Workers=<class path>,<class path>] [-LightWeight]]
+ *
+ *  Corners is the number of control points around the loop, Sharpness how far they are pulled
+ *  towards the centre, TrackWidth is in pixels and Clearance is the smallest gap between two parts
+ *  of the track as a fraction of the image size. Every mask is traced by AMapManager::CreateTrack
+ *  before it's written.
+ *
+ *  With -Benchmark every image is run through the MapBuildBenchmark commandlet in a process of its own
+ *  and the per stage medians are collected into scaling.csv. Peak memory never goes down within a process,
+ *  so the peak of every image is its own. The build peak is the part above what the process held before the first build.
+ */
+UCLASS()
+class RACINGENGINEER_API UTrackCorpusCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UTrackCorpusCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	struct FTrackShape
+	{
+		int32 Size = 512;
+		int32 Corners = 12;
+		float Sharpness = 0.4f;
+		float TrackWidth = 3.0f;
+
+		// Smallest distance between two centre line points that aren't neighbours along the loop
+		float MinCentreLineGap = 0.0f;
+	};
+
+	// Catmull-Rom loop through control points scattered around the image centre, sampled every half pixel
+	static TArray<FVector2f> MakeCentreLine(const FTrackShape& Shape, FRandomStream& RandomStream);
+
+	// Inside the image with a margin and never closer to itself than MinCentreLineGap
+	static bool IsCentreLineValid(const TArray<FVector2f>& CentreLine, const FTrackShape& Shape);
+
+	static void RasterizeTrack(const TArray<FVector2f>& CentreLine, const FTrackShape& Shape, FImage& OutImage);
+
+	// Runs the same tracing as the map build and checks it went around the whole loop
+	static bool IsTraceable(const FImage& Image, const float CentreLineLength);
+
+	static float GetLoopLength(const TArray<FVector2f>& CentreLine);
+
+	bool RunBenchmarks(const TArray<FString>& ImagePaths, const FString& OutputDir, const FString& Params) const;
+
+	static void AppendScalingRows(const FString& ReportPath, const FString& ImagePath, FString& InOutCsv);
+};
@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TrackFollower.h"
+
+#include "MapBuildPipeline.h"
+
+namespace TrackFollower
+{
+	// The pursuit point is this many seconds of travel ahead, but never closer than MinLookahead
+	constexpr float LookaheadSeconds = 0.6f;
+	constexpr float MinLookaheadCm = 600.0f;
+
+	// Lateral acceleration the speed profile allows in bends and the deceleration it plans braking with
+	constexpr float MaxLateralAccelerationCm = 700.0f;
+	constexpr float BrakingDecelerationCm = 600.0f;
+
+	// Difference to the wanted speed at which throttle or brake are fully applied
+	constexpr float SpeedErrorForFullInputCm = 500.0f;
+
+	constexpr int32 CurvatureSteps = 16;
+
+	// The racing line's speed profile is of a point mass, the vehicle follows it with a margin and reads it a little ahead for its response
+	constexpr float RacingLineSpeedScale = 0.85f;
+	constexpr float RacingLineResponseSeconds = 0.3f;
+}
+
+const float FTrackFollower::MaxSteerAngleRadians = FMath::DegreesToRadians(35.0f);
+
+FVector2D FTrackFollower::GetPursuitPoint(const FTrackFrameTable& TrackFrames, float Distance, float Speed, float LaneOffset)
+{
+	const float PursuitDistance = Distance + FMath::Max(TrackFollower::MinLookaheadCm, FMath::Max(Speed, 0.0f) * TrackFollower::LookaheadSeconds);
+	const FVector2D PursuitPoint(TrackFrames.GetRacingLineLocationAtDistance(PursuitDistance));
+
+	if (LaneOffset == 0.0f)
+	{
+		return PursuitPoint;
+	}
+
+	const FVector Direction = TrackFrames.GetDirectionAtDistance(PursuitDistance);
+	return PursuitPoint + FVector2D(-Direction.Y, Direction.X) * LaneOffset;
+}
+
+float FTrackFollower::GetHeadingError(const FVector2D& Location, const FVector2D& Forward, const FVector2D& PursuitPoint)
+{
+	const FVector2D Heading = Forward.GetSafeNormal();
+	const FVector2D ToTarget = (PursuitPoint - Location).GetSafeNormal();
+
+	// A positive cross product is to the right with Y pointing right
+	return FMath::Atan2(FVector2D::CrossProduct(Heading, ToTarget), FVector2D::DotProduct(Heading, ToTarget));
+}
+
+float FTrackFollower::GetSteeringInput(float SteeringAngle)
+{
+	return FMath::Clamp(SteeringAngle / MaxSteerAngleRadians, -1.0f, 1.0f);
+}
+
+float FTrackFollower::GetProfileSpeed(const FTrackFrameTable& TrackFrames, float Distance, float Speed, float MaxSpeed)
+{
+	Speed = FMath::Max(Speed, 0.0f);
+
+	if (TrackFrames.HasRacingLine())
+	{
+		const float ProfileSpeed = TrackFrames.GetRacingLineSpeedAtDistance(Distance + Speed * TrackFollower::RacingLineResponseSeconds);
+		return FMath::Min(MaxSpeed, ProfileSpeed * TrackFollower::RacingLineSpeedScale);
+	}
+
+	// The sharpest bend within braking distance limits the speed, curvature is estimated as heading change over distance
+	const float BrakingDistance = Speed * Speed / (2.0f * TrackFollower::BrakingDecelerationCm) + TrackFollower::MinLookaheadCm;
+	const FVector CurrentDirection = TrackFrames.GetDirectionAtDistance(Distance);
+
+	float MaxCurvature = 0.0f;
+	for (int32 Step = 1; Step <= TrackFollower::CurvatureSteps; Step++)
+	{
+		const float AheadDistance = BrakingDistance * Step / TrackFollower::CurvatureSteps;
+		const FVector AheadDirection = TrackFrames.GetDirectionAtDistance(Distance + AheadDistance);
+		const float HeadingChange = FMath::Acos(FMath::Clamp(FVector::DotProduct(CurrentDirection, AheadDirection), -1.0f, 1.0f));
+
+		MaxCurvature = FMath::Max(MaxCurvature, HeadingChange / AheadDistance);
+	}
+
+	if (MaxCurvature > UE_KINDA_SMALL_NUMBER)
+	{
+		return FMath::Min(MaxSpeed, FMath::Sqrt(TrackFollower::MaxLateralAccelerationCm / MaxCurvature));
+	}
+
+	return MaxSpeed;
+}
+
+void FTrackFollower::GetPedalInputs(float WantedSpeed, float Speed, float& OutThrottle, float& OutBrake)
+{
+	const float SpeedError = WantedSpeed - Speed;
+
+	OutThrottle = FMath::Clamp(SpeedError / TrackFollower::SpeedErrorForFullInputCm, 0.0f, 1.0f);
+	OutBrake = FMath::Clamp(-SpeedError / TrackFollower::SpeedErrorForFullInputCm, 0.0f, 1.0f);
+}
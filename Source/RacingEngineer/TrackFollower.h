@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FTrackFrameTable;
+
+/**
+ *  Pure pursuit steering and the speed profile both the drive benchmark and the AI drivers follow the track with.
+ *  Everything is in map space and only reads the FTrackFrameTable, so it is safe on the physics thread.
+ */
+struct RACINGENGINEER_API FTrackFollower
+{
+	// Angle the steering input of 1 stands for, roughly the front wheels' max steer angle
+	static const float MaxSteerAngleRadians;
+
+	// Point ahead of Distance to steer at, on the racing line when the track has one and LaneOffset to the right of it
+	static FVector2D GetPursuitPoint(const FTrackFrameTable& TrackFrames, float Distance, float Speed, float LaneOffset = 0.0f);
+
+	// Angle from Forward to the pursuit point, positive turns right
+	static float GetHeadingError(const FVector2D& Location, const FVector2D& Forward, const FVector2D& PursuitPoint);
+
+	static float GetSteeringInput(float SteeringAngle);
+
+	// Speed to drive at Distance, from the racing line's profile or else the sharpest bend in braking distance, never above MaxSpeed
+	static float GetProfileSpeed(const FTrackFrameTable& TrackFrames, float Distance, float Speed, float MaxSpeed);
+
+	static void GetPedalInputs(float WantedSpeed, float Speed, float& OutThrottle, float& OutBrake);
+};
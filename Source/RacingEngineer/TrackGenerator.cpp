@@ -3,10 +3,13 @@
 
 #include "TrackGenerator.h"
 
+#include "RacingEngineer.h"
 #include "TerrainGenerator.h"
 #include "Components/SplineComponent.h"
 #include "Components/SplineMeshComponent.h"
+#include "KismetProceduralMeshLibrary.h"
 #include "Async/Async.h"
+#include "Async/ParallelFor.h"
 
 // Sets default values
 ATrackGenerator::ATrackGenerator()
@@ -31,6 +34,9 @@ void ATrackGenerator::Tick(float DeltaTime)
 
 void ATrackGenerator::DoWork(const FWorkerData& Data, const FOnWorkFinished Callback)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(ATrackGenerator::DoWork);
+	LLM_SCOPE_BYTAG(RacingEngineer_Track);
+
 	PrepareTrackSplineMeshData(Data.TrackSpline, GetTrackMeshSize());
 
 	AsyncTask(ENamedThreads::GameThread, [this, Callback]
@@ -39,6 +45,59 @@ void ATrackGenerator::DoWork(const FWorkerData& Data, const FOnWorkFinished Call
 	});
 }
 
+void ATrackGenerator::ResetWork()
+{
+	TrackMeshSpawnData.Empty();
+	TrackMeshSpawned = 0;
+	ActiveTrackMeshesNum = 0;
+
+	// Pooled components only lose their scene proxy and physics body, they are re-registered by the next build
+	for (USplineMeshComponent* SplineMeshComponent : TrackMeshComponents)
+	{
+		if (SplineMeshComponent != nullptr && SplineMeshComponent->IsRegistered())
+		{
+			SplineMeshComponent->UnregisterComponent();
+		}
+	}
+
+	for (UProceduralMeshComponent* MergedMesh : MergedTrackMeshComponents)
+	{
+		if (MergedMesh != nullptr && MergedMesh->IsRegistered())
+		{
+			MergedMesh->UnregisterComponent();
+		}
+	}
+
+	for (UProceduralMeshComponent* CollisionMesh : MergedTrackCollisionComponents)
+	{
+		if (CollisionMesh != nullptr && CollisionMesh->IsRegistered())
+		{
+			CollisionMesh->UnregisterComponent();
+		}
+	}
+
+	PendingMergedClusters.Empty();
+	PendingMergeCallback.Unbind();
+}
+
+FWorkerMemoryUsage ATrackGenerator::GetRetainedMemory() const
+{
+	FWorkerMemoryUsage Usage;
+	Usage.BuildBuffers = TrackMeshSpawnData.GetAllocatedSize();
+
+	for (const UProceduralMeshComponent* MergedMesh : MergedTrackMeshComponents)
+	{
+		Usage.ComponentData += GetProcMeshSectionsSize(MergedMesh);
+	}
+
+	for (const UProceduralMeshComponent* CollisionMesh : MergedTrackCollisionComponents)
+	{
+		Usage.ComponentData += GetProcMeshSectionsSize(CollisionMesh);
+	}
+
+	return Usage;
+}
+
 FVector ATrackGenerator::GetTrackMeshSize() const
 {
 	if (TrackMesh != nullptr)
@@ -155,28 +214,53 @@ void ATrackGenerator::PrepareTrackSplineMeshData(const USplineComponent* TrackSp
 
 void ATrackGenerator::SpawnTrackBasedOnPreparedData(TArray<FTrackSplineSpawnData>& TrackSpawnData, FOnWorkFinished Callback)
 {
+	INC_DWORD_STAT_BY(STAT_RacingEngineer_SpawnQueueDepth, TrackSpawnData.Num());
+
 	SpawnBatchTrackMeshTimer.BindLambda([this, &TrackSpawnData, Callback]()
 		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(ATrackGenerator::SpawnBatch);
+			LLM_SCOPE_BYTAG(RacingEngineer_Track);
+
+			const int32 BatchStart = TrackMeshSpawned;
+
 			for (int32 i = 0; i < BatchSize && TrackMeshSpawned < TrackSpawnData.Num(); i++, TrackMeshSpawned++)
 			{
 				const FTrackSplineSpawnData& TrackSplineMeshData = TrackSpawnData[TrackMeshSpawned];
 
-				USplineMeshComponent* SplineMeshComponent = NewObject<USplineMeshComponent>(this,
-					USplineMeshComponent::StaticClass(), TrackSplineMeshData.SplineMeshName);
+				// Components left over from a previous build are reused instead of spawning new ones
+				USplineMeshComponent* SplineMeshComponent = TrackMeshComponents.IsValidIndex(TrackMeshSpawned)
+					? TrackMeshComponents[TrackMeshSpawned].Get() : nullptr;
+
+				if (SplineMeshComponent != nullptr)
+				{
+					SplineMeshComponent->SetStaticMesh(TrackMesh);
+					SplineMeshComponent->RegisterComponentWithWorld(GetWorld());
+				}
+				else
+				{
+					SplineMeshComponent = NewObject<USplineMeshComponent>(this,
+						USplineMeshComponent::StaticClass(), TrackSplineMeshData.SplineMeshName);
+
+					SplineMeshComponent->SetStaticMesh(TrackMesh);
+					SplineMeshComponent->SetMobility(EComponentMobility::Stationary);
+					SplineMeshComponent->SetCastShadow(false);
+					SplineMeshComponent->CreationMethod = EComponentCreationMethod::UserConstructionScript;
+					SplineMeshComponent->RegisterComponentWithWorld(GetWorld());
+					SplineMeshComponent->AttachToComponent(GetRootComponent(), FAttachmentTransformRules::KeepRelativeTransform);
+					SplineMeshComponent->SetSplineUpDir(FVector::UpVector);
+					SplineMeshComponent->SetCollisionEnabled(ECollisionEnabled::PhysicsOnly);
+					SplineMeshComponent->SetCollisionProfileName(TEXT("BlockAll"));
+
+					TrackMeshComponents.SetNum(TrackMeshSpawned + 1);
+					TrackMeshComponents[TrackMeshSpawned] = SplineMeshComponent;
+				}
 
-				SplineMeshComponent->SetStaticMesh(TrackMesh);
-				SplineMeshComponent->SetMobility(EComponentMobility::Stationary);
-				SplineMeshComponent->SetCastShadow(false);
-				SplineMeshComponent->CreationMethod = EComponentCreationMethod::UserConstructionScript;
-				SplineMeshComponent->RegisterComponentWithWorld(GetWorld());
-				SplineMeshComponent->AttachToComponent(GetRootComponent(), FAttachmentTransformRules::KeepRelativeTransform);
-				SplineMeshComponent->SetSplineUpDir(FVector::UpVector);
 				SplineMeshComponent->SetStartAndEnd(TrackSplineMeshData.StartPos, TrackSplineMeshData.StartTangent * TangentScalar,
 					TrackSplineMeshData.EndPos, TrackSplineMeshData.EndTangent * TangentScalar);
-				SplineMeshComponent->SetCollisionEnabled(ECollisionEnabled::PhysicsOnly);
-				SplineMeshComponent->SetCollisionProfileName(TEXT("BlockAll"));
 			}
 
+			DEC_DWORD_STAT_BY(STAT_RacingEngineer_SpawnQueueDepth, TrackMeshSpawned - BatchStart);
+
 			if (TrackMeshSpawned < TrackSpawnData.Num())
 			{
 				GetWorld()->GetTimerManager().SetTimerForNextTick(SpawnBatchTrackMeshTimer);
@@ -184,12 +268,10 @@ void ATrackGenerator::SpawnTrackBasedOnPreparedData(TArray<FTrackSplineSpawnData
 
 			if (TrackMeshSpawned == TrackSpawnData.Num())
 			{
+				ActiveTrackMeshesNum = TrackMeshSpawned;
 				TrackMeshSpawnData.Empty();
 
-				if (Callback.IsBound())
-				{
-					Callback.Execute();
-				}
+				MergeTrackSegments(Callback);
 			}
 		});
 
@@ -226,4 +308,358 @@ void ATrackGenerator::CreateMeshOnSpline(const USplineComponent* TrackSplineComp
 	}
 }
 
+#pragma endregion
+
+#pragma region MergingMesh
+
+FTrackSegmentSnapshot FTrackSegmentSnapshot::Make(const USplineMeshComponent& Segment)
+{
+	FTrackSegmentSnapshot Snapshot;
+	Snapshot.SplineParams = Segment.SplineParams;
+	Snapshot.SplineUpDir = Segment.SplineUpDir;
+	Snapshot.ForwardAxis = Segment.ForwardAxis;
+	Snapshot.bSmoothInterpRollScale = Segment.bSmoothInterpRollScale;
+	Snapshot.RelativeTransform = Segment.GetRelativeTransform();
+
+	if (!FMath::IsNearlyEqual(Segment.SplineBoundaryMin, Segment.SplineBoundaryMax))
+	{
+		Snapshot.MeshMinAlong = Segment.SplineBoundaryMin;
+		Snapshot.MeshRangeAlong = Segment.SplineBoundaryMax - Segment.SplineBoundaryMin;
+	}
+	else if (const UStaticMesh* StaticMesh = Segment.GetStaticMesh())
+	{
+		const FBoxSphereBounds Bounds = StaticMesh->GetBounds();
+		Snapshot.MeshMinAlong = static_cast<float>(USplineMeshComponent::GetAxisValueRef(Bounds.Origin, Segment.ForwardAxis)
+			- USplineMeshComponent::GetAxisValueRef(Bounds.BoxExtent, Segment.ForwardAxis));
+		Snapshot.MeshRangeAlong = static_cast<float>(2.0 * USplineMeshComponent::GetAxisValueRef(Bounds.BoxExtent, Segment.ForwardAxis));
+	}
+
+	return Snapshot;
+}
+
+FTransform FTrackSegmentSnapshot::CalcSliceTransform(const float DistanceAlong) const
+{
+	const FSplineMeshParams& Params = SplineParams;
+	const float Alpha = MeshRangeAlong != 0.0f ? (DistanceAlong - MeshMinAlong) / MeshRangeAlong : 0.0f;
+	const float InterpAlpha = bSmoothInterpRollScale ? FMath::SmoothStep(0.0f, 1.0f, Alpha) : Alpha;
+
+	// Past the ends the spline continues along its end tangents
+	FVector SplinePos;
+	FVector SplineDir;
+	if (Alpha < 0.0f)
+	{
+		SplinePos = Params.StartPos + Params.StartTangent * Alpha;
+		SplineDir = Params.StartTangent.GetSafeNormal();
+	}
+	else if (Alpha > 1.0f)
+	{
+		SplinePos = Params.EndPos + Params.EndTangent * (Alpha - 1.0f);
+		SplineDir = Params.EndTangent.GetSafeNormal();
+	}
+	else
+	{
+		SplinePos = FMath::CubicInterp(Params.StartPos, Params.StartTangent, Params.EndPos, Params.EndTangent, Alpha);
+		SplineDir = FMath::CubicInterpDerivative(Params.StartPos, Params.StartTangent, Params.EndPos, Params.EndTangent, Alpha).GetSafeNormal();
+	}
+
+	const FVector BaseXVec = (SplineUpDir ^ SplineDir).GetSafeNormal();
+	const FVector BaseYVec = (SplineDir ^ BaseXVec).GetSafeNormal();
+
+	const FVector2D SliceOffset = FMath::Lerp(Params.StartOffset, Params.EndOffset, InterpAlpha);
+	SplinePos += SliceOffset.X * BaseXVec + SliceOffset.Y * BaseYVec;
+
+	const float Roll = FMath::Lerp(Params.StartRoll, Params.EndRoll, InterpAlpha);
+	const float CosRoll = FMath::Cos(Roll);
+	const float SinRoll = FMath::Sin(Roll);
+	const FVector XVec = CosRoll * BaseXVec - SinRoll * BaseYVec;
+	const FVector YVec = CosRoll * BaseYVec + SinRoll * BaseXVec;
+
+	const FVector2D Scale = FMath::Lerp(Params.StartScale, Params.EndScale, InterpAlpha);
+
+	FTransform SliceTransform;
+	switch (ForwardAxis)
+	{
+	case ESplineMeshAxis::X:
+		SliceTransform = FTransform(SplineDir, XVec, YVec, SplinePos);
+		SliceTransform.SetScale3D(FVector(1.0, Scale.X, Scale.Y));
+		break;
+	case ESplineMeshAxis::Y:
+		SliceTransform = FTransform(YVec, SplineDir, XVec, SplinePos);
+		SliceTransform.SetScale3D(FVector(Scale.Y, 1.0, Scale.X));
+		break;
+	case ESplineMeshAxis::Z:
+		SliceTransform = FTransform(XVec, YVec, SplineDir, SplinePos);
+		SliceTransform.SetScale3D(FVector(Scale.X, Scale.Y, 1.0));
+		break;
+	}
+
+	return SliceTransform;
+}
+
+void ATrackGenerator::MergeTrackSegments(FOnWorkFinished Callback)
+{
+	if (!bMergeTrackSegments || ActiveTrackMeshesNum == 0 || TrackMesh == nullptr)
+	{
+		Callback.ExecuteIfBound();
+		return;
+	}
+
+	// The undeformed source mesh has to be read on the game thread, in cooked builds it needs bAllowCPUAccess
+	TArray<FMergedTrackSection> SourceSections;
+	SourceSections.SetNum(TrackMesh->GetNumSections(0));
+
+	for (int32 SectionIndex = 0; SectionIndex < SourceSections.Num(); SectionIndex++)
+	{
+		FMergedTrackSection& Section = SourceSections[SectionIndex];
+		UKismetProceduralMeshLibrary::GetSectionFromStaticMesh(TrackMesh, 0, SectionIndex,
+			Section.Vertices, Section.Triangles, Section.Normals, Section.UVs, Section.Tangents);
+
+		if (Section.Vertices.IsEmpty())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("ATrackGenerator::MergeTrackSegments Couldn't read TrackMesh section %d, is CPU access allowed?"), SectionIndex);
+			Callback.ExecuteIfBound();
+			return;
+		}
+	}
+
+	// The background task only gets plain copies of the segments, the components are never read off the game thread
+	TArray<FTrackSegmentSnapshot> Segments;
+	Segments.Reserve(ActiveTrackMeshesNum);
+	for (int32 SegmentIndex = 0; SegmentIndex < ActiveTrackMeshesNum; SegmentIndex++)
+	{
+		Segments.Emplace(FTrackSegmentSnapshot::Make(*TrackMeshComponents[SegmentIndex]));
+	}
+
+	// The worker callback is delayed until the merged collision has cooked, so a regeneration can't reuse the segments before they are replaced
+	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask,
+		[WeakThis = TWeakObjectPtr<ATrackGenerator>(this), SourceSections = MoveTemp(SourceSections),
+		Segments = MoveTemp(Segments), SegmentsPerCluster = SegmentsPerMergedMesh, Callback]
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(ATrackGenerator::BuildMergedClusters);
+			LLM_SCOPE_BYTAG(RacingEngineer_Track);
+
+			// Segments are grouped by consecutive index, so every cluster covers one continuous region of the track
+			TArray<FMergedTrackCluster> Clusters;
+			Clusters.SetNum(FMath::DivideAndRoundUp(Segments.Num(), SegmentsPerCluster));
+
+			ParallelFor(Clusters.Num(), [&](int32 ClusterIndex)
+				{
+					FMergedTrackCluster& Cluster = Clusters[ClusterIndex];
+					Cluster.FirstSegment = ClusterIndex * SegmentsPerCluster;
+					Cluster.SegmentsNum = FMath::Min(SegmentsPerCluster, Segments.Num() - Cluster.FirstSegment);
+					BuildMergedCluster(Cluster, SourceSections, TConstArrayView<FTrackSegmentSnapshot>(Segments).Slice(Cluster.FirstSegment, Cluster.SegmentsNum));
+				});
+
+			AsyncTask(ENamedThreads::GameThread, [WeakThis, Clusters = MoveTemp(Clusters), Callback]() mutable
+				{
+					if (WeakThis.IsValid())
+					{
+						WeakThis->SwapInMergedClusters(Clusters, Callback);
+					}
+					else
+					{
+						Callback.ExecuteIfBound();
+					}
+				});
+		});
+}
+
+void ATrackGenerator::BuildMergedCluster(FMergedTrackCluster& Cluster, const TArray<FMergedTrackSection>& SourceSections,
+	TConstArrayView<FTrackSegmentSnapshot> Segments)
+{
+	Cluster.Sections.SetNum(SourceSections.Num());
+
+	for (int32 SectionIndex = 0; SectionIndex < SourceSections.Num(); SectionIndex++)
+	{
+		const FMergedTrackSection& Source = SourceSections[SectionIndex];
+		FMergedTrackSection& Merged = Cluster.Sections[SectionIndex];
+
+		const int32 VerticesNum = Source.Vertices.Num() * Segments.Num();
+		Merged.Vertices.Reserve(VerticesNum);
+		Merged.Normals.Reserve(VerticesNum);
+		Merged.UVs.Reserve(VerticesNum);
+		Merged.Tangents.Reserve(VerticesNum);
+		Merged.Triangles.Reserve(Source.Triangles.Num() * Segments.Num());
+
+		for (const FTrackSegmentSnapshot& Segment : Segments)
+		{
+			const int32 IndexOffset = Merged.Vertices.Num();
+			const FTransform& SegmentTransform = Segment.RelativeTransform;
+
+			// Same deformation as the spline mesh vertex factory, the vertex is moved onto the slice at its distance along the forward axis
+			for (int32 VertexIndex = 0; VertexIndex < Source.Vertices.Num(); VertexIndex++)
+			{
+				FVector SliceVertex = Source.Vertices[VertexIndex];
+				double& DistanceAlong = USplineMeshComponent::GetAxisValueRef(SliceVertex, Segment.ForwardAxis);
+				const FTransform SliceTransform = Segment.CalcSliceTransform(static_cast<float>(DistanceAlong)) * SegmentTransform;
+				DistanceAlong = 0.0;
+
+				Merged.Vertices.Emplace(SliceTransform.TransformPosition(SliceVertex));
+				Merged.UVs.Emplace(Source.UVs.IsValidIndex(VertexIndex) ? Source.UVs[VertexIndex] : FVector2D::ZeroVector);
+
+				if (Source.Normals.IsValidIndex(VertexIndex))
+				{
+					Merged.Normals.Emplace(SliceTransform.TransformVectorNoScale(Source.Normals[VertexIndex]));
+				}
+
+				if (Source.Tangents.IsValidIndex(VertexIndex))
+				{
+					const FProcMeshTangent& SourceTangent = Source.Tangents[VertexIndex];
+					Merged.Tangents.Emplace(SliceTransform.TransformVectorNoScale(SourceTangent.TangentX), SourceTangent.bFlipTangentY);
+				}
+			}
+
+			for (const int32 TriangleIndex : Source.Triangles)
+			{
+				Merged.Triangles.Emplace(TriangleIndex + IndexOffset);
+			}
+		}
+
+		const int32 CollisionIndexOffset = Cluster.CollisionVertices.Num();
+		Cluster.CollisionVertices.Append(Merged.Vertices);
+		for (const int32 TriangleIndex : Merged.Triangles)
+		{
+			Cluster.CollisionTriangles.Emplace(TriangleIndex + CollisionIndexOffset);
+		}
+	}
+}
+
+void ATrackGenerator::SwapInMergedClusters(TArray<FMergedTrackCluster>& Clusters, FOnWorkFinished Callback)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(ATrackGenerator::SwapInMergedClusters);
+	LLM_SCOPE_BYTAG(RacingEngineer_Track);
+
+	PendingMergedClusters.Reset(Clusters.Num());
+	PendingMergeCallback = Callback;
+
+	for (int32 ClusterIndex = 0; ClusterIndex < Clusters.Num(); ClusterIndex++)
+	{
+		FMergedTrackCluster& Cluster = Clusters[ClusterIndex];
+
+		UProceduralMeshComponent* MergedMesh = MergedTrackMeshComponents.IsValidIndex(ClusterIndex)
+			? MergedTrackMeshComponents[ClusterIndex].Get() : nullptr;
+
+		if (MergedMesh == nullptr)
+		{
+			MergedMesh = NewObject<UProceduralMeshComponent>(this,
+				UProceduralMeshComponent::StaticClass(), *FString::Printf(TEXT("MergedTrackMesh%d"), ClusterIndex));
+
+			MergedMesh->SetCastShadow(false);
+			MergedMesh->CreationMethod = EComponentCreationMethod::UserConstructionScript;
+			MergedMesh->AttachToComponent(GetRootComponent(), FAttachmentTransformRules::KeepRelativeTransform);
+			MergedMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+
+			MergedTrackMeshComponents.SetNum(ClusterIndex + 1);
+			MergedTrackMeshComponents[ClusterIndex] = MergedMesh;
+		}
+
+		UProceduralMeshComponent* CollisionMesh = MergedTrackCollisionComponents.IsValidIndex(ClusterIndex)
+			? MergedTrackCollisionComponents[ClusterIndex].Get() : nullptr;
+
+		if (CollisionMesh == nullptr)
+		{
+			CollisionMesh = NewObject<UProceduralMeshComponent>(this,
+				UProceduralMeshComponent::StaticClass(), *FString::Printf(TEXT("MergedTrackCollision%d"), ClusterIndex));
+
+			CollisionMesh->SetVisibility(false);
+			CollisionMesh->SetCastShadow(false);
+			CollisionMesh->bUseAsyncCooking = true;
+			CollisionMesh->CreationMethod = EComponentCreationMethod::UserConstructionScript;
+			CollisionMesh->AttachToComponent(GetRootComponent(), FAttachmentTransformRules::KeepRelativeTransform);
+			CollisionMesh->SetCollisionEnabled(ECollisionEnabled::PhysicsOnly);
+			CollisionMesh->SetCollisionProfileName(TEXT("BlockAll"));
+
+			MergedTrackCollisionComponents.SetNum(ClusterIndex + 1);
+			MergedTrackCollisionComponents[ClusterIndex] = CollisionMesh;
+		}
+
+		// Hidden until the collision has cooked, the segments under it are still drawn and colliding
+		MergedMesh->SetVisibility(false);
+		MergedMesh->RegisterComponentWithWorld(GetWorld());
+		CollisionMesh->RegisterComponentWithWorld(GetWorld());
+
+		for (int32 SectionIndex = 0; SectionIndex < Cluster.Sections.Num(); SectionIndex++)
+		{
+			FMergedTrackSection& Section = Cluster.Sections[SectionIndex];
+			const FProcMeshSection* ExistingSection = MergedMesh->GetProcMeshSection(SectionIndex);
+
+			// Full clusters of a regenerated track have the same topology, only the vertex data has to be updated
+			if (ExistingSection != nullptr && ExistingSection->ProcVertexBuffer.Num() == Section.Vertices.Num()
+				&& ExistingSection->ProcIndexBuffer.Num() == Section.Triangles.Num())
+			{
+				MergedMesh->UpdateMeshSection(SectionIndex, Section.Vertices, Section.Normals,
+					Section.UVs, TArray<FColor>(), Section.Tangents);
+			}
+			else
+			{
+				MergedMesh->CreateMeshSection(SectionIndex, Section.Vertices, Section.Triangles, Section.Normals,
+					Section.UVs, TArray<FColor>(), Section.Tangents, false);
+			}
+
+			MergedMesh->SetMaterial(SectionIndex, TrackMesh->GetMaterial(SectionIndex));
+		}
+
+		// One section is one async cook, the component swaps in a new body setup once it has finished
+		FPendingMergedCluster& Pending = PendingMergedClusters.Emplace_GetRef();
+		Pending.ClusterIndex = ClusterIndex;
+		Pending.FirstSegment = Cluster.FirstSegment;
+		Pending.SegmentsNum = Cluster.SegmentsNum;
+		Pending.PreviousBodySetup = CollisionMesh->GetBodySetup();
+
+		CollisionMesh->CreateMeshSection(0, Cluster.CollisionVertices, Cluster.CollisionTriangles, TArray<FVector>(),
+			TArray<FVector2D>(), TArray<FColor>(), TArray<FProcMeshTangent>(), true);
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("ATrackGenerator::SwapInMergedClusters Merging %d track segments into %d meshes"),
+		ActiveTrackMeshesNum, Clusters.Num());
+
+	CookedMergedClustersTimer.BindUObject(this, &ATrackGenerator::FinishCookedMergedClusters);
+	FinishCookedMergedClusters();
+}
+
+void ATrackGenerator::FinishCookedMergedClusters()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(ATrackGenerator::FinishCookedMergedClusters);
+
+	// Outside of game worlds the procedural mesh cooks right away and keeps its body setup
+	const bool bCooksAsync = GetWorld() != nullptr && GetWorld()->IsGameWorld();
+
+	for (int32 PendingIndex = PendingMergedClusters.Num() - 1; PendingIndex >= 0; PendingIndex--)
+	{
+		const FPendingMergedCluster& Pending = PendingMergedClusters[PendingIndex];
+		UProceduralMeshComponent* CollisionMesh = MergedTrackCollisionComponents[Pending.ClusterIndex];
+
+		if (bCooksAsync && CollisionMesh->GetBodySetup() == Pending.PreviousBodySetup.Get())
+		{
+			continue;
+		}
+
+		MergedTrackMeshComponents[Pending.ClusterIndex]->SetVisibility(true);
+
+		// The segments stay around unregistered, so they no longer have a scene proxy or a physics body
+		const int32 LastSegment = Pending.FirstSegment + Pending.SegmentsNum;
+		for (int32 SegmentIndex = Pending.FirstSegment; SegmentIndex < LastSegment; SegmentIndex++)
+		{
+			USplineMeshComponent* SplineMeshComponent = TrackMeshComponents[SegmentIndex];
+			if (SplineMeshComponent != nullptr)
+			{
+				SplineMeshComponent->UnregisterComponent();
+			}
+		}
+
+		PendingMergedClusters.RemoveAtSwap(PendingIndex);
+	}
+
+	if (!PendingMergedClusters.IsEmpty())
+	{
+		GetWorld()->GetTimerManager().SetTimerForNextTick(CookedMergedClustersTimer);
+		return;
+	}
+
+	// Unbound first, the callback may start the next build
+	const FOnWorkFinished Callback = PendingMergeCallback;
+	PendingMergeCallback.Unbind();
+	Callback.ExecuteIfBound();
+}
+
 #pragma endregion
\ No newline at end of file
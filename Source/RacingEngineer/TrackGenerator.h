@@ -5,6 +5,8 @@
 #include "CoreMinimal.h"
 #include "WorkerActor.h"
 #include "GameFramework/Actor.h"
+#include "ProceduralMeshComponent.h"
+#include "Components/SplineMeshComponent.h"
 #include "TrackGenerator.generated.h"
 
 USTRUCT()
@@ -19,6 +21,58 @@ struct FTrackSplineSpawnData
 	FName SplineMeshName;
 };
 
+struct FMergedTrackSection
+{
+	TArray<FVector> Vertices;
+	TArray<int32> Triangles;
+	TArray<FVector> Normals;
+	TArray<FVector2D> UVs;
+	TArray<FProcMeshTangent> Tangents;
+};
+
+// Everything a spline mesh segment deforms its mesh with, copied on the game thread so the merge never touches the component
+struct FTrackSegmentSnapshot
+{
+	FSplineMeshParams SplineParams;
+	FVector SplineUpDir = FVector::UpVector;
+	TEnumAsByte<ESplineMeshAxis::Type> ForwardAxis = ESplineMeshAxis::X;
+	bool bSmoothInterpRollScale = false;
+
+	// Extent of the mesh along the forward axis that is stretched over the spline
+	float MeshMinAlong = 0.0f;
+	float MeshRangeAlong = 1.0f;
+
+	FTransform RelativeTransform;
+
+	static FTrackSegmentSnapshot Make(const USplineMeshComponent& Segment);
+
+	// Port of USplineMeshComponent::CalcSliceTransform, RacingEngineer.TrackGenerator.SliceTransformMatchesSplineMesh keeps them in step
+	FTransform CalcSliceTransform(const float DistanceAlong) const;
+};
+
+struct FMergedTrackCluster
+{
+	// One entry per section of the source TrackMesh
+	TArray<FMergedTrackSection> Sections;
+	int32 FirstSegment = 0;
+	int32 SegmentsNum = 0;
+
+	// Every section in one, so the collision of the cluster is cooked once
+	TArray<FVector> CollisionVertices;
+	TArray<int32> CollisionTriangles;
+};
+
+// Cluster whose collision is still cooking, its segments keep rendering and colliding until it has
+struct FPendingMergedCluster
+{
+	int32 ClusterIndex = 0;
+	int32 FirstSegment = 0;
+	int32 SegmentsNum = 0;
+
+	// The component swaps its body setup for the cooked one once the async cook finishes
+	TWeakObjectPtr<UBodySetup> PreviousBodySetup;
+};
+
 UCLASS()
 class RACINGENGINEER_API ATrackGenerator : public AWorkerActor
 {
@@ -37,6 +91,9 @@ public:
 	virtual void Tick(float DeltaTime) override;
 
 	virtual void DoWork(const FWorkerData& Data, const FOnWorkFinished Callback) override;
+	virtual void ResetWork() override;
+	virtual FWorkerMemoryUsage GetRetainedMemory() const override;
+
 	UFUNCTION()
 	FVector GetTrackMeshSize() const;
 public:
@@ -51,6 +108,14 @@ private:
 	void PrepareTrackSplineMeshData(const USplineComponent* TrackSpline, const FVector&  MeshSize);
 	void SpawnTrackBasedOnPreparedData(TArray<FTrackSplineSpawnData>& TrackSpawnData, FOnWorkFinished Callback);
 
+	void MergeTrackSegments(FOnWorkFinished Callback);
+	static void BuildMergedCluster(FMergedTrackCluster& Cluster, const TArray<FMergedTrackSection>& SourceSections,
+		TConstArrayView<FTrackSegmentSnapshot> Segments);
+	void SwapInMergedClusters(TArray<FMergedTrackCluster>& Clusters, FOnWorkFinished Callback);
+
+	// Swaps the clusters whose collision has cooked in for their segments, finishes the work once all have
+	void FinishCookedMergedClusters();
+
 private:
 	UPROPERTY(EditAnywhere)
 	double TangentScalar = 0.5;
@@ -58,7 +123,29 @@ private:
 	UPROPERTY(EditAnywhere)
 	int32 BatchSize = 5;
 
+	// Bakes the deformed segments of every track region into one procedural mesh with a single collision body
+	UPROPERTY(EditAnywhere, Category = "Merging")
+	bool bMergeTrackSegments = true;
+
+	UPROPERTY(EditAnywhere, Category = "Merging", meta = (ClampMin = 1))
+	int32 SegmentsPerMergedMesh = 32;
+
 	TArray<FTrackSplineSpawnData> TrackMeshSpawnData;
 	int32 TrackMeshSpawned = 0;
+	int32 ActiveTrackMeshesNum = 0;
 	FTimerDelegate SpawnBatchTrackMeshTimer;
+
+	UPROPERTY(VisibleAnywhere)
+	TArray<TObjectPtr<USplineMeshComponent>> TrackMeshComponents;
+
+	UPROPERTY(VisibleAnywhere)
+	TArray<TObjectPtr<UProceduralMeshComponent>> MergedTrackMeshComponents;
+
+	// Hidden, one per merged mesh, their single section is the collision of every section of it
+	UPROPERTY(VisibleAnywhere)
+	TArray<TObjectPtr<UProceduralMeshComponent>> MergedTrackCollisionComponents;
+
+	TArray<FPendingMergedCluster> PendingMergedClusters;
+	FOnWorkFinished PendingMergeCallback;
+	FTimerDelegate CookedMergedClustersTimer;
 };
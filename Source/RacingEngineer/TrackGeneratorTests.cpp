@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TrackGenerator.h"
+
+#include "Misc/AutomationTest.h"
+#include "Components/SplineMeshComponent.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTrackSegmentSliceTransformTest, "RacingEngineer.TrackGenerator.SliceTransformMatchesSplineMesh",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTrackSegmentSliceTransformTest::RunTest(const FString& Parameters)
+{
+	USplineMeshComponent* Segment = NewObject<USplineMeshComponent>(GetTransientPackage());
+
+	Segment->SplineParams.StartPos = FVector(-120.0, 40.0, 10.0);
+	Segment->SplineParams.StartTangent = FVector(600.0, 150.0, 40.0);
+	Segment->SplineParams.EndPos = FVector(480.0, 260.0, 35.0);
+	Segment->SplineParams.EndTangent = FVector(500.0, -220.0, -10.0);
+	Segment->SplineParams.StartOffset = FVector2D(5.0, -3.0);
+	Segment->SplineParams.EndOffset = FVector2D(-2.0, 8.0);
+	Segment->SplineParams.StartRoll = 0.1f;
+	Segment->SplineParams.EndRoll = -0.35f;
+	Segment->SplineParams.StartScale = FVector2D(1.0, 1.5);
+	Segment->SplineParams.EndScale = FVector2D(0.75, 2.0);
+	Segment->SplineUpDir = FVector(0.1, 0.0, 1.0).GetSafeNormal();
+
+	// The bounds decide where a distance along lands on the spline, so the static mesh is never needed
+	Segment->SplineBoundaryMin = -50.0f;
+	Segment->SplineBoundaryMax = 250.0f;
+
+	// Past both ends as well, the merge extrapolates there like the vertex factory
+	const float Distances[] = { -120.0f, -50.0f, 0.0f, 37.5f, 100.0f, 199.0f, 250.0f, 400.0f };
+
+	for (const ESplineMeshAxis::Type ForwardAxis : { ESplineMeshAxis::X, ESplineMeshAxis::Y, ESplineMeshAxis::Z })
+	{
+		for (const bool bSmoothInterpRollScale : { false, true })
+		{
+			Segment->ForwardAxis = ForwardAxis;
+			Segment->bSmoothInterpRollScale = bSmoothInterpRollScale;
+
+			const FTrackSegmentSnapshot Snapshot = FTrackSegmentSnapshot::Make(*Segment);
+
+			for (const float DistanceAlong : Distances)
+			{
+				const FTransform Expected = Segment->CalcSliceTransform(DistanceAlong);
+				const FTransform Actual = Snapshot.CalcSliceTransform(DistanceAlong);
+
+				if (!Actual.Equals(Expected, 0.01))
+				{
+					AddError(FString::Printf(TEXT("Axis %d, smooth %d, distance %.1f: expected %s, got %s"),
+						static_cast<int32>(ForwardAxis), bSmoothInterpRollScale, DistanceAlong,
+						*Expected.ToString(), *Actual.ToString()));
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+#endif
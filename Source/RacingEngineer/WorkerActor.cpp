@@ -3,6 +3,35 @@
 
 #include "WorkerActor.h"
 #include "Async/Async.h"
+#include "EngineUtils.h"
+#include "ProceduralMeshComponent.h"
+
+static void ReportWorkersMemory(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+{
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	FWorkerMemoryUsage Total;
+	for (TActorIterator<AWorkerActor> It(World); It; ++It)
+	{
+		const FWorkerMemoryUsage Usage = It->GetRetainedMemory();
+		Total.BuildBuffers += Usage.BuildBuffers;
+		Total.ComponentData += Usage.ComponentData;
+
+		Ar.Logf(TEXT("%-40s build buffers %10.2f KB, component data %10.2f KB"),
+			*It->GetName(), Usage.BuildBuffers / 1024.0, Usage.ComponentData / 1024.0);
+	}
+
+	Ar.Logf(TEXT("%-40s build buffers %10.2f KB, component data %10.2f KB"),
+		TEXT("Total"), Total.BuildBuffers / 1024.0, Total.ComponentData / 1024.0);
+}
+
+static FAutoConsoleCommandWithWorldArgsAndOutputDevice WorkerMemReportCommand(
+	TEXT("RacingEngineer.WorkerMemReport"),
+	TEXT("Lists the bytes every map build worker keeps after the build"),
+	FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&ReportWorkersMemory));
 
 // Sets default values
 AWorkerActor::AWorkerActor()
@@ -16,6 +45,39 @@ void AWorkerActor::DoWork(const FWorkerData& Data, const FOnWorkFinished Callbac
 {
 }
 
+void AWorkerActor::ResetWork()
+{
+}
+
+void AWorkerActor::GatherBuildSettings(FMapBuildSettings& OutSettings) const
+{
+}
+
+FWorkerMemoryUsage AWorkerActor::GetRetainedMemory() const
+{
+	return FWorkerMemoryUsage();
+}
+
+SIZE_T AWorkerActor::GetProcMeshSectionsSize(const UProceduralMeshComponent* ProceduralMesh)
+{
+	SIZE_T Size = 0;
+
+	if (ProceduralMesh != nullptr)
+	{
+		for (int32 SectionIndex = 0; SectionIndex < ProceduralMesh->GetNumSections(); SectionIndex++)
+		{
+			// GetProcMeshSection isn't const, the section is only read
+			const FProcMeshSection* Section = const_cast<UProceduralMeshComponent*>(ProceduralMesh)->GetProcMeshSection(SectionIndex);
+			if (Section != nullptr)
+			{
+				Size += Section->ProcVertexBuffer.GetAllocatedSize() + Section->ProcIndexBuffer.GetAllocatedSize();
+			}
+		}
+	}
+
+	return Size;
+}
+
 // Called when the game starts or when spawned
 void AWorkerActor::BeginPlay()
 {
@@ -5,16 +5,33 @@
 #include "CoreMinimal.h"
 #include "Components/SplineComponent.h"
 #include "GameFramework/Actor.h"
+#include "MapBuildPipeline.h"
 #include "WorkerActor.generated.h"
 
+class UProceduralMeshComponent;
+
 DECLARE_DELEGATE(FOnWorkFinished);
 
+// Bytes a worker keeps alive once its work is done
+struct FWorkerMemoryUsage
+{
+	// CPU side build output still held by the worker itself
+	SIZE_T BuildBuffers = 0;
+
+	// Copies owned by the worker's components, like mesh sections and instance data
+	SIZE_T ComponentData = 0;
+};
+
 USTRUCT()
 struct FWorkerData
 {
 	GENERATED_BODY()
 
-	TArray<uint8> HeightData;
+	// Shared by all workers, each of them may move out the parts that only it uses
+	TSharedPtr<FMapBuildData> BuildData;
+
+	// Taken out of BuildData before the workers start, only the terrain draws it
+	TSharedPtr<const FTerrainMeshData> TerrainMesh;
 	uint32 TextureWidth;
 	uint32 TextureHeight;
 	UPROPERTY()
@@ -22,7 +39,8 @@ struct FWorkerData
 	FVector VertScale;
 
 	FWorkerData()
-		: HeightData()
+		: BuildData()
+		, TerrainMesh()
 		, TextureWidth(0)
 	    , TextureHeight(0)
 		, TrackSpline(nullptr)
@@ -30,13 +48,13 @@ struct FWorkerData
 	{
 	}
 
-	FWorkerData(const TArray<uint8>& InHeightData, const uint32 InTextureWidth, const uint32 InTextureHeight, 
-		const USplineComponent* InTrackSpline, const FVector& InVertScale)
-		: HeightData(InHeightData)
-		, TextureWidth(InTextureWidth)
-		, TextureHeight(InTextureHeight)
+	FWorkerData(const TSharedRef<FMapBuildData>& InBuildData, const USplineComponent* InTrackSpline)
+		: BuildData(InBuildData)
+		, TerrainMesh()
+		, TextureWidth(InBuildData->Width)
+		, TextureHeight(InBuildData->Height)
 		, TrackSpline(InTrackSpline)
-		, VertScale(InVertScale)
+		, VertScale(InBuildData->Settings.VertScale)
 	{
 	}
 };
@@ -52,10 +70,21 @@ public:
 
 	virtual void DoWork(const FWorkerData& Data, const FOnWorkFinished Callback);
 
+	// Tears down the results of the previous DoWork, spawned components and actors are kept for reuse
+	virtual void ResetWork();
+
+	// Adds the worker's own inputs to the settings of the CPU side of the map build
+	virtual void GatherBuildSettings(FMapBuildSettings& OutSettings) const;
+
+	// Listed by the RacingEngineer.WorkerMemReport console command
+	virtual FWorkerMemoryUsage GetRetainedMemory() const;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	static SIZE_T GetProcMeshSectionsSize(const UProceduralMeshComponent* ProceduralMesh);
+
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
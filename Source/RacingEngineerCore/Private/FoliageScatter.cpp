@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FoliageScatter.h"
+
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+void FFoliageScatter::Scatter(TConstArrayView<FVector3f> Vertices, TConstArrayView<float> TrackDistance, const FFoliageScatterSettings& Settings,
+	TArray<FTransform>& OutGrassTransforms, TArray<FTransform>& OutRocksTransforms, TArray<FTransform>& OutTreesTransforms)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FFoliageScatter::Scatter);
+
+	OutGrassTransforms.Reset(Settings.MaxGrass);
+	OutRocksTransforms.Reset(Settings.MaxRocks);
+	OutTreesTransforms.Reset(Settings.MaxTrees);
+
+	FRandomStream RandomStream(Settings.Seed);
+
+	ScatterBand(Vertices, TrackDistance, Settings, RandomStream, OutGrassTransforms, OutRocksTransforms, OutTreesTransforms);
+}
+
+void FFoliageScatter::ScatterBand(TConstArrayView<FVector3f> Vertices, TConstArrayView<float> TrackDistance, const FFoliageScatterSettings& Settings,
+	FRandomStream& RandomStream, TArray<FTransform>& OutGrassTransforms, TArray<FTransform>& OutRocksTransforms, TArray<FTransform>& OutTreesTransforms)
+{
+	check(Vertices.Num() == TrackDistance.Num());
+
+	auto AddTransform = [&RandomStream](TArray<FTransform>& Transforms, const FVector& Location)
+	{
+		const float RandomScale = RandomStream.FRandRange(0.5f, 3.0f);
+		const float RandomYaw = RandomStream.RandRange(0, 360);
+
+		Transforms.Emplace(FRotator(0, RandomYaw, 0).Quaternion(), Location, FVector(RandomScale));
+	};
+
+	for (int32 Index = 0; Index < Vertices.Num(); Index++)
+	{
+		if (TrackDistance[Index] <= Settings.MinTrackDistance)
+		{
+			continue;
+		}
+
+		const FVector Location(Vertices[Index]);
+
+		if (RandomStream.FRand() < Settings.GrassProbability && OutGrassTransforms.Num() < Settings.MaxGrass)
+		{
+			AddTransform(OutGrassTransforms, Location);
+		}
+		else if (RandomStream.FRand() < Settings.RocksProbability && OutRocksTransforms.Num() < Settings.MaxRocks)
+		{
+			AddTransform(OutRocksTransforms, Location);
+		}
+		else if (RandomStream.FRand() < Settings.TreesProbability && OutTreesTransforms.Num() < Settings.MaxTrees)
+		{
+			AddTransform(OutTreesTransforms, Location);
+		}
+	}
+}
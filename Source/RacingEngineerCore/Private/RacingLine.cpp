@@ -0,0 +1,254 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RacingLine.h"
+
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+namespace RacingLine
+{
+	/**
+	 *  Line being relaxed, the samples of a level are every Stride-th one of the whole loop.
+	 */
+	class FRelaxation
+	{
+	public:
+		FRelaxation(TConstArrayView<FVector> InCentres, TConstArrayView<FVector> Directions, float InMaxOffset, TArray<float>& InOffsets)
+			: Offsets(InOffsets)
+			, MaxOffset(InMaxOffset)
+			, SamplesNum(InCentres.Num())
+		{
+			Centres.SetNumUninitialized(SamplesNum);
+			Normals.SetNumUninitialized(SamplesNum);
+			Points.SetNumUninitialized(SamplesNum);
+
+			for (int32 Index = 0; Index < SamplesNum; Index++)
+			{
+				Centres[Index] = FVector2D(InCentres[Index]);
+				Normals[Index] = FVector2D(-Directions[Index].Y, Directions[Index].X).GetSafeNormal();
+				Points[Index] = Centres[Index] + Normals[Index] * Offsets[Index];
+			}
+		}
+
+		// Aims every level sample at the curvature of its neighbours, weighted by how close each of them is
+		void Smooth(int32 Stride)
+		{
+			const int32 LevelNum = GetLevelNum(Stride);
+
+			for (int32 LevelIndex = 0; LevelIndex < LevelNum; LevelIndex++)
+			{
+				const int32 Previous2 = GetLevelSample(LevelIndex - 2, Stride);
+				const int32 Previous = GetLevelSample(LevelIndex - 1, Stride);
+				const int32 Index = GetLevelSample(LevelIndex, Stride);
+				const int32 Next = GetLevelSample(LevelIndex + 1, Stride);
+				const int32 Next2 = GetLevelSample(LevelIndex + 2, Stride);
+
+				const float PreviousCurvature = FRacingLine::GetCurvature(Points[Previous2], Points[Previous], Points[Index]);
+				const float NextCurvature = FRacingLine::GetCurvature(Points[Index], Points[Next], Points[Next2]);
+				const double PreviousLength = FVector2D::Distance(Points[Index], Points[Previous]);
+				const double NextLength = FVector2D::Distance(Points[Index], Points[Next]);
+
+				const float TargetCurvature = PreviousLength + NextLength > UE_DOUBLE_SMALL_NUMBER
+					? (NextLength * PreviousCurvature + PreviousLength * NextCurvature) / (PreviousLength + NextLength)
+					: 0.0f;
+
+				Adjust(Previous, Index, Next, TargetCurvature);
+			}
+		}
+
+		// Places the samples between two level samples on a curvature blended from both ends, for the next level to start from
+		void Interpolate(int32 Stride)
+		{
+			const int32 LevelNum = GetLevelNum(Stride);
+
+			for (int32 LevelIndex = 0; LevelIndex < LevelNum; LevelIndex++)
+			{
+				const int32 Previous = GetLevelSample(LevelIndex - 1, Stride);
+				const int32 Start = GetLevelSample(LevelIndex, Stride);
+				const int32 End = GetLevelSample(LevelIndex + 1, Stride);
+				const int32 Next = GetLevelSample(LevelIndex + 2, Stride);
+
+				// The last segment closes the loop and is shorter when the samples don't divide by the stride
+				const int32 Unwrapped = End > Start ? End : SamplesNum;
+
+				const float StartCurvature = FRacingLine::GetCurvature(Points[Previous], Points[Start], Points[End]);
+				const float EndCurvature = FRacingLine::GetCurvature(Points[Start], Points[End], Points[Next]);
+
+				for (int32 Index = Start + 1; Index < Unwrapped; Index++)
+				{
+					const float Alpha = static_cast<float>(Index - Start) / (Unwrapped - Start);
+
+					SetOffset(Index, FMath::Lerp(Offsets[Start], Offsets[End], Alpha));
+					Adjust(Start, Index, End, FMath::Lerp(StartCurvature, EndCurvature, Alpha));
+				}
+			}
+		}
+
+		int32 GetLevelNum(int32 Stride) const
+		{
+			return (SamplesNum + Stride - 1) / Stride;
+		}
+
+	private:
+		int32 GetLevelSample(int32 LevelIndex, int32 Stride) const
+		{
+			const int32 LevelNum = GetLevelNum(Stride);
+			return ((LevelIndex % LevelNum + LevelNum) % LevelNum) * Stride;
+		}
+
+		void SetOffset(int32 Index, double Offset)
+		{
+			Offsets[Index] = static_cast<float>(FMath::Clamp(Offset, -MaxOffset, MaxOffset));
+			Points[Index] = Centres[Index] + Normals[Index] * Offsets[Index];
+		}
+
+		// Puts the sample on the chord between its neighbours, then takes one Newton step from there to the target curvature
+		void Adjust(int32 Previous, int32 Index, int32 Next, float TargetCurvature)
+		{
+			const FVector2D Chord = Points[Next] - Points[Previous];
+			const double ChordCrossNormal = FVector2D::CrossProduct(Chord, Normals[Index]);
+			if (FMath::Abs(ChordCrossNormal) <= UE_DOUBLE_SMALL_NUMBER)
+			{
+				return;
+			}
+
+			SetOffset(Index, -FVector2D::CrossProduct(Chord, Centres[Index] - Points[Previous]) / ChordCrossNormal);
+
+			const double OffsetDelta = 0.01 * FMath::Max(Chord.Size(), 1.0);
+			const float Curvature = FRacingLine::GetCurvature(Points[Previous], Points[Index], Points[Next]);
+			const float MovedCurvature = FRacingLine::GetCurvature(Points[Previous], Points[Index] + Normals[Index] * OffsetDelta, Points[Next]);
+
+			const double CurvatureSlope = (MovedCurvature - Curvature) / OffsetDelta;
+			if (FMath::Abs(CurvatureSlope) > UE_DOUBLE_SMALL_NUMBER)
+			{
+				SetOffset(Index, Offsets[Index] + (TargetCurvature - Curvature) / CurvatureSlope);
+			}
+		}
+
+		TArray<FVector2D> Centres;
+		TArray<FVector2D> Normals;
+		TArray<FVector2D> Points;
+		TArray<float>& Offsets;
+
+		double MaxOffset = 0.0;
+		int32 SamplesNum = 0;
+	};
+}
+
+void FRacingLine::SolveOffsets(TConstArrayView<FVector> Centres, TConstArrayView<FVector> Directions, const FRacingLineSettings& Settings,
+	TArray<float>& OutOffsets)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRacingLine::SolveOffsets);
+
+	check(Centres.Num() == Directions.Num());
+
+	const int32 SamplesNum = Centres.Num();
+	OutOffsets.Init(0.0f, SamplesNum);
+
+	// Every sample needs two neighbours on either side
+	const int32 MinLevelSamples = FMath::Max(Settings.MinLevelSamples, 5);
+	if (SamplesNum < MinLevelSamples || Settings.MaxOffset <= 0.0f)
+	{
+		return;
+	}
+
+	RacingLine::FRelaxation Relaxation(Centres, Directions, Settings.MaxOffset, OutOffsets);
+
+	int32 Stride = 1;
+	while (Stride * 2 <= Settings.CoarsestStride && Relaxation.GetLevelNum(Stride * 2) >= MinLevelSamples)
+	{
+		Stride *= 2;
+	}
+
+	for (; Stride >= 1; Stride /= 2)
+	{
+		const int32 Iterations = FMath::CeilToInt32(Settings.Iterations * FMath::Sqrt(static_cast<float>(Stride)));
+		for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			Relaxation.Smooth(Stride);
+		}
+
+		if (Stride > 1)
+		{
+			Relaxation.Interpolate(Stride);
+		}
+	}
+}
+
+void FRacingLine::SolveSpeeds(TConstArrayView<FVector> LinePoints, const FRacingLineSettings& Settings, TArray<float>& OutSpeeds)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRacingLine::SolveSpeeds);
+
+	const int32 SamplesNum = LinePoints.Num();
+	OutSpeeds.Init(Settings.MaxSpeed, SamplesNum);
+
+	if (SamplesNum < 3)
+	{
+		return;
+	}
+
+	// Steps[i] is the distance from sample i to the next one
+	TArray<float> Steps;
+	TArray<float> Curvatures;
+	Steps.SetNumUninitialized(SamplesNum);
+	Curvatures.SetNumUninitialized(SamplesNum);
+
+	int32 SlowestIndex = 0;
+
+	for (int32 Index = 0; Index < SamplesNum; Index++)
+	{
+		const FVector2D Previous(LinePoints[(Index + SamplesNum - 1) % SamplesNum]);
+		const FVector2D Current(LinePoints[Index]);
+		const FVector2D Next(LinePoints[(Index + 1) % SamplesNum]);
+
+		Steps[Index] = FVector::Dist(LinePoints[Index], LinePoints[(Index + 1) % SamplesNum]);
+		Curvatures[Index] = FMath::Abs(GetCurvature(Previous, Current, Next));
+
+		if (Curvatures[Index] > UE_KINDA_SMALL_NUMBER)
+		{
+			OutSpeeds[Index] = FMath::Min(Settings.MaxSpeed, FMath::Sqrt(Settings.MaxLateralAcceleration / Curvatures[Index]));
+		}
+
+		if (OutSpeeds[Index] < OutSpeeds[SlowestIndex])
+		{
+			SlowestIndex = Index;
+		}
+	}
+
+	auto GetLongitudinalGrip = [&Settings](float Speed, float Curvature, float MaxLongitudinal)
+	{
+		const float LateralUsed = FMath::Clamp(Speed * Speed * Curvature / Settings.MaxLateralAcceleration, 0.0f, 1.0f);
+		return MaxLongitudinal * FMath::Sqrt(1.0f - LateralUsed * LateralUsed);
+	};
+
+	// The slowest sample is bound by its curvature alone, so both passes can start there and go once around the loop
+	for (int32 Step = 1; Step < SamplesNum; Step++)
+	{
+		const int32 Index = (SlowestIndex + Step) % SamplesNum;
+		const int32 Previous = (Index + SamplesNum - 1) % SamplesNum;
+
+		const float Grip = GetLongitudinalGrip(OutSpeeds[Previous], Curvatures[Previous], Settings.MaxAcceleration);
+		OutSpeeds[Index] = FMath::Min(OutSpeeds[Index], FMath::Sqrt(FMath::Square(OutSpeeds[Previous]) + 2.0f * Grip * Steps[Previous]));
+	}
+
+	for (int32 Step = 1; Step < SamplesNum; Step++)
+	{
+		const int32 Index = (SlowestIndex + SamplesNum - Step) % SamplesNum;
+		const int32 Next = (Index + 1) % SamplesNum;
+
+		const float Grip = GetLongitudinalGrip(OutSpeeds[Next], Curvatures[Next], Settings.MaxDeceleration);
+		OutSpeeds[Index] = FMath::Min(OutSpeeds[Index], FMath::Sqrt(FMath::Square(OutSpeeds[Next]) + 2.0f * Grip * Steps[Index]));
+	}
+}
+
+float FRacingLine::GetCurvature(const FVector2D& Previous, const FVector2D& Current, const FVector2D& Next)
+{
+	// Inverse radius of the circle through the three points
+	const double Denominator = FVector2D::Distance(Previous, Current) * FVector2D::Distance(Current, Next) * FVector2D::Distance(Previous, Next);
+	if (Denominator <= UE_DOUBLE_SMALL_NUMBER)
+	{
+		return 0.0f;
+	}
+
+	return static_cast<float>(2.0 * FVector2D::CrossProduct(Current - Previous, Next - Current) / Denominator);
+}
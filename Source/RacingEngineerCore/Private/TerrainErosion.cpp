@@ -0,0 +1,319 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainErosion.h"
+
+#include "Async/ParallelFor.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+namespace TerrainErosion
+{
+	// Right, down, left, up, so the opposite of direction i is (i + 2) % 4
+	constexpr int32 DirectionsNum = 4;
+	const FIntPoint Directions[DirectionsNum] = { FIntPoint(1, 0), FIntPoint(0, 1), FIntPoint(-1, 0), FIntPoint(0, -1) };
+
+	// Six buffers of FErosion, its outflows and the erodability
+	constexpr int32 FloatsPerTexel = 6 + DirectionsNum + 1;
+
+	// Same value for the same seed, iteration and texel, whichever task asks
+	float GetRain(const int32 Seed, const int32 Iteration, const int32 Index, const float RainAmount)
+	{
+		uint32 Hash = HashCombineFast(HashCombineFast(static_cast<uint32>(Seed), static_cast<uint32>(Iteration)), static_cast<uint32>(Index));
+		Hash ^= Hash >> 16;
+		Hash *= 0x7feb352d;
+		Hash ^= Hash >> 15;
+		Hash *= 0x846ca68b;
+		Hash ^= Hash >> 16;
+
+		return RainAmount * (0.5f + (Hash & 0xFFFFFF) / static_cast<float>(0x1000000));
+	}
+
+	/**
+	 *  Water, sediment and heights of one run, each with a buffer to write the next iteration into.
+	 */
+	class FErosion
+	{
+	public:
+		FErosion(TArray<float>&& InHeights, TConstArrayView<float> InErodability, const uint32 InWidth, const uint32 InHeight,
+			const FTerrainErosionSettings& InSettings)
+			: Heights(MoveTemp(InHeights))
+			, Erodability(InErodability)
+			, Width(InWidth)
+			, Height(InHeight)
+			, Settings(InSettings)
+		{
+			const int32 TexelsNum = Width * Height;
+
+			NextHeights.SetNumUninitialized(TexelsNum);
+			Water.SetNumUninitialized(TexelsNum);
+			NextWater.SetNumUninitialized(TexelsNum);
+			Sediment.SetNumZeroed(TexelsNum);
+			NextSediment.SetNumUninitialized(TexelsNum);
+			Outflows.SetNumUninitialized(TexelsNum * DirectionsNum);
+
+			for (int32 Index = 0; Index < TexelsNum; Index++)
+			{
+				Water[Index] = GetRain(Settings.Seed, 0, Index, Settings.RainAmount);
+			}
+
+			TalusHeight = FMath::Tan(FMath::DegreesToRadians(Settings.TalusAngleDegrees)) * Settings.CellSize;
+			TilesNum = FMath::DivideAndRoundUp(Height, static_cast<uint32>(FMath::Max(1, Settings.TileRows)));
+		}
+
+		void Iterate(const int32 Iteration)
+		{
+			ForEachTexel([this](const int32 X, const int32 Y, const int32 Index) { CalculateOutflows(X, Y, Index); });
+			ForEachTexel([this, Iteration](const int32 X, const int32 Y, const int32 Index) { TransportSediment(X, Y, Index, Iteration); });
+
+			Swap(Heights, NextHeights);
+			Swap(Water, NextWater);
+			Swap(Sediment, NextSediment);
+
+			ForEachTexel([this](const int32 X, const int32 Y, const int32 Index) { RelaxTalus(X, Y, Index); });
+
+			Swap(Heights, NextHeights);
+		}
+
+		// Sediment still in the water settles where it is
+		void Settle()
+		{
+			for (int32 Index = 0; Index < Heights.Num(); Index++)
+			{
+				Heights[Index] += Sediment[Index] * Erodability[Index];
+			}
+		}
+
+		TArray<float> TakeHeights()
+		{
+			return MoveTemp(Heights);
+		}
+
+	private:
+		template <typename FunctionType>
+		void ForEachTexel(FunctionType&& Function)
+		{
+			const int32 TileRows = FMath::Max(1, Settings.TileRows);
+
+			ParallelFor(TilesNum, [this, TileRows, &Function](int32 Tile)
+				{
+					const int32 FirstRow = Tile * TileRows;
+					const int32 EndRow = FMath::Min(FirstRow + TileRows, static_cast<int32>(Height));
+
+					for (int32 Y = FirstRow; Y < EndRow; Y++)
+					{
+						for (int32 X = 0; X < static_cast<int32>(Width); X++)
+						{
+							Function(X, Y, Y * Width + X);
+						}
+					}
+				});
+		}
+
+		bool IsInside(const int32 X, const int32 Y) const
+		{
+			return X >= 0 && Y >= 0 && X < static_cast<int32>(Width) && Y < static_cast<int32>(Height);
+		}
+
+		// Water moves towards lower water surfaces, at most half of the largest drop so it levels instead of sloshing
+		void CalculateOutflows(const int32 X, const int32 Y, const int32 Index)
+		{
+			const float Surface = Heights[Index] + Water[Index];
+
+			float Drops[DirectionsNum];
+			float DropsSum = 0.0f;
+			float MaxDrop = 0.0f;
+
+			for (int32 Direction = 0; Direction < DirectionsNum; Direction++)
+			{
+				const int32 NeighbourX = X + Directions[Direction].X;
+				const int32 NeighbourY = Y + Directions[Direction].Y;
+
+				Drops[Direction] = 0.0f;
+				if (IsInside(NeighbourX, NeighbourY))
+				{
+					const int32 Neighbour = NeighbourY * Width + NeighbourX;
+					Drops[Direction] = FMath::Max(Surface - Heights[Neighbour] - Water[Neighbour], 0.0f);
+				}
+
+				DropsSum += Drops[Direction];
+				MaxDrop = FMath::Max(MaxDrop, Drops[Direction]);
+			}
+
+			const float Outflow = DropsSum > 0.0f ? FMath::Min(Water[Index], MaxDrop * 0.5f) / DropsSum : 0.0f;
+
+			for (int32 Direction = 0; Direction < DirectionsNum; Direction++)
+			{
+				Outflows[Index * DirectionsNum + Direction] = Drops[Direction] * Outflow;
+			}
+		}
+
+		// Moves water and the sediment in it, then erodes or deposits towards what the flow can carry
+		void TransportSediment(const int32 X, const int32 Y, const int32 Index, const int32 Iteration)
+		{
+			float Outflow = 0.0f;
+			float Inflow = 0.0f;
+			float SedimentInflow = 0.0f;
+
+			for (int32 Direction = 0; Direction < DirectionsNum; Direction++)
+			{
+				Outflow += Outflows[Index * DirectionsNum + Direction];
+
+				const int32 NeighbourX = X + Directions[Direction].X;
+				const int32 NeighbourY = Y + Directions[Direction].Y;
+				if (IsInside(NeighbourX, NeighbourY))
+				{
+					const int32 Neighbour = NeighbourY * Width + NeighbourX;
+					const float NeighbourInflow = Outflows[Neighbour * DirectionsNum + (Direction + 2) % DirectionsNum];
+
+					Inflow += NeighbourInflow;
+					SedimentInflow += Water[Neighbour] > 0.0f ? Sediment[Neighbour] * NeighbourInflow / Water[Neighbour] : 0.0f;
+				}
+			}
+
+			const float SedimentOutflow = Water[Index] > 0.0f ? Sediment[Index] * Outflow / Water[Index] : 0.0f;
+
+			float NewHeight = Heights[Index];
+			float NewSediment = Sediment[Index] - SedimentOutflow + SedimentInflow;
+
+			const float Capacity = Settings.SedimentCapacity * FMath::Max(GetSlope(X, Y), Settings.MinSlope) * 0.5f * (Inflow + Outflow);
+			const float Rate = Erodability[Index];
+
+			if (NewSediment > Capacity)
+			{
+				const float Deposited = Settings.DepositionRate * (NewSediment - Capacity) * Rate;
+				NewHeight += Deposited;
+				NewSediment -= Deposited;
+			}
+			else
+			{
+				// Never below the lowest neighbour, which would dig pits water can't leave
+				const float Eroded = FMath::Min(Settings.ErosionRate * (Capacity - NewSediment), FMath::Max(Heights[Index] - GetLowestNeighbour(X, Y), 0.0f)) * Rate;
+				NewHeight -= Eroded;
+				NewSediment += Eroded;
+			}
+
+			NextHeights[Index] = NewHeight;
+			NextSediment[Index] = FMath::Max(NewSediment, 0.0f);
+			NextWater[Index] = (Water[Index] - Outflow + Inflow) * (1.0f - Settings.Evaporation) + GetRain(Settings.Seed, Iteration + 1, Index, Settings.RainAmount);
+		}
+
+		// Material above the talus slope moves to the lower texel of each pair. Both texels of a pair move the same amount,
+		// so nothing is lost, and an eighth of the excess per neighbour keeps a texel from overshooting
+		void RelaxTalus(const int32 X, const int32 Y, const int32 Index)
+		{
+			float Delta = 0.0f;
+
+			for (int32 OffsetY = -1; OffsetY <= 1; OffsetY++)
+			{
+				for (int32 OffsetX = -1; OffsetX <= 1; OffsetX++)
+				{
+					const int32 NeighbourX = X + OffsetX;
+					const int32 NeighbourY = Y + OffsetY;
+					if ((OffsetX == 0 && OffsetY == 0) || !IsInside(NeighbourX, NeighbourY))
+					{
+						continue;
+					}
+
+					const int32 Neighbour = NeighbourY * Width + NeighbourX;
+					const float Difference = Heights[Index] - Heights[Neighbour];
+					const float Talus = OffsetX != 0 && OffsetY != 0 ? TalusHeight * UE_SQRT_2 : TalusHeight;
+					const float Excess = FMath::Abs(Difference) - Talus;
+
+					if (Excess > 0.0f)
+					{
+						const float Moved = Settings.ThermalRate * Excess * 0.5f / 8.0f * FMath::Min(Erodability[Index], Erodability[Neighbour]);
+						Delta -= FMath::Sign(Difference) * Moved;
+					}
+				}
+			}
+
+			NextHeights[Index] = Heights[Index] + Delta;
+		}
+
+		// Height difference per unit of distance, from central differences
+		float GetSlope(const int32 X, const int32 Y) const
+		{
+			const float Left = Heights[Y * Width + FMath::Max(X - 1, 0)];
+			const float Right = Heights[Y * Width + FMath::Min(X + 1, static_cast<int32>(Width) - 1)];
+			const float Up = Heights[FMath::Max(Y - 1, 0) * Width + X];
+			const float Down = Heights[FMath::Min(Y + 1, static_cast<int32>(Height) - 1) * Width + X];
+
+			return FVector2f(Right - Left, Down - Up).Size() / (2.0f * Settings.CellSize);
+		}
+
+		float GetLowestNeighbour(const int32 X, const int32 Y) const
+		{
+			float Lowest = Heights[Y * Width + X];
+
+			for (int32 Direction = 0; Direction < DirectionsNum; Direction++)
+			{
+				const int32 NeighbourX = X + Directions[Direction].X;
+				const int32 NeighbourY = Y + Directions[Direction].Y;
+				if (IsInside(NeighbourX, NeighbourY))
+				{
+					Lowest = FMath::Min(Lowest, Heights[NeighbourY * Width + NeighbourX]);
+				}
+			}
+
+			return Lowest;
+		}
+
+		TArray<float> Heights;
+		TArray<float> NextHeights;
+		TArray<float> Water;
+		TArray<float> NextWater;
+		TArray<float> Sediment;
+		TArray<float> NextSediment;
+
+		// Water each texel gives to each of its neighbours this iteration
+		TArray<float> Outflows;
+
+		TConstArrayView<float> Erodability;
+		uint32 Width = 0;
+		uint32 Height = 0;
+		const FTerrainErosionSettings& Settings;
+
+		float TalusHeight = 0.0f;
+		int32 TilesNum = 0;
+	};
+}
+
+int32 FTerrainErosion::GetIterations(const uint32 Width, const uint32 Height, const FTerrainErosionSettings& Settings)
+{
+	const int64 TexelsNum = static_cast<int64>(Width) * Height;
+	if (TexelsNum == 0 || Settings.Iterations <= 0 || GetMemoryBytes(Width, Height) > Settings.MaxMemoryBytes)
+	{
+		return 0;
+	}
+
+	return static_cast<int32>(FMath::Clamp<int64>(Settings.MaxTexelIterations / TexelsNum, 1, Settings.Iterations));
+}
+
+int64 FTerrainErosion::GetMemoryBytes(const uint32 Width, const uint32 Height)
+{
+	return static_cast<int64>(Width) * Height * TerrainErosion::FloatsPerTexel * sizeof(float);
+}
+
+int32 FTerrainErosion::Erode(TArray<float>& Heights, TConstArrayView<float> Erodability, const uint32 Width, const uint32 Height,
+	const FTerrainErosionSettings& Settings)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTerrainErosion::Erode);
+
+	const int32 Iterations = GetIterations(Width, Height, Settings);
+	if (Iterations == 0 || static_cast<uint32>(Heights.Num()) != Width * Height || static_cast<uint32>(Erodability.Num()) != Width * Height)
+	{
+		return 0;
+	}
+
+	TerrainErosion::FErosion Erosion(MoveTemp(Heights), Erodability, Width, Height, Settings);
+
+	for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		Erosion.Iterate(Iteration);
+	}
+
+	Erosion.Settle();
+	Heights = Erosion.TakeHeights();
+
+	return Iterations;
+}
@@ -0,0 +1,224 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainGrid.h"
+
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+FOctahedralNormal::FOctahedralNormal(const FVector3f& Normal)
+{
+	const float L1Norm = FMath::Abs(Normal.X) + FMath::Abs(Normal.Y) + FMath::Abs(Normal.Z);
+	FVector2f Octahedral = L1Norm > 0.0f ? FVector2f(Normal.X, Normal.Y) / L1Norm : FVector2f::ZeroVector;
+
+	// The lower hemisphere is folded over the diagonals
+	if (Normal.Z < 0.0f)
+	{
+		Octahedral = FVector2f(
+			(1.0f - FMath::Abs(Octahedral.Y)) * (Octahedral.X >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - FMath::Abs(Octahedral.X)) * (Octahedral.Y >= 0.0f ? 1.0f : -1.0f));
+	}
+
+	X = static_cast<int16>(FMath::RoundToInt(FMath::Clamp(Octahedral.X, -1.0f, 1.0f) * MAX_int16));
+	Y = static_cast<int16>(FMath::RoundToInt(FMath::Clamp(Octahedral.Y, -1.0f, 1.0f) * MAX_int16));
+}
+
+FVector3f FOctahedralNormal::Unpack() const
+{
+	const float OctahedralX = X / static_cast<float>(MAX_int16);
+	const float OctahedralY = Y / static_cast<float>(MAX_int16);
+
+	FVector3f Normal(OctahedralX, OctahedralY, 1.0f - FMath::Abs(OctahedralX) - FMath::Abs(OctahedralY));
+
+	const float Fold = FMath::Max(-Normal.Z, 0.0f);
+	Normal.X += Normal.X >= 0.0f ? -Fold : Fold;
+	Normal.Y += Normal.Y >= 0.0f ? -Fold : Fold;
+
+	return Normal.GetSafeNormal();
+}
+
+TArray<FVector2D> FTerrainGrid::CalculateUVs(const uint32 Width, const uint32 Height)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTerrainGrid::CalculateUVs);
+
+	TArray<FVector2D> UVs;
+	UVs.Reserve(Width * Height);
+	for (uint32 y = 0; y < Height; y++)
+	{
+		for (uint32 x = 0; x < Width; x++)
+		{
+			UVs.Emplace(x / (Width - 1.0), y / (Height - 1.0));
+		}
+	}
+	return UVs;
+}
+
+TArray<int32> FTerrainGrid::CalculateTriangles(const uint32 Width, const uint32 Height)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTerrainGrid::CalculateTriangles);
+
+	const uint32 TriangleNodesCount = (Width - 1) * (Height - 1) * 2 * 3;
+	TArray<int32> TriangleNodes;
+	TriangleNodes.Reserve(TriangleNodesCount);
+
+	for (uint32 y = 0; y < Height - 1; y++)
+	{
+		for (uint32 x = 0; x < Width - 1; x++)
+		{
+			TriangleNodes.Emplace(x + y * Width);
+			TriangleNodes.Emplace(x + (y + 1) * Width);
+			TriangleNodes.Emplace(x + 1 + y * Width);
+
+			TriangleNodes.Emplace(x + 1 + y * Width);
+			TriangleNodes.Emplace(x + (y + 1) * Width);
+			TriangleNodes.Emplace(x + 1 + (y + 1) * Width);
+		}
+	}
+
+	return TriangleNodes;
+}
+
+FORCEINLINE void NormalizeVector(FVector3f& v)
+{
+	if (!v.Normalize())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to Normalize %s"), *v.ToString());
+	}
+}
+
+FVector3f FTerrainGrid::GetNormal(const FVector3f& V0, const FVector3f& V1, const FVector3f& V2)
+{
+	const FVector3f Edge1 = V1 - V0;
+	const FVector3f Edge2 = V2 - V0;
+
+	FVector3f crossVector = FVector3f::CrossProduct(Edge2, Edge1);
+
+	NormalizeVector(crossVector);
+
+	return crossVector;
+}
+
+TArray<FOctahedralNormal> FTerrainGrid::CalculateNormals(const TArray<FVector3f>& Verts, const TArray<int32>& Triangles, const uint32 Width, const uint32 Height)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTerrainGrid::CalculateNormals);
+
+	const uint32 NormalCount = Width * Height;
+	const uint32 TriangleIndicesCount = (Width - 1) * (Height - 1) * 2 * 3;
+
+	check(Verts.Num() == NormalCount)
+	check(Triangles.Num() == TriangleIndicesCount)
+
+	TArray<FVector3f> Normals;
+	Normals.Empty(NormalCount);
+	Normals.AddZeroed(NormalCount);
+
+	for (uint32 i = 0; i < TriangleIndicesCount; i += 3)
+	{
+		const uint32 I0 = Triangles[i];
+		const uint32 I1 = Triangles[i + 1];
+		const uint32 I2 = Triangles[i + 2];
+		
+		FVector3f Normal = GetNormal
+		(
+			Verts[I0],
+			Verts[I1],
+			Verts[I2]
+		);
+
+		Normals[I0] += Normal;
+		Normals[I1] += Normal;
+		Normals[I2] += Normal;
+	}
+
+	TArray<FOctahedralNormal> PackedNormals;
+	PackedNormals.Reserve(NormalCount);
+
+	for (size_t i = 0; i < NormalCount; i++)
+	{
+		NormalizeVector(Normals[i]);
+		PackedNormals.Emplace(Normals[i]);
+	}
+
+	return PackedNormals;
+}
+
+FLandscapeLayout FLandscapeLayout::Choose(const uint32 GridWidth, const uint32 GridHeight, const int32 MaxComponents)
+{
+	// Section sizes the landscape supports, a component has 1 or 2x2 sections
+	constexpr int32 SectionQuads[] = { 7, 15, 31, 63, 127, 255 };
+	constexpr int32 SectionsPerComponent[] = { 1, 2 };
+
+	// Landscapes stop at 8k vertices per side, larger grids are downsampled
+	constexpr int32 MaxQuads = 8160;
+
+	const FIntPoint GridQuads(
+		FMath::Clamp(static_cast<int32>(GridWidth) - 1, 1, MaxQuads),
+		FMath::Clamp(static_cast<int32>(GridHeight) - 1, 1, MaxQuads));
+
+	struct FCandidate
+	{
+		FLandscapeLayout Layout;
+		int64 Excess = 0;
+	};
+
+	TArray<FCandidate> Candidates;
+	int64 MinExcess = MAX_int64;
+
+	for (const int32 Quads : SectionQuads)
+	{
+		for (const int32 Sections : SectionsPerComponent)
+		{
+			FLandscapeLayout Layout;
+			Layout.QuadsPerSection = Quads;
+			Layout.SectionsPerComponent = Sections;
+			Layout.ComponentsNum = FIntPoint(
+				FMath::DivideAndRoundUp(GridQuads.X, Layout.GetComponentQuads()),
+				FMath::DivideAndRoundUp(GridQuads.Y, Layout.GetComponentQuads()));
+
+			if (Layout.ComponentsNum.X * Layout.ComponentsNum.Y > MaxComponents)
+			{
+				continue;
+			}
+
+			const FIntPoint Quads2D = Layout.GetQuadsNum();
+			const int64 Excess = static_cast<int64>(Quads2D.X) * Quads2D.Y - static_cast<int64>(GridQuads.X) * GridQuads.Y;
+
+			Candidates.Add({ Layout, Excess });
+			MinExcess = FMath::Min(MinExcess, Excess);
+		}
+	}
+
+	// Nothing fits the budget, the largest components keep the count as low as it gets
+	if (Candidates.IsEmpty())
+	{
+		FLandscapeLayout Best;
+		Best.QuadsPerSection = SectionQuads[UE_ARRAY_COUNT(SectionQuads) - 1];
+		Best.SectionsPerComponent = 2;
+		Best.ComponentsNum = FIntPoint(
+			FMath::DivideAndRoundUp(GridQuads.X, Best.GetComponentQuads()),
+			FMath::DivideAndRoundUp(GridQuads.Y, Best.GetComponentQuads()));
+		return Best;
+	}
+
+	// Up to an eighth more quads per side than the grid, (9/8)^2 - 1 of its area, is worth it for fewer components.
+	// Grids smaller than every layout only get the closest ones
+	const int64 GridArea = static_cast<int64>(GridQuads.X) * GridQuads.Y;
+	const int64 AllowedExcess = FMath::Max(MinExcess, GridArea * 17 / 64);
+
+	const FLandscapeLayout* Best = nullptr;
+	int64 BestExcess = MAX_int64;
+	int32 BestComponents = MAX_int32;
+
+	for (const FCandidate& Candidate : Candidates)
+	{
+		const int32 Components = Candidate.Layout.ComponentsNum.X * Candidate.Layout.ComponentsNum.Y;
+		if (Candidate.Excess <= AllowedExcess
+			&& (Components < BestComponents || (Components == BestComponents && Candidate.Excess < BestExcess)))
+		{
+			Best = &Candidate.Layout;
+			BestExcess = Candidate.Excess;
+			BestComponents = Components;
+		}
+	}
+
+	return *Best;
+}
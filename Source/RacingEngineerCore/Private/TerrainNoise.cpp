@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainNoise.h"
+
+#include <random>
+
+namespace TerrainNoise
+{
+	constexpr float GradX[12] = { 1, -1, 1, -1, 1, -1, 1, -1, 0, 0, 0, 0 };
+	constexpr float GradY[12] = { 1, 1, -1, -1, 0, 0, 0, 0, 1, -1, 1, -1 };
+
+	int32 FastFloor(const float Value)
+	{
+		return Value >= 0.0f ? static_cast<int32>(Value) : static_cast<int32>(Value) - 1;
+	}
+
+	float InterpQuintic(const float T)
+	{
+		return T * T * T * (T * (T * 6.0f - 15.0f) + 10.0f);
+	}
+}
+
+FTerrainNoise::FTerrainNoise(const int32 InSeed, const float InFrequency)
+	: Seed(InSeed)
+	, Frequency(InFrequency)
+{
+	// Shuffled with the generator FastNoise seeds its table with, so maps keep their terrain
+	std::mt19937_64 Generator(InSeed);
+
+	for (int32 Index = 0; Index < 256; Index++)
+	{
+		Perm[Index] = static_cast<uint8>(Index);
+	}
+
+	for (int32 Index = 0; Index < 256; Index++)
+	{
+		const int32 Other = static_cast<int32>(Generator() % (256 - Index)) + Index;
+		const uint8 Value = Perm[Index];
+
+		Perm[Index] = Perm[Index + 256] = Perm[Other];
+		Perm[Other] = Value;
+		Perm12[Index] = Perm12[Index + 256] = Perm[Index] % 12;
+	}
+}
+
+float FTerrainNoise::GetNoise2D(float X, float Y) const
+{
+	X *= Frequency;
+	Y *= Frequency;
+
+	const int32 X0 = TerrainNoise::FastFloor(X);
+	const int32 Y0 = TerrainNoise::FastFloor(Y);
+
+	const float XDistance0 = X - X0;
+	const float YDistance0 = Y - Y0;
+	const float XDistance1 = XDistance0 - 1.0f;
+	const float YDistance1 = YDistance0 - 1.0f;
+
+	const float XAlpha = TerrainNoise::InterpQuintic(XDistance0);
+	const float YAlpha = TerrainNoise::InterpQuintic(YDistance0);
+
+	const float Row0 = FMath::Lerp(GradCoord2D(X0, Y0, XDistance0, YDistance0), GradCoord2D(X0 + 1, Y0, XDistance1, YDistance0), XAlpha);
+	const float Row1 = FMath::Lerp(GradCoord2D(X0, Y0 + 1, XDistance0, YDistance1), GradCoord2D(X0 + 1, Y0 + 1, XDistance1, YDistance1), XAlpha);
+
+	return FMath::Lerp(Row0, Row1, YAlpha);
+}
+
+float FTerrainNoise::GradCoord2D(const int32 X, const int32 Y, const float XDistance, const float YDistance) const
+{
+	const uint8 Gradient = Perm12[(X & 0xff) + Perm[Y & 0xff]];
+	return XDistance * TerrainNoise::GradX[Gradient] + YDistance * TerrainNoise::GradY[Gradient];
+}
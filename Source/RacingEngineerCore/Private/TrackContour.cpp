@@ -0,0 +1,252 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TrackContour.h"
+
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+#pragma region TrackMask
+
+void FTrackMask::Init(const uint32 InWidth, const uint32 InHeight)
+{
+	Width = InWidth;
+	Height = InHeight;
+	Bits.Init(false, Width * Height);
+}
+
+void FTrackMask::Reset()
+{
+	Width = 0;
+	Height = 0;
+	Bits.Empty();
+}
+
+void FTrackMask::SetRow(const uint32 Y, TConstArrayView<FColor> RowColors)
+{
+	check(static_cast<uint32>(RowColors.Num()) == Width && Y < Height);
+
+	for (uint32 X = 0; X < Width; X++)
+	{
+		Bits[Y * Width + X] = IsTrackValue(RowColors[X].R);
+	}
+}
+
+void FTrackMask::SetRow(const uint32 Y, TConstArrayView<uint8> RowValues)
+{
+	check(static_cast<uint32>(RowValues.Num()) == Width && Y < Height);
+
+	for (uint32 X = 0; X < Width; X++)
+	{
+		Bits[Y * Width + X] = IsTrackValue(RowValues[X]);
+	}
+}
+
+#pragma endregion
+
+namespace TrackContour
+{
+	// The tracing only asks whether a pixel is part of the track, so colors and masks share it
+	template <typename IsTrackPixelType>
+	FTrackNode FindFirstTrackNode(const IsTrackPixelType& IsTrackPixel, const uint32 TextureHeight, const uint32 TextureWidth)
+	{
+		// search from the bottom left corner
+		for (uint32 y = TextureHeight - 1; y > 0 / 2; y--)
+		{
+			for (uint32 x = 0; x < TextureWidth; x++)
+			{
+				if (IsTrackPixel(x, y))
+				{
+					return FTrackNode(FVector2D(x, y), EDirection::Left);
+				}
+			}
+		}
+
+		UE_LOG(LogTemp, Warning, TEXT("FTrackContour::FindFirstTrackNode Couldn't find the first node"));
+		return FTrackNode(FVector2D(0, TextureWidth - 1), EDirection::Left);
+	}
+
+	template <typename IsTrackPixelType>
+	FTrackNode FindNextTrackNode(const IsTrackPixelType& IsTrackPixel, const uint32 TextureWidth, const uint32 TextureHeight, const FTrackNode& CurrentNode)
+	{
+		EDirection CurrentDirection = CurrentNode.PrevPointDirection + 1;
+		bool bFound = false;
+
+		for (int i = 0; i < 7; i++)
+		{
+			const FVector2D NeighbourPos = FTrackContour::AddDirectionToPosition(CurrentNode.Position, CurrentDirection);
+
+			if (NeighbourPos.X > 0 && NeighbourPos.X < TextureWidth &&
+				NeighbourPos.Y > 0 && NeighbourPos.Y < TextureHeight)
+			{
+				if (IsTrackPixel(static_cast<uint32>(NeighbourPos.X), static_cast<uint32>(NeighbourPos.Y)))
+				{
+					bFound = true;
+					break;
+				}
+			}
+
+			CurrentDirection = CurrentDirection + 1;
+		}
+
+		if (!bFound)
+		{
+			UE_LOG(LogTemp, Error, TEXT("FTrackContour::FindNextTrackNode Couldn't find the next node"));
+			check(false);
+		}
+
+		const EDirection DirectionToOrigin = CurrentDirection + 4;
+		return FTrackNode(FTrackContour::AddDirectionToPosition(CurrentNode.Position, CurrentDirection), DirectionToOrigin);
+	}
+
+	template <typename IsTrackPixelType>
+	TArray<FVector2D> TraceTrack(const IsTrackPixelType& IsTrackPixel, const uint32 TextureHeight, const uint32 TextureWidth, const uint32 BoundHeight)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FTrackContour::TraceTrack);
+
+		TArray<FVector2D> TrackNodes;
+
+		FTrackNode TrackNode = FindFirstTrackNode(IsTrackPixel, TextureHeight, TextureWidth);
+		TrackNodes.Add(TrackNode.Position);
+		constexpr uint8 MinNumberOfNodes = 3;
+
+		for (uint8 i = 0; i < MinNumberOfNodes; i++)
+		{
+			TrackNode = FindNextTrackNode(IsTrackPixel, TextureWidth, BoundHeight, TrackNode);
+			TrackNodes.Add(TrackNode.Position);
+		}
+
+		while (FTrackContour::ShouldFindAnotherTrackNode(TrackNodes))
+		{
+			TrackNode = FindNextTrackNode(IsTrackPixel, TextureWidth, BoundHeight, TrackNode);
+			TrackNodes.Add(TrackNode.Position);
+		}
+
+		return TrackNodes;
+	}
+
+	auto MakeColorsPredicate(TConstArrayView<FColor> HeightTextureColors, const uint32 TextureWidth)
+	{
+		return [HeightTextureColors, TextureWidth](const uint32 X, const uint32 Y)
+		{
+			return FTrackMask::IsTrackValue(HeightTextureColors[Y * TextureWidth + X].R);
+		};
+	}
+
+	auto MakeMaskPredicate(const FTrackMask& TrackMask)
+	{
+		return [&TrackMask](const uint32 X, const uint32 Y)
+		{
+			return TrackMask.IsTrack(X, Y);
+		};
+	}
+}
+
+TArray<FVector2D> FTrackContour::CreateTrack(TConstArrayView<FColor> HeightTextureColors, const uint32 TextureHeight,
+	const uint32 TextureWidth, const uint8 SkipNodesCount)
+{
+	return DecimateTrack(TraceTrack(HeightTextureColors, TextureHeight, TextureWidth), SkipNodesCount);
+}
+
+TArray<FVector2D> FTrackContour::CreateTrack(const FTrackMask& TrackMask, const uint8 SkipNodesCount)
+{
+	return DecimateTrack(TraceTrack(TrackMask), SkipNodesCount);
+}
+
+TArray<FVector2D> FTrackContour::TraceTrack(TConstArrayView<FColor> HeightTextureColors, const uint32 TextureHeight, const uint32 TextureWidth)
+{
+	// Rows are bounded by the width, the texture is expected to be square
+	return TrackContour::TraceTrack(TrackContour::MakeColorsPredicate(HeightTextureColors, TextureWidth), TextureHeight, TextureWidth, TextureWidth);
+}
+
+TArray<FVector2D> FTrackContour::TraceTrack(const FTrackMask& TrackMask)
+{
+	return TrackContour::TraceTrack(TrackContour::MakeMaskPredicate(TrackMask), TrackMask.Height, TrackMask.Width, TrackMask.Height);
+}
+
+TArray<FVector2D> FTrackContour::DecimateTrack(const TArray<FVector2D>& TrackNodes, const uint8 SkipNodesCount)
+{
+	if (SkipNodesCount > 0)
+	{
+		TArray<FVector2D> TrackNodesReduced;
+		TrackNodesReduced.Reserve(TrackNodes.Num() / SkipNodesCount);
+		// Reduce the number of nodes
+		for (SIZE_T i = 0; i < TrackNodes.Num(); i += SkipNodesCount)
+		{
+			TrackNodesReduced.Add(TrackNodes[i]);
+		}
+
+		return TrackNodesReduced;
+	}
+	else
+	{
+		return TrackNodes;
+	}
+}
+
+FTrackNode FTrackContour::FindFirstTrackNode(TConstArrayView<FColor> HeightTextureColors, const uint32 TextureHeight, const uint32 TextureWidth)
+{
+	return TrackContour::FindFirstTrackNode(TrackContour::MakeColorsPredicate(HeightTextureColors, TextureWidth), TextureHeight, TextureWidth);
+}
+
+FTrackNode FTrackContour::FindNextTrackNode(TConstArrayView<FColor> HeightTextureColors, const uint32 TextureWidth, const FTrackNode& CurrentNode)
+{
+	return TrackContour::FindNextTrackNode(TrackContour::MakeColorsPredicate(HeightTextureColors, TextureWidth), TextureWidth, TextureWidth, CurrentNode);
+}
+
+FTrackNode FTrackContour::FindFirstTrackNode(const FTrackMask& TrackMask)
+{
+	return TrackContour::FindFirstTrackNode(TrackContour::MakeMaskPredicate(TrackMask), TrackMask.Height, TrackMask.Width);
+}
+
+FTrackNode FTrackContour::FindNextTrackNode(const FTrackMask& TrackMask, const FTrackNode& CurrentNode)
+{
+	return TrackContour::FindNextTrackNode(TrackContour::MakeMaskPredicate(TrackMask), TrackMask.Width, TrackMask.Height, CurrentNode);
+}
+
+bool FTrackContour::ShouldFindAnotherTrackNode(const TArray<FVector2D>& TrackNodes)
+{
+	check(TrackNodes.Num() >= 3);
+
+	const FVector2D FirstNode = TrackNodes[0];
+	const FVector2D LastNode = TrackNodes.Last();
+
+	return FVector2D::DistSquared(FirstNode, LastNode) > 2;
+}
+
+FVector2D FTrackContour::AddDirectionToPosition(const FVector2D& Vector2D, const EDirection& Direction)
+{
+	FVector2D MoveVec;
+
+	switch (Direction)
+	{
+	case EDirection::UpLeft:
+		MoveVec = FVector2D(-1.0, -1.0);
+		break;
+	case EDirection::Up:
+		MoveVec = FVector2D(0.0, -1.0);
+		break;
+	case EDirection::UpRight:
+		MoveVec = FVector2D(1.0, -1.0);
+		break;
+	case EDirection::Right:
+		MoveVec = FVector2D(1.0, 0.0);
+		break;
+	case EDirection::DownRight:
+		MoveVec = FVector2D(1.0, 1.0);
+		break;
+	case EDirection::Down:
+		MoveVec = FVector2D(0.0, 1.0);
+		break;
+	case EDirection::DownLeft:
+		MoveVec = FVector2D(-1.0, 1.0);
+		break;
+	case EDirection::Left:
+		MoveVec = FVector2D(-1.0, 0.0);
+		break;
+	default:
+		MoveVec = FVector2D(0.0, 0.0);
+		break;
+	}
+
+	return Vector2D + MoveVec;
+}
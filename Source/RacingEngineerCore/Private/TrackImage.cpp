@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TrackImage.h"
+
+TArray<FColor> FTrackImage::MakeEllipse(const uint32 Width, const uint32 Height)
+{
+	// Radii as shares of the half size, the loop is wide enough to trace on a 16 pixel image
+	constexpr double OuterRadiusX = 0.8;
+	constexpr double OuterRadiusY = 0.6;
+	constexpr double InnerScale = 0.55;
+
+	TArray<FColor> Colors;
+	Colors.Init(FColor::White, Width * Height);
+
+	for (uint32 Y = 0; Y < Height; Y++)
+	{
+		for (uint32 X = 0; X < Width; X++)
+		{
+			// Squared elliptic distance from the centre, no roots so it is exact on every compiler
+			const double U = (X + 0.5 - Width * 0.5) / (Width * 0.5 * OuterRadiusX);
+			const double V = (Y + 0.5 - Height * 0.5) / (Height * 0.5 * OuterRadiusY);
+			const double DistanceSquared = U * U + V * V;
+
+			if (DistanceSquared <= 1.0 && DistanceSquared >= InnerScale * InnerScale)
+			{
+				Colors[Y * Width + X] = FColor::Black;
+			}
+		}
+	}
+
+	return Colors;
+}
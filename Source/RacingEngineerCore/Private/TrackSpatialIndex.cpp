@@ -0,0 +1,182 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TrackSpatialIndex.h"
+
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+namespace TrackSpatialIndex
+{
+	double DistSquaredToSegment(const FVector2D& Location, const FVector2D& Start, const FVector2D& End, float& OutAlpha)
+	{
+		const FVector2D Segment = End - Start;
+		const double SegmentLengthSquared = Segment.SizeSquared();
+
+		OutAlpha = SegmentLengthSquared > UE_SMALL_NUMBER
+			? static_cast<float>(FMath::Clamp(FVector2D::DotProduct(Location - Start, Segment) / SegmentLengthSquared, 0.0, 1.0))
+			: 0.0f;
+
+		return FVector2D::DistSquared(Location, Start + Segment * OutAlpha);
+	}
+}
+
+void FTrackSpatialIndex::Build(TConstArrayView<FVector> InPoints, const double InCellSize)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTrackSpatialIndex::Build);
+
+	Reset();
+
+	const int32 PointsNum = InPoints.Num();
+	if (PointsNum < 2 || InCellSize <= 0.0)
+	{
+		return;
+	}
+
+	Points.Reserve(PointsNum);
+	for (const FVector& Point : InPoints)
+	{
+		Points.Emplace(Point.X, Point.Y);
+	}
+
+	FBox2D Bounds(Points);
+	CellSize = InCellSize;
+	Origin = Bounds.Min;
+	CellsNum = FIntPoint(
+		FMath::Max(1, FMath::CeilToInt32(Bounds.GetSize().X / CellSize)),
+		FMath::Max(1, FMath::CeilToInt32(Bounds.GetSize().Y / CellSize)));
+
+	// Counted first and filled second, so the cells share one flat array
+	auto ForEachSegmentCell = [this, PointsNum](const int32 SegmentIndex, auto&& Function)
+	{
+		const FVector2D& Start = Points[SegmentIndex];
+		const FVector2D& End = Points[(SegmentIndex + 1) % PointsNum];
+
+		const FIntPoint MinCell = GetCell(FVector2D(FMath::Min(Start.X, End.X), FMath::Min(Start.Y, End.Y)));
+		const FIntPoint MaxCell = GetCell(FVector2D(FMath::Max(Start.X, End.X), FMath::Max(Start.Y, End.Y)));
+
+		for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; CellY++)
+		{
+			for (int32 CellX = MinCell.X; CellX <= MaxCell.X; CellX++)
+			{
+				Function(CellY * CellsNum.X + CellX);
+			}
+		}
+	};
+
+	CellStarts.Init(0, CellsNum.X * CellsNum.Y + 1);
+	for (int32 SegmentIndex = 0; SegmentIndex < PointsNum; SegmentIndex++)
+	{
+		ForEachSegmentCell(SegmentIndex, [this](const int32 Cell) { CellStarts[Cell + 1]++; });
+	}
+
+	for (int32 Cell = 1; Cell < CellStarts.Num(); Cell++)
+	{
+		CellStarts[Cell] += CellStarts[Cell - 1];
+	}
+
+	TArray<int32> CellFill(CellStarts.GetData(), CellStarts.Num() - 1);
+	CellSegments.SetNumUninitialized(CellStarts.Last());
+
+	for (int32 SegmentIndex = 0; SegmentIndex < PointsNum; SegmentIndex++)
+	{
+		ForEachSegmentCell(SegmentIndex, [this, &CellFill, SegmentIndex](const int32 Cell) { CellSegments[CellFill[Cell]++] = SegmentIndex; });
+	}
+}
+
+void FTrackSpatialIndex::Reset()
+{
+	CellsNum = FIntPoint::ZeroValue;
+	Points.Empty();
+	CellStarts.Empty();
+	CellSegments.Empty();
+}
+
+FIntPoint FTrackSpatialIndex::GetCell(const FVector2D& Location) const
+{
+	return FIntPoint(
+		FMath::Clamp(FMath::FloorToInt32((Location.X - Origin.X) / CellSize), 0, CellsNum.X - 1),
+		FMath::Clamp(FMath::FloorToInt32((Location.Y - Origin.Y) / CellSize), 0, CellsNum.Y - 1));
+}
+
+int32 FTrackSpatialIndex::FindClosestSegment(const FVector2D& Location, float& OutAlpha, double* OutDistSquared) const
+{
+	if (IsEmpty())
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 PointsNum = Points.Num();
+
+	// Locations off the grid start from the closest cell on its border, their distance to it is added to every ring
+	const FIntPoint StartCell = GetCell(Location);
+	const FVector2D StartCellMin = Origin + FVector2D(StartCell) * CellSize;
+	const FVector2D ClampedLocation(
+		FMath::Clamp(Location.X, StartCellMin.X, StartCellMin.X + CellSize),
+		FMath::Clamp(Location.Y, StartCellMin.Y, StartCellMin.Y + CellSize));
+	const double OffGridDistance = FVector2D::Distance(Location, ClampedLocation);
+
+	int32 ClosestSegment = INDEX_NONE;
+	double ClosestDistSquared = MAX_dbl;
+	float ClosestAlpha = 0.0f;
+
+	auto VisitCell = [&](const int32 CellX, const int32 CellY)
+	{
+		if (CellX < 0 || CellY < 0 || CellX >= CellsNum.X || CellY >= CellsNum.Y)
+		{
+			return;
+		}
+
+		const int32 Cell = CellY * CellsNum.X + CellX;
+		for (int32 Entry = CellStarts[Cell]; Entry < CellStarts[Cell + 1]; Entry++)
+		{
+			const int32 SegmentIndex = CellSegments[Entry];
+
+			float Alpha = 0.0f;
+			const double DistSquared = TrackSpatialIndex::DistSquaredToSegment(Location, Points[SegmentIndex], Points[(SegmentIndex + 1) % PointsNum], Alpha);
+
+			if (DistSquared < ClosestDistSquared)
+			{
+				ClosestDistSquared = DistSquared;
+				ClosestSegment = SegmentIndex;
+				ClosestAlpha = Alpha;
+			}
+		}
+	};
+
+	const int32 MaxRing = FMath::Max(CellsNum.X, CellsNum.Y);
+	for (int32 Ring = 0; Ring <= MaxRing; Ring++)
+	{
+		// Every cell of this ring and the ones after it is at least this far away. The clamped location is the closest
+		// point of the grid, so the way to it and the way on from it to a cell meet at a right angle or wider
+		const double RingDistanceSquared = FMath::Square(OffGridDistance) + FMath::Square(FMath::Max(Ring - 1, 0) * CellSize);
+		if (ClosestSegment != INDEX_NONE && RingDistanceSquared > ClosestDistSquared)
+		{
+			break;
+		}
+
+		if (Ring == 0)
+		{
+			VisitCell(StartCell.X, StartCell.Y);
+			continue;
+		}
+
+		for (int32 Offset = -Ring; Offset <= Ring; Offset++)
+		{
+			VisitCell(StartCell.X + Offset, StartCell.Y - Ring);
+			VisitCell(StartCell.X + Offset, StartCell.Y + Ring);
+		}
+		for (int32 Offset = -Ring + 1; Offset <= Ring - 1; Offset++)
+		{
+			VisitCell(StartCell.X - Ring, StartCell.Y + Offset);
+			VisitCell(StartCell.X + Ring, StartCell.Y + Offset);
+		}
+	}
+
+	OutAlpha = ClosestAlpha;
+	if (OutDistSquared != nullptr)
+	{
+		*OutDistSquared = ClosestDistSquared;
+	}
+
+	return ClosestSegment;
+}
@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FFoliageScatterSettings
+{
+	int32 Seed = 0;
+
+	// Chance of a vertex getting an instance, grass is tried first, then rocks, then trees
+	float GrassProbability = 0.0f;
+	float RocksProbability = 0.0f;
+	float TreesProbability = 0.0f;
+
+	int32 MaxGrass = 0;
+	int32 MaxRocks = 0;
+	int32 MaxTrees = 0;
+
+	// Vertices closer than this to the track centre line are left empty
+	float MinTrackDistance = 0.0f;
+};
+
+/**
+ *  Places foliage on terrain vertices with a random yaw and scale.
+ *  Seeded, so the same terrain and settings always give the same transforms.
+ */
+class RACINGENGINEERCORE_API FFoliageScatter
+{
+public:
+	static void Scatter(TConstArrayView<FVector3f> Vertices, TConstArrayView<float> TrackDistance, const FFoliageScatterSettings& Settings,
+		TArray<FTransform>& OutGrassTransforms, TArray<FTransform>& OutRocksTransforms, TArray<FTransform>& OutTreesTransforms);
+
+	// Continues a scatter with the next vertices in map order, appending to the transforms placed so far.
+	// Bands handed in one after another with a stream seeded from Settings.Seed give the same transforms as one Scatter
+	static void ScatterBand(TConstArrayView<FVector3f> Vertices, TConstArrayView<float> TrackDistance, const FFoliageScatterSettings& Settings,
+		FRandomStream& RandomStream, TArray<FTransform>& OutGrassTransforms, TArray<FTransform>& OutRocksTransforms, TArray<FTransform>& OutTreesTransforms);
+};
@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FRacingLineSettings
+{
+	// How far the line may leave the centre line to either side, the track's half width minus the car's
+	float MaxOffset = 0.0f;
+
+	// The solve starts on every CoarsestStride-th sample, as long as that leaves MinLevelSamples, and halves the stride per level
+	int32 CoarsestStride = 64;
+	int32 MinLevelSamples = 16;
+
+	// Sweeps on the finest level, coarser levels get sqrt(Stride) times as many
+	int32 Iterations = 20;
+
+	// Simple point mass vehicle, everything in cm and seconds
+	float MaxSpeed = 5000.0f;
+	float MaxLateralAcceleration = 900.0f;
+	float MaxAcceleration = 400.0f;
+	float MaxDeceleration = 900.0f;
+};
+
+/**
+ *  Minimum curvature line through a closed track and the fastest speed a point mass can follow it with.
+ *  The track is its centre line sampled at a constant spacing, the line is an offset along each sample's right vector.
+ */
+class RACINGENGINEERCORE_API FRacingLine
+{
+public:
+	// Nonlinear Gauss-Seidel sweeps moving every sample until its curvature is the one its neighbours interpolate.
+	// Long bends are shaped on a thinned loop first, each finer level starts from the coarser one's line
+	static void SolveOffsets(TConstArrayView<FVector> Centres, TConstArrayView<FVector> Directions, const FRacingLineSettings& Settings,
+		TArray<float>& OutOffsets);
+
+	// Limits every sample by its curvature, then runs acceleration forwards and braking backwards from the slowest one.
+	// Longitudinal grip is what is left of the friction circle after cornering
+	static void SolveSpeeds(TConstArrayView<FVector> LinePoints, const FRacingLineSettings& Settings, TArray<float>& OutSpeeds);
+
+	// Signed, positive for bends to the right
+	static float GetCurvature(const FVector2D& Previous, const FVector2D& Current, const FVector2D& Next);
+};
@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+#include <type_traits>
+
+/**
+ *  Fixed size lock free queue between exactly one producer and one consumer thread.
+ *  Neither side ever waits, Push fails instead of overwriting when the consumer falls behind.
+ */
+template<typename ElementType, uint32 Capacity>
+class TSpscRingBuffer
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity has to be a power of two");
+	static_assert(std::is_trivially_copyable_v<ElementType>, "Elements are copied in and out of the buffer");
+
+public:
+	// Producer thread only
+	bool Push(const ElementType& Element)
+	{
+		const uint32 Write = WriteIndex.load(std::memory_order_relaxed);
+		if (Write - ReadIndex.load(std::memory_order_acquire) == Capacity)
+		{
+			return false;
+		}
+
+		Elements[Write & (Capacity - 1)] = Element;
+		WriteIndex.store(Write + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	// Consumer thread only
+	bool Pop(ElementType& OutElement)
+	{
+		const uint32 Read = ReadIndex.load(std::memory_order_relaxed);
+		if (Read == WriteIndex.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+
+		OutElement = Elements[Read & (Capacity - 1)];
+		ReadIndex.store(Read + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	// Exact only on the consumer thread, anywhere else it is a snapshot
+	uint32 Num() const
+	{
+		return WriteIndex.load(std::memory_order_acquire) - ReadIndex.load(std::memory_order_acquire);
+	}
+
+	static constexpr uint32 GetCapacity() { return Capacity; }
+
+private:
+	ElementType Elements[Capacity];
+
+	// On their own cache lines, so the two threads don't invalidate each other's line on every element
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> WriteIndex = 0;
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> ReadIndex = 0;
+};
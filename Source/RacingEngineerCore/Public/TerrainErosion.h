@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FTerrainErosionSettings
+{
+	int32 Seed = 0;
+
+	int32 Iterations = 0;
+
+	// Texels times iterations a run may cost, larger maps get fewer iterations so the stage keeps a bounded cost.
+	// A texel iteration takes about 125 ns on one core, so 512x512 gets 8 iterations in about 260 ms, split over the cores
+	int64 MaxTexelIterations = 8ll * 512 * 512;
+
+	// Working memory a run may take, see GetMemoryBytes. Larger maps are left as they are
+	int64 MaxMemoryBytes = 512ll * 1024 * 1024;
+
+	// Distance between two texels, in the units of the heights
+	float CellSize = 1.0f;
+
+	// Water added to every texel per iteration, varied per texel and iteration by the seed
+	float RainAmount = 1.0f;
+	float Evaporation = 0.05f;
+
+	// Sediment the water can carry per unit of slope and flow, and the share of the difference taken or dropped per iteration
+	float SedimentCapacity = 4.0f;
+	float MinSlope = 0.01f;
+	float ErosionRate = 0.3f;
+	float DepositionRate = 0.3f;
+
+	// Steepest slope loose material rests at and the share of the excess that slides down per iteration
+	float TalusAngleDegrees = 35.0f;
+	float ThermalRate = 0.5f;
+
+	// Texel rows a task works on, the result doesn't depend on it
+	int32 TileRows = 32;
+};
+
+/**
+ *  Grid based hydraulic erosion with thermal talus relaxation.
+ *  Water flows to lower neighbours and carries sediment it takes from steep slopes and drops on flat ones,
+ *  then material steeper than the talus angle slides down. Every pass reads one buffer and writes another,
+ *  so rows run in parallel and the same settings always give the same heights, whatever the thread count.
+ */
+class RACINGENGINEERCORE_API FTerrainErosion
+{
+public:
+	// Erodability is 0 to 1 per texel, 0 keeps a texel as it is, like under the track.
+	// Returns the number of iterations run
+	static int32 Erode(TArray<float>& Heights, TConstArrayView<float> Erodability, const uint32 Width, const uint32 Height,
+		const FTerrainErosionSettings& Settings);
+
+	// 0 when the map needs more memory than the settings allow
+	static int32 GetIterations(const uint32 Width, const uint32 Height, const FTerrainErosionSettings& Settings);
+
+	// Heights, water and sediment twice over, the outflows to four neighbours and the erodability, 11 floats per texel
+	static int64 GetMemoryBytes(const uint32 Width, const uint32 Height);
+};
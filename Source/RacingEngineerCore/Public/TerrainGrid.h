@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ *  Unit vector in 4 bytes, the octahedral mapping stored as two signed normalized 16 bit values.
+ *  The round trip error stays well under a hundredth of a degree.
+ */
+struct RACINGENGINEERCORE_API FOctahedralNormal
+{
+	int16 X = 0;
+	int16 Y = 0;
+
+	FOctahedralNormal() = default;
+	explicit FOctahedralNormal(const FVector3f& Normal);
+
+	FVector3f Unpack() const;
+
+	friend FArchive& operator<<(FArchive& Ar, FOctahedralNormal& Normal)
+	{
+		return Ar << Normal.X << Normal.Y;
+	}
+};
+
+/**
+ *  Regular Width * Height vertex grid of the terrain, vertices are row major.
+ */
+class RACINGENGINEERCORE_API FTerrainGrid
+{
+public:
+	static TArray<int32> CalculateTriangles(const uint32 Width, const uint32 Height);
+
+	static FVector3f GetNormal(const FVector3f& V0, const FVector3f& V1, const FVector3f& V2);
+
+	static TArray<FOctahedralNormal> CalculateNormals(const TArray<FVector3f>& Verts, const TArray<int32>& Triangles, const uint32 Width, const uint32 Height);
+
+	static TArray<FVector2D> CalculateUVs(const uint32 Width, const uint32 Height);
+};
+
+/**
+ *  Component and section sizing of a landscape covering a terrain grid.
+ *  The landscape has ComponentsNum * GetComponentQuads() + 1 vertices per side, which rarely equals the grid, so heights are resampled onto it.
+ */
+struct RACINGENGINEERCORE_API FLandscapeLayout
+{
+	int32 QuadsPerSection = 63;
+	int32 SectionsPerComponent = 1;
+	FIntPoint ComponentsNum = FIntPoint(1, 1);
+
+	int32 GetComponentQuads() const { return QuadsPerSection * SectionsPerComponent; }
+	FIntPoint GetQuadsNum() const { return ComponentsNum * GetComponentQuads(); }
+	FIntPoint GetVerticesNum() const { return GetQuadsNum() + FIntPoint(1, 1); }
+
+	// Layout with the fewest components, at most MaxComponents, that covers the grid's resolution without exceeding it by more than an
+	// eighth per side. Fewer, larger components are what keeps the per component cost low, like the sizes Epic recommends
+	static FLandscapeLayout Choose(const uint32 GridWidth, const uint32 GridHeight, const int32 MaxComponents);
+};
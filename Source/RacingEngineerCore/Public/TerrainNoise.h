@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ *  Quintic Perlin noise, the same values FastNoise gives for a seed and frequency.
+ *  Only read after construction, so one instance is safe to sample from any number of threads and cheap to copy by value.
+ */
+class RACINGENGINEERCORE_API FTerrainNoise
+{
+public:
+	explicit FTerrainNoise(const int32 InSeed = 1337, const float InFrequency = 0.01f);
+
+	// Roughly -1 to 1
+	float GetNoise2D(float X, float Y) const;
+
+	int32 GetSeed() const { return Seed; }
+	float GetFrequency() const { return Frequency; }
+
+private:
+	float GradCoord2D(const int32 X, const int32 Y, const float XDistance, const float YDistance) const;
+
+	int32 Seed = 0;
+	float Frequency = 0.0f;
+
+	// Doubled so lookups need no wrapping
+	uint8 Perm[512];
+	uint8 Perm12[512];
+};
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class EDirection : uint8
+{
+	Left = 0,
+	DownLeft = 1,
+	Down = 2,
+	DownRight = 3,
+	Right = 4,
+	UpRight = 5,
+	Up = 6,
+	UpLeft = 7,
+};
+
+inline EDirection operator+(const EDirection& Dir, const int& Val)
+{
+	return static_cast<EDirection>((static_cast<int>(Dir) + Val) % 8);
+}
+
+/**
+ *  One bit per pixel of a track mask, set for the dark track pixels (R < 127).
+ *  Traces the same track as the colors at a 32nd of their size, so very large images don't have to be kept whole.
+ */
+struct RACINGENGINEERCORE_API FTrackMask
+{
+	uint32 Width = 0;
+	uint32 Height = 0;
+	TBitArray<> Bits;
+
+	void Init(const uint32 InWidth, const uint32 InHeight);
+	void Reset();
+
+	void SetRow(const uint32 Y, TConstArrayView<FColor> RowColors);
+
+	// Grayscale values, as read from raw 8 bit images
+	void SetRow(const uint32 Y, TConstArrayView<uint8> RowValues);
+
+	bool IsEmpty() const { return Bits.Num() == 0; }
+	bool IsTrack(const uint32 X, const uint32 Y) const { return Bits[Y * Width + X]; }
+
+	SIZE_T GetAllocatedSize() const { return Bits.GetAllocatedSize(); }
+
+	static bool IsTrackValue(const uint8 Value) { return Value < 127; }
+};
+
+struct FTrackNode
+{
+	FVector2D Position = FVector2D::ZeroVector;
+	EDirection PrevPointDirection = EDirection::Left;
+};
+
+/**
+ *  Follows the outline of the dark track pixels (R < 127) of a track mask, starting from the bottom left.
+ *  Colors are row major, Width * Height of them, or packed into an FTrackMask.
+ */
+class RACINGENGINEERCORE_API FTrackContour
+{
+public:
+	// Traced nodes with only every SkipNodesCount-th one kept, 0 keeps all of them
+	static TArray<FVector2D> CreateTrack(TConstArrayView<FColor> HeightTextureColors, const uint32 TextureHeight,
+		const uint32 TextureWidth, const uint8 SkipNodesCount);
+
+	// Every pixel of the outline until the loop closes
+	static TArray<FVector2D> TraceTrack(TConstArrayView<FColor> HeightTextureColors, const uint32 TextureHeight, const uint32 TextureWidth);
+
+	static TArray<FVector2D> CreateTrack(const FTrackMask& TrackMask, const uint8 SkipNodesCount);
+	static TArray<FVector2D> TraceTrack(const FTrackMask& TrackMask);
+
+	static TArray<FVector2D> DecimateTrack(const TArray<FVector2D>& TrackNodes, const uint8 SkipNodesCount);
+
+	static FTrackNode FindFirstTrackNode(TConstArrayView<FColor> HeightTextureColors, const uint32 TextureHeight, const uint32 TextureWidth);
+	static FTrackNode FindNextTrackNode(TConstArrayView<FColor> HeightTextureColors, const uint32 TextureWidth, const FTrackNode& CurrentNode);
+	static FTrackNode FindFirstTrackNode(const FTrackMask& TrackMask);
+	static FTrackNode FindNextTrackNode(const FTrackMask& TrackMask, const FTrackNode& CurrentNode);
+	static bool ShouldFindAnotherTrackNode(const TArray<FVector2D>& TrackNodes);
+	static FVector2D AddDirectionToPosition(const FVector2D& Vector2D, const EDirection& Direction);
+};
@@ -0,0 +1,16 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ *  Track images made in code, for checks that shouldn't depend on imported textures.
+ */
+class RACINGENGINEERCORE_API FTrackImage
+{
+public:
+	// White image with a dark elliptic loop around its centre, the same pixels on every platform.
+	// Colors are row major, Width * Height of them
+	static TArray<FColor> MakeEllipse(const uint32 Width, const uint32 Height);
+};
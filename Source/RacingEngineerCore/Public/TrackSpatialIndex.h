@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ *  Uniform grid over the segments of a closed track polyline in the XY plane, for closest point queries from anywhere.
+ *  A query near the track reads a handful of cells, one far away walks rings of cells until no closer segment can be left.
+ */
+class RACINGENGINEERCORE_API FTrackSpatialIndex
+{
+public:
+	// Segment i runs from point i to point i + 1, the last one closes the loop
+	void Build(TConstArrayView<FVector> Points, const double InCellSize);
+	void Reset();
+
+	bool IsEmpty() const { return Points.IsEmpty(); }
+
+	// Segment with the closest point to Location and how far along it that point is, INDEX_NONE when empty
+	int32 FindClosestSegment(const FVector2D& Location, float& OutAlpha, double* OutDistSquared = nullptr) const;
+
+	SIZE_T GetAllocatedSize() const { return Points.GetAllocatedSize() + CellStarts.GetAllocatedSize() + CellSegments.GetAllocatedSize(); }
+
+private:
+	FIntPoint GetCell(const FVector2D& Location) const;
+
+	double CellSize = 1.0;
+	FVector2D Origin = FVector2D::ZeroVector;
+	FIntPoint CellsNum = FIntPoint::ZeroValue;
+
+	TArray<FVector2D> Points;
+
+	// Segments of cell i are CellSegments[CellStarts[i]] up to CellSegments[CellStarts[i + 1]]
+	TArray<int32> CellStarts;
+	TArray<int32> CellSegments;
+};
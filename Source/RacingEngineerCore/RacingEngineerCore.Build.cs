@@ -0,0 +1,17 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+
+// Map generation algorithms that only need Core, no UObjects, world or RHI.
+// Standalone/CMakeLists.txt builds the same sources without the engine, with unit tests and benchmarks
+public class RacingEngineerCore : ModuleRules
+{
+	public RacingEngineerCore(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicDependencyModuleNames.AddRange(new string[] {
+			"Core"
+		});
+	}
+}
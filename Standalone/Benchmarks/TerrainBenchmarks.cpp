@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FoliageScatter.h"
+#include "SpscRingBuffer.h"
+#include "TerrainErosion.h"
+#include "TerrainGrid.h"
+#include "TerrainNoise.h"
+#include "TrackFixtures.h"
+
+#include <benchmark/benchmark.h>
+
+static void BM_TerrainNoise(benchmark::State& State)
+{
+	const int32 Size = static_cast<int32>(State.range(0));
+	const FTerrainNoise Noise(1337, 0.01f);
+
+	TArray<float> Heights;
+	Heights.SetNumUninitialized(Size * Size);
+
+	for (auto _ : State)
+	{
+		for (int32 Index = 0; Index < Size * Size; Index++)
+		{
+			Heights[Index] = Noise.GetNoise2D(Index % Size, Index / Size);
+		}
+		benchmark::DoNotOptimize(Heights.GetData());
+	}
+	State.SetItemsProcessed(State.iterations() * Size * Size);
+}
+BENCHMARK(BM_TerrainNoise)->Arg(512)->Unit(benchmark::kMillisecond);
+
+static void BM_TerrainTriangles(benchmark::State& State)
+{
+	const uint32 Size = static_cast<uint32>(State.range(0));
+
+	for (auto _ : State)
+	{
+		benchmark::DoNotOptimize(FTerrainGrid::CalculateTriangles(Size, Size));
+	}
+}
+BENCHMARK(BM_TerrainTriangles)->Arg(512)->Arg(1024)->Unit(benchmark::kMillisecond);
+
+static void BM_TerrainNormals(benchmark::State& State)
+{
+	const uint32 Size = static_cast<uint32>(State.range(0));
+	const TArray<FVector3f> Vertices = TrackFixtures::MakeHillsGrid(Size, Size);
+	const TArray<int32> Triangles = FTerrainGrid::CalculateTriangles(Size, Size);
+
+	for (auto _ : State)
+	{
+		benchmark::DoNotOptimize(FTerrainGrid::CalculateNormals(Vertices, Triangles, Size, Size));
+	}
+}
+BENCHMARK(BM_TerrainNormals)->Arg(512)->Arg(1024)->Unit(benchmark::kMillisecond);
+
+static void BM_TerrainErosion(benchmark::State& State)
+{
+	const uint32 Size = static_cast<uint32>(State.range(0));
+
+	TArray<float> Source;
+	for (const FVector3f& Vertex : TrackFixtures::MakeHillsGrid(Size, Size))
+	{
+		Source.Add(Vertex.Z * 500.0f);
+	}
+
+	TArray<float> Erodability;
+	Erodability.Init(1.0f, Source.Num());
+
+	FTerrainErosionSettings Settings;
+	Settings.Iterations = static_cast<int32>(State.range(1));
+	Settings.MaxTexelIterations = static_cast<int64>(Size) * Size * Settings.Iterations;
+	Settings.CellSize = 100.0f;
+
+	for (auto _ : State)
+	{
+		TArray<float> Heights = Source;
+		benchmark::DoNotOptimize(FTerrainErosion::Erode(Heights, Erodability, Size, Size, Settings));
+	}
+	State.SetItemsProcessed(State.iterations() * Size * Size * Settings.Iterations);
+}
+// 512x512 with 8 iterations is the default budget of FTerrainErosionSettings
+BENCHMARK(BM_TerrainErosion)->Args({ 256, 16 })->Args({ 512, 8 })->Args({ 512, 16 })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_FoliageScatter(benchmark::State& State)
+{
+	const TArray<FVector3f> Vertices = TrackFixtures::MakeHillsGrid(512, 512);
+
+	TArray<float> TrackDistance;
+	for (const FVector3f& Vertex : Vertices)
+	{
+		TrackDistance.Add(FMath::Abs(Vertex.X - 256.0f));
+	}
+
+	FFoliageScatterSettings Settings;
+	Settings.GrassProbability = 0.05f;
+	Settings.RocksProbability = 0.02f;
+	Settings.TreesProbability = 0.01f;
+	Settings.MaxGrass = 10000;
+	Settings.MaxRocks = 3000;
+	Settings.MaxTrees = 1000;
+	Settings.MinTrackDistance = 8.0f;
+
+	TArray<FTransform> Grass, Rocks, Trees;
+	for (auto _ : State)
+	{
+		FFoliageScatter::Scatter(Vertices, TrackDistance, Settings, Grass, Rocks, Trees);
+		benchmark::DoNotOptimize(Grass.GetData());
+	}
+}
+BENCHMARK(BM_FoliageScatter)->Unit(benchmark::kMillisecond);
+
+static void BM_SpscRingBufferPushPop(benchmark::State& State)
+{
+	TSpscRingBuffer<uint64, 1024> Buffer;
+	uint64 Value = 0;
+
+	for (auto _ : State)
+	{
+		Buffer.Push(Value);
+		Buffer.Pop(Value);
+		benchmark::DoNotOptimize(Value);
+	}
+}
+BENCHMARK(BM_SpscRingBufferPushPop);
@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RacingLine.h"
+#include "TrackContour.h"
+#include "TrackFixtures.h"
+#include "TrackSpatialIndex.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+static void BM_TraceTrackColors(benchmark::State& State)
+{
+	const uint32 Size = static_cast<uint32>(State.range(0));
+	const TArray<FColor> Colors = TrackFixtures::MakeRingImage(Size, Size * 0.3, Size * 0.4);
+
+	for (auto _ : State)
+	{
+		benchmark::DoNotOptimize(FTrackContour::TraceTrack(Colors, Size, Size));
+	}
+}
+BENCHMARK(BM_TraceTrackColors)->Arg(512)->Arg(2048)->Unit(benchmark::kMillisecond);
+
+static void BM_TraceTrackMask(benchmark::State& State)
+{
+	const uint32 Size = static_cast<uint32>(State.range(0));
+	const TArray<FColor> Colors = TrackFixtures::MakeRingImage(Size, Size * 0.3, Size * 0.4);
+
+	FTrackMask TrackMask;
+	TrackMask.Init(Size, Size);
+	for (uint32 Y = 0; Y < Size; Y++)
+	{
+		TrackMask.SetRow(Y, TConstArrayView<FColor>(Colors.GetData() + Y * Size, Size));
+	}
+
+	for (auto _ : State)
+	{
+		benchmark::DoNotOptimize(FTrackContour::TraceTrack(TrackMask));
+	}
+}
+BENCHMARK(BM_TraceTrackMask)->Arg(512)->Arg(2048)->Unit(benchmark::kMillisecond);
+
+static void BM_SpatialIndexQuery(benchmark::State& State)
+{
+	TArray<FVector> Centres;
+	TArray<FVector> Directions;
+	TrackFixtures::MakeStadium(200000.0, 50000.0, 100.0, Centres, Directions);
+
+	FTrackSpatialIndex Index;
+	Index.Build(Centres, 800.0);
+
+	std::mt19937 Generator(1);
+	std::uniform_real_distribution<double> Distribution(-60000.0, 260000.0);
+
+	for (auto _ : State)
+	{
+		float Alpha = 0.0f;
+		benchmark::DoNotOptimize(Index.FindClosestSegment(FVector2D(Distribution(Generator), Distribution(Generator)), Alpha));
+	}
+}
+BENCHMARK(BM_SpatialIndexQuery);
+
+static void BM_SpatialIndexBuild(benchmark::State& State)
+{
+	TArray<FVector> Centres;
+	TArray<FVector> Directions;
+	TrackFixtures::MakeStadium(200000.0, 50000.0, 100.0, Centres, Directions);
+
+	for (auto _ : State)
+	{
+		FTrackSpatialIndex Index;
+		Index.Build(Centres, 800.0);
+		benchmark::DoNotOptimize(Index);
+	}
+}
+BENCHMARK(BM_SpatialIndexBuild)->Unit(benchmark::kMicrosecond);
+
+static void BM_RacingLineSolve(benchmark::State& State)
+{
+	TArray<FVector> Centres;
+	TArray<FVector> Directions;
+	TrackFixtures::MakeStadium(200000.0, 50000.0, static_cast<double>(State.range(0)), Centres, Directions);
+
+	FRacingLineSettings Settings;
+	Settings.MaxOffset = 600.0f;
+
+	TArray<float> Offsets;
+	TArray<float> Speeds;
+	for (auto _ : State)
+	{
+		FRacingLine::SolveOffsets(Centres, Directions, Settings, Offsets);
+		FRacingLine::SolveSpeeds(Centres, Settings, Speeds);
+		benchmark::DoNotOptimize(Speeds.GetData());
+	}
+	State.SetItemsProcessed(State.iterations() * Centres.Num());
+}
+BENCHMARK(BM_RacingLineSolve)->Arg(200)->Arg(50)->Unit(benchmark::kMillisecond);
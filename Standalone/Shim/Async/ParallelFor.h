@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <atomic>
+#include <thread>
+
+enum class EParallelForFlags
+{
+	None = 0,
+	ForceSingleThread = 1,
+};
+
+// Indices handed out one at a time to a thread per core, like the engine's task graph would
+template <typename FunctionType>
+void ParallelFor(int32 Num, FunctionType&& Body, EParallelForFlags Flags = EParallelForFlags::None)
+{
+	const int32 ThreadsNum = Flags == EParallelForFlags::ForceSingleThread
+		? 1
+		: FMath::Min(Num, FMath::Max(1, static_cast<int32>(std::thread::hardware_concurrency())));
+
+	if (ThreadsNum <= 1)
+	{
+		for (int32 Index = 0; Index < Num; Index++)
+		{
+			Body(Index);
+		}
+		return;
+	}
+
+	std::atomic<int32> NextIndex = 0;
+	auto Work = [&NextIndex, &Body, Num]()
+	{
+		for (int32 Index = NextIndex++; Index < Num; Index = NextIndex++)
+		{
+			Body(Index);
+		}
+	};
+
+	std::vector<std::thread> Threads;
+	Threads.reserve(ThreadsNum - 1);
+	for (int32 Thread = 1; Thread < ThreadsNum; Thread++)
+	{
+		Threads.emplace_back(Work);
+	}
+
+	Work();
+
+	for (std::thread& Thread : Threads)
+	{
+		Thread.join();
+	}
+}
@@ -0,0 +1,446 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ *  Engine free stand in for the part of Core the RacingEngineerCore sources use, so they build with a plain compiler.
+ *  Names and behaviour follow the engine's, only as far as those sources and the standalone tests rely on them.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#pragma region Platform
+
+using int8 = std::int8_t;
+using int16 = std::int16_t;
+using int32 = std::int32_t;
+using int64 = std::int64_t;
+using uint8 = std::uint8_t;
+using uint16 = std::uint16_t;
+using uint32 = std::uint32_t;
+using uint64 = std::uint64_t;
+using SIZE_T = std::size_t;
+using TCHAR = char;
+
+#define RACINGENGINEERCORE_API
+#define FORCEINLINE inline
+#define PLATFORM_CACHE_LINE_SIZE 64
+#define TEXT(Text) Text
+
+#define MAX_int16 (std::numeric_limits<int16>::max())
+#define MAX_int32 (std::numeric_limits<int32>::max())
+#define MAX_int64 (std::numeric_limits<int64>::max())
+#define MAX_dbl (std::numeric_limits<double>::max())
+#define INDEX_NONE (-1)
+
+#define UE_SMALL_NUMBER (1.e-8f)
+#define UE_KINDA_SMALL_NUMBER (1.e-4f)
+#define UE_DOUBLE_SMALL_NUMBER (1.e-8)
+#define UE_PI (3.1415926535897932f)
+#define UE_SQRT_2 (1.4142135623730950488016887242097f)
+
+#define UE_ARRAY_COUNT(Array) (sizeof(Array) / sizeof((Array)[0]))
+
+// Braced like the engine's, callers sometimes leave out the semicolon
+#define check(Expression) { assert(Expression); }
+
+#define UE_LOG(Category, Verbosity, Format, ...) std::fprintf(stderr, Format "\n", ##__VA_ARGS__)
+
+#define TRACE_CPUPROFILER_EVENT_SCOPE(Name)
+#define LLM_SCOPE_BYTAG(Tag)
+
+template <typename T>
+constexpr std::remove_reference_t<T>&& MoveTemp(T&& Value)
+{
+	return static_cast<std::remove_reference_t<T>&&>(Value);
+}
+
+template <typename T>
+void Swap(T& A, T& B)
+{
+	std::swap(A, B);
+}
+
+inline uint32 HashCombineFast(uint32 A, uint32 B)
+{
+	return A ^ (B + 0x9e3779b9 + (A << 6) + (A >> 2));
+}
+
+class FArchive
+{
+public:
+	virtual ~FArchive() = default;
+	virtual void Serialize(void* Data, int64 Num) = 0;
+
+	FArchive& operator<<(int16& Value)
+	{
+		Serialize(&Value, sizeof(Value));
+		return *this;
+	}
+};
+
+#pragma endregion
+
+#pragma region Containers
+
+template <typename ElementType>
+class TArray
+{
+public:
+	TArray() = default;
+	TArray(const ElementType* Data, int32 Count) : Elements(Data, Data + Count) {}
+	TArray(std::initializer_list<ElementType> List) : Elements(List) {}
+
+	int32 Num() const { return static_cast<int32>(Elements.size()); }
+	bool IsEmpty() const { return Elements.empty(); }
+	bool IsValidIndex(int32 Index) const { return Index >= 0 && Index < Num(); }
+
+	ElementType* GetData() { return Elements.data(); }
+	const ElementType* GetData() const { return Elements.data(); }
+
+	ElementType& operator[](SIZE_T Index) { return Elements[Index]; }
+	const ElementType& operator[](SIZE_T Index) const { return Elements[Index]; }
+
+	ElementType& Last() { return Elements.back(); }
+	const ElementType& Last() const { return Elements.back(); }
+
+	int32 Add(const ElementType& Element) { Elements.push_back(Element); return Num() - 1; }
+	int32 Add(ElementType&& Element) { Elements.push_back(MoveTemp(Element)); return Num() - 1; }
+
+	template <typename... ArgsType>
+	int32 Emplace(ArgsType&&... Args)
+	{
+		Elements.emplace_back(std::forward<ArgsType>(Args)...);
+		return Num() - 1;
+	}
+
+	void Reserve(int32 Number) { Elements.reserve(Number); }
+	void Reset(int32 Slack = 0) { Elements.clear(); Elements.reserve(Slack); }
+	void Empty(int32 Slack = 0) { Elements.clear(); Elements.shrink_to_fit(); Elements.reserve(Slack); }
+	void Init(const ElementType& Element, int32 Number) { Elements.assign(Number, Element); }
+	void SetNum(int32 Number) { Elements.resize(Number); }
+	void SetNumUninitialized(int32 Number) { Elements.resize(Number); }
+	void SetNumZeroed(int32 Number) { Elements.assign(Number, ElementType()); }
+	void AddZeroed(int32 Count) { Elements.resize(Elements.size() + Count, ElementType()); }
+
+	SIZE_T GetAllocatedSize() const { return Elements.capacity() * sizeof(ElementType); }
+
+	auto begin() { return Elements.begin(); }
+	auto end() { return Elements.end(); }
+	auto begin() const { return Elements.begin(); }
+	auto end() const { return Elements.end(); }
+
+	bool operator==(const TArray& Other) const { return Elements == Other.Elements; }
+
+private:
+	std::vector<ElementType> Elements;
+};
+
+template <typename ElementType>
+class TArrayView
+{
+public:
+	using NonConstType = std::remove_const_t<ElementType>;
+
+	TArrayView() = default;
+	TArrayView(ElementType* InData, int32 InNum) : Data(InData), Count(InNum) {}
+	TArrayView(const TArray<NonConstType>& Array) : Data(Array.GetData()), Count(Array.Num()) {}
+	TArrayView(TArray<NonConstType>& Array) : Data(Array.GetData()), Count(Array.Num()) {}
+
+	int32 Num() const { return Count; }
+	bool IsEmpty() const { return Count == 0; }
+	ElementType* GetData() const { return Data; }
+	ElementType& operator[](SIZE_T Index) const { return Data[Index]; }
+
+	TArrayView Slice(int32 Index, int32 InNum) const { return TArrayView(Data + Index, InNum); }
+
+	ElementType* begin() const { return Data; }
+	ElementType* end() const { return Data + Count; }
+
+private:
+	ElementType* Data = nullptr;
+	int32 Count = 0;
+};
+
+template <typename ElementType>
+using TConstArrayView = TArrayView<const ElementType>;
+
+template <typename AllocatorType = void>
+class TBitArray
+{
+public:
+	void Init(bool bValue, int32 Number) { Bits.assign(Number, bValue); }
+	void Empty() { Bits.clear(); Bits.shrink_to_fit(); }
+	int32 Num() const { return static_cast<int32>(Bits.size()); }
+
+	std::vector<bool>::reference operator[](SIZE_T Index) { return Bits[Index]; }
+	bool operator[](SIZE_T Index) const { return Bits[Index]; }
+
+	SIZE_T GetAllocatedSize() const { return (Bits.capacity() + 7) / 8; }
+
+private:
+	std::vector<bool> Bits;
+};
+
+#pragma endregion
+
+#pragma region Math
+
+struct FMath
+{
+	template <typename T> static constexpr T Abs(const T A) { return A < T(0) ? -A : A; }
+	template <typename T> static constexpr T Sign(const T A) { return A > T(0) ? T(1) : (A < T(0) ? T(-1) : T(0)); }
+	template <typename T> static constexpr T Max(const T A, const T B) { return A < B ? B : A; }
+	template <typename T> static constexpr T Min(const T A, const T B) { return A < B ? A : B; }
+	template <typename T> static constexpr T Clamp(const T X, const T MinValue, const T MaxValue) { return X < MinValue ? MinValue : (X < MaxValue ? X : MaxValue); }
+	template <typename T> static constexpr T Square(const T A) { return A * A; }
+	template <typename T> static constexpr T DivideAndRoundUp(const T Dividend, const T Divisor) { return (Dividend + Divisor - 1) / Divisor; }
+
+	template <typename T, typename U>
+	static constexpr T Lerp(const T& A, const T& B, const U& Alpha) { return static_cast<T>(A + Alpha * (B - A)); }
+
+	static float Sqrt(const float Value) { return std::sqrt(Value); }
+	static double Sqrt(const double Value) { return std::sqrt(Value); }
+	static float Tan(const float Value) { return std::tan(Value); }
+	static float DegreesToRadians(const float Degrees) { return Degrees * (UE_PI / 180.0f); }
+
+	static int32 RoundToInt(const float Value) { return static_cast<int32>(std::floor(Value + 0.5f)); }
+	static int32 CeilToInt32(const double Value) { return static_cast<int32>(std::ceil(Value)); }
+	static int32 FloorToInt32(const double Value) { return static_cast<int32>(std::floor(Value)); }
+	static int32 TruncToInt(const float Value) { return static_cast<int32>(Value); }
+	static int64 RoundToInt64(const double Value) { return static_cast<int64>(std::floor(Value + 0.5)); }
+};
+
+struct FIntPoint
+{
+	int32 X = 0;
+	int32 Y = 0;
+
+	static const FIntPoint ZeroValue;
+
+	constexpr FIntPoint() = default;
+	constexpr FIntPoint(int32 InX, int32 InY) : X(InX), Y(InY) {}
+
+	FIntPoint operator+(const FIntPoint& Other) const { return FIntPoint(X + Other.X, Y + Other.Y); }
+	FIntPoint operator*(int32 Scale) const { return FIntPoint(X * Scale, Y * Scale); }
+	bool operator==(const FIntPoint& Other) const { return X == Other.X && Y == Other.Y; }
+};
+
+inline const FIntPoint FIntPoint::ZeroValue(0, 0);
+
+template <typename T>
+struct TVector;
+
+template <typename T>
+struct TVector2
+{
+	T X = 0;
+	T Y = 0;
+
+	static const TVector2 ZeroVector;
+
+	constexpr TVector2() = default;
+	constexpr TVector2(T InX, T InY) : X(InX), Y(InY) {}
+	explicit TVector2(const FIntPoint& Point) : X(static_cast<T>(Point.X)), Y(static_cast<T>(Point.Y)) {}
+	template <typename U>
+	explicit TVector2(const TVector<U>& Vector) : X(static_cast<T>(Vector.X)), Y(static_cast<T>(Vector.Y)) {}
+
+	TVector2 operator+(const TVector2& Other) const { return TVector2(X + Other.X, Y + Other.Y); }
+	TVector2 operator-(const TVector2& Other) const { return TVector2(X - Other.X, Y - Other.Y); }
+	TVector2 operator*(T Scale) const { return TVector2(X * Scale, Y * Scale); }
+	// Multiplies by the reciprocal like the engine, which rounds differently from dividing
+	TVector2 operator/(T Scale) const { const T RScale = T(1) / Scale; return TVector2(X * RScale, Y * RScale); }
+	bool operator==(const TVector2& Other) const { return X == Other.X && Y == Other.Y; }
+
+	T SizeSquared() const { return X * X + Y * Y; }
+	T Size() const { return std::sqrt(SizeSquared()); }
+
+	TVector2 GetSafeNormal(T Tolerance = UE_SMALL_NUMBER) const
+	{
+		const T SquareSum = SizeSquared();
+		return SquareSum > Tolerance ? *this * (T(1) / std::sqrt(SquareSum)) : ZeroVector;
+	}
+
+	static T DotProduct(const TVector2& A, const TVector2& B) { return A.X * B.X + A.Y * B.Y; }
+	static T CrossProduct(const TVector2& A, const TVector2& B) { return A.X * B.Y - A.Y * B.X; }
+	static T DistSquared(const TVector2& A, const TVector2& B) { return (B - A).SizeSquared(); }
+	static T Distance(const TVector2& A, const TVector2& B) { return (B - A).Size(); }
+};
+
+template <typename T>
+inline const TVector2<T> TVector2<T>::ZeroVector(0, 0);
+
+template <typename T>
+struct TVector
+{
+	T X = 0;
+	T Y = 0;
+	T Z = 0;
+
+	static const TVector ZeroVector;
+
+	constexpr TVector() = default;
+	constexpr TVector(T InX, T InY, T InZ) : X(InX), Y(InY), Z(InZ) {}
+	explicit constexpr TVector(T Value) : X(Value), Y(Value), Z(Value) {}
+	template <typename U, typename = std::enable_if_t<!std::is_same_v<T, U>>>
+	explicit TVector(const TVector<U>& Other) : X(static_cast<T>(Other.X)), Y(static_cast<T>(Other.Y)), Z(static_cast<T>(Other.Z)) {}
+
+	TVector operator+(const TVector& Other) const { return TVector(X + Other.X, Y + Other.Y, Z + Other.Z); }
+	TVector operator-(const TVector& Other) const { return TVector(X - Other.X, Y - Other.Y, Z - Other.Z); }
+	TVector operator*(T Scale) const { return TVector(X * Scale, Y * Scale, Z * Scale); }
+	TVector& operator+=(const TVector& Other) { X += Other.X; Y += Other.Y; Z += Other.Z; return *this; }
+	bool operator==(const TVector& Other) const { return X == Other.X && Y == Other.Y && Z == Other.Z; }
+
+	T SizeSquared() const { return X * X + Y * Y + Z * Z; }
+	T Size() const { return std::sqrt(SizeSquared()); }
+
+	bool Normalize(T Tolerance = UE_SMALL_NUMBER)
+	{
+		const T SquareSum = SizeSquared();
+		if (SquareSum > Tolerance)
+		{
+			*this = *this * (T(1) / std::sqrt(SquareSum));
+			return true;
+		}
+		return false;
+	}
+
+	TVector GetSafeNormal(T Tolerance = UE_SMALL_NUMBER) const
+	{
+		TVector Result = *this;
+		return Result.Normalize(Tolerance) ? Result : ZeroVector;
+	}
+
+	std::string ToString() const { return "X=" + std::to_string(X) + " Y=" + std::to_string(Y) + " Z=" + std::to_string(Z); }
+
+	static T DotProduct(const TVector& A, const TVector& B) { return A.X * B.X + A.Y * B.Y + A.Z * B.Z; }
+	static TVector CrossProduct(const TVector& A, const TVector& B) { return TVector(A.Y * B.Z - A.Z * B.Y, A.Z * B.X - A.X * B.Z, A.X * B.Y - A.Y * B.X); }
+	static T Dist(const TVector& A, const TVector& B) { return (B - A).Size(); }
+};
+
+template <typename T>
+inline const TVector<T> TVector<T>::ZeroVector(0, 0, 0);
+
+// The engine's ToString gives an FString, whose operator* is the character data
+inline const char* operator*(const std::string& String) { return String.c_str(); }
+
+using FVector = TVector<double>;
+using FVector3f = TVector<float>;
+using FVector2D = TVector2<double>;
+using FVector2f = TVector2<float>;
+
+struct FBox2D
+{
+	FVector2D Min;
+	FVector2D Max;
+
+	explicit FBox2D(const TArray<FVector2D>& Points)
+		: Min(MAX_dbl, MAX_dbl)
+		, Max(-MAX_dbl, -MAX_dbl)
+	{
+		for (const FVector2D& Point : Points)
+		{
+			Min = FVector2D(FMath::Min(Min.X, Point.X), FMath::Min(Min.Y, Point.Y));
+			Max = FVector2D(FMath::Max(Max.X, Point.X), FMath::Max(Max.Y, Point.Y));
+		}
+	}
+
+	FVector2D GetSize() const { return Max - Min; }
+};
+
+struct FQuat
+{
+	double X = 0.0;
+	double Y = 0.0;
+	double Z = 0.0;
+	double W = 1.0;
+};
+
+struct FRotator
+{
+	double Pitch = 0.0;
+	double Yaw = 0.0;
+	double Roll = 0.0;
+
+	FRotator(double InPitch, double InYaw, double InRoll) : Pitch(InPitch), Yaw(InYaw), Roll(InRoll) {}
+
+	FQuat Quaternion() const
+	{
+		const double HalfRadians = UE_PI / 360.0;
+		const double SP = std::sin(Pitch * HalfRadians), CP = std::cos(Pitch * HalfRadians);
+		const double SY = std::sin(Yaw * HalfRadians), CY = std::cos(Yaw * HalfRadians);
+		const double SR = std::sin(Roll * HalfRadians), CR = std::cos(Roll * HalfRadians);
+
+		return FQuat{ CR * SP * SY - SR * CP * CY, -CR * SP * CY - SR * CP * SY, CR * CP * SY - SR * SP * CY, CR * CP * CY + SR * SP * SY };
+	}
+};
+
+struct FTransform
+{
+	FQuat Rotation;
+	FVector Translation;
+	FVector Scale3D = FVector(1.0);
+
+	FTransform() = default;
+	FTransform(const FQuat& InRotation, const FVector& InTranslation, const FVector& InScale3D)
+		: Rotation(InRotation), Translation(InTranslation), Scale3D(InScale3D) {}
+
+	FVector GetLocation() const { return Translation; }
+	FVector GetScale3D() const { return Scale3D; }
+	FQuat GetRotation() const { return Rotation; }
+};
+
+struct FColor
+{
+	uint8 B = 0;
+	uint8 G = 0;
+	uint8 R = 0;
+	uint8 A = 0;
+
+	static const FColor White;
+	static const FColor Black;
+
+	constexpr FColor() = default;
+	constexpr FColor(uint8 InR, uint8 InG, uint8 InB, uint8 InA = 255) : B(InB), G(InG), R(InR), A(InA) {}
+};
+
+inline const FColor FColor::White(255, 255, 255);
+inline const FColor FColor::Black(0, 0, 0);
+
+// Same generator as the engine's, so seeded results match the game's
+struct FRandomStream
+{
+	explicit FRandomStream(int32 InSeed) : Seed(static_cast<uint32>(InSeed)) {}
+
+	float FRand()
+	{
+		MutateSeed();
+
+		uint32 Bits = 0x3F800000U | (Seed >> 9);
+		float Result;
+		std::memcpy(&Result, &Bits, sizeof(Result));
+		return Result - 1.0f;
+	}
+
+	float FRandRange(float InMin, float InMax) { return InMin + (InMax - InMin) * FRand(); }
+
+	int32 RandHelper(int32 A) { return A > 0 ? FMath::Min(FMath::TruncToInt(FRand() * static_cast<float>(A)), A - 1) : 0; }
+	int32 RandRange(int32 InMin, int32 InMax) { return InMin + RandHelper(InMax - InMin + 1); }
+
+private:
+	void MutateSeed() { Seed = (Seed * 196314165U) + 907633515U; }
+
+	uint32 Seed = 0;
+};
+
+#pragma endregion
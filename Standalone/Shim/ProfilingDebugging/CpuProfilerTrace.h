@@ -0,0 +1,6 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// TRACE_CPUPROFILER_EVENT_SCOPE is defined away in the shim's CoreMinimal.h, there is no trace to write to
+#include "CoreMinimal.h"
@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FoliageScatter.h"
+#include "TrackFixtures.h"
+
+#include <gtest/gtest.h>
+
+namespace FoliageScatterTests
+{
+	FFoliageScatterSettings MakeSettings()
+	{
+		FFoliageScatterSettings Settings;
+		Settings.Seed = 42;
+		Settings.GrassProbability = 0.05f;
+		Settings.RocksProbability = 0.02f;
+		Settings.TreesProbability = 0.01f;
+		Settings.MaxGrass = 500;
+		Settings.MaxRocks = 200;
+		Settings.MaxTrees = 100;
+		Settings.MinTrackDistance = 10.0f;
+		return Settings;
+	}
+
+	TArray<float> MakeTrackDistance(const TArray<FVector3f>& Vertices)
+	{
+		TArray<float> TrackDistance;
+		for (const FVector3f& Vertex : Vertices)
+		{
+			TrackDistance.Add(FMath::Abs(Vertex.X - 64.0f));
+		}
+		return TrackDistance;
+	}
+
+	TArray<FVector> GetLocations(const TArray<FTransform>& Transforms)
+	{
+		TArray<FVector> Locations;
+		for (const FTransform& Transform : Transforms)
+		{
+			Locations.Add(Transform.GetLocation());
+		}
+		return Locations;
+	}
+}
+
+TEST(FoliageScatter, SameSeedSameTransforms)
+{
+	const TArray<FVector3f> Vertices = TrackFixtures::MakeHillsGrid(128, 128);
+	const TArray<float> TrackDistance = FoliageScatterTests::MakeTrackDistance(Vertices);
+	const FFoliageScatterSettings Settings = FoliageScatterTests::MakeSettings();
+
+	TArray<FTransform> Grass[2], Rocks[2], Trees[2];
+	for (int32 Run = 0; Run < 2; Run++)
+	{
+		FFoliageScatter::Scatter(Vertices, TrackDistance, Settings, Grass[Run], Rocks[Run], Trees[Run]);
+	}
+
+	EXPECT_GT(Grass[0].Num(), 0);
+	EXPECT_EQ(FoliageScatterTests::GetLocations(Grass[0]), FoliageScatterTests::GetLocations(Grass[1]));
+	EXPECT_EQ(FoliageScatterTests::GetLocations(Rocks[0]), FoliageScatterTests::GetLocations(Rocks[1]));
+	EXPECT_EQ(FoliageScatterTests::GetLocations(Trees[0]), FoliageScatterTests::GetLocations(Trees[1]));
+}
+
+TEST(FoliageScatter, BandsGiveTheSameTransformsAsOneScatter)
+{
+	const TArray<FVector3f> Vertices = TrackFixtures::MakeHillsGrid(128, 128);
+	const TArray<float> TrackDistance = FoliageScatterTests::MakeTrackDistance(Vertices);
+	const FFoliageScatterSettings Settings = FoliageScatterTests::MakeSettings();
+
+	TArray<FTransform> Grass, Rocks, Trees;
+	FFoliageScatter::Scatter(Vertices, TrackDistance, Settings, Grass, Rocks, Trees);
+
+	TArray<FTransform> BandGrass, BandRocks, BandTrees;
+	FRandomStream RandomStream(Settings.Seed);
+	constexpr int32 BandVertices = 128 * 16;
+
+	for (int32 First = 0; First < Vertices.Num(); First += BandVertices)
+	{
+		FFoliageScatter::ScatterBand(TConstArrayView<FVector3f>(Vertices).Slice(First, BandVertices), TConstArrayView<float>(TrackDistance).Slice(First, BandVertices),
+			Settings, RandomStream, BandGrass, BandRocks, BandTrees);
+	}
+
+	EXPECT_EQ(FoliageScatterTests::GetLocations(Grass), FoliageScatterTests::GetLocations(BandGrass));
+	EXPECT_EQ(FoliageScatterTests::GetLocations(Rocks), FoliageScatterTests::GetLocations(BandRocks));
+	EXPECT_EQ(FoliageScatterTests::GetLocations(Trees), FoliageScatterTests::GetLocations(BandTrees));
+}
+
+TEST(FoliageScatter, KeepsClearOfTheTrackAndWithinTheCaps)
+{
+	const TArray<FVector3f> Vertices = TrackFixtures::MakeHillsGrid(128, 128);
+	const TArray<float> TrackDistance = FoliageScatterTests::MakeTrackDistance(Vertices);
+
+	FFoliageScatterSettings Settings = FoliageScatterTests::MakeSettings();
+	Settings.GrassProbability = 1.0f;
+	Settings.MaxGrass = 300;
+
+	TArray<FTransform> Grass, Rocks, Trees;
+	FFoliageScatter::Scatter(Vertices, TrackDistance, Settings, Grass, Rocks, Trees);
+
+	EXPECT_EQ(Grass.Num(), Settings.MaxGrass);
+	EXPECT_LE(Rocks.Num(), Settings.MaxRocks);
+	EXPECT_LE(Trees.Num(), Settings.MaxTrees);
+
+	for (const FTransform& Transform : Grass)
+	{
+		EXPECT_GT(FMath::Abs(Transform.GetLocation().X - 64.0), Settings.MinTrackDistance);
+		EXPECT_GE(Transform.GetScale3D().X, 0.5);
+		EXPECT_LE(Transform.GetScale3D().X, 3.0);
+	}
+}
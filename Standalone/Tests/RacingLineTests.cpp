@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RacingLine.h"
+#include "TrackFixtures.h"
+
+#include <gtest/gtest.h>
+
+namespace RacingLineTests
+{
+	// Squared curvature integrated along the loop, what a smoother line keeps low
+	double GetBendingEnergy(const TArray<FVector>& Points)
+	{
+		const int32 SamplesNum = Points.Num();
+
+		double Energy = 0.0;
+		for (int32 Index = 0; Index < SamplesNum; Index++)
+		{
+			const FVector& Next = Points[(Index + 1) % SamplesNum];
+			const float Curvature = FRacingLine::GetCurvature(FVector2D(Points[(Index + SamplesNum - 1) % SamplesNum]), FVector2D(Points[Index]), FVector2D(Next));
+			Energy += FMath::Square(static_cast<double>(Curvature)) * FVector::Dist(Points[Index], Next);
+		}
+		return Energy;
+	}
+
+	TArray<FVector> ApplyOffsets(const TArray<FVector>& Centres, const TArray<FVector>& Directions, const TArray<float>& Offsets)
+	{
+		TArray<FVector> Points;
+		for (int32 Index = 0; Index < Centres.Num(); Index++)
+		{
+			const FVector Right = FVector(-Directions[Index].Y, Directions[Index].X, 0.0).GetSafeNormal();
+			Points.Add(Centres[Index] + Right * Offsets[Index]);
+		}
+		return Points;
+	}
+}
+
+TEST(RacingLine, CurvatureOfACircleIsItsInverseRadius)
+{
+	const double Radius = 500.0;
+	const FVector2D Previous(Radius * std::cos(-0.1), Radius * std::sin(-0.1));
+	const FVector2D Current(Radius, 0.0);
+	const FVector2D Next(Radius * std::cos(0.1), Radius * std::sin(0.1));
+
+	EXPECT_NEAR(FMath::Abs(FRacingLine::GetCurvature(Previous, Current, Next)), 1.0 / Radius, 1.e-6);
+	EXPECT_FLOAT_EQ(FRacingLine::GetCurvature(Previous, Current, Next), -FRacingLine::GetCurvature(Next, Current, Previous));
+	EXPECT_EQ(FRacingLine::GetCurvature(FVector2D(0, 0), FVector2D(1, 0), FVector2D(2, 0)), 0.0f);
+}
+
+TEST(RacingLine, OffsetsStayOnTheTrackAndSmoothTheBends)
+{
+	TArray<FVector> Centres;
+	TArray<FVector> Directions;
+	TrackFixtures::MakeStadium(30000.0, 5000.0, 200.0, Centres, Directions);
+
+	FRacingLineSettings Settings;
+	Settings.MaxOffset = 600.0f;
+
+	TArray<float> Offsets;
+	FRacingLine::SolveOffsets(Centres, Directions, Settings, Offsets);
+
+	ASSERT_EQ(Offsets.Num(), Centres.Num());
+	for (const float Offset : Offsets)
+	{
+		EXPECT_LE(FMath::Abs(Offset), Settings.MaxOffset + 1.e-3f);
+	}
+
+	const TArray<FVector> Line = RacingLineTests::ApplyOffsets(Centres, Directions, Offsets);
+	EXPECT_LT(RacingLineTests::GetBendingEnergy(Line), RacingLineTests::GetBendingEnergy(Centres) * 0.9);
+}
+
+TEST(RacingLine, TooFewSamplesKeepTheCentreLine)
+{
+	const TArray<FVector> Centres = { FVector(0, 0, 0), FVector(1, 0, 0), FVector(1, 1, 0) };
+	const TArray<FVector> Directions = { FVector(1, 0, 0), FVector(0, 1, 0), FVector(-1, 0, 0) };
+
+	FRacingLineSettings Settings;
+	Settings.MaxOffset = 100.0f;
+
+	TArray<float> Offsets;
+	FRacingLine::SolveOffsets(Centres, Directions, Settings, Offsets);
+
+	EXPECT_EQ(Offsets, TArray<float>({ 0.0f, 0.0f, 0.0f }));
+}
+
+TEST(RacingLine, SpeedsAreBoundByGripAndBraking)
+{
+	TArray<FVector> Centres;
+	TArray<FVector> Directions;
+	TrackFixtures::MakeStadium(30000.0, 5000.0, 200.0, Centres, Directions);
+
+	const FRacingLineSettings Settings;
+	TArray<float> Speeds;
+	FRacingLine::SolveSpeeds(Centres, Settings, Speeds);
+
+	ASSERT_EQ(Speeds.Num(), Centres.Num());
+
+	// Mid bend the lateral grip decides, sqrt(a * r)
+	const float CornerSpeed = FMath::Sqrt(Settings.MaxLateralAcceleration * 5000.0f);
+	const int32 MidBend = static_cast<int32>((30000.0 + UE_PI * 5000.0 * 0.5) / (2.0 * 30000.0 + 2.0 * UE_PI * 5000.0) * Centres.Num());
+	EXPECT_NEAR(Speeds[MidBend], CornerSpeed, CornerSpeed * 0.02f);
+
+	const int32 SamplesNum = Speeds.Num();
+	for (int32 Index = 0; Index < SamplesNum; Index++)
+	{
+		const int32 Next = (Index + 1) % SamplesNum;
+		const float Step = FVector::Dist(Centres[Index], Centres[Next]);
+
+		EXPECT_LE(Speeds[Index], Settings.MaxSpeed);
+		// v^2 reaches 2e7, past where floats resolve single units
+		const float Tolerance = FMath::Square(Speeds[Index]) * 1.e-5f;
+		EXPECT_LE(FMath::Square(Speeds[Next]), FMath::Square(Speeds[Index]) + 2.0f * Settings.MaxAcceleration * Step + Tolerance);
+		EXPECT_LE(FMath::Square(Speeds[Index]), FMath::Square(Speeds[Next]) + 2.0f * Settings.MaxDeceleration * Step + Tolerance);
+	}
+}
@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpscRingBuffer.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+TEST(SpscRingBuffer, FailsWhenFullAndKeepsTheOrder)
+{
+	TSpscRingBuffer<int32, 4> Buffer;
+
+	for (int32 Value = 0; Value < 4; Value++)
+	{
+		EXPECT_TRUE(Buffer.Push(Value));
+	}
+	EXPECT_FALSE(Buffer.Push(4));
+	EXPECT_EQ(Buffer.Num(), 4u);
+
+	int32 Value = -1;
+	for (int32 Expected = 0; Expected < 4; Expected++)
+	{
+		ASSERT_TRUE(Buffer.Pop(Value));
+		EXPECT_EQ(Value, Expected);
+	}
+	EXPECT_FALSE(Buffer.Pop(Value));
+}
+
+TEST(SpscRingBuffer, IndicesWrapAround)
+{
+	TSpscRingBuffer<int32, 2> Buffer;
+
+	int32 Value = 0;
+	for (int32 Round = 0; Round < 1000; Round++)
+	{
+		ASSERT_TRUE(Buffer.Push(Round));
+		ASSERT_TRUE(Buffer.Pop(Value));
+		ASSERT_EQ(Value, Round);
+	}
+}
+
+TEST(SpscRingBuffer, ConsumerSeesEveryElementOnce)
+{
+	TSpscRingBuffer<uint64, 64> Buffer;
+	constexpr uint64 ElementsNum = 200000;
+
+	std::thread Producer([&Buffer]()
+		{
+			for (uint64 Value = 1; Value <= ElementsNum; Value++)
+			{
+				while (!Buffer.Push(Value))
+				{
+					std::this_thread::yield();
+				}
+			}
+		});
+
+	uint64 Expected = 1;
+	uint64 Value = 0;
+	while (Expected <= ElementsNum)
+	{
+		if (!Buffer.Pop(Value))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		ASSERT_EQ(Value, Expected);
+		Expected++;
+	}
+
+	Producer.join();
+}
@@ -0,0 +1,141 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainErosion.h"
+#include "TrackFixtures.h"
+
+#include <gtest/gtest.h>
+
+namespace TerrainErosionTests
+{
+	constexpr uint32 Size = 96;
+
+	TArray<float> MakeHeights()
+	{
+		TArray<float> Heights;
+		for (const FVector3f& Vertex : TrackFixtures::MakeHillsGrid(Size, Size))
+		{
+			Heights.Add(Vertex.Z * 50.0f + Vertex.X * 2.0f);
+		}
+		return Heights;
+	}
+
+	FTerrainErosionSettings MakeSettings()
+	{
+		FTerrainErosionSettings Settings;
+		Settings.Seed = 3;
+		Settings.Iterations = 24;
+		Settings.CellSize = 10.0f;
+		return Settings;
+	}
+}
+
+TEST(TerrainErosion, IterationsShrinkWithTheMap)
+{
+	FTerrainErosionSettings Settings;
+	Settings.Iterations = 64;
+	Settings.MaxTexelIterations = 64ll * 256 * 256;
+
+	EXPECT_EQ(FTerrainErosion::GetIterations(256, 256, Settings), 64);
+	EXPECT_EQ(FTerrainErosion::GetIterations(512, 512, Settings), 16);
+	EXPECT_EQ(FTerrainErosion::GetIterations(2048, 2048, Settings), 1);
+	EXPECT_EQ(FTerrainErosion::GetIterations(0, 0, Settings), 0);
+
+	Settings.Iterations = 0;
+	EXPECT_EQ(FTerrainErosion::GetIterations(256, 256, Settings), 0);
+}
+
+TEST(TerrainErosion, MapsOverTheMemoryBudgetAreLeftAlone)
+{
+	FTerrainErosionSettings Settings = TerrainErosionTests::MakeSettings();
+	EXPECT_EQ(FTerrainErosion::GetMemoryBytes(256, 256), 256ll * 256 * 11 * sizeof(float));
+
+	Settings.MaxMemoryBytes = FTerrainErosion::GetMemoryBytes(TerrainErosionTests::Size, TerrainErosionTests::Size) - 1;
+
+	TArray<float> Heights = TerrainErosionTests::MakeHeights();
+	const TArray<float> Source = Heights;
+	TArray<float> Erodability;
+	Erodability.Init(1.0f, Heights.Num());
+
+	EXPECT_EQ(FTerrainErosion::GetIterations(TerrainErosionTests::Size, TerrainErosionTests::Size, Settings), 0);
+	EXPECT_EQ(FTerrainErosion::Erode(Heights, Erodability, TerrainErosionTests::Size, TerrainErosionTests::Size, Settings), 0);
+	EXPECT_EQ(Heights, Source);
+}
+
+TEST(TerrainErosion, ResultDoesNotDependOnTheTiling)
+{
+	const TArray<float> Source = TerrainErosionTests::MakeHeights();
+	TArray<float> Erodability;
+	Erodability.Init(1.0f, Source.Num());
+
+	FTerrainErosionSettings Settings = TerrainErosionTests::MakeSettings();
+
+	TArray<float> Tiled = Source;
+	Settings.TileRows = 5;
+	ASSERT_EQ(FTerrainErosion::Erode(Tiled, Erodability, TerrainErosionTests::Size, TerrainErosionTests::Size, Settings), Settings.Iterations);
+
+	TArray<float> Whole = Source;
+	Settings.TileRows = TerrainErosionTests::Size;
+	FTerrainErosion::Erode(Whole, Erodability, TerrainErosionTests::Size, TerrainErosionTests::Size, Settings);
+
+	EXPECT_EQ(Tiled, Whole);
+	EXPECT_FALSE(Tiled == Source);
+}
+
+TEST(TerrainErosion, ZeroErodabilityKeepsTheTexel)
+{
+	TArray<float> Heights = TerrainErosionTests::MakeHeights();
+	const TArray<float> Source = Heights;
+
+	// A band down the middle like the track's
+	TArray<float> Erodability;
+	for (uint32 Y = 0; Y < TerrainErosionTests::Size; Y++)
+	{
+		for (uint32 X = 0; X < TerrainErosionTests::Size; X++)
+		{
+			Erodability.Add(X >= 40 && X < 56 ? 0.0f : 1.0f);
+		}
+	}
+
+	FTerrainErosion::Erode(Heights, Erodability, TerrainErosionTests::Size, TerrainErosionTests::Size, TerrainErosionTests::MakeSettings());
+
+	for (int32 Index = 0; Index < Heights.Num(); Index++)
+	{
+		if (Erodability[Index] == 0.0f)
+		{
+			ASSERT_EQ(Heights[Index], Source[Index]) << Index;
+		}
+	}
+}
+
+TEST(TerrainErosion, TalusFlattensASpike)
+{
+	constexpr uint32 Size = 16;
+
+	TArray<float> Heights;
+	Heights.Init(0.0f, Size * Size);
+	Heights[8 * Size + 8] = 1000.0f;
+
+	TArray<float> Erodability;
+	Erodability.Init(1.0f, Size * Size);
+
+	FTerrainErosionSettings Settings;
+	Settings.Iterations = 16;
+	Settings.RainAmount = 0.0f;
+
+	FTerrainErosion::Erode(Heights, Erodability, Size, Size, Settings);
+
+	EXPECT_LT(Heights[8 * Size + 8], 500.0f);
+	EXPECT_GT(Heights[8 * Size + 7], 0.0f);
+}
+
+TEST(TerrainErosion, MismatchedInputsAreLeftAlone)
+{
+	TArray<float> Heights;
+	Heights.Init(1.0f, 10);
+	TArray<float> Erodability;
+	Erodability.Init(1.0f, 9);
+
+	EXPECT_EQ(FTerrainErosion::Erode(Heights, Erodability, 5, 2, TerrainErosionTests::MakeSettings()), 0);
+	EXPECT_EQ(Heights.Num(), 10);
+}
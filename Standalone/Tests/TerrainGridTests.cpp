@@ -0,0 +1,148 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainGrid.h"
+#include "TrackFixtures.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+TEST(TerrainGrid, TrianglesCoverEveryQuadTwice)
+{
+	constexpr uint32 Width = 7;
+	constexpr uint32 Height = 5;
+
+	const TArray<int32> Triangles = FTerrainGrid::CalculateTriangles(Width, Height);
+
+	ASSERT_EQ(Triangles.Num(), static_cast<int32>((Width - 1) * (Height - 1) * 6));
+	for (const int32 Index : Triangles)
+	{
+		EXPECT_GE(Index, 0);
+		EXPECT_LT(Index, static_cast<int32>(Width * Height));
+	}
+}
+
+TEST(TerrainGrid, FlatGridNormalsPointUp)
+{
+	constexpr uint32 Width = 16;
+	constexpr uint32 Height = 16;
+
+	TArray<FVector3f> Vertices;
+	for (uint32 Y = 0; Y < Height; Y++)
+	{
+		for (uint32 X = 0; X < Width; X++)
+		{
+			Vertices.Emplace(X * 100.0f, Y * 100.0f, 0.0f);
+		}
+	}
+
+	const TArray<FOctahedralNormal> Normals = FTerrainGrid::CalculateNormals(Vertices, FTerrainGrid::CalculateTriangles(Width, Height), Width, Height);
+
+	ASSERT_EQ(Normals.Num(), static_cast<int32>(Width * Height));
+	for (const FOctahedralNormal& Normal : Normals)
+	{
+		const FVector3f Unpacked = Normal.Unpack();
+		EXPECT_NEAR(Unpacked.Z, 1.0f, 1.e-4f);
+	}
+}
+
+TEST(TerrainGrid, HillNormalsAreUnitLength)
+{
+	constexpr uint32 Width = 64;
+	constexpr uint32 Height = 48;
+
+	const TArray<FOctahedralNormal> Normals = FTerrainGrid::CalculateNormals(TrackFixtures::MakeHillsGrid(Width, Height),
+		FTerrainGrid::CalculateTriangles(Width, Height), Width, Height);
+
+	for (const FOctahedralNormal& Normal : Normals)
+	{
+		EXPECT_NEAR(Normal.Unpack().Size(), 1.0f, 1.e-4f);
+	}
+}
+
+TEST(TerrainGrid, UVsSpanTheUnitSquare)
+{
+	const TArray<FVector2D> UVs = FTerrainGrid::CalculateUVs(5, 3);
+
+	ASSERT_EQ(UVs.Num(), 15);
+	EXPECT_EQ(UVs[0], FVector2D(0.0, 0.0));
+	EXPECT_EQ(UVs[4], FVector2D(1.0, 0.0));
+	EXPECT_EQ(UVs[14], FVector2D(1.0, 1.0));
+	EXPECT_EQ(UVs[7], FVector2D(0.5, 0.5));
+}
+
+TEST(OctahedralNormal, RoundTripsWithinAHundredthOfADegree)
+{
+	std::mt19937 Generator(7);
+	std::normal_distribution<float> Distribution;
+
+	double MaxDegrees = 0.0;
+	for (int32 Index = 0; Index < 10000; Index++)
+	{
+		const FVector3f Normal = FVector3f(Distribution(Generator), Distribution(Generator), Distribution(Generator)).GetSafeNormal();
+		const FVector3f Unpacked = FOctahedralNormal(Normal).Unpack();
+
+		// The cosine of angles this small rounds to 1 in floats
+		const double Degrees = std::atan2(FVector3f::CrossProduct(Normal, Unpacked).Size(), FVector3f::DotProduct(Normal, Unpacked)) * 180.0 / UE_PI;
+		MaxDegrees = FMath::Max(MaxDegrees, Degrees);
+	}
+
+	EXPECT_LT(MaxDegrees, 0.01);
+}
+
+TEST(OctahedralNormal, KeepsTheAxes)
+{
+	const FVector3f Axes[] = { FVector3f(1, 0, 0), FVector3f(-1, 0, 0), FVector3f(0, 1, 0), FVector3f(0, -1, 0), FVector3f(0, 0, 1), FVector3f(0, 0, -1) };
+
+	for (const FVector3f& Axis : Axes)
+	{
+		const FVector3f Unpacked = FOctahedralNormal(Axis).Unpack();
+		EXPECT_NEAR(FVector3f::DotProduct(Axis, Unpacked), 1.0f, 1.e-6f);
+	}
+}
+
+TEST(LandscapeLayout, CoversTheGridWithinTheComponentBudget)
+{
+	const uint32 GridSizes[] = { 2, 64, 127, 128, 255, 505, 512, 1009, 2048, 4096 };
+
+	for (const uint32 GridSize : GridSizes)
+	{
+		const FLandscapeLayout Layout = FLandscapeLayout::Choose(GridSize, GridSize, 1024);
+
+		EXPECT_GE(Layout.GetVerticesNum().X, static_cast<int32>(GridSize)) << GridSize;
+		EXPECT_GE(Layout.GetVerticesNum().Y, static_cast<int32>(GridSize)) << GridSize;
+		EXPECT_LE(Layout.ComponentsNum.X * Layout.ComponentsNum.Y, 1024) << GridSize;
+	}
+}
+
+TEST(LandscapeLayout, ExactFitsHaveNoExcess)
+{
+	const FLandscapeLayout Layout = FLandscapeLayout::Choose(1021, 1021, 1024);
+
+	EXPECT_EQ(Layout.GetVerticesNum(), FIntPoint(1021, 1021));
+	EXPECT_EQ(Layout.ComponentsNum, FIntPoint(2, 2));
+}
+
+TEST(LandscapeLayout, PrefersFewerComponentsOverASmallExcess)
+{
+	// 63 quad sections fit 505 exactly with 4x4 components, a single component of 2x2 255 quad sections has 6 more quads per side
+	const FLandscapeLayout Exact = FLandscapeLayout::Choose(505, 505, 1024);
+	EXPECT_EQ(Exact.QuadsPerSection, 255);
+	EXPECT_EQ(Exact.SectionsPerComponent, 2);
+	EXPECT_EQ(Exact.ComponentsNum, FIntPoint(1, 1));
+
+	// 17x17 components of 31 quads would be closest to 512, 9x9 components of 2x2 such sections are within an eighth
+	const FLandscapeLayout Layout = FLandscapeLayout::Choose(512, 512, 1024);
+	EXPECT_EQ(Layout.QuadsPerSection, 31);
+	EXPECT_EQ(Layout.SectionsPerComponent, 2);
+	EXPECT_EQ(Layout.ComponentsNum, FIntPoint(9, 9));
+
+	const uint32 GridSizes[] = { 505, 512, 1009, 2048, 4096 };
+	for (const uint32 GridSize : GridSizes)
+	{
+		const FLandscapeLayout Chosen = FLandscapeLayout::Choose(GridSize, GridSize, 1024);
+		EXPECT_LE(Chosen.GetQuadsNum().X, (GridSize - 1) * 9 / 8) << GridSize;
+		EXPECT_LE(Chosen.ComponentsNum.X * Chosen.ComponentsNum.Y, 256) << GridSize;
+	}
+}
@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainNoise.h"
+
+#include "Async/ParallelFor.h"
+
+#include <gtest/gtest.h>
+
+TEST(TerrainNoise, SameSeedSameValues)
+{
+	const FTerrainNoise Noise(1337, 0.01f);
+	const FTerrainNoise Copy = Noise;
+	const FTerrainNoise Other(1338, 0.01f);
+
+	int32 Differences = 0;
+	for (int32 Y = 0; Y < 64; Y++)
+	{
+		for (int32 X = 0; X < 64; X++)
+		{
+			const float Value = Noise.GetNoise2D(X * 7.3f, Y * 5.1f);
+			ASSERT_EQ(Value, FTerrainNoise(1337, 0.01f).GetNoise2D(X * 7.3f, Y * 5.1f));
+			ASSERT_EQ(Value, Copy.GetNoise2D(X * 7.3f, Y * 5.1f));
+			Differences += Value != Other.GetNoise2D(X * 7.3f, Y * 5.1f);
+		}
+	}
+
+	EXPECT_GT(Differences, 64 * 64 / 2);
+}
+
+TEST(TerrainNoise, ZeroOnTheLatticeAndBoundedBetween)
+{
+	const FTerrainNoise Noise(5, 1.0f);
+
+	float MinValue = 0.0f;
+	float MaxValue = 0.0f;
+	for (int32 Y = -50; Y < 50; Y++)
+	{
+		for (int32 X = -50; X < 50; X++)
+		{
+			EXPECT_EQ(Noise.GetNoise2D(X, Y), 0.0f);
+
+			const float Value = Noise.GetNoise2D(X + 0.37f, Y + 0.61f);
+			MinValue = FMath::Min(MinValue, Value);
+			MaxValue = FMath::Max(MaxValue, Value);
+		}
+	}
+
+	EXPECT_GE(MinValue, -1.0f);
+	EXPECT_LE(MaxValue, 1.0f);
+	EXPECT_LT(MinValue, -0.2f);
+	EXPECT_GT(MaxValue, 0.2f);
+}
+
+TEST(TerrainNoise, ThreadsSampleOneInstance)
+{
+	const FTerrainNoise Noise(99, 0.02f);
+	constexpr int32 Size = 256;
+
+	TArray<float> Serial;
+	for (int32 Index = 0; Index < Size * Size; Index++)
+	{
+		Serial.Add(Noise.GetNoise2D(Index % Size, Index / Size));
+	}
+
+	TArray<float> Parallel;
+	Parallel.SetNumUninitialized(Size * Size);
+	ParallelFor(Size, [&Noise, &Parallel](int32 Y)
+		{
+			for (int32 X = 0; X < Size; X++)
+			{
+				Parallel[Y * Size + X] = Noise.GetNoise2D(X, Y);
+			}
+		});
+
+	EXPECT_EQ(Serial, Parallel);
+}
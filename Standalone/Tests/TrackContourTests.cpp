@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TrackContour.h"
+#include "TrackFixtures.h"
+#include "TrackImage.h"
+
+#include <gtest/gtest.h>
+
+namespace TrackContourTests
+{
+	constexpr uint32 Size = 128;
+
+	FTrackMask MakeMask(const TArray<FColor>& Colors)
+	{
+		FTrackMask TrackMask;
+		TrackMask.Init(Size, Size);
+		for (uint32 Y = 0; Y < Size; Y++)
+		{
+			TrackMask.SetRow(Y, TConstArrayView<FColor>(Colors.GetData() + Y * Size, Size));
+		}
+		return TrackMask;
+	}
+}
+
+TEST(TrackContour, TracesAClosedLoopOfNeighbouringTrackPixels)
+{
+	const TArray<FColor> Colors = TrackFixtures::MakeRingImage(TrackContourTests::Size, 30.0, 40.0);
+
+	const TArray<FVector2D> Nodes = FTrackContour::TraceTrack(Colors, TrackContourTests::Size, TrackContourTests::Size);
+
+	ASSERT_GT(Nodes.Num(), 100);
+	EXPECT_LE(FVector2D::DistSquared(Nodes[0], Nodes.Last()), 2.0);
+
+	for (int32 Index = 0; Index < Nodes.Num(); Index++)
+	{
+		const FVector2D& Node = Nodes[Index];
+		EXPECT_TRUE(FTrackMask::IsTrackValue(Colors[static_cast<uint32>(Node.Y) * TrackContourTests::Size + static_cast<uint32>(Node.X)].R));
+
+		if (Index > 0)
+		{
+			EXPECT_LE(FVector2D::DistSquared(Node, Nodes[Index - 1]), 2.0);
+		}
+	}
+}
+
+TEST(TrackContour, MaskTracesTheSameNodesAsColors)
+{
+	const TArray<FColor> Colors = TrackFixtures::MakeRingImage(TrackContourTests::Size, 30.0, 40.0);
+	const FTrackMask TrackMask = TrackContourTests::MakeMask(Colors);
+
+	EXPECT_EQ(FTrackContour::TraceTrack(TrackMask), FTrackContour::TraceTrack(Colors, TrackContourTests::Size, TrackContourTests::Size));
+	EXPECT_EQ(FTrackContour::CreateTrack(TrackMask, 5), FTrackContour::CreateTrack(Colors, TrackContourTests::Size, TrackContourTests::Size, 5));
+}
+
+TEST(TrackContour, MaskPacksOneBitPerPixel)
+{
+	const TArray<FColor> Colors = TrackFixtures::MakeRingImage(TrackContourTests::Size, 30.0, 40.0);
+	const FTrackMask TrackMask = TrackContourTests::MakeMask(Colors);
+
+	EXPECT_LE(TrackMask.GetAllocatedSize(), TrackContourTests::Size * TrackContourTests::Size / 8 + 8);
+
+	for (uint32 Y = 0; Y < TrackContourTests::Size; Y++)
+	{
+		for (uint32 X = 0; X < TrackContourTests::Size; X++)
+		{
+			ASSERT_EQ(TrackMask.IsTrack(X, Y), FTrackMask::IsTrackValue(Colors[Y * TrackContourTests::Size + X].R));
+		}
+	}
+}
+
+TEST(TrackContour, DecimateKeepsEveryNthNode)
+{
+	TArray<FVector2D> Nodes;
+	for (int32 Index = 0; Index < 10; Index++)
+	{
+		Nodes.Emplace(Index, 0.0);
+	}
+
+	const TArray<FVector2D> Decimated = FTrackContour::DecimateTrack(Nodes, 3);
+
+	ASSERT_EQ(Decimated.Num(), 4);
+	EXPECT_EQ(Decimated[0], Nodes[0]);
+	EXPECT_EQ(Decimated[1], Nodes[3]);
+	EXPECT_EQ(Decimated[3], Nodes[9]);
+
+	EXPECT_EQ(FTrackContour::DecimateTrack(Nodes, 0), Nodes);
+}
+
+TEST(TrackContour, DirectionsWrapAround)
+{
+	EXPECT_EQ(EDirection::UpLeft + 1, EDirection::Left);
+	EXPECT_EQ(EDirection::Right + 4, EDirection::Left);
+	EXPECT_EQ(FTrackContour::AddDirectionToPosition(FVector2D(5.0, 5.0), EDirection::DownRight), FVector2D(6.0, 6.0));
+	EXPECT_EQ(FTrackContour::AddDirectionToPosition(FVector2D(5.0, 5.0), EDirection::Up), FVector2D(5.0, 4.0));
+}
+
+TEST(TrackImage, EllipseTracesAtEverySize)
+{
+	const uint32 Sizes[] = { 16, 64, 256, 512 };
+
+	for (const uint32 Size : Sizes)
+	{
+		const TArray<FColor> Colors = FTrackImage::MakeEllipse(Size, Size);
+		const TArray<FVector2D> Nodes = FTrackContour::TraceTrack(Colors, Size, Size);
+
+		EXPECT_GT(Nodes.Num(), static_cast<int32>(Size)) << Size;
+		EXPECT_LE(FVector2D::DistSquared(Nodes[0], Nodes.Last()), 2.0) << Size;
+	}
+}
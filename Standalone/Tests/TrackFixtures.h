@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Shapes shared by the tests and benchmarks
+namespace TrackFixtures
+{
+	// White Size * Size image with a dark ring of the given radii around its centre
+	inline TArray<FColor> MakeRingImage(const uint32 Size, const double InnerRadius, const double OuterRadius)
+	{
+		TArray<FColor> Colors;
+		Colors.Init(FColor(255, 255, 255), Size * Size);
+
+		const FVector2D Centre(Size * 0.5, Size * 0.5);
+		for (uint32 Y = 0; Y < Size; Y++)
+		{
+			for (uint32 X = 0; X < Size; X++)
+			{
+				const double Distance = FVector2D::Distance(FVector2D(X, Y), Centre);
+				if (Distance >= InnerRadius && Distance <= OuterRadius)
+				{
+					Colors[Y * Size + X] = FColor(0, 0, 0);
+				}
+			}
+		}
+
+		return Colors;
+	}
+
+	// Stadium shaped centre line, two straights joined by half circles, sampled every Spacing units
+	inline void MakeStadium(const double StraightLength, const double Radius, const double Spacing, TArray<FVector>& OutCentres, TArray<FVector>& OutDirections)
+	{
+		const double Perimeter = 2.0 * StraightLength + 2.0 * UE_PI * Radius;
+		const int32 SamplesNum = static_cast<int32>(Perimeter / Spacing);
+
+		OutCentres.Reset(SamplesNum);
+		OutDirections.Reset(SamplesNum);
+
+		for (int32 Index = 0; Index < SamplesNum; Index++)
+		{
+			double Distance = Perimeter * Index / SamplesNum;
+
+			if (Distance < StraightLength)
+			{
+				OutCentres.Emplace(Distance, -Radius, 0.0);
+				OutDirections.Emplace(1.0, 0.0, 0.0);
+				continue;
+			}
+			Distance -= StraightLength;
+
+			if (Distance < UE_PI * Radius)
+			{
+				const double Angle = -UE_PI * 0.5 + Distance / Radius;
+				OutCentres.Emplace(StraightLength + Radius * std::cos(Angle), Radius * std::sin(Angle), 0.0);
+				OutDirections.Emplace(-std::sin(Angle), std::cos(Angle), 0.0);
+				continue;
+			}
+			Distance -= UE_PI * Radius;
+
+			if (Distance < StraightLength)
+			{
+				OutCentres.Emplace(StraightLength - Distance, Radius, 0.0);
+				OutDirections.Emplace(-1.0, 0.0, 0.0);
+				continue;
+			}
+			Distance -= StraightLength;
+
+			const double Angle = UE_PI * 0.5 + Distance / Radius;
+			OutCentres.Emplace(Radius * std::cos(Angle), Radius * std::sin(Angle), 0.0);
+			OutDirections.Emplace(-std::sin(Angle), std::cos(Angle), 0.0);
+		}
+	}
+
+	// Rolling Width * Height grid of vertices one unit apart
+	inline TArray<FVector3f> MakeHillsGrid(const uint32 Width, const uint32 Height)
+	{
+		TArray<FVector3f> Vertices;
+		Vertices.Reserve(Width * Height);
+
+		for (uint32 Y = 0; Y < Height; Y++)
+		{
+			for (uint32 X = 0; X < Width; X++)
+			{
+				Vertices.Emplace(X, Y, 4.0f * std::sin(X * 0.1f) * std::cos(Y * 0.07f));
+			}
+		}
+
+		return Vertices;
+	}
+}
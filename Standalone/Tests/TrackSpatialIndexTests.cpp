@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TrackSpatialIndex.h"
+#include "TrackFixtures.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace TrackSpatialIndexTests
+{
+	double BruteForceDistSquared(const TArray<FVector>& Points, const FVector2D& Location)
+	{
+		double Closest = MAX_dbl;
+		for (int32 Index = 0; Index < Points.Num(); Index++)
+		{
+			const FVector2D Start(Points[Index]);
+			const FVector2D End(Points[(Index + 1) % Points.Num()]);
+			const FVector2D Segment = End - Start;
+
+			const double Alpha = FMath::Clamp(FVector2D::DotProduct(Location - Start, Segment) / Segment.SizeSquared(), 0.0, 1.0);
+			Closest = FMath::Min(Closest, FVector2D::DistSquared(Location, Start + Segment * Alpha));
+		}
+		return Closest;
+	}
+}
+
+TEST(TrackSpatialIndex, EmptyIndexFindsNothing)
+{
+	FTrackSpatialIndex Index;
+	float Alpha = 0.0f;
+
+	EXPECT_TRUE(Index.IsEmpty());
+	EXPECT_EQ(Index.FindClosestSegment(FVector2D(1.0, 2.0), Alpha), INDEX_NONE);
+}
+
+TEST(TrackSpatialIndex, MatchesBruteForceOnAndOffTheGrid)
+{
+	TArray<FVector> Centres;
+	TArray<FVector> Directions;
+	TrackFixtures::MakeStadium(20000.0, 8000.0, 250.0, Centres, Directions);
+
+	FTrackSpatialIndex Index;
+	Index.Build(Centres, 2000.0);
+	ASSERT_FALSE(Index.IsEmpty());
+
+	std::mt19937 Generator(11);
+	std::uniform_real_distribution<double> Distribution(-40000.0, 60000.0);
+
+	for (int32 Query = 0; Query < 2000; Query++)
+	{
+		const FVector2D Location(Distribution(Generator), Distribution(Generator));
+
+		float Alpha = -1.0f;
+		double DistSquared = 0.0;
+		const int32 Segment = Index.FindClosestSegment(Location, Alpha, &DistSquared);
+
+		ASSERT_NE(Segment, INDEX_NONE);
+		EXPECT_GE(Alpha, 0.0f);
+		EXPECT_LE(Alpha, 1.0f);
+		EXPECT_NEAR(std::sqrt(DistSquared), std::sqrt(TrackSpatialIndexTests::BruteForceDistSquared(Centres, Location)), 1.e-6);
+	}
+}
+
+TEST(TrackSpatialIndex, ReportsWhereAlongTheSegment)
+{
+	const TArray<FVector> Square = { FVector(0, 0, 0), FVector(100, 0, 0), FVector(100, 100, 0), FVector(0, 100, 0) };
+
+	FTrackSpatialIndex Index;
+	Index.Build(Square, 10.0);
+
+	float Alpha = 0.0f;
+	double DistSquared = 0.0;
+	EXPECT_EQ(Index.FindClosestSegment(FVector2D(25.0, -5.0), Alpha, &DistSquared), 0);
+	EXPECT_FLOAT_EQ(Alpha, 0.25f);
+	EXPECT_DOUBLE_EQ(DistSquared, 25.0);
+
+	// The closing segment from the last point back to the first
+	EXPECT_EQ(Index.FindClosestSegment(FVector2D(-3.0, 40.0), Alpha), 3);
+	EXPECT_FLOAT_EQ(Alpha, 0.6f);
+}